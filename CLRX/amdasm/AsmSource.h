@@ -33,6 +33,7 @@
 #include <memory>
 #include <CLRX/amdasm/Commons.h>
 #include <CLRX/utils/Utilities.h>
+#include <CLRX/utils/InputOutput.h>
 
 /// main namespace
 namespace CLRX
@@ -169,6 +170,43 @@ struct LineTrans
     LineNo lineNo;    ///< source code line number
 };
 
+/// filtered content of source file
+/** holds prepared lines (as returned by AsmStreamInputFilter) and their column
+ * translations. Used to cache contents of the included files. */
+class AsmFilteredSource: public RefCountable, public NonCopyableAndNonMovable
+{
+private:
+    std::vector<char> content;
+    std::vector<LineTrans> colTranslations;
+    std::vector<size_t> colTransEnds;
+public:
+    /// constructor
+    AsmFilteredSource()
+    { }
+    
+    /// adds prepared line
+    /**
+     * \param colTrans column translations of line
+     * \param lineSize line size
+     * \param line line text (without newline character)
+     */
+    void addLine(const std::vector<LineTrans>& colTrans, size_t lineSize,
+                const char* line);
+    
+    /// get content (lines separated by newline)
+    const std::vector<char>& getContent() const
+    { return content; }
+    /// get column translations of all lines
+    const std::vector<LineTrans>& getColTranslations() const
+    { return colTranslations; }
+    /// get number of lines
+    size_t getLinesNum() const
+    { return colTransEnds.size(); }
+    /// get end of column translations of line
+    size_t getColTransEnd(size_t lineIndex) const
+    { return colTransEnds[lineIndex]; }
+};
+
 /// assembler macro aegument
 struct AsmMacroArg
 {
@@ -188,6 +226,27 @@ public:
         LineNo lineNo;    ///< line number
         RefPtr<const AsmSource> source; ///< source
     };
+    /// type of segment of precompiled line
+    enum class SegmentType: cxbyte
+    {
+        TEXT = 0,   ///< text from content
+        ARG,        ///< macro argument
+        COUNT       ///< macro count ('\@')
+    };
+    /// segment of precompiled line
+    struct Segment
+    {
+        SegmentType type;   ///< segment type
+        size_t pos;     ///< position of text in content or argument index
+        size_t size;    ///< size of text
+    };
+    /// precompiled line
+    struct CompiledLine
+    {
+        size_t segmentsStart;   ///< first segment
+        size_t segmentsEnd;     ///< end of segments
+        size_t endPos;          ///< position of line end (newline) in content
+    };
 private:
     LineNo contentLineNo;
     AsmSourcePos sourcePos;
@@ -195,11 +254,19 @@ private:
     std::vector<char> content;
     std::vector<SourceTrans> sourceTranslations;
     std::vector<LineTrans> colTranslations;
+    std::vector<Segment> segments;
+    std::vector<CompiledLine> compiledLines;
+    
+    void compileContent(size_t startPos);
 public:
     /// constructor
     AsmMacro(const AsmSourcePos& pos, const Array<AsmMacroArg>& args);
     /// constructor with rlvalue for arguments
     AsmMacro(const AsmSourcePos& pos, Array<AsmMacroArg>&& args);
+    /// constructor with prepared content (used while loading macro library)
+    AsmMacro(const AsmSourcePos& pos, Array<AsmMacroArg>&& args,
+             std::vector<char>&& content, std::vector<SourceTrans>&& sourceTrans,
+             std::vector<LineTrans>&& colTrans);
     
     /// adds line to macro from source
     /**
@@ -226,6 +293,12 @@ public:
     /// get source position
     const AsmSourcePos& getSourcePos() const
     { return sourcePos; }
+    /// get precompiled line (segments for substitution in non-alternate mode)
+    const CompiledLine& getCompiledLine(size_t index) const
+    { return compiledLines[index]; }
+    /// get segment of precompiled lines
+    const Segment& getSegment(size_t index) const
+    { return segments[index]; }
     /// get number of arguments
     const size_t getArgsNum() const
     { return args.size(); }
@@ -234,6 +307,25 @@ public:
     { return args[i]; }
 };
 
+/// list of named macros (stored in precompiled macro library)
+typedef std::vector<std::pair<CString, RefPtr<const AsmMacro> > > AsmMacroList;
+
+/// write precompiled macro library
+/** writes macros with their arguments and sources of their content. Sources
+ * shared by many macros are stored only once.
+ * \param os output stream
+ * \param macros list of macros
+ */
+extern void writeAsmMacroLibrary(std::ostream& os, const AsmMacroList& macros);
+
+/// read precompiled macro library
+/** throws Exception if library is corrupted.
+ * \param size size of library data
+ * \param data library data
+ * \return list of macros
+ */
+extern AsmMacroList readAsmMacroLibrary(size_t size, const cxbyte* data);
+
 /// assembler repeat
 class AsmRepeat: public NonCopyableAndNonMovable
 {
@@ -382,10 +474,20 @@ public:
     { return type; }
 };
 
+/// line scanning implementation used by AsmStreamInputFilter
+enum class AsmLineScanType: cxbyte
+{
+    AUTO = 0,   ///< fastest implementation supported by CPU (checked at runtime)
+    SCALAR,     ///< portable byte-at-a-time scanning
+    SSE2,       ///< SSE2 scanning (16 bytes at time)
+    AVX2        ///< AVX2 scanning (32 bytes at time)
+};
+
 /// assembler input layout filter
 /** filters input from comments and join splitted lines by backslash.
  * readLine returns prepared line which have only space (' ') and
- * non-space characters. */
+ * non-space characters. Regular files are memory mapped and lines which
+ * do not need filtering are returned directly from mapped file. */
 class AsmStreamInputFilter: public AsmInputFilter
 {
 private:
@@ -400,9 +502,24 @@ private:
     
     bool managed;
     std::istream* stream;
+    RefPtr<const MappedFile> mappedFile;
+    const char* mappedData;
+    size_t mappedSize;
+    size_t mappedPos;
     LineMode mode;
     size_t stmtPos;
+    size_t (*lineScanner)(const char* str, size_t size);
+    bool messagesPrinted;
+    RefPtr<const AsmFilteredSource> cachedSource;
+    size_t cachedLineIndex;
+    RefPtr<AsmFilteredSource> recordedSource;
+    uint64_t recordedTimestamp;
     
+    void openFile(const CString& filename);
+    size_t readInput(char* dest, size_t maxSize);
+    const char* readMappedLine(size_t& lineSize);
+    const char* readFilteredLine(Assembler& assembler, size_t& lineSize);
+    const char* readCachedLine(size_t& lineSize);
 public:
     /// constructor with input stream and their filename
     explicit AsmStreamInputFilter(std::istream& is, const CString& filename = "");
@@ -413,10 +530,25 @@ public:
              const CString& filename = "");
     /// constructor with source position and input filename
     AsmStreamInputFilter(const AsmSourcePos& pos, const CString& filename);
+    /// constructor with source position and cached content of file
+    AsmStreamInputFilter(const AsmSourcePos& pos,
+            RefPtr<const AsmFilteredSource> cachedSource, const CString& filename);
     /// destructor
     ~AsmStreamInputFilter();
     
     const char* readLine(Assembler& assembler, size_t& lineSize);
+    
+    /// set line scanning implementation (throws Exception if not supported)
+    void setLineScanType(AsmLineScanType scanType);
+    /// returns true if line scanning implementation is supported by this machine
+    static bool isLineScanTypeSupported(AsmLineScanType scanType);
+    
+    /// record prepared lines to cache them (for file with specified timestamp)
+    void recordContent(uint64_t timestamp);
+    
+    /// returns true if input is read from memory mapped file
+    bool isMappedFile() const
+    { return mappedFile; }
 };
 
 /// assembler macro input filter (for macro filtering)
@@ -431,6 +563,7 @@ private:
     RefPtr<const AsmMacro> macro;  ///< input macro
     MacroArgMap argMap;  ///< input macro argument map
     MacroLocalMap localMap; ///< local defines for macro
+    std::vector<const CString*> argValues; ///< argument values in macro order
     
     uint64_t macroCount;
     LineNo contentLineNo;
@@ -438,6 +571,9 @@ private:
     const LineTrans* curColTrans;
     size_t realLinePos; ///< real line size
     bool alternateMacro;
+    
+    void initialize(const AsmSourcePos& pos);
+    const char* readCompiledLine(size_t& lineSize);
 public:
     /// constructor with input macro, source position and arguments map
     AsmMacroInputFilter(RefPtr<const AsmMacro> macro, const AsmSourcePos& pos,
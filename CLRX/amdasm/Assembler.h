@@ -31,7 +31,12 @@
 #include <iostream>
 #include <vector>
 #include <utility>
+#include <algorithm>
 #include <stack>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <initializer_list>
 #include <unordered_set>
 #include <unordered_map>
 #include <CLRX/utils/Utilities.h>
@@ -49,8 +54,10 @@ enum: Flags
     ASM_FORCE_ADD_SYMBOLS = 2,
     ASM_ALTMACRO = 4,
     ASM_BUGGYFPLIT = 8, // buggy handling of fpliterals (including fp constants)
+    ASM_STATS = 16,     ///< collect statistics (phase timings and counters)
+    ASM_DEDUP = 32,     ///< store identical kernel codes once in binary (if possible)
     ASM_TESTRUN = (1U<<31), ///< only for running tests
-    ASM_ALL = FLAGS_ALL&~(ASM_TESTRUN|ASM_BUGGYFPLIT)  ///< all flags
+    ASM_ALL = FLAGS_ALL&~(ASM_TESTRUN|ASM_BUGGYFPLIT|ASM_STATS|ASM_DEDUP)  ///< all flags
 };
 
 enum: cxbyte {
@@ -227,6 +234,93 @@ union AsmExprArg;
 
 class AsmExpression;
 
+/// statistics of assembler arena allocator
+struct AsmArenaStats
+{
+    size_t blocksNum;       ///< number of allocated blocks
+    size_t blocksSize;      ///< total size of allocated blocks
+    size_t allocsNum;       ///< number of allocations
+    size_t reusedAllocsNum; ///< number of allocations that reused freed chunks
+    size_t heapAllocsNum;   ///< number of big allocations passed to heap
+    size_t usedSize;        ///< size of currently allocated memory
+    size_t maxUsedSize;     ///< peak size of allocated memory
+};
+
+/// assembler arena allocator
+/** allocates small chunks from big blocks. Freed chunks are reused by later allocations
+ * of same size class, and blocks are released at once while destroying arena.
+ * Big chunks are allocated directly from heap */
+class AsmArena: public NonCopyableAndNonMovable
+{
+public:
+    /// alignment and granularity of chunks
+    static const size_t chunkAlign = 16;
+    /// maximal size of chunk that is held in blocks
+    static const size_t maxChunkSize = 1024;
+private:
+    static const size_t blockSize = 65536;
+    
+    struct FreeChunk
+    { FreeChunk* next; };
+    
+    std::vector<std::unique_ptr<cxbyte[]> > blocks;
+    cxbyte* blockPos;
+    cxbyte* blockEnd;
+    FreeChunk* freeChunks[maxChunkSize/chunkAlign];
+    AsmArenaStats stats;
+    
+    void* allocateFromNewBlock(size_t size);
+public:
+    /// constructor
+    AsmArena();
+    
+    /// allocate chunk of memory
+    void* allocate(size_t size)
+    {
+        size = (size + chunkAlign-1) & ~(chunkAlign-1);
+        if (size > maxChunkSize || size == 0)
+            return allocateBig(size);
+        stats.allocsNum++;
+        stats.usedSize += size;
+        stats.maxUsedSize = std::max(stats.maxUsedSize, stats.usedSize);
+        FreeChunk*& freeChunk = freeChunks[(size>>4)-1];
+        if (freeChunk != nullptr)
+        {   // reuse freed chunk
+            void* ptr = freeChunk;
+            freeChunk = freeChunk->next;
+            stats.reusedAllocsNum++;
+            return ptr;
+        }
+        if (size > size_t(blockEnd-blockPos))
+            return allocateFromNewBlock(size);
+        void* ptr = blockPos;
+        blockPos += size;
+        return ptr;
+    }
+    /// free chunk of memory (size must be same as size passed to allocate)
+    void deallocate(void* ptr, size_t size)
+    {
+        size = (size + chunkAlign-1) & ~(chunkAlign-1);
+        if (size > maxChunkSize || size == 0)
+        {
+            deallocateBig(ptr, size);
+            return;
+        }
+        stats.usedSize -= size;
+        FreeChunk* freeChunk = static_cast<FreeChunk*>(ptr);
+        freeChunk->next = freeChunks[(size>>4)-1];
+        freeChunks[(size>>4)-1] = freeChunk;
+    }
+    /// allocate big chunk from heap
+    void* allocateBig(size_t size);
+    /// free big chunk
+    void deallocateBig(void* ptr, size_t size);
+    
+    /// get statistics
+    const AsmArenaStats& getStats() const
+    { return stats; }
+};
+
 /// assembler symbol occurrence in expression
 struct AsmExprSymbolOccurrence
 {
@@ -239,6 +333,91 @@ struct AsmExprSymbolOccurrence
     { return expression==b.expression && opIndex==b.opIndex && argIndex==b.argIndex; }
 };
 
+/// list of symbol occurrences in expressions
+/** elements are allocated in arena of expression that was added first
+ * (or in heap if that expression is not in arena). Arena must live longer than list */
+class AsmSymbolOccurrences
+{
+private:
+    AsmArena* arena;
+    AsmExprSymbolOccurrence* elems;
+    size_t elemsNum;
+    size_t capacity;
+    
+    void reserve(size_t newCapacity);
+    void freeElems();
+public:
+    /// empty constructor
+    AsmSymbolOccurrences() : arena(nullptr), elems(nullptr), elemsNum(0), capacity(0)
+    { }
+    /// copy constructor (elements are allocated in same arena)
+    AsmSymbolOccurrences(const AsmSymbolOccurrences& b);
+    /// move constructor
+    AsmSymbolOccurrences(AsmSymbolOccurrences&& b) noexcept
+            : arena(b.arena), elems(b.elems), elemsNum(b.elemsNum), capacity(b.capacity)
+    {
+        b.elems = nullptr;
+        b.elemsNum = b.capacity = 0;
+    }
+    /// destructor
+    ~AsmSymbolOccurrences()
+    { freeElems(); }
+    
+    /// copy assignment
+    AsmSymbolOccurrences& operator=(const AsmSymbolOccurrences& b);
+    /// move assignment
+    AsmSymbolOccurrences& operator=(AsmSymbolOccurrences&& b) noexcept;
+    
+    /// return true if list is empty
+    bool empty() const
+    { return elemsNum==0; }
+    /// get number of occurrences
+    size_t size() const
+    { return elemsNum; }
+    /// get occurrence
+    AsmExprSymbolOccurrence& operator[](size_t i)
+    { return elems[i]; }
+    /// get occurrence
+    const AsmExprSymbolOccurrence& operator[](size_t i) const
+    { return elems[i]; }
+    /// get begin iterator
+    AsmExprSymbolOccurrence* begin()
+    { return elems; }
+    /// get begin iterator
+    const AsmExprSymbolOccurrence* begin() const
+    { return elems; }
+    /// get end iterator
+    AsmExprSymbolOccurrence* end()
+    { return elems+elemsNum; }
+    /// get end iterator
+    const AsmExprSymbolOccurrence* end() const
+    { return elems+elemsNum; }
+    
+    /// add occurrence (exprArena is used if list has not been allocated yet)
+    void push_back(AsmArena* exprArena, const AsmExprSymbolOccurrence& occur)
+    {
+        if (elemsNum == capacity)
+        {
+            if (elems == nullptr)
+                arena = exprArena;
+            reserve(capacity!=0 ? capacity<<1 : 2);
+        }
+        elems[elemsNum++] = occur;
+    }
+    /// insert occurrences before first occurrence
+    void insertFront(AsmArena* exprArena, const AsmExprSymbolOccurrence* first,
+                const AsmExprSymbolOccurrence* last);
+    /// shrink list to given size
+    void resize(size_t newSize)
+    { elemsNum = std::min(elemsNum, newSize); }
+    /// clear list and free its elements
+    void clear()
+    {
+        freeElems();
+        elemsNum = capacity = 0;
+    }
+};
+
 struct AsmRegVar;
 
 /// assembler symbol structure
@@ -262,32 +441,41 @@ struct AsmSymbol
     };
     
     /** list of occurrences in expressions */
-    std::vector<AsmExprSymbolOccurrence> occurrencesInExprs;
+    AsmSymbolOccurrences occurrencesInExprs;
+    cxuint firstFixupSectionId; ///< section of first pending fixup
+    cxuint lastFixupSectionId;  ///< section of last pending fixup
+    size_t firstFixup;  ///< index of first pending fixup (SIZE_MAX if no fixups)
+    size_t lastFixup;   ///< index of last pending fixup (SIZE_MAX if no fixups)
     
     /// empty constructor
     explicit AsmSymbol(bool _onceDefined = false) :
             refCount(1), sectionId(ASMSECT_ABS), info(0), other(0), hasValue(false),
             onceDefined(_onceDefined), resolving(false), base(false), snapshot(false),
-            regRange(false), value(0), size(0), expression(nullptr)
+            regRange(false), value(0), size(0), expression(nullptr),
+            firstFixupSectionId(0), lastFixupSectionId(0),
+            firstFixup(SIZE_MAX), lastFixup(SIZE_MAX)
     { }
     /// constructor with expression
     explicit AsmSymbol(AsmExpression* expr, bool _onceDefined = false, bool _base = false) :
             refCount(1), sectionId(ASMSECT_ABS), info(0), other(0), hasValue(false),
             onceDefined(_onceDefined), resolving(false), base(_base),
-            snapshot(false), regRange(false), value(0), size(0), expression(expr)
+            snapshot(false), regRange(false), value(0), size(0), expression(expr),
+            firstFixupSectionId(0), lastFixupSectionId(0),
+            firstFixup(SIZE_MAX), lastFixup(SIZE_MAX)
     { }
     /// constructor with value and section id
     explicit AsmSymbol(cxuint _sectionId, uint64_t _value, bool _onceDefined = false) :
             refCount(1), sectionId(_sectionId), info(0), other(0), hasValue(true),
             onceDefined(_onceDefined), resolving(false), base(false), snapshot(false),
-            regRange(false), value(_value), size(0), expression(nullptr)
+            regRange(false), value(_value), size(0), expression(nullptr),
+            firstFixupSectionId(0), lastFixupSectionId(0),
+            firstFixup(SIZE_MAX), lastFixup(SIZE_MAX)
     { }
     /// destructor
     ~AsmSymbol();
     
     /// adds occurrence in expression
-    void addOccurrenceInExpr(AsmExpression* expr, size_t argIndex, size_t opIndex)
-    { occurrencesInExprs.push_back({expr, argIndex, opIndex}); }
+    void addOccurrenceInExpr(AsmExpression* expr, size_t argIndex, size_t opIndex);
     /// remove occurrence in expression
     void removeOccurrenceInExpr(AsmExpression* expr, size_t argIndex, size_t opIndex);
     /// clear list of occurrences in expression
@@ -299,10 +487,183 @@ struct AsmSymbol
     { return hasValue || expression!=nullptr; }
 };
 
-/// assembler symbol map
-typedef std::unordered_map<CString, AsmSymbol> AsmSymbolMap;
 /// assembler symbol entry
-typedef AsmSymbolMap::value_type AsmSymbolEntry;
+typedef std::pair<const CString, AsmSymbol> AsmSymbolEntry;
+
+/// assembler symbol map
+/** symbol table that holds precomputed hashes of names, thus symbols can be found
+ * by name given as part of string (without creating new string).
+ * Entries are stored in stable memory (pointers are valid until erasure)
+ * and are iterated in order of insertion. Lookup interface (find, count, at)
+ * is same as in std::unordered_map that was used by older versions */
+class AsmSymbolMap: public NonCopyableAndNonMovable
+{
+public:
+    typedef CString key_type;   ///< key type
+    typedef AsmSymbol mapped_type;  ///< mapped type
+    typedef AsmSymbolEntry value_type;  ///< value type
+    typedef size_t size_type;   ///< size type
+    
+    /// iterator of symbol map
+    template<typename T>
+    class Iterator
+    {
+    private:
+        friend class AsmSymbolMap;
+        friend class Iterator<AsmSymbolEntry>;
+        AsmSymbolEntry* const* ptr;
+        AsmSymbolEntry* const* ptrEnd;
+        
+        Iterator(AsmSymbolEntry* const* _ptr, AsmSymbolEntry* const* _ptrEnd)
+                : ptr(_ptr), ptrEnd(_ptrEnd)
+        { skipErased(); }
+        void skipErased()
+        { while (ptr != ptrEnd && *ptr == nullptr) ptr++; }
+    public:
+        /// empty constructor
+        Iterator() : ptr(nullptr), ptrEnd(nullptr)
+        { }
+        /// conversion to constant iterator
+        operator Iterator<const AsmSymbolEntry>() const
+        { return Iterator<const AsmSymbolEntry>(ptr, ptrEnd); }
+        
+        /// dereference
+        T& operator*() const
+        { return **ptr; }
+        /// member access
+        T* operator->() const
+        { return *ptr; }
+        /// pre-increment
+        Iterator& operator++()
+        {
+            ptr++;
+            skipErased();
+            return *this;
+        }
+        /// post-increment
+        Iterator operator++(int)
+        {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+        /// equality
+        bool operator==(const Iterator& it) const
+        { return ptr == it.ptr; }
+        /// inequality
+        bool operator!=(const Iterator& it) const
+        { return ptr != it.ptr; }
+    };
+    
+    typedef Iterator<AsmSymbolEntry> iterator;  ///< iterator
+    typedef Iterator<const AsmSymbolEntry> const_iterator;  ///< constant iterator
+private:
+    struct Slot
+    {
+        size_t hash;
+        size_t index;   ///< index of entry (SIZE_MAX if slot is empty)
+    };
+    typedef std::aligned_storage<sizeof(AsmSymbolEntry),
+                alignof(AsmSymbolEntry)>::type EntryStorage;
+    static const size_t entryChunkSize = 256;
+    
+    std::vector<AsmSymbolEntry*> entries;   // in insertion order (null if erased)
+    size_t entriesNum;
+    std::unique_ptr<Slot[]> slots;
+    size_t slotsMask;
+    std::vector<std::unique_ptr<EntryStorage[]> > entryChunks;
+    size_t lastChunkUsed;
+    std::vector<AsmSymbolEntry*> freeEntries;
+    
+    size_t findSlot(const char* name, size_t nameLen, size_t hash) const;
+    void rehash(size_t newSlotsNum);
+    AsmSymbolEntry* allocateEntry();
+    std::pair<iterator, bool> insertNew(size_t hash, CString&& name,
+                const AsmSymbol& symbol);
+public:
+    /// constructor
+    AsmSymbolMap();
+    /// constructor with initial symbols
+    AsmSymbolMap(std::initializer_list<std::pair<CString, AsmSymbol> > list);
+    /// destructor
+    ~AsmSymbolMap();
+    
+    /// compute hash of name
+    /** FNV-1a hash with final mixing (from MurmurHash3), because slot index is taken
+     * from lowest bits of hash and these bits must depend on all characters */
+    static size_t hashName(const char* name, size_t nameLen)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < nameLen; i++)
+            hash = (hash ^ cxbyte(name[i])) * 1099511628211ULL;
+        hash ^= hash>>33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash>>33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash>>33;
+        return size_t(hash);
+    }
+    
+    /// get number of symbols
+    size_t size() const
+    { return entriesNum; }
+    /// return true if empty
+    bool empty() const
+    { return entriesNum == 0; }
+    
+    /// begin iterator
+    iterator begin()
+    { return iterator(entries.data(), entries.data()+entries.size()); }
+    /// end iterator
+    iterator end()
+    { return iterator(entries.data()+entries.size(), entries.data()+entries.size()); }
+    /// begin iterator
+    const_iterator begin() const
+    { return const_iterator(entries.data(), entries.data()+entries.size()); }
+    /// end iterator
+    const_iterator end() const
+    { return const_iterator(entries.data()+entries.size(),
+                entries.data()+entries.size()); }
+    /// begin iterator
+    const_iterator cbegin() const
+    { return begin(); }
+    /// end iterator
+    const_iterator cend() const
+    { return end(); }
+    
+    /// find symbol by name
+    iterator find(const char* name, size_t nameLen);
+    /// find symbol by name
+    const_iterator find(const char* name, size_t nameLen) const
+    { return const_cast<AsmSymbolMap*>(this)->find(name, nameLen); }
+    /// find symbol by name
+    iterator find(const CString& name)
+    { return find(name.c_str(), name.size()); }
+    /// find symbol by name
+    const_iterator find(const CString& name) const
+    { return find(name.c_str(), name.size()); }
+    /// get number of symbols with name (0 or 1)
+    size_t count(const CString& name) const
+    { return find(name) != end() ? 1 : 0; }
+    /// get symbol by name (throws std::out_of_range if not found)
+    AsmSymbol& at(const CString& name);
+    /// get symbol by name (throws std::out_of_range if not found)
+    const AsmSymbol& at(const CString& name) const
+    { return const_cast<AsmSymbolMap*>(this)->at(name); }
+    
+    /// insert symbol if not exists
+    /**
+     * \return iterator to entry and true if symbol has been inserted
+     */
+    std::pair<iterator, bool> insert(const std::pair<CString, AsmSymbol>& entry);
+    /// insert empty symbol if not exists
+    /**
+     * \return iterator to entry and true if symbol has been inserted
+     */
+    std::pair<iterator, bool> insert(const char* name, size_t nameLen);
+    /// erase symbol
+    void erase(iterator it);
+};
 
 /// target for assembler expression
 struct AsmExprTarget
@@ -359,10 +720,83 @@ struct AsmRelocation
     uint64_t addend;    ///< addend
 };
 
+/// assembler fixup (pending target in form 'symbol' or 'symbol+constant')
+/** fixups are lightweight replacement of expressions for simple targets
+ * (for example jumps to forward labels). They are held by section of destination,
+ * chained in symbol and are resolved when symbol will be defined */
+struct AsmFixup
+{
+    AsmSourcePos sourcePos; ///< source position of target
+    AsmSymbolEntry* symbol; ///< symbol entry
+    uint64_t addend;    ///< addend (constant added to value of symbol)
+    AsmExprTargetType type; ///< type of target
+    cxuint sectionId;   ///< section id of destination
+    size_t offset;      ///< offset of destination
+    cxuint nextSectionId;   ///< section of next fixup of symbol
+    size_t nextFixup;   ///< index of next fixup of symbol (SIZE_MAX if last)
+};
+
+/// assembler statistics (collected only if ASM_STATS flag is enabled)
+struct AsmStats
+{
+    double readingTime;     ///< time of reading and filtering source lines (in seconds)
+    double parsingTime;     ///< time of parsing statements (labels, pseudo-ops)
+    double macroTime;       ///< time of macro substitutions and repetitions
+    double encodingTime;    ///< time of encoding instructions
+    double resolvingTime;   ///< time of resolving symbols after assembling
+    double preparingTime;   ///< time of preparing output binary
+    double writingTime;     ///< time of writing output binary
+    uint64_t linesNum;      ///< number of read lines (including expanded lines)
+    uint64_t macroSubstsNum;    ///< number of macro substitutions
+    uint64_t repetitionsNum;    ///< number of repetitions
+    uint64_t expressionsNum;    ///< number of parsed expressions
+    uint64_t fixupsNum;     ///< number of fixups (simple targets without expressions)
+    size_t symbolsNum;      ///< number of symbols
+    uint64_t sectionsSize;  ///< total size of sections
+    uint64_t dedupSavedSize;    ///< bytes saved by deduplication of kernel codes
+};
+
+/// read-only view of operators of expression
+/** provides interface of Array (size, indexing and iterators) and conversion to
+ * Array, thus code that bound reference to Array returned by older
+ * AsmExpression::getOps still compiles (it gets copy of operators) */
+class AsmExprOps
+{
+private:
+    const AsmExprOp* ops;
+    size_t opsNum;
+public:
+    /// constructor
+    AsmExprOps(const AsmExprOp* _ops, size_t _opsNum) : ops(_ops), opsNum(_opsNum)
+    { }
+    /// get number of operators
+    size_t size() const
+    { return opsNum; }
+    /// return true if empty
+    bool empty() const
+    { return opsNum==0; }
+    /// get operator
+    const AsmExprOp& operator[](size_t i) const
+    { return ops[i]; }
+    /// get data
+    const AsmExprOp* data() const
+    { return ops; }
+    /// get begin iterator
+    const AsmExprOp* begin() const
+    { return ops; }
+    /// get end iterator
+    const AsmExprOp* end() const
+    { return ops+opsNum; }
+    /// copy operators to Array
+    operator Array<AsmExprOp>() const
+    { return Array<AsmExprOp>(ops, ops+opsNum); }
+};
+
 /// assembler expression class
 class AsmExpression: public NonCopyableAndNonMovable
 {
 private:
+    friend class Assembler;
     class TempSymbolSnapshotMap;
     
     AsmExprTarget target;
@@ -370,9 +804,20 @@ private:
     size_t symOccursNum;
     bool relativeSymOccurs;
     bool baseExpr;
-    Array<AsmExprOp> ops;
-    std::unique_ptr<LineCol[]> messagePositions;    ///< for every potential message
-    std::unique_ptr<AsmExprArg[]> args;
+    AsmArena* arena;    ///< arena that holds arrays (null if they are in heap)
+    size_t opsNum;
+    size_t arraysSize;
+    AsmExprOp* ops;
+    LineCol* messagePositions;    ///< for every potential message
+    AsmExprArg* args;
+    
+    void allocateArrays(size_t opsNum, size_t opPosNum, size_t argsNum);
+    void freeArrays();
+    
+    // get index of message position for operator
+    size_t getMessagePosIndex(size_t opIndex) const;
+    // evaluate simple relative expression without stack
+    bool evaluateSimpleRelative(uint64_t& value, cxuint& sectionId) const;
     
     AsmSourcePos getSourcePos(size_t msgPosIndex) const
     {
@@ -386,7 +831,7 @@ private:
                TempSymbolSnapshotMap* snapshotMap, const AsmSymbolEntry& symEntry,
                AsmSymbolEntry*& outSymEntry, const AsmSourcePos* topParentSourcePos);
     
-    AsmExpression();
+    explicit AsmExpression(AsmArena* arena = nullptr);
     void setParams(size_t symOccursNum, bool relativeSymOccurs,
             size_t _opsNum, const AsmExprOp* ops, size_t opPosNum, const LineCol* opPos,
             size_t argsNum, const AsmExprArg* args, bool baseExpr = false);
@@ -402,9 +847,18 @@ public:
     /// destructor
     ~AsmExpression();
     
+    /// allocate expression (from heap)
+    static void* operator new(size_t size);
+    /// allocate expression from arena
+    static void* operator new(size_t size, AsmArena& arena);
+    /// free expression (from heap or from arena)
+    static void operator delete(void* ptr, size_t size);
+    /// free expression if constructor failed
+    static void operator delete(void* ptr, AsmArena& arena);
+    
     /// return true if expression is empty
     bool isEmpty() const
-    { return ops.empty(); }
+    { return opsNum==0; }
 
     /// helper to create symbol snapshot. Creates initial expression for symbol snapshot
     AsmExpression* createForSnapshot(const AsmSourcePos* exprSourcePos) const;
@@ -421,7 +875,7 @@ public:
      * \return true if evaluated
      */
     bool evaluate(Assembler& assembler, uint64_t& value, cxuint& sectionId) const
-    { return evaluate(assembler, 0, ops.size(), value, sectionId); }
+    { return evaluate(assembler, 0, opsNum, value, sectionId); }
     
     /// try to evaluate expression
     /**
@@ -482,15 +936,23 @@ public:
     /// substitute occurrence in expression by value
     void substituteOccurrence(AsmExprSymbolOccurrence occurrence, uint64_t value,
                   cxuint sectionId = ASMSECT_ABS);
+    /// get number of operators
+    size_t getOpsNum() const
+    { return opsNum; }
     /// get operators list
-    const Array<AsmExprOp>& getOps() const
-    { return ops; }
+    /** returns view instead of reference to Array, because operators are held
+     * in single chunk with arguments (in arena) */
+    AsmExprOps getOps() const
+    { return AsmExprOps(ops, opsNum); }
     /// get argument list
     const AsmExprArg* getArgs() const
-    { return args.get(); }
+    { return args; }
     /// get source position
     const AsmSourcePos& getSourcePos() const
     { return sourcePos; }
+    /// get arena that holds expression (null if expression is in heap)
+    AsmArena* getArena() const
+    { return arena; }
     
     size_t toTop(size_t opIndex) const;
     
@@ -505,6 +967,10 @@ inline AsmSymbol::~AsmSymbol()
     clearOccurrencesInExpr();
 }
 
+inline void AsmSymbol::addOccurrenceInExpr(AsmExpression* expr, size_t argIndex,
+                    size_t opIndex)
+{ occurrencesInExprs.push_back(expr->getArena(), {expr, argIndex, opIndex}); }
+
 /// assembler expression argument
 union AsmExprArg
 {
@@ -592,7 +1058,24 @@ struct AsmVarUsage
     const AsmRegVar* regVar;    // if null, then usage of called register
 };
 
+/// fill run in section (data that is not stored in content)
+/** run is repeated pattern or reference to region of mapped file */
+struct AsmSectionFill
+{
+    uint64_t offset;    ///< offset in section
+    size_t contentPos;  ///< position in content before that run is placed
+    uint64_t size;      ///< size of run in bytes
+    cxbyte patternSize; ///< size of pattern (1-8 bytes)
+    cxbyte pattern[8];  ///< repeated pattern
+    const cxbyte* data; ///< data of run (if not null, used instead pattern)
+    RefPtr<const MappedFile> mappedFile;    ///< mapped file that holds data
+};
+
 /// assembler section
+/** content of section can be chunked: big fill runs (for example from '.skip')
+ * and mapped file regions (from '.incbin') are held as descriptors and they are
+ * expanded by flatten() or while writing binary.
+ * Content holds only remaining bytes of section */
 struct AsmSection
 {
     const char* name;       ///< section name
@@ -601,7 +1084,9 @@ struct AsmSection
     Flags flags;   ///< section flags
     uint64_t alignment; ///< section alignment
     uint64_t size;  ///< section size
-    std::vector<cxbyte> content;    ///< content of section
+    std::vector<cxbyte> content;    ///< content of section (without fill runs)
+    std::vector<AsmSectionFill> fills;  ///< fill runs (ordered by offset)
+    std::vector<AsmFixup> fixups;   ///< fixups with destination in this section
     
     /// register variables
     std::unordered_map<CString, AsmRegVar> regVars;
@@ -617,7 +1102,32 @@ struct AsmSection
     
     /// get section's size
     size_t getSize() const
-    { return ((flags&ASMSECT_WRITEABLE) != 0) ? content.size() : size; }
+    {
+        if ((flags&ASMSECT_WRITEABLE) == 0)
+            return size;
+        if (fills.empty())
+            return content.size();
+        const AsmSectionFill& fill = fills.back();
+        return fill.offset + fill.size + content.size() - fill.contentPos;
+    }
+    
+    /// add fill run at end of section
+    void addFill(uint64_t size, cxuint patternSize, const cxbyte* pattern);
+    /// add region of mapped file at end of section
+    void addMappedData(const RefPtr<const MappedFile>& mappedFile, size_t offset,
+                size_t size);
+    /// get pointer to data at offset (data must not be in fill run)
+    cxbyte* getData(size_t offset);
+    /// expand fill runs into content
+    void flatten();
+    /// get contiguous data of section
+    /** if whole section is single mapped region then returns pointer to mapped file,
+     * otherwise flattens section. returns null if section is empty */
+    const cxbyte* getFlatData();
+    /// write content with expanded fill runs
+    void writeContent(std::ostream& os) const;
+    /// write content with expanded fill runs to buffer (of size of section)
+    void writeContent(cxbyte* out) const;
 };
 
 /// type of clause
@@ -674,6 +1184,7 @@ private:
     friend struct AsmAmdCL2PseudoOps; // INTERNAL LOGIC
     friend struct GCNAsmUtils; // INTERNAL LOGIC
 
+    AsmArena exprArena; // must be destroyed after all expressions
     Array<CString> filenames;
     BinaryFormat format;
     GPUDeviceType deviceType;
@@ -684,14 +1195,32 @@ private:
     ISAAssembler* isaAssembler;
     std::vector<DefSym> defSyms;
     std::vector<CString> includeDirs;
+    // include name -> found file path
+    std::unordered_map<CString, CString> includeResolutions;
+    // file path -> cached filtered content
+    std::unordered_map<CString, RefPtr<const AsmFilteredSource> > includedSources;
     std::vector<AsmSection> sections;
+    // sections with expanded fill runs (made by getSections if they have fill runs)
+    mutable std::mutex flatSectionsMutex;
+    mutable bool flatSectionsReady;
+    mutable std::vector<AsmSection> flatSections;
     AsmSymbolMap symbolMap;
+    // symbols of local labels ('b' and 'f') indexed by label number
+    struct LocalLabel
+    {
+        AsmSymbolEntry* prev;
+        AsmSymbolEntry* next;
+    };
+    std::vector<LocalLabel> localLabels;
     std::unordered_set<AsmSymbolEntry*> symbolSnapshots;
     std::vector<AsmRelocation> relocations;
+    size_t pendingFixupsNum;    // number of unresolved fixups
     MacroMap macroMap;
     KernelMap kernelMap;
     std::vector<AsmKernel> kernels;
     Flags flags;
+    mutable AsmStats stats;
+    cxuint binGenThreadsNum;
     uint64_t macroCount;
     uint64_t localCount; // macro's local count
     bool alternateMacro;
@@ -766,9 +1295,24 @@ private:
     ParseState parseSymbol(const char*& linePtr, AsmSymbolEntry*& entry,
                    bool localLabel = true, bool dontCreateSymbol = false);
     bool skipSymbol(const char*& linePtr);
+    /// get symbol of local label (digits without suffix), creates it if needed
+    AsmSymbolEntry* getLocalLabelSymbol(const char* digits, size_t digitsNum,
+                bool forward);
     
     bool setSymbol(AsmSymbolEntry& symEntry, uint64_t value, cxuint sectionId);
     
+    /// parse target in form 'symbol' or 'symbol+constant' that can be fixup
+    /** if target is not simple or symbol is defined then linePtr is not changed
+     * and false is returned */
+    bool parseFixupTarget(const char*& linePtr, AsmFixup& fixup);
+    /// add fixup to pending fixups of its symbol
+    void addFixup(const AsmFixup& fixup, AsmExprTargetType type, cxuint sectionId,
+                  size_t offset);
+    /// resolve pending fixups of defined symbol
+    bool resolveFixups(AsmSymbolEntry& symEntry);
+    /// convert pending fixups of symbol into expressions
+    void makeFixupExprs(AsmSymbolEntry& symEntry);
+    
     bool assignSymbol(const CString& symbolName, const char* symbolPlace,
                   const char* linePtr, bool reassign = true, bool baseExpr = false);
     
@@ -797,6 +1341,8 @@ private:
     
     /// returns false when includeLevel is too deep, throw error if failed a file opening
     bool includeFile(const char* pseudoOpPlace, const std::string& filename);
+    void addIncludeCache(const CString& filename, uint64_t timestamp,
+                RefPtr<const AsmFilteredSource> source);
     
     ParseState makeMacroSubstitution(const char* string);
     
@@ -810,6 +1356,15 @@ private:
     }
 
     cxbyte* reserveData(size_t size, cxbyte fillValue = 0);
+    /// put data filled by pattern (big fills are held as fill runs)
+    void fillData(uint64_t size, cxuint patternSize, const cxbyte* pattern);
+    /// put region of mapped file (big regions are not copied into content)
+    void putMappedData(const RefPtr<const MappedFile>& mappedFile, size_t offset,
+                size_t size);
+    /// throw exception if any file that holds mapped data has been changed
+    void checkMappedFiles() const;
+    /// returns true if file is one of files that hold mapped data
+    bool isMappedFile(const char* filename) const;
     
     void goToMain(const char* pseudoOpPlace);
     void goToKernel(const char* pseudoOpPlace, const char* kernelName);
@@ -883,12 +1438,26 @@ public:
     bool assemble();
     
     /// write binary to file
+    /** if output file is one of files included by '.incbin', then whole binary is
+     * generated before opening output. raw code is written directly from section
+     * content and mapped regions by gathered writes (writev) if system has them.
+     * throws exception if any file included by '.incbin' has been changed while
+     * assembling or if writing failed */
     void writeBinary(const char* filename) const;
     /// write binary to stream
+    /** throws exception if any file included by '.incbin' has been changed while
+     * assembling or if writing failed */
     void writeBinary(std::ostream& outStream) const;
     /// write binary to array
+    /** throws exception if any file included by '.incbin' has been changed while
+     * assembling */
     void writeBinary(Array<cxbyte>& array) const;
     
+    /// write defined macros as precompiled macro library to file
+    void writeMacroLibrary(const char* filename) const;
+    /// write defined macros as precompiled macro library to stream
+    void writeMacroLibrary(std::ostream& outStream) const;
+    
     /// get AMD driver version
     uint32_t getDriverVersion() const
     { return driverVersion; }
@@ -920,17 +1489,41 @@ public:
     /// set flags
     void setFlags(Flags flags)
     { this->flags = flags; }
+    /// get number of threads that generate kernel's binaries (0 or 1 - no threads)
+    cxuint getBinGenThreadsNum() const
+    { return binGenThreadsNum; }
+    /// set number of threads that generate kernel's binaries while writing output
+    /** used by AMD and AMDCL2 binary formats. output is same as without threads */
+    void setBinGenThreadsNum(cxuint threadsNum)
+    { binGenThreadsNum = threadsNum; }
     /// get include directory list
     const std::vector<CString>& getIncludeDirs() const
     { return includeDirs; }
     /// adds include directory
     void addIncludeDir(const CString& includeDir);
+    /// clear process-wide cache of included files (filtered contents)
+    static void clearIncludeCache();
     /// get symbols map
+    /** symbols map is AsmSymbolMap (not std::unordered_map as in older versions),
+     * it provides lookup interface of std::unordered_map (find, count, at)
+     * and iteration in insertion order, but it can not be copied */
     const AsmSymbolMap& getSymbolMap() const
     { return symbolMap; }
     /// get sections
-    const std::vector<AsmSection>& getSections() const
+    /** content of returned sections is complete: if sections have fill runs, then
+     * flattened copy of sections is made once after assembling */
+    const std::vector<AsmSection>& getSections() const;
+    /// get sections as they are held by assembler
+    /** big fill runs and mapped regions of sections are not in content
+     * (see AsmSection::fills) */
+    const std::vector<AsmSection>& getRawSections() const
     { return sections; }
+    /// get statistics of arena allocator of expressions
+    const AsmArenaStats& getExpressionArenaStats() const
+    { return exprArena.getStats(); }
+    /// get statistics (filled only if ASM_STATS flag is enabled)
+    const AsmStats& getStats() const
+    { return stats; }
     /// get kernel map
     const KernelMap& getKernelMap() const
     { return kernelMap; }
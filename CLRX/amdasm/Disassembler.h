@@ -28,6 +28,7 @@
 #include <istream>
 #include <ostream>
 #include <vector>
+#include <functional>
 #include <utility>
 #include <memory>
 #include <CLRX/amdbin/AmdBinaries.h>
@@ -95,10 +96,14 @@ protected:
     std::vector<std::pair<size_t, CString> > namedLabels;   ///< named labels
     std::vector<CString> relSymbols;    ///< symbols used by relocations
     std::vector<std::pair<size_t, Relocation> > relocations;    ///< relocations
+    size_t sectionIndex;    ///< section index (used by numbered labels)
     FastOutputBuffer output;    ///< output buffer
     
     /// constructor
     explicit ISADisassembler(Disassembler& disassembler, cxuint outBufSize = 500);
+    /// constructor with own output stream
+    ISADisassembler(Disassembler& disassembler, std::ostream& output,
+                cxuint outBufSize = 500);
     
     /// write location in the code
     void writeLocation(size_t pos);
@@ -127,6 +132,17 @@ public:
     void setDontPrintLabels(bool after)
     { dontPrintLabelsAfterCode = after; }
     
+    /// get section index (used by numbered labels)
+    size_t getSectionIndex() const
+    { return sectionIndex; }
+    /// set section index (used by numbered labels)
+    void setSectionIndex(size_t sectionIndex)
+    { this->sectionIndex = sectionIndex; }
+    
+    /// get disassembler
+    Disassembler& getDisassembler()
+    { return disassembler; }
+    
     /// analyze code before disassemblying
     virtual void analyzeBeforeDisassemble() = 0;
     
@@ -172,19 +188,180 @@ public:
     { return output.flush(); }
 };
 
+/// GCN instruction index flags
+enum : cxbyte
+{
+    GCNINSTR_LITERAL = 1,   ///< instruction has 32-bit literal
+    GCNINSTR_BRANCH = 2     ///< instruction is branch (has branch target)
+};
+
+/// index of pre-decoded GCN instructions (in struct of arrays form)
+/** i-th element of every array describes i-th instruction. sequence of zero words
+ * is indexed as sequence of single-word instructions. offsets and branch targets
+ * are relative to start of code (code must be smaller than 2GB) */
+struct GCNInstrIndex
+{
+    size_t startOffset; ///< offset of start of code
+    std::vector<uint32_t> offsets;  ///< offsets of instructions (from code start)
+    std::vector<cxbyte> encodings;  ///< encodings of instructions (GCNENC_*)
+    std::vector<uint16_t> opcodes;  ///< opcodes of instructions in their encodings
+    std::vector<cxbyte> sizes;  ///< sizes of instructions in bytes
+    std::vector<cxbyte> flags;  ///< instruction flags (GCNINSTR_*)
+    /// branch targets (from code start, negative if before code, UINT32_MAX if no branch)
+    std::vector<uint32_t> branchTargets;
+    
+    /// constructor
+    GCNInstrIndex() : startOffset(0)
+    { }
+    
+    /// get number of instructions
+    size_t size() const
+    { return offsets.size(); }
+    
+    /// get offset of i-th instruction (with start offset)
+    size_t getOffset(size_t i) const
+    { return startOffset + offsets[i]; }
+    /// get branch target of i-th instruction (with start offset, SIZE_MAX if no branch)
+    size_t getBranchTarget(size_t i) const
+    {
+        return (branchTargets[i] != UINT32_MAX) ?
+                startOffset + int32_t(branchTargets[i]) : SIZE_MAX;
+    }
+    
+    /// clear index
+    void clear()
+    {
+        offsets.clear();
+        encodings.clear();
+        opcodes.clear();
+        sizes.clear();
+        flags.clear();
+        branchTargets.clear();
+    }
+};
+
+/// GCN operand kinds
+enum : cxbyte
+{
+    GCNOP_NONE = 0,     ///< no operand (for example, disabled export source)
+    GCNOP_REG,          ///< register range (SGPRs, VGPRs or special registers)
+    GCNOP_INLINE,       ///< inline constant (value in code)
+    GCNOP_LITERAL,      ///< 32-bit literal constant (value in value)
+    GCNOP_IMM           ///< immediate value (value in value)
+};
+
+/// GCN operand modifiers
+enum : cxbyte
+{
+    GCNOPMOD_ABS = 1,   ///< absolute value
+    GCNOPMOD_NEG = 2,   ///< negation
+    GCNOPMOD_SEXT = 4   ///< sign extension (SDWA)
+};
+
+/// GCN instruction record flags
+enum : uint32_t
+{
+    GCNREC_GLC = 1,     ///< GLC bit
+    GCNREC_SLC = 2,     ///< SLC bit
+    GCNREC_TFE = 4,     ///< TFE bit
+    GCNREC_LDS = 8,     ///< LDS bit (MUBUF)
+    GCNREC_GDS = 0x10,  ///< GDS bit (DS)
+    GCNREC_OFFEN = 0x20,    ///< OFFEN bit (MUBUF/MTBUF)
+    GCNREC_IDXEN = 0x40,    ///< IDXEN bit (MUBUF/MTBUF)
+    GCNREC_ADDR64 = 0x80,   ///< ADDR64 bit (MUBUF/MTBUF)
+    GCNREC_CLAMP = 0x100,   ///< clamp (VOP3 and SDWA)
+    GCNREC_UNORM = 0x200,   ///< UNORM bit (MIMG)
+    GCNREC_R128 = 0x400,    ///< R128 bit (MIMG)
+    GCNREC_LWE = 0x800,     ///< LWE bit (MIMG)
+    GCNREC_DA = 0x1000,     ///< DA bit (MIMG)
+    GCNREC_D16 = 0x2000,    ///< D16 bit (MIMG)
+    GCNREC_DONE = 0x4000,   ///< DONE bit (EXP)
+    GCNREC_COMPR = 0x8000,  ///< COMPR bit (EXP)
+    GCNREC_VM = 0x10000,    ///< VM bit (EXP)
+    GCNREC_SDWA = 0x20000,  ///< SDWA word (extra holds it)
+    GCNREC_DPP = 0x40000,   ///< DPP word (extra holds it)
+    GCNREC_HIGH = 0x80000   ///< high half of the attribute (VINTRP encoded as VOP3)
+};
+
+/// GCN instruction operand
+struct GCNOperand
+{
+    cxbyte kind;        ///< operand kind (GCNOP_*)
+    cxbyte regsNum;     ///< number of registers
+    cxbyte modifiers;   ///< modifiers (GCNOPMOD_*)
+    /// operand code: 0-255 - scalar operands (as in SRC0 field), 256-511 - VGPRs
+    uint16_t code;
+    uint32_t value;     ///< literal or immediate value
+};
+
+/// decoded GCN instruction (typed form of disassembled instruction)
+/** operands are in the same order as in assembler syntax. unused fields of
+ * instruction are not stored as operands */
+struct GCNInstrRecord
+{
+    size_t offset;      ///< offset of instruction (with start offset)
+    const char* mnemonic;   ///< mnemonic (static string, null if illegal instruction)
+    cxbyte encoding;    ///< encoding (GCNENC_*, VOP3B for VOP3 with SDST)
+    uint16_t opcode;    ///< opcode in encoding
+    cxbyte size;        ///< size in bytes
+    cxbyte operandsNum; ///< number of operands
+    GCNOperand operands[6]; ///< operands
+    uint32_t flags;     ///< flags (GCNREC_*)
+    /// memory offset (for DS with two offsets: offset0 | (offset1<<8))
+    uint32_t memOffset;
+    uint32_t extra;     ///< SDWA or DPP word
+    cxbyte omod;        ///< output modifier (VOP3)
+    cxbyte dmask;       ///< data mask (MIMG)
+    cxbyte dfmt;        ///< data format (MTBUF)
+    cxbyte nfmt;        ///< number format (MTBUF)
+    size_t branchTarget;    ///< branch target (SIZE_MAX if no branch)
+};
+
 /// GCN architectur dissassembler
 class GCNDisassembler: public ISADisassembler
 {
 private:
     bool instrOutOfCode;
+    size_t decodeChunkSize;
+    GCNInstrIndex instrIndex;
+    // input of instruction index that can be used by next disassemblying
+    const cxbyte* indexInput;
+    size_t indexInputSize;
+    
+    void disassembleInstrs(const GCNInstrIndex& index, size_t first, size_t last);
+    void disassembleInChunks(const std::vector<size_t>& chunkFirsts);
     
     friend struct GCNDisasmUtils; // INTERNAL LOGIC
 public:
     /// constructor
     GCNDisassembler(Disassembler& disassembler);
+    /// constructor with own output stream (for example for separate thread)
+    GCNDisassembler(Disassembler& disassembler, std::ostream& output);
     /// destructor
     ~GCNDisassembler();
     
+    /// get size of code chunk decoded by single thread (0 - no parallel decoding)
+    size_t getDecodeChunkSize() const
+    { return decodeChunkSize; }
+    /// set size of code chunk decoded by single thread (0 - no parallel decoding)
+    /** code is decoded in parallel only if disassembler has more threads and code
+     * has more than one chunk. output is same as decoded by single thread */
+    void setDecodeChunkSize(size_t size)
+    { decodeChunkSize = size; }
+    
+    /// build instruction index for current input code
+    void buildInstrIndex();
+    /// get instruction index (built by buildInstrIndex or while analyzing code)
+    const GCNInstrIndex& getInstrIndex() const
+    { return instrIndex; }
+
+    /// decode i-th instruction from instruction index to record
+    /** instruction index must be built for current input code */
+    void decodeInstr(size_t i, GCNInstrRecord& record) const;
+    /// decode all instructions of input code and pass them to visitor
+    /** instruction index is built if needed. no text is formatted */
+    void decodeInstrs(const std::function<void(const GCNInstrRecord&)>& visitor);
+
     /// analyze code before disassemblying
     void analyzeBeforeDisassemble();
     /// disassemble code
@@ -349,6 +526,7 @@ private:
     std::ostream& output;
     Flags flags;
     size_t sectionCount;
+    cxuint threadsNum;
 public:
     /// constructor for 32-bit GPU binary
     /**
@@ -441,6 +619,14 @@ public:
     void setFlags(Flags flags)
     { this->flags = flags; }
     
+    /// get number of threads that disassemble kernels or code chunks
+    cxuint getThreadsNum() const
+    { return threadsNum; }
+    /// set number of threads that disassemble kernels or code chunks (0 or 1 - none)
+    /** output is same as disassembled without threads */
+    void setThreadsNum(cxuint threadsNum)
+    { this->threadsNum = threadsNum; }
+    
     /// get deviceType
     GPUDeviceType getDeviceType() const;
     
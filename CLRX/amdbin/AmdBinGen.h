@@ -208,6 +208,9 @@ class AmdGPUBinGenerator: public NonCopyableAndNonMovable
 private:
     bool manageable;
     const AmdInput* input;
+    cxuint threadsNum;
+    bool deduplication;
+    mutable uint64_t dedupSavedSize;
     
     void generateInternal(std::ostream* osPtr, std::vector<char>* vPtr,
              Array<cxbyte>* aPtr) const;
@@ -241,6 +244,24 @@ public:
     /// set input
     void setInput(const AmdInput* input);
     
+    /// get number of threads that generate kernel's binaries
+    cxuint getThreadsNum() const
+    { return threadsNum; }
+    /// set number of threads that generate kernel's binaries (0 or 1 - no threads)
+    /** output is same as generated without threads */
+    void setThreadsNum(cxuint threadsNum)
+    { this->threadsNum = threadsNum; }
+    
+    /// return true if identical inner binaries of kernels are stored once
+    bool hasDeduplication() const
+    { return deduplication; }
+    /// enable storing identical inner binaries of kernels once (duplicates points to first copy)
+    void setDeduplication(bool deduplication)
+    { this->deduplication = deduplication; }
+    /// get number of bytes saved by deduplication in last generated binary
+    uint64_t getDedupSavedSize() const
+    { return dedupSavedSize; }
+    
     /// generates binary
     void generate(Array<cxbyte>& array) const;
     
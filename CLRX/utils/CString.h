@@ -35,6 +35,8 @@ namespace CLRX
 {
 
 /// simple C-string container
+/** short strings (shorter than inlineSize) are held inside object without
+ * heap allocation */
 class CString
 {
 public:
@@ -43,8 +45,28 @@ public:
     typedef char element_type; ///< element type
     typedef std::string::size_type size_type; ///< size type
     static const size_type npos = -1;   ///< value to indicate no position
+    /// size of inline storage (with null-character)
+    static const size_t inlineSize = 16;
 private:
-    char* ptr;
+    char* ptr;  // points to inlineBuf for short string, null if empty
+    char inlineBuf[inlineSize];
+    
+    // allocate storage for n characters and null-character
+    char* allocate(size_t n)
+    { return (n < inlineSize) ? inlineBuf : new char[n+1]; }
+    // free storage (if in heap)
+    void release()
+    {
+        if (ptr != inlineBuf)
+            delete[] ptr;
+    }
+    // replace old storage by new storage that has been filled
+    void replace(char* newPtr)
+    {
+        if (ptr != newPtr)
+            release();
+        ptr = newPtr;
+    }
 public:
     /// constructor
     CString(): ptr(nullptr)
@@ -54,7 +76,7 @@ public:
     explicit CString(size_t n) : ptr(nullptr)
     {
         if (n == 0) return;
-        ptr = new char[n+1];
+        ptr = allocate(n);
         ptr[n] = 0;
     }
     
@@ -66,7 +88,7 @@ public:
         const size_t n = ::strlen(str);
         if (n == 0)
             return;
-        ptr = new char[n+1];
+        ptr = allocate(n);
         ::memcpy(ptr, str, n);
         ptr[n] = 0;
     }
@@ -77,7 +99,7 @@ public:
         const size_t n = str.size();
         if (n == 0)
             return;
-        ptr = new char[n+1];
+        ptr = allocate(n);
         ::memcpy(ptr, str.c_str(), n);
         ptr[n] = 0;
     }
@@ -87,7 +109,7 @@ public:
     {
         if (n == 0)
             return;
-        ptr = new char[n+1];
+        ptr = allocate(n);
         ::memcpy(ptr, str, n);
         ptr[n] = 0;
     }
@@ -98,7 +120,7 @@ public:
         const size_t n = end-str;
         if (n == 0)
             return;
-        ptr = new char[n+1];
+        ptr = allocate(n);
         ::memcpy(ptr, str, n);
         ptr[n] = 0;
     }
@@ -108,7 +130,7 @@ public:
     {
         if (n == 0)
             return;
-        ptr = new char[n+1];
+        ptr = allocate(n);
         ::memset(ptr, ch, n);
         ptr[n] = 0;
     }
@@ -119,14 +141,21 @@ public:
         const size_t n = cstr.size();
         if (n == 0)
             return;
-        ptr = new char[n+1];
+        ptr = allocate(n);
         ::memcpy(ptr, cstr.c_str(), n);
         ptr[n] = 0;
     }
     
     /// move-constructor
     CString(CString&& cstr) noexcept : ptr(cstr.ptr)
-    { cstr.ptr = nullptr; }
+    {
+        if (cstr.ptr == cstr.inlineBuf)
+        {
+            ::memcpy(inlineBuf, cstr.inlineBuf, inlineSize);
+            ptr = inlineBuf;
+        }
+        cstr.ptr = nullptr;
+    }
     
     /// constructor
     CString(std::initializer_list<char> init) : ptr(nullptr)
@@ -134,14 +163,14 @@ public:
         const size_t n = init.size();
         if (n == 0)
             return;
-        ptr = new char[n+1];
+        ptr = allocate(n);
         std::copy(init.begin(), init.end(), ptr);
         ptr[n] = 0; // null char
     }
     
     /// destructor
     ~CString()
-    { delete[] ptr; }
+    { release(); }
     
     /// copy-assignment
     CString& operator=(const CString& cstr)
@@ -154,8 +183,15 @@ public:
     /// move-assignment
     CString& operator=(CString&& cstr) noexcept
     {
-        delete[] ptr;   // delete old
+        if (this == &cstr)
+            return *this;
+        release();   // delete old
         ptr = cstr.ptr;
+        if (cstr.ptr == cstr.inlineBuf)
+        {
+            ::memcpy(inlineBuf, cstr.inlineBuf, inlineSize);
+            ptr = inlineBuf;
+        }
         cstr.ptr = nullptr;
         return *this;
     }
@@ -177,8 +213,7 @@ public:
     {
         if (str==nullptr)
         {
-            delete[] ptr;
-            ptr = nullptr;
+            clear();
             return *this;
         }
         size_t length = ::strlen(str);
@@ -190,15 +225,13 @@ public:
     {
         if (n == 0)
         {   // just clear
-            delete[] ptr;
-            ptr = nullptr;
+            clear();
             return *this;
         }
-        char* newPtr = new char[n+1];
-        ::memcpy(newPtr, str, n);
+        char* newPtr = allocate(n);
+        ::memmove(newPtr, str, n); // str can be part of this string
         newPtr[n] = 0;
-        delete[] ptr;
-        ptr = newPtr;
+        replace(newPtr);
         return *this;
     }
     
@@ -211,15 +244,13 @@ public:
     {
         if (n == 0)
         {   // just clear
-            delete[] ptr;
-            ptr = nullptr;
+            clear();
             return *this;
         }
-        char* newPtr = new char[n+1];
+        char* newPtr = allocate(n);
         ::memset(newPtr, ch, n);
         newPtr[n] = 0; // null-char
-        delete[] ptr;
-        ptr = newPtr;
+        replace(newPtr);
         return *this;
     }
     
@@ -229,15 +260,13 @@ public:
         const size_t n = init.size();
         if (n == 0)
         {   // just clear
-            delete[] ptr;
-            ptr = nullptr;
+            clear();
             return *this;
         }
-        char* newPtr = new char[n+1];
+        char* newPtr = allocate(n);
         std::copy(init.begin(), init.end(), newPtr);
         newPtr[n] = 0; // null char
-        delete[] ptr;
-        ptr = newPtr;
+        replace(newPtr);
         return *this;
     }
     
@@ -277,7 +306,7 @@ public:
     /// clear this string
     void clear()
     {
-        delete[] ptr;
+        release();
         ptr = nullptr;
     }
     
@@ -335,7 +364,11 @@ public:
     
     /// swap this string with another
     void swap(CString& s2) noexcept
-    { std::swap(ptr, s2.ptr); }
+    {
+        CString tmp(std::move(s2));
+        s2 = std::move(*this);
+        *this = std::move(tmp);
+    }
 };
 
 /// equal operator
@@ -31,6 +31,7 @@
 #include <memory>
 #include <streambuf>
 #include <CLRX/utils/Utilities.h>
+#include <CLRX/utils/Containers.h>
 
 /// main namespace
 namespace CLRX
@@ -347,38 +348,63 @@ public:
 };
 
 /// fast and direct output buffer
+/** output buffer can write to output stream or directly to memory
+ * (to buffer with size of whole output, without any intermediate copies) */
 class FastOutputBuffer: public NonCopyableAndNonMovable
 {
 private:
-    std::ostream& os;
-    cxuint endPos;
-    cxuint bufSize;
-    std::unique_ptr<char[]> buffer;
+    std::ostream* os;
+    size_t endPos;
+    size_t bufSize;
+    std::unique_ptr<char[]> bufferHolder;
+    char* buffer;
     uint64_t written;
+    
+    void checkMemoryOverflow()
+    {
+        if (os == nullptr)
+            throw Exception("Output buffer overflow");
+    }
 public:
     /// constructor with inBufSize and output
     /**
      * \param _bufSize max buffer size
      * \param output output stream
      */
-    FastOutputBuffer(cxuint _bufSize, std::ostream& output) : os(output), endPos(0),
-            bufSize(_bufSize), buffer(new char[_bufSize]), written(0)
+    FastOutputBuffer(cxuint _bufSize, std::ostream& output) : os(&output), endPos(0),
+            bufSize(_bufSize), bufferHolder(new char[_bufSize]),
+            buffer(bufferHolder.get()), written(0)
+    { }
+    /// constructor with output memory
+    /**
+     * \param outSize size of output memory (size of whole output)
+     * \param output output memory
+     */
+    FastOutputBuffer(size_t outSize, char* output) : os(nullptr), endPos(0),
+            bufSize(outSize), buffer(output), written(0)
     { }
     /// destructor
     ~FastOutputBuffer()
     { 
         flush();
-        os.flush();
+        if (os != nullptr)
+            os->flush();
     }
     
     /// get written bytes number
     uint64_t getWritten() const
     { return written; }
     
+    /// returns true if buffer writes to output stream
+    bool hasOStream() const
+    { return os != nullptr; }
+    
     /// write output buffer
     void flush()
     {
-        os.write(buffer.get(), endPos);
+        if (os == nullptr)
+            return; // data already in output memory
+        os->write(buffer, endPos);
         endPos = 0;
     }
     
@@ -386,8 +412,11 @@ public:
     char* reserve(cxuint toReserve)
     {
         if (toReserve > bufSize-endPos)
+        {
+            checkMemoryOverflow();
             flush();
-        return buffer.get() + endPos;
+        }
+        return buffer + endPos;
     }
     
     /// finish reservation and go forward
@@ -402,12 +431,13 @@ public:
     {
         if (length > bufSize-endPos)
         {
+            checkMemoryOverflow();
             flush();
-            os.write(string, length);
+            os->write(string, length);
         }
         else
         {
-            ::memcpy(buffer.get()+endPos, string, length);
+            ::memcpy(buffer+endPos, string, length);
             endPos += length;
         }
         written += length;
@@ -431,7 +461,10 @@ public:
     void put(char c)
     {
         if (endPos == bufSize)
+        {
+            checkMemoryOverflow();
             flush();
+        }
         buffer[endPos++] = c;
         written++;
     }
@@ -439,11 +472,13 @@ public:
     /// fill (put num c character)
     void fill(size_t num, char c)
     {
+        if (os == nullptr && num > bufSize-endPos)
+            checkMemoryOverflow();
         size_t count = num;
         while (count != 0)
         {
              size_t bufNum = std::min(size_t(bufSize-endPos), count);
-             ::memset(buffer.get()+endPos, c, bufNum);
+             ::memset(buffer+endPos, c, bufNum);
              count -= bufNum;
              endPos += bufNum;
              if (endPos == bufSize)
@@ -452,12 +487,91 @@ public:
         written += num;
     }
     
-    /// get output stream
+    /// get output stream (only if buffer writes to output stream)
     const std::ostream& getOStream() const
-    { return os; }
-    /// get output stream
+    { return *os; }
+    /// get output stream (only if buffer writes to output stream)
     std::ostream& getOStream()
-    { return os; }
+    { return *os; }
+};
+
+/// create output buffer for binary generators
+/** if array or vector is given, then it is resized to exact size of output and
+ * buffer writes directly into it, otherwise buffer writes to output stream
+ * \param outSize size of whole output
+ * \param os output stream (used if array and vector are null)
+ * \param array output array
+ * \param vector output vector
+ * \return new output buffer
+ */
+inline std::unique_ptr<FastOutputBuffer> createFastOutputBuffer(size_t outSize,
+            std::ostream* os, Array<cxbyte>* array, std::vector<char>* vector)
+{
+    if (array != nullptr)
+    {
+        array->resize(outSize);
+        return std::unique_ptr<FastOutputBuffer>(new FastOutputBuffer(outSize,
+                    reinterpret_cast<char*>(array->data())));
+    }
+    if (vector != nullptr)
+    {
+        vector->resize(outSize);
+        return std::unique_ptr<FastOutputBuffer>(
+                    new FastOutputBuffer(outSize, vector->data()));
+    }
+    return std::unique_ptr<FastOutputBuffer>(new FastOutputBuffer(256, *os));
+}
+
+/*
+ * memory mapped files
+ */
+
+/// read-only memory mapped file
+/** maps whole regular file into memory. Empty file is mapped as empty range. */
+class MappedFile: public RefCountable, public NonCopyableAndNonMovable
+{
+private:
+    const cxbyte* content;
+    size_t contentSize;
+    CString filename;
+#ifdef HAVE_WINDOWS
+    void* fileHandle;
+    void* mapHandle;
+#else
+    uint64_t fileDevice;
+    uint64_t fileInode;
+    uint64_t fileModTime;   // in nanoseconds
+#endif
+public:
+    /// constructor (maps file)
+    /**
+     * \param filename name of regular file
+     */
+    explicit MappedFile(const char* filename);
+    /// destructor (unmaps file)
+    ~MappedFile();
+
+    /// get mapped data
+    const cxbyte* data() const
+    { return content; }
+    /// get size of mapped data
+    size_t size() const
+    { return contentSize; }
+    /// get name of mapped file
+    const CString& getFilename() const
+    { return filename; }
+
+    /// returns true if file given by name is mapped file
+    /** Under Windows always returns false (mapped file can not be opened for writing) */
+    bool isSameFile(const char* filename) const;
+    /// returns true if mapped file has been changed (resized or written) after mapping
+    /** file replaced or removed after mapping is not treated as changed,
+     * because mapping still holds old file. Under Windows always returns false
+     * (mapped file can not be written) */
+    bool isChanged() const;
+    
+    /// returns true if file is regular file that can be mapped
+    static bool isMappable(const char* filename);
 };
 
 };
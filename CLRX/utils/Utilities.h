@@ -32,6 +32,7 @@
 #include <cstdint>
 #include <mutex>
 #include <atomic>
+#include <functional>
 #include <CLRX/utils/Containers.h>
 #include <CLRX/utils/CString.h>
 
@@ -334,10 +335,26 @@ struct CStringHash
     }
 };
 
+/// calculate hash of memory block (to find identical blocks)
+/**
+ * \param size size of block
+ * \param data block data
+ * \param hash initial hash value (to continue hashing of previous blocks)
+ * \return hash value
+ */
+inline size_t calculateDataHash(size_t size, const cxbyte* data, size_t hash = 0)
+{
+    for (size_t i = 0; i < size; i++)
+        hash = ((hash<<8)^data[i])*size_t(0xbf146a3dU);
+    return hash;
+}
+
 /// counts leading zeroes for 32-bit unsigned integer. For zero behavior is undefined
 inline cxuint CLZ32(uint32_t v);
 /// counts leading zeroes for 64-bit unsigned integer. For zero behavior is undefined
 inline cxuint CLZ64(uint64_t v);
+/// counts trailing zeroes for 32-bit unsigned integer. For zero behavior is undefined
+inline cxuint CTZ32(uint32_t v);
 
 inline cxuint CLZ32(uint32_t v)
 {
@@ -361,6 +378,17 @@ inline cxuint CLZ64(uint64_t v)
 #endif
 }
 
+inline cxuint CTZ32(uint32_t v)
+{
+#ifdef __GNUC__
+    return __builtin_ctz(v);
+#else
+    cxuint count = 0;
+    for (; (v&1)==0; v>>=1, count++);
+    return count;
+#endif
+}
+
 /// safely compares sum of two unsigned integers with other unsigned integer
 template<typename T, typename T2>
 inline bool usumGt(T a, T b, T2 c)
@@ -706,6 +734,20 @@ extern std::string getHomeDir();
 /// create directory
 extern void makeDir(const char* dirname);
 
+/* thread utilities */
+
+/// call function for items (indices from 0 to itemsNum-1) in parallel threads
+/**
+ * items are divided into contiguous ranges, one range per thread. if thread can not
+ * be created then its range is processed by current thread. if function throws
+ * exception then exception from first failed item (in items order) is rethrown.
+ * \param threadsNum number of threads (0 or 1 - all items in current thread)
+ * \param itemsNum number of items
+ * \param func function called with index of item
+ */
+extern void runInParallel(cxuint threadsNum, size_t itemsNum,
+            const std::function<void(size_t)>& func);
+
 /*
  * Reference support
  */
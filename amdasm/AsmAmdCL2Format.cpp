@@ -31,7 +31,7 @@
 
 using namespace CLRX;
 
-static const char* amdCL2PseudoOpNamesTbl[] =
+const char* CLRX::amdCL2PseudoOpNamesTbl[] =
 {
     "acl_version", "arch_minor", "arch_stepping",
     "arg", "bssdata", "compile_options", "config",
@@ -44,6 +44,9 @@ static const char* amdCL2PseudoOpNamesTbl[] =
     "useenqueue", "usegeneric", "usesetup", "vgprsnum"
 };
 
+const size_t CLRX::amdCL2PseudoOpNamesNum =
+        sizeof(amdCL2PseudoOpNamesTbl)/sizeof(char*);
+
 enum
 {
     AMDCL2OP_ACL_VERSION = 0, AMDCL2OP_ARCH_MINOR, AMDCL2OP_ARCH_STEPPING,
@@ -333,10 +336,7 @@ bool AsmAmdCL2PseudoOps::checkPseudoOpName(const CString& string)
 {
     if (string.empty() || string[0] != '.')
         return false;
-    const size_t pseudoOp = binaryFind(amdCL2PseudoOpNamesTbl, amdCL2PseudoOpNamesTbl +
-                sizeof(amdCL2PseudoOpNamesTbl)/sizeof(char*), string.c_str()+1,
-               CStringLess()) - amdCL2PseudoOpNamesTbl;
-    return pseudoOp < sizeof(amdCL2PseudoOpNamesTbl)/sizeof(char*);
+    return getAsmPseudoOpIndex(string, ASMPOT_AMDCL2) != ASMPSEUDOOP_NONE;
 }
 
 void AsmAmdCL2PseudoOps::setAclVersion(AsmAmdCL2Handler& handler, const char* linePtr)
@@ -1190,9 +1190,7 @@ void AsmAmdCL2PseudoOps::doConfig(AsmAmdCL2Handler& handler, const char* pseudoO
 bool AsmAmdCL2Handler::parsePseudoOp(const CString& firstName,
        const char* stmtPlace, const char* linePtr)
 {
-    const size_t pseudoOp = binaryFind(amdCL2PseudoOpNamesTbl, amdCL2PseudoOpNamesTbl +
-                    sizeof(amdCL2PseudoOpNamesTbl)/sizeof(char*), firstName.c_str()+1,
-                   CStringLess()) - amdCL2PseudoOpNamesTbl;
+    const size_t pseudoOp = getAsmPseudoOpIndex(firstName, ASMPOT_AMDCL2);
     
     switch(pseudoOp)
     {
@@ -1352,11 +1350,13 @@ bool AsmAmdCL2Handler::prepareBinary()
     const size_t kernelsNum = kernelStates.size();
     for (size_t i = 0; i < sectionsNum; i++)
     {
-        const AsmSection& asmSection = assembler.sections[i];
+        AsmSection& asmSection = assembler.sections[i];
         const Section& section = sections[i];
         const size_t sectionSize = asmSection.getSize();
-        const cxbyte* sectionData = (!asmSection.content.empty()) ?
-                asmSection.content.data() : (const cxbyte*)"";
+        // binary generator requires contiguous content
+        const cxbyte* sectionData = asmSection.getFlatData();
+        if (sectionData == nullptr)
+            sectionData = (const cxbyte*)"";
         AmdCL2KernelInput* kernel = (section.kernelId!=ASMKERN_GLOBAL) ?
                     &output.kernels[section.kernelId] : nullptr;
         
@@ -1573,23 +1573,24 @@ bool AsmAmdCL2Handler::resolveRelocation(const AsmExpression* expr, uint64_t& ou
                 "code section");
         return false;
     }
-    const Array<AsmExprOp>& ops = expr->getOps();
+    const AsmExprOps ops = expr->getOps();
+    const size_t opsNum = ops.size();
     
     size_t relOpStart = 0;
-    size_t relOpEnd = ops.size();
+    size_t relOpEnd = opsNum;
     RelocType relType = RELTYPE_LOW_32BIT;
     // checking what is expression
-    AsmExprOp lastOp = ops.back();
+    AsmExprOp lastOp = ops[opsNum-1];
     if (lastOp==AsmExprOp::BIT_AND || lastOp==AsmExprOp::MODULO ||
         lastOp==AsmExprOp::SIGNED_MODULO || lastOp==AsmExprOp::DIVISION ||
         lastOp==AsmExprOp::SIGNED_DIVISION || lastOp==AsmExprOp::SHIFT_RIGHT)
     {   // check low or high relocation
         relOpStart = 0;
-        relOpEnd = expr->toTop(ops.size()-2);
+        relOpEnd = expr->toTop(opsNum-2);
         /// evaluate second argument
         cxuint tmpSectionId;
         uint64_t secondArg;
-        if (!expr->evaluate(assembler, relOpEnd, ops.size()-1, secondArg, tmpSectionId))
+        if (!expr->evaluate(assembler, relOpEnd, opsNum-1, secondArg, tmpSectionId))
             return false;
         if (tmpSectionId!=ASMSECT_ABS)
         {   // must be absolute
@@ -1655,11 +1656,17 @@ bool AsmAmdCL2Handler::resolveRelocation(const AsmExpression* expr, uint64_t& ou
 void AsmAmdCL2Handler::writeBinary(std::ostream& os) const
 {
     AmdCL2GPUBinGenerator binGenerator(&output);
+    binGenerator.setThreadsNum(assembler.getBinGenThreadsNum());
+    binGenerator.setDeduplication((assembler.flags & ASM_DEDUP) != 0);
     binGenerator.generate(os);
+    assembler.stats.dedupSavedSize = binGenerator.getDedupSavedSize();
 }
 
 void AsmAmdCL2Handler::writeBinary(Array<cxbyte>& array) const
 {
     AmdCL2GPUBinGenerator binGenerator(&output);
+    binGenerator.setThreadsNum(assembler.getBinGenThreadsNum());
+    binGenerator.setDeduplication((assembler.flags & ASM_DEDUP) != 0);
     binGenerator.generate(array);
+    assembler.stats.dedupSavedSize = binGenerator.getDedupSavedSize();
 }
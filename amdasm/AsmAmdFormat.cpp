@@ -30,7 +30,7 @@
 
 using namespace CLRX;
 
-static const char* amdPseudoOpNamesTbl[] =
+const char* CLRX::amdPseudoOpNamesTbl[] =
 {
     "arg", "boolconsts", "calnote", "cbid",
     "cbmask", "compile_options", "condout", "config",
@@ -47,6 +47,9 @@ static const char* amdPseudoOpNamesTbl[] =
     "useprintf", "userdata", "vgprsnum"
 };
 
+const size_t CLRX::amdPseudoOpNamesNum =
+        sizeof(amdPseudoOpNamesTbl)/sizeof(char*);
+
 enum
 {
     AMDOP_ARG = 0, AMDOP_BOOLCONSTS, AMDOP_CALNOTE, AMDOP_CBID,
@@ -263,10 +266,7 @@ bool AsmAmdPseudoOps::checkPseudoOpName(const CString& string)
 {
     if (string.empty() || string[0] != '.')
         return false;
-    const size_t pseudoOp = binaryFind(amdPseudoOpNamesTbl, amdPseudoOpNamesTbl +
-                sizeof(amdPseudoOpNamesTbl)/sizeof(char*), string.c_str()+1,
-               CStringLess()) - amdPseudoOpNamesTbl;
-    return pseudoOp < sizeof(amdPseudoOpNamesTbl)/sizeof(char*);
+    return getAsmPseudoOpIndex(string, ASMPOT_AMD) != ASMPSEUDOOP_NONE;
 }
 
 void AsmAmdPseudoOps::setCompileOptions(AsmAmdHandler& handler, const char* linePtr)
@@ -1591,9 +1591,7 @@ void AsmAmdPseudoOps::doArg(AsmAmdHandler& handler, const char* pseudoOpPlace,
 bool AsmAmdHandler::parsePseudoOp(const CString& firstName,
        const char* stmtPlace, const char* linePtr)
 {
-    const size_t pseudoOp = binaryFind(amdPseudoOpNamesTbl, amdPseudoOpNamesTbl +
-                    sizeof(amdPseudoOpNamesTbl)/sizeof(char*), firstName.c_str()+1,
-                   CStringLess()) - amdPseudoOpNamesTbl;
+    const size_t pseudoOp = getAsmPseudoOpIndex(firstName, ASMPOT_AMD);
     
     switch(pseudoOp)
     {
@@ -1793,11 +1791,13 @@ bool AsmAmdHandler::prepareBinary()
     const size_t kernelsNum = kernelStates.size();
     for (size_t i = 0; i < sectionsNum; i++)
     {
-        const AsmSection& asmSection = assembler.sections[i];
+        AsmSection& asmSection = assembler.sections[i];
         const Section& section = sections[i];
         const size_t sectionSize = asmSection.getSize();
-        const cxbyte* sectionData = (!asmSection.content.empty()) ?
-                asmSection.content.data() : (const cxbyte*)"";
+        // binary generator requires contiguous content
+        const cxbyte* sectionData = asmSection.getFlatData();
+        if (sectionData == nullptr)
+            sectionData = (const cxbyte*)"";
         AmdKernelInput* kernel = (section.kernelId!=ASMKERN_GLOBAL) ?
                     &output.kernels[section.kernelId] : nullptr;
                 
@@ -1936,11 +1936,17 @@ bool AsmAmdHandler::prepareBinary()
 void AsmAmdHandler::writeBinary(std::ostream& os) const
 {
     AmdGPUBinGenerator binGenerator(&output);
+    binGenerator.setThreadsNum(assembler.getBinGenThreadsNum());
+    binGenerator.setDeduplication((assembler.flags & ASM_DEDUP) != 0);
     binGenerator.generate(os);
+    assembler.stats.dedupSavedSize = binGenerator.getDedupSavedSize();
 }
 
 void AsmAmdHandler::writeBinary(Array<cxbyte>& array) const
 {
     AmdGPUBinGenerator binGenerator(&output);
+    binGenerator.setThreadsNum(assembler.getBinGenThreadsNum());
+    binGenerator.setDeduplication((assembler.flags & ASM_DEDUP) != 0);
     binGenerator.generate(array);
+    assembler.stats.dedupSavedSize = binGenerator.getDedupSavedSize();
 }
@@ -19,6 +19,7 @@
 
 #include <CLRX/Config.h>
 #include <string>
+#include <cstring>
 #include <vector>
 #include <stack>
 #include <algorithm>
@@ -39,10 +40,197 @@ static const uint64_t operatorWithMessage =
         (1ULL<<int(AsmExprOp::SHIFT_LEFT)) | (1ULL<<int(AsmExprOp::SHIFT_RIGHT)) |
         (1ULL<<int(AsmExprOp::SIGNED_SHIFT_RIGHT));
 
-AsmExpression::AsmExpression() : symOccursNum(0), relativeSymOccurs(false),
-            baseExpr(false)
+/*
+ * arena allocator
+ */
+
+AsmArena::AsmArena() : blockPos(nullptr), blockEnd(nullptr)
+{
+    std::fill(freeChunks, freeChunks + maxChunkSize/chunkAlign, nullptr);
+    ::memset(&stats, 0, sizeof(AsmArenaStats));
+}
+
+void* AsmArena::allocateFromNewBlock(size_t size)
+{
+    blocks.push_back(std::unique_ptr<cxbyte[]>(new cxbyte[blockSize]));
+    stats.blocksNum++;
+    stats.blocksSize += blockSize;
+    // blocks from new[] are aligned for any fundamental type
+    blockPos = blocks.back().get() + size;
+    blockEnd = blocks.back().get() + blockSize;
+    return blocks.back().get();
+}
+
+void* AsmArena::allocateBig(size_t size)
+{
+    void* ptr = ::operator new(size);
+    stats.allocsNum++;
+    stats.heapAllocsNum++;
+    stats.usedSize += size;
+    stats.maxUsedSize = std::max(stats.maxUsedSize, stats.usedSize);
+    return ptr;
+}
+
+void AsmArena::deallocateBig(void* ptr, size_t size)
+{
+    ::operator delete(ptr);
+    stats.usedSize -= size;
+}
+
+/*
+ * symbol occurrences
+ */
+
+AsmSymbolOccurrences::AsmSymbolOccurrences(const AsmSymbolOccurrences& b)
+        : arena(b.arena), elems(nullptr), elemsNum(0), capacity(0)
+{
+    if (b.elemsNum == 0)
+        return;
+    reserve(b.elemsNum);
+    std::copy(b.elems, b.elems+b.elemsNum, elems);
+    elemsNum = b.elemsNum;
+}
+
+AsmSymbolOccurrences& AsmSymbolOccurrences::operator=(const AsmSymbolOccurrences& b)
+{
+    if (this == &b)
+        return *this;
+    clear();
+    arena = b.arena;
+    if (b.elemsNum != 0)
+    {
+        reserve(b.elemsNum);
+        std::copy(b.elems, b.elems+b.elemsNum, elems);
+        elemsNum = b.elemsNum;
+    }
+    return *this;
+}
+
+AsmSymbolOccurrences& AsmSymbolOccurrences::operator=(AsmSymbolOccurrences&& b) noexcept
+{
+    if (this == &b)
+        return *this;
+    freeElems();
+    arena = b.arena;
+    elems = b.elems;
+    elemsNum = b.elemsNum;
+    capacity = b.capacity;
+    b.elems = nullptr;
+    b.elemsNum = b.capacity = 0;
+    return *this;
+}
+
+void AsmSymbolOccurrences::reserve(size_t newCapacity)
+{
+    const size_t newSize = newCapacity*sizeof(AsmExprSymbolOccurrence);
+    AsmExprSymbolOccurrence* newElems = static_cast<AsmExprSymbolOccurrence*>(
+            (arena != nullptr) ? arena->allocate(newSize) : ::operator new(newSize));
+    std::copy(elems, elems+elemsNum, newElems);
+    freeElems();
+    elems = newElems;
+    capacity = newCapacity;
+}
+
+void AsmSymbolOccurrences::freeElems()
+{
+    if (elems == nullptr)
+        return;
+    if (arena != nullptr)
+        arena->deallocate(elems, capacity*sizeof(AsmExprSymbolOccurrence));
+    else
+        ::operator delete(elems);
+    elems = nullptr;
+}
+
+void AsmSymbolOccurrences::insertFront(AsmArena* exprArena,
+            const AsmExprSymbolOccurrence* first, const AsmExprSymbolOccurrence* last)
+{
+    const size_t insertedNum = last-first;
+    if (insertedNum == 0)
+        return;
+    if (elems == nullptr)
+        arena = exprArena;
+    if (elemsNum + insertedNum > capacity)
+        reserve(std::max(elemsNum + insertedNum, capacity<<1));
+    std::copy_backward(elems, elems+elemsNum, elems+elemsNum+insertedNum);
+    std::copy(first, last, elems);
+    elemsNum += insertedNum;
+}
+
+/*
+ * expressions
+ */
+
+/* every expression object is preceded by header that holds arena pointer,
+ * thus expression can be freed by plain delete */
+static const size_t exprHeaderSize = AsmArena::chunkAlign;
+
+void* AsmExpression::operator new(size_t size)
+{
+    cxbyte* header = static_cast<cxbyte*>(::operator new(size + exprHeaderSize));
+    *reinterpret_cast<AsmArena**>(header) = nullptr;
+    return header + exprHeaderSize;
+}
+
+void* AsmExpression::operator new(size_t size, AsmArena& arena)
+{
+    cxbyte* header = static_cast<cxbyte*>(arena.allocate(size + exprHeaderSize));
+    *reinterpret_cast<AsmArena**>(header) = &arena;
+    return header + exprHeaderSize;
+}
+
+void AsmExpression::operator delete(void* ptr, size_t size)
+{
+    if (ptr == nullptr)
+        return;
+    cxbyte* header = static_cast<cxbyte*>(ptr) - exprHeaderSize;
+    AsmArena* arena = *reinterpret_cast<AsmArena**>(header);
+    if (arena != nullptr)
+        arena->deallocate(header, size + exprHeaderSize);
+    else
+        ::operator delete(header);
+}
+
+void AsmExpression::operator delete(void* ptr, AsmArena& arena)
+{
+    arena.deallocate(static_cast<cxbyte*>(ptr) - exprHeaderSize,
+                sizeof(AsmExpression) + exprHeaderSize);
+}
+
+AsmExpression::AsmExpression(AsmArena* _arena) : symOccursNum(0),
+            relativeSymOccurs(false), baseExpr(false), arena(_arena), opsNum(0),
+            arraysSize(0), ops(nullptr), messagePositions(nullptr), args(nullptr)
 { }
 
+void AsmExpression::allocateArrays(size_t _opsNum, size_t opPosNum, size_t argsNum)
+{
+    // arguments, message positions and operators are in single chunk
+    const size_t argsSize = argsNum*sizeof(AsmExprArg);
+    const size_t opPosSize = opPosNum*sizeof(LineCol);
+    const size_t newArraysSize = argsSize + opPosSize + _opsNum*sizeof(AsmExprOp);
+    cxbyte* data = nullptr;
+    if (newArraysSize != 0)
+        data = static_cast<cxbyte*>((arena != nullptr) ?
+                arena->allocate(newArraysSize) : ::operator new(newArraysSize));
+    freeArrays();
+    arraysSize = newArraysSize;
+    opsNum = _opsNum;
+    args = reinterpret_cast<AsmExprArg*>(data);
+    messagePositions = reinterpret_cast<LineCol*>(data + argsSize);
+    ops = reinterpret_cast<AsmExprOp*>(data + argsSize + opPosSize);
+}
+
+void AsmExpression::freeArrays()
+{
+    if (arraysSize == 0)
+        return;
+    if (arena != nullptr)
+        arena->deallocate(args, arraysSize);
+    else
+        ::operator delete(args);
+    arraysSize = 0;
+}
+
 void AsmExpression::setParams(size_t _symOccursNum,
           bool _relativeSymOccurs, size_t _opsNum, const AsmExprOp* _ops, size_t _opPosNum,
           const LineCol* _opPos, size_t _argsNum, const AsmExprArg* _args, bool _baseExpr)
@@ -50,11 +238,10 @@ void AsmExpression::setParams(size_t _symOccursNum,
     symOccursNum = _symOccursNum;
     relativeSymOccurs = _relativeSymOccurs;
     baseExpr = _baseExpr;
-    args.reset(new AsmExprArg[_argsNum]);
-    ops.assign(_ops, _ops+_opsNum);
-    messagePositions.reset(new LineCol[_opPosNum]);
-    std::copy(_args, _args+_argsNum, args.get());
-    std::copy(_opPos, _opPos+_opPosNum, messagePositions.get());
+    allocateArrays(_opsNum, _opPosNum, _argsNum);
+    std::copy(_ops, _ops+_opsNum, ops);
+    std::copy(_args, _args+_argsNum, args);
+    std::copy(_opPos, _opPos+_opPosNum, messagePositions);
 }
 
 AsmExpression::AsmExpression(const AsmSourcePos& _pos, size_t _symOccursNum,
@@ -62,29 +249,29 @@ AsmExpression::AsmExpression(const AsmSourcePos& _pos, size_t _symOccursNum,
           const LineCol* _opPos, size_t _argsNum, const AsmExprArg* _args,
           bool _baseExpr)
         : sourcePos(_pos), symOccursNum(_symOccursNum), relativeSymOccurs(_relSymOccurs),
-          baseExpr(_baseExpr), ops(_ops, _ops+_opsNum)
+          baseExpr(_baseExpr), arena(nullptr), opsNum(0), arraysSize(0)
 {
-    args.reset(new AsmExprArg[_argsNum]);
-    messagePositions.reset(new LineCol[_opPosNum]);
-    std::copy(_args, _args+_argsNum, args.get());
-    std::copy(_opPos, _opPos+_opPosNum, messagePositions.get());
+    allocateArrays(_opsNum, _opPosNum, _argsNum);
+    std::copy(_ops, _ops+_opsNum, ops);
+    std::copy(_args, _args+_argsNum, args);
+    std::copy(_opPos, _opPos+_opPosNum, messagePositions);
 }
 
 AsmExpression::AsmExpression(const AsmSourcePos& _pos, size_t _symOccursNum,
             bool _relSymOccurs, size_t _opsNum, size_t _opPosNum, size_t _argsNum,
             bool _baseExpr)
         : sourcePos(_pos), symOccursNum(_symOccursNum), relativeSymOccurs(_relSymOccurs),
-          baseExpr(_baseExpr), ops(_opsNum)
+          baseExpr(_baseExpr), arena(nullptr), opsNum(0), arraysSize(0)
 {
-    args.reset(new AsmExprArg[_argsNum]);
-    messagePositions.reset(new LineCol[_opPosNum]);
+    allocateArrays(_opsNum, _opPosNum, _argsNum);
+    std::fill(ops, ops+_opsNum, AsmExprOp::NONE);
 }
 
 AsmExpression::~AsmExpression()
 {
     if (!baseExpr)
     {   // delete all occurrences in expression at that place
-        for (size_t i = 0, j = 0; i < ops.size(); i++)
+        for (size_t i = 0, j = 0; i < opsNum; i++)
             if (ops[i] == AsmExprOp::ARG_SYMBOL)
             {
                 args[j].symbol->second.removeOccurrenceInExpr(this, j, i);
@@ -93,6 +280,184 @@ AsmExpression::~AsmExpression()
             else if (ops[i]==AsmExprOp::ARG_VALUE)
                 j++;
     }
+    freeArrays();
+}
+
+/* compute operator for absolute values (value2 is first argument of binary operator).
+ * returns false if operator prints message (division by zero, shift out of range),
+ * value is not computed in this case */
+static bool computeAbsoluteOp(AsmExprOp op, uint64_t value2, uint64_t& value)
+{
+    switch (op)
+    {
+        case AsmExprOp::NEGATE:
+            value = -value;
+            break;
+        case AsmExprOp::BIT_NOT:
+            value = ~value;
+            break;
+        case AsmExprOp::LOGICAL_NOT:
+            value = !value;
+            break;
+        case AsmExprOp::ADDITION:
+            value = value2 + value;
+            break;
+        case AsmExprOp::SUBTRACT:
+            value = value2 - value;
+            break;
+        case AsmExprOp::MULTIPLY:
+            value = value2 * value;
+            break;
+        case AsmExprOp::DIVISION:
+            if (value == 0)
+                return false;
+            value = value2 / value;
+            break;
+        case AsmExprOp::SIGNED_DIVISION:
+            if (value == 0)
+                return false;
+            value = int64_t(value2) / int64_t(value);
+            break;
+        case AsmExprOp::MODULO:
+            if (value == 0)
+                return false;
+            value = value2 % value;
+            break;
+        case AsmExprOp::SIGNED_MODULO:
+            if (value == 0)
+                return false;
+            value = int64_t(value2) % int64_t(value);
+            break;
+        case AsmExprOp::BIT_AND:
+            value = value2 & value;
+            break;
+        case AsmExprOp::BIT_OR:
+            value = value2 | value;
+            break;
+        case AsmExprOp::BIT_XOR:
+            value = value2 ^ value;
+            break;
+        case AsmExprOp::BIT_ORNOT:
+            value = value2 | ~value;
+            break;
+        case AsmExprOp::SHIFT_LEFT:
+            if (value >= 64)
+                return false;
+            value = value2 << value;
+            break;
+        case AsmExprOp::SHIFT_RIGHT:
+            if (value >= 64)
+                return false;
+            value = value2 >> value;
+            break;
+        case AsmExprOp::SIGNED_SHIFT_RIGHT:
+            if (value >= 64)
+                return false;
+            value = int64_t(value2) >> value;
+            break;
+        case AsmExprOp::LOGICAL_AND:
+            value = value2 && value;
+            break;
+        case AsmExprOp::LOGICAL_OR:
+            value = value2 || value;
+            break;
+        case AsmExprOp::EQUAL:
+            value = (value2 == value) ? UINT64_MAX : 0;
+            break;
+        case AsmExprOp::NOT_EQUAL:
+            value = (value2 != value) ? UINT64_MAX : 0;
+            break;
+        case AsmExprOp::LESS:
+            value = (int64_t(value2) < int64_t(value))? UINT64_MAX: 0;
+            break;
+        case AsmExprOp::LESS_EQ:
+            value = (int64_t(value2) <= int64_t(value)) ? UINT64_MAX : 0;
+            break;
+        case AsmExprOp::GREATER:
+            value = (int64_t(value2) > int64_t(value)) ? UINT64_MAX : 0;
+            break;
+        case AsmExprOp::GREATER_EQ:
+            value = (int64_t(value2) >= int64_t(value)) ? UINT64_MAX : 0;
+            break;
+        case AsmExprOp::BELOW:
+            value = (value2 < value)? UINT64_MAX: 0;
+            break;
+        case AsmExprOp::BELOW_EQ:
+            value = (value2 <= value) ? UINT64_MAX : 0;
+            break;
+        case AsmExprOp::ABOVE:
+            value = (value2 > value) ? UINT64_MAX : 0;
+            break;
+        case AsmExprOp::ABOVE_EQ:
+            value = (value2 >= value) ? UINT64_MAX : 0;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+size_t AsmExpression::getMessagePosIndex(size_t opIndex) const
+{
+    size_t messagePosIndex = 0;
+    for (size_t i = 0; i < opIndex; i++)
+        if ((operatorWithMessage & (1ULL<<cxuint(ops[i])))!=0)
+            messagePosIndex++;
+    return messagePosIndex;
+}
+
+bool AsmExpression::evaluateSimpleRelative(uint64_t& value, cxuint& sectionId) const
+{
+    /* expression with additions, subtractions and negations is a sum of arguments
+     * multiplied by 1 or -1. subtree in postfix notation has continuous range of
+     * arguments, hence we flip signs of arguments of negated subtree */
+    if (opsNum > 32)
+        return false;
+    size_t rangeStarts[32]; // stack of first arguments of subtrees
+    bool negated[32];
+    size_t stackSize = 0;
+    size_t argsNum = 0;
+    for (size_t i = 0; i < opsNum; i++)
+    {
+        const AsmExprOp op = ops[i];
+        if (op == AsmExprOp::ARG_VALUE)
+        {
+            negated[argsNum] = false;
+            rangeStarts[stackSize++] = argsNum++;
+        }
+        else if (op == AsmExprOp::NEGATE || op == AsmExprOp::SUBTRACT)
+        {   // negate last subtree
+            for (size_t j = rangeStarts[stackSize-1]; j < argsNum; j++)
+                negated[j] = !negated[j];
+            if (op == AsmExprOp::SUBTRACT)
+                stackSize--;
+        }
+        else if (op == AsmExprOp::ADDITION)
+            stackSize--;
+        else
+            return false;
+    }
+    
+    uint64_t outValue = 0;
+    cxuint relSectionId = ASMSECT_ABS;
+    uint64_t relMultiply = 0;
+    for (size_t j = 0; j < argsNum; j++)
+    {
+        const uint64_t argValue = args[j].relValue.value;
+        outValue += negated[j] ? -argValue : argValue;
+        const cxuint argSectionId = args[j].relValue.sectionId;
+        if (argSectionId == ASMSECT_ABS)
+            continue;
+        if (relMultiply != 0 && argSectionId != relSectionId)
+            return false; // many sections
+        relSectionId = argSectionId;
+        relMultiply += negated[j] ? -1 : 1;
+    }
+    if (relMultiply != 0 && relMultiply != 1)
+        return false; // wrong result, general path prints error
+    value = outValue;
+    sectionId = (relMultiply == 1) ? relSectionId : ASMSECT_ABS;
+    return true;
 }
 
 bool AsmExpression::evaluate(Assembler& assembler, size_t opStart, size_t opEnd,
@@ -106,210 +471,70 @@ bool AsmExpression::evaluate(Assembler& assembler, size_t opStart, size_t opEnd,
     cxuint sectionId = 0;
     if (!relativeSymOccurs)
     {   // all value is absolute
-        std::stack<uint64_t> stack;
+        // stack depth is not greater than number of operators
+        uint64_t stackBuf[32];
+        std::unique_ptr<uint64_t[]> heapStack;
+        uint64_t* stack = stackBuf;
+        if (opEnd-opStart > 32)
+        {
+            heapStack.reset(new uint64_t[opEnd-opStart]);
+            stack = heapStack.get();
+        }
+        size_t stackSize = 0;
         
         size_t argPos = 0;
         size_t opPos = 0;
-        size_t messagePosIndex = 0;
-        
         for (opPos = 0; opPos < opStart; opPos++)
-        {
             if (ops[opPos]==AsmExprOp::ARG_VALUE)
                 argPos++;
-            if ((operatorWithMessage & (1ULL<<cxuint(ops[opPos])))!=0)
-                messagePosIndex++;
-        }
         
         while (opPos < opEnd)
         {
             const AsmExprOp op = ops[opPos++];
             if (op == AsmExprOp::ARG_VALUE)
             {
-                stack.push(args[argPos++].value);
+                stack[stackSize++] = args[argPos++].value;
                 continue;
             }
-            value = stack.top();
-            stack.pop();
-            if (isUnaryOp(op))
+            value = stack[--stackSize];
+            if (op == AsmExprOp::CHOICE)
             {
-                switch (op)
-                {
-                    case AsmExprOp::NEGATE:
-                        value = -value;
-                        break;
-                    case AsmExprOp::BIT_NOT:
-                        value = ~value;
-                        break;
-                    case AsmExprOp::LOGICAL_NOT:
-                        value = !value;
-                        break;
-                    default:
-                        break;
-                }
+                const uint64_t value2 = stack[--stackSize];
+                const uint64_t value3 = stack[--stackSize];
+                value = value3 ? value2 : value;
             }
-            else if (isBinaryOp(op))
+            else
             {
-                uint64_t value2 = stack.top();
-                stack.pop();
-                switch (op)
-                {
-                    case AsmExprOp::ADDITION:
-                        value = value2 + value;
-                        break;
-                    case AsmExprOp::SUBTRACT:
-                        value = value2 - value;
-                        break;
-                    case AsmExprOp::MULTIPLY:
-                        value = value2 * value;
-                        break;
-                    case AsmExprOp::DIVISION:
-                        if (value != 0)
-                            value = value2 / value;
-                        else // error
-                        {
-                            assembler.printError(getSourcePos(messagePosIndex),
-                                   "Division by zero");
-                            failed = true;
-                            value = 0;
-                        }
-                        messagePosIndex++;
-                        break;
-                    case AsmExprOp::SIGNED_DIVISION:
-                        if (value != 0)
-                            value = int64_t(value2) / int64_t(value);
-                        else // error
-                        {
-                            assembler.printError(getSourcePos(messagePosIndex),
-                                   "Division by zero");
-                            failed = true;
-                            value = 0;
-                        }
-                        messagePosIndex++;
-                        break;
-                    case AsmExprOp::MODULO:
-                        if (value != 0)
-                            value = value2 % value;
-                        else // error
-                        {
-                            assembler.printError(getSourcePos(messagePosIndex),
-                                   "Division by zero");
-                            failed = true;
-                            value = 0;
-                        }
-                        messagePosIndex++;
-                        break;
-                    case AsmExprOp::SIGNED_MODULO:
-                        if (value != 0)
-                            value = int64_t(value2) % int64_t(value);
-                        else // error
-                        {
-                            assembler.printError(getSourcePos(messagePosIndex),
-                                   "Division by zero");
-                            failed = true;
-                            value = 0;
-                        }
-                        messagePosIndex++;
-                        break;
-                    case AsmExprOp::BIT_AND:
-                        value = value2 & value;
-                        break;
-                    case AsmExprOp::BIT_OR:
-                        value = value2 | value;
-                        break;
-                    case AsmExprOp::BIT_XOR:
-                        value = value2 ^ value;
-                        break;
-                    case AsmExprOp::BIT_ORNOT:
-                        value = value2 | ~value;
-                        break;
-                    case AsmExprOp::SHIFT_LEFT:
-                        if (value < 64)
-                            value = value2 << value;
-                        else
-                        {
-                            assembler.printWarning(getSourcePos(messagePosIndex),
-                                   "Shift count out of range (between 0 and 63)");
-                            value = 0;
-                        }
-                        messagePosIndex++;
-                        break;
-                    case AsmExprOp::SHIFT_RIGHT:
-                        if (value < 64)
-                            value = value2 >> value;
-                        else
-                        {
-                            assembler.printWarning(getSourcePos(messagePosIndex),
-                                   "Shift count out of range (between 0 and 63)");
-                            value = 0;
-                        }
-                        messagePosIndex++;
-                        break;
-                    case AsmExprOp::SIGNED_SHIFT_RIGHT:
-                        if (value < 64)
-                            value = int64_t(value2) >> value;
-                        else
-                        {
-                            assembler.printWarning(getSourcePos(messagePosIndex),
+                const uint64_t value2 = isBinaryOp(op) ? stack[--stackSize] : 0;
+                if (!computeAbsoluteOp(op, value2, value))
+                {   // message positions are only used while printing message
+                    const AsmSourcePos msgPos = getSourcePos(
+                                getMessagePosIndex(opPos-1));
+                    if (op == AsmExprOp::SHIFT_LEFT || op == AsmExprOp::SHIFT_RIGHT ||
+                        op == AsmExprOp::SIGNED_SHIFT_RIGHT)
+                    {
+                        assembler.printWarning(msgPos,
                                    "Shift count out of range (between 0 and 63)");
-                            value = (value2>=(1ULL<<63)) ? UINT64_MAX : 0;
-                        }
-                        messagePosIndex++;
-                        break;
-                    case AsmExprOp::LOGICAL_AND:
-                        value = value2 && value;
-                        break;
-                    case AsmExprOp::LOGICAL_OR:
-                        value = value2 || value;
-                        break;
-                    case AsmExprOp::EQUAL:
-                        value = (value2 == value) ? UINT64_MAX : 0;
-                        break;
-                    case AsmExprOp::NOT_EQUAL:
-                        value = (value2 != value) ? UINT64_MAX : 0;
-                        break;
-                    case AsmExprOp::LESS:
-                        value = (int64_t(value2) < int64_t(value))? UINT64_MAX: 0;
-                        break;
-                    case AsmExprOp::LESS_EQ:
-                        value = (int64_t(value2) <= int64_t(value)) ? UINT64_MAX : 0;
-                        break;
-                    case AsmExprOp::GREATER:
-                        value = (int64_t(value2) > int64_t(value)) ? UINT64_MAX : 0;
-                        break;
-                    case AsmExprOp::GREATER_EQ:
-                        value = (int64_t(value2) >= int64_t(value)) ? UINT64_MAX : 0;
-                        break;
-                    case AsmExprOp::BELOW:
-                        value = (value2 < value)? UINT64_MAX: 0;
-                        break;
-                    case AsmExprOp::BELOW_EQ:
-                        value = (value2 <= value) ? UINT64_MAX : 0;
-                        break;
-                    case AsmExprOp::ABOVE:
-                        value = (value2 > value) ? UINT64_MAX : 0;
-                        break;
-                    case AsmExprOp::ABOVE_EQ:
-                        value = (value2 >= value) ? UINT64_MAX : 0;
-                        break;
-                    default:
-                        break;
+                        value = (op == AsmExprOp::SIGNED_SHIFT_RIGHT &&
+                                value2>=(1ULL<<63)) ? UINT64_MAX : 0;
+                    }
+                    else
+                    {
+                        assembler.printError(msgPos, "Division by zero");
+                        failed = true;
+                        value = 0;
+                    }
                 }
             }
-            else if (op == AsmExprOp::CHOICE)
-            {
-                const uint64_t value2 = stack.top();
-                stack.pop();
-                const uint64_t value3 = stack.top();
-                stack.pop();
-                value = value3 ? value2 : value;
-            }
-            stack.push(value);
+            stack[stackSize++] = value;
         }
         
-        if (!stack.empty())
-            value = stack.top();
+        if (stackSize != 0)
+            value = stack[stackSize-1];
         sectionId = ASMSECT_ABS;
     }
+    else if (opStart == 0 && opEnd == opsNum && evaluateSimpleRelative(value, sectionId))
+    { }  // only additions and subtractions of relative values
     else
     {   // relative symbols
         struct RelMultiply
@@ -821,22 +1046,22 @@ class CLRX_INTERNAL CLRX::AsmExpression::TempSymbolSnapshotMap:
 
 AsmExpression* AsmExpression::createForSnapshot(const AsmSourcePos* exprSourcePos) const
 {
-    std::unique_ptr<AsmExpression> expr(new AsmExpression);
+    // snapshot expression is allocated in same place as this expression
+    std::unique_ptr<AsmExpression> expr((arena != nullptr) ?
+            new(*arena) AsmExpression(arena) : new AsmExpression);
     size_t argsNum = 0;
     size_t msgPosNum = 0;
-    for (AsmExprOp op: ops)
-        if (AsmExpression::isArg(op))
+    for (size_t i = 0; i < opsNum; i++)
+        if (AsmExpression::isArg(ops[i]))
             argsNum++;
-        else if (operatorWithMessage & (1ULL<<int(op)))
+        else if (operatorWithMessage & (1ULL<<int(ops[i])))
             msgPosNum++;
     expr->sourcePos = sourcePos;
     expr->sourcePos.exprSourcePos = exprSourcePos;
-    expr->ops = ops;
-    expr->args.reset(new AsmExprArg[argsNum]);
-    std::copy(args.get(), args.get()+argsNum, expr->args.get());
-    expr->messagePositions.reset(new LineCol[msgPosNum]);
-    std::copy(messagePositions.get(), messagePositions.get()+msgPosNum,
-              expr->messagePositions.get());
+    expr->allocateArrays(opsNum, msgPosNum, argsNum);
+    std::copy(ops, ops+opsNum, expr->ops);
+    std::copy(args, args+argsNum, expr->args);
+    std::copy(messagePositions, messagePositions+msgPosNum, expr->messagePositions);
     return expr.release();
 }
 
@@ -903,10 +1128,10 @@ bool AsmExpression::makeSymbolSnapshot(Assembler& assembler,
         size_t opIndex = se.opIndex;
         size_t argIndex = se.argIndex;
         AsmExpression* expr = se.entry->second.expression;
-        const size_t opsSize = expr->ops.size();
+        const size_t opsSize = expr->opsNum;
         
-        AsmExprArg* args = expr->args.get();
-        AsmExprOp* ops = expr->ops.data();
+        AsmExprArg* args = expr->args;
+        AsmExprOp* ops = expr->ops;
         if (opIndex < opsSize)
         {
             for (; opIndex < opsSize; opIndex++)
@@ -1042,6 +1267,71 @@ bool AsmExpression::makeSymbolSnapshot(Assembler& assembler,
     return good;
 }
 
+/* fold constant subexpressions (operators that have only absolute values as arguments).
+ * operators that print messages while evaluation are not folded */
+static void foldConstantSubexprs(std::vector<AsmExprOp>& ops,
+            std::vector<AsmExprArg>& args, std::vector<LineCol>& msgPositions)
+{
+    std::vector<AsmExprOp> newOps;
+    std::vector<AsmExprArg> newArgs;
+    std::vector<LineCol> newMsgPositions;
+    std::vector<bool> constStack; // true if stack entry is absolute value
+    size_t argIndex = 0;
+    size_t msgPosIndex = 0;
+    bool folded = false;
+    for (AsmExprOp op: ops)
+    {
+        if (op == AsmExprOp::ARG_VALUE || op == AsmExprOp::ARG_SYMBOL)
+        {
+            const AsmExprArg& arg = args[argIndex++];
+            constStack.push_back(op == AsmExprOp::ARG_VALUE &&
+                        arg.relValue.sectionId == ASMSECT_ABS);
+            newOps.push_back(op);
+            newArgs.push_back(arg);
+            continue;
+        }
+        const bool withMessage = (operatorWithMessage & (1ULL<<cxuint(op)))!=0;
+        const size_t opArgsNum = (op == AsmExprOp::CHOICE) ? 3 :
+                    AsmExpression::isUnaryOp(op) ? 1 : 2;
+        bool constArgs = true;
+        for (size_t i = constStack.size()-opArgsNum; i < constStack.size(); i++)
+            constArgs &= constStack[i];
+        if (constArgs)
+        {   // last arguments are absolute values (they are at end of new ops)
+            const AsmExprArg* opArgs = newArgs.data() + newArgs.size()-opArgsNum;
+            uint64_t value = opArgs[opArgsNum-1].value;
+            bool computed = true;
+            if (op == AsmExprOp::CHOICE)
+                value = opArgs[0].value ? opArgs[1].value : value;
+            else
+                computed = computeAbsoluteOp(op, (opArgsNum==2) ? opArgs[0].value : 0,
+                            value);
+            if (computed)
+            {   // replace arguments by result
+                newOps.resize(newOps.size()-opArgsNum+1);
+                newArgs.resize(newArgs.size()-opArgsNum+1);
+                constStack.resize(constStack.size()-opArgsNum+1);
+                newArgs.back().relValue.value = value;
+                newArgs.back().relValue.sectionId = ASMSECT_ABS;
+                if (withMessage)
+                    msgPosIndex++; // skip message position of folded operator
+                folded = true;
+                continue;
+            }
+        }
+        constStack.resize(constStack.size()-opArgsNum+1);
+        constStack.back() = false;
+        newOps.push_back(op);
+        if (withMessage)
+            newMsgPositions.push_back(msgPositions[msgPosIndex++]);
+    }
+    if (!folded)
+        return;
+    ops.swap(newOps);
+    args.swap(newArgs);
+    msgPositions.swap(newMsgPositions);
+}
+
 AsmExpression* AsmExpression::parse(Assembler& assembler, const char*& linePtr,
             bool makeBase, bool dontResolveSymbolsLater)
 {
@@ -1076,8 +1366,11 @@ AsmExpression* AsmExpression::parse(Assembler& assembler, const char*& linePtr,
         XT_ARG = 2
     };
     ExpectedToken expectedToken = XT_FIRST;
-    std::unique_ptr<AsmExpression> expr(new AsmExpression);
+    std::unique_ptr<AsmExpression> expr(new(assembler.exprArena)
+                AsmExpression(&assembler.exprArena));
     expr->sourcePos = assembler.getSourcePos(startString);
+    if ((assembler.flags & ASM_STATS) != 0)
+        assembler.stats.expressionsNum++;
     
     while (linePtr != end)
     {
@@ -1509,6 +1802,9 @@ AsmExpression* AsmExpression::parse(Assembler& assembler, const char*& linePtr,
     
     if (good)
     {
+        if (symOccursNum != 0)
+            // only parts that depend on unresolved symbols will be evaluated later
+            foldConstantSubexprs(ops, args, outMsgPositions);
         const size_t argsNum = args.size();
         // if good, we set symbol occurrences, operators, arguments ...
         expr->setParams(symOccursNum, relativeSymOccurs,
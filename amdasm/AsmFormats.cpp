@@ -108,14 +108,13 @@ bool AsmRawCodeHandler::prepareBinary()
 { return true; }
 
 void AsmRawCodeHandler::writeBinary(std::ostream& os) const
-{
-    const AsmSection& section = assembler.getSections()[0];
-    if (!section.content.empty())
-        os.write((char*)section.content.data(), section.content.size());
+{   // fill runs are expanded while writing
+    assembler.sections[0].writeContent(os);
 }
 
 void AsmRawCodeHandler::writeBinary(Array<cxbyte>& array) const
 {
-    const AsmSection& section = assembler.getSections()[0];
-    array.assign(section.content.begin(), section.content.end());
+    const AsmSection& section = assembler.sections[0];
+    array.allocate(section.getSize());
+    section.writeContent(array.data());
 }
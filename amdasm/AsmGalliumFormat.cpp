@@ -29,7 +29,7 @@
 
 using namespace CLRX;
 
-static const char* galliumPseudoOpNamesTbl[] =
+const char* CLRX::galliumPseudoOpNamesTbl[] =
 {
     "arg", "args", "config",
     "debugmode", "dims", "dx10clamp",
@@ -42,6 +42,9 @@ static const char* galliumPseudoOpNamesTbl[] =
     "userdatanum", "vgprsnum"
 };
 
+const size_t CLRX::galliumPseudoOpNamesNum =
+        sizeof(galliumPseudoOpNamesTbl)/sizeof(char*);
+
 enum
 {
     GALLIUMOP_ARG = 0, GALLIUMOP_ARGS, GALLIUMOP_CONFIG,
@@ -251,10 +254,7 @@ bool AsmGalliumPseudoOps::checkPseudoOpName(const CString& string)
 {
     if (string.empty() || string[0] != '.')
         return false;
-    const size_t pseudoOp = binaryFind(galliumPseudoOpNamesTbl, galliumPseudoOpNamesTbl +
-                sizeof(galliumPseudoOpNamesTbl)/sizeof(char*), string.c_str()+1,
-               CStringLess()) - galliumPseudoOpNamesTbl;
-    return pseudoOp < sizeof(galliumPseudoOpNamesTbl)/sizeof(char*);
+    return getAsmPseudoOpIndex(string, ASMPOT_GALLIUM) != ASMPSEUDOOP_NONE;
 }
 
 void AsmGalliumPseudoOps::doConfig(AsmGalliumHandler& handler, const char* pseudoOpPlace,
@@ -887,9 +887,7 @@ void AsmGalliumPseudoOps::doKCodeEnd(AsmGalliumHandler& handler, const char* pse
 bool AsmGalliumHandler::parsePseudoOp(const CString& firstName,
            const char* stmtPlace, const char* linePtr)
 {
-    const size_t pseudoOp = binaryFind(galliumPseudoOpNamesTbl, galliumPseudoOpNamesTbl +
-                    sizeof(galliumPseudoOpNamesTbl)/sizeof(char*), firstName.c_str()+1,
-                   CStringLess()) - galliumPseudoOpNamesTbl;
+    const size_t pseudoOp = getAsmPseudoOpIndex(firstName, ASMPOT_GALLIUM);
     
     switch(pseudoOp)
     {
@@ -1009,11 +1007,13 @@ bool AsmGalliumHandler::prepareBinary()
     
     for (size_t i = 0; i < sectionsNum; i++)
     {
-        const AsmSection& asmSection = assembler.sections[i];
+        AsmSection& asmSection = assembler.sections[i];
         const Section& section = sections[i];
         const size_t sectionSize = asmSection.getSize();
-        const cxbyte* sectionData = (!asmSection.content.empty()) ?
-                asmSection.content.data() : (const cxbyte*)"";
+        // binary generator requires contiguous content
+        const cxbyte* sectionData = asmSection.getFlatData();
+        if (sectionData == nullptr)
+            sectionData = (const cxbyte*)"";
         switch(asmSection.type)
         {
             case AsmSectionType::CODE:
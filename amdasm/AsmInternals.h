@@ -22,6 +22,7 @@
 
 #include <CLRX/Config.h>
 #include <cstdint>
+#include <climits>
 #include <string>
 #include <utility>
 #include <CLRX/utils/Utilities.h>
@@ -41,7 +42,8 @@ static inline void skipSpacesToEnd(const char*& string, const char* end)
 { while (string!=end && *string == ' ') string++; }
 
 // extract sybol name or argument name or other identifier
-static inline CString extractSymName(const char*& string, const char* end,
+// skip symbol name (without creating string)
+static inline void skipSymName(const char*& string, const char* end,
            bool localLabelSymName)
 {
     const char* startString = string;
@@ -61,6 +63,13 @@ static inline CString extractSymName(const char*& string, const char* end,
                 string = startString;
         }
     }
+}
+
+static inline CString extractSymName(const char*& string, const char* end,
+           bool localLabelSymName)
+{
+    const char* startString = string;
+    skipSymName(string, end, localLabelSymName);
     return CString(startString, string);
 }
 
@@ -79,6 +88,48 @@ void skipSpacesAndLabels(const char*& linePtr, const char* end);
 
 class Assembler;
 
+/// pseudo-op tables (core tables and format handlers' tables)
+enum : cxbyte
+{
+    ASMPOT_CORE = 0,    ///< all main pseudo-ops
+    ASMPOT_OFFLINE,     ///< pseudo-ops used while skipping clauses
+    ASMPOT_MACROREPEAT, ///< pseudo-ops not ignored while putting macro content
+    ASMPOT_AMD,         ///< AMD Catalyst format pseudo-ops
+    ASMPOT_AMDCL2,      ///< AMD OpenCL 2.0 format pseudo-ops
+    ASMPOT_GALLIUM,     ///< Gallium format pseudo-ops
+    ASMPOT_MAX
+};
+
+/// index of pseudo-op that is not in table
+static const cxuint ASMPSEUDOOP_NONE = UINT_MAX;
+
+/// entry of unified pseudo-op dispatch table
+struct CLRX_INTERNAL AsmPseudoOpEntry
+{
+    const char* name;   ///< name (without dot)
+    cxuint ops[ASMPOT_MAX]; ///< index in every pseudo-op table or ASMPSEUDOOP_NONE
+};
+
+/// find pseudo-op in unified dispatch table (name with dot)
+CLRX_INTERNAL extern const AsmPseudoOpEntry* findAsmPseudoOp(const CString& name);
+
+/// get index of pseudo-op in specified table (name with dot)
+static inline cxuint getAsmPseudoOpIndex(const CString& name, cxbyte table)
+{
+    const AsmPseudoOpEntry* entry = findAsmPseudoOp(name);
+    return entry!=nullptr ? entry->ops[table] : ASMPSEUDOOP_NONE;
+}
+
+/// initialize unified pseudo-op dispatch table (called once)
+CLRX_INTERNAL extern void initializeAsmPseudoOps();
+
+CLRX_INTERNAL extern const char* amdPseudoOpNamesTbl[];
+CLRX_INTERNAL extern const size_t amdPseudoOpNamesNum;
+CLRX_INTERNAL extern const char* amdCL2PseudoOpNamesTbl[];
+CLRX_INTERNAL extern const size_t amdCL2PseudoOpNamesNum;
+CLRX_INTERNAL extern const char* galliumPseudoOpNamesTbl[];
+CLRX_INTERNAL extern const size_t galliumPseudoOpNamesNum;
+
 enum class IfIntComp
 {
     EQUAL = 0,
@@ -101,8 +152,11 @@ struct CLRX_INTERNAL AsmParseUtils
     static bool getAnyValueArg(Assembler& asmr, uint64_t& value, cxuint& sectionId,
                     const char*& linePtr);
     
+    /* get jump target. if target is forward symbol (or symbol+constant),
+     * then fixup is returned (outFixup.symbol is not null) */
     static bool getJumpValueArg(Assembler& asmr, uint64_t& value,
-            std::unique_ptr<AsmExpression>& outTargetExpr, const char*& linePtr);
+            std::unique_ptr<AsmExpression>& outTargetExpr, AsmFixup& outFixup,
+            const char*& linePtr);
     // get name (not symbol name)
     static bool getNameArg(Assembler& asmr, CString& outStr, const char*& linePtr,
                const char* objName, bool requiredArg = true,
@@ -272,6 +326,8 @@ struct CLRX_INTERNAL AsmPseudoOps: AsmParseUtils
                       const char* linePtr);
     // purge macro
     static void purgeMacro(Assembler& asmr, const char* linePtr);
+    // load macros from precompiled macro library
+    static void useMacroLibrary(Assembler& asmr, const char* linePtr);
     // do IRP
     static void doIRP(Assembler& asmr, const char* pseudoOpPlace, const char* linePtr,
                       bool perChar = false);
@@ -27,6 +27,7 @@
 #include <set>
 #include <utility>
 #include <algorithm>
+#include <mutex>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/amdbin/AmdBinaries.h>
 #include <CLRX/amdbin/GalliumBinaries.h>
@@ -119,7 +120,7 @@ static const char* pseudoOpNamesTbl[] =
     "short", "single", "size", "skip",
     "space", "string", "string16", "string32",
     "string64", "struct", "text", "title",
-    "undef", "version", "warning", "weak", "word"
+    "undef", "usemacrolib", "version", "warning", "weak", "word"
 };
 
 enum
@@ -155,9 +156,100 @@ enum
     ASMOP_SHORT, ASMOP_SINGLE, ASMOP_SIZE, ASMOP_SKIP,
     ASMOP_SPACE, ASMOP_STRING, ASMOP_STRING16, ASMOP_STRING32,
     ASMOP_STRING64, ASMOP_STRUCT, ASMOP_TEXT, ASMOP_TITLE,
-    ASMOP_UNDEF, ASMOP_VERSION, ASMOP_WARNING, ASMOP_WEAK, ASMOP_WORD
+    ASMOP_UNDEF, ASMOP_USEMACROLIB, ASMOP_VERSION, ASMOP_WARNING, ASMOP_WEAK,
+    ASMOP_WORD
 };
 
+/* unified pseudo-op dispatch table. it holds names from all pseudo-op tables
+ * (core and format handlers' tables) in single open-addressing hash table.
+ * every entry holds index of pseudo-op in every table, hence single lookup
+ * resolves pseudo-op for core and for any format handler */
+
+static std::once_flag asmPseudoOpsOnceFlag;
+static Array<AsmPseudoOpEntry> asmPseudoOpEntries;
+static Array<uint16_t> asmPseudoOpHashTable; // index+1 of entry, zero if empty
+static size_t asmPseudoOpHashMask;
+
+static inline uint32_t hashPseudoOpName(const char* name)
+{   // FNV-1a
+    uint32_t hash = 2166136261U;
+    for (; *name != 0; name++)
+        hash = (hash ^ cxbyte(*name)) * 16777619U;
+    return hash;
+}
+
+static void buildAsmPseudoOpTable()
+{
+    const char* const* tables[ASMPOT_MAX] = { pseudoOpNamesTbl,
+        offlinePseudoOpNamesTbl, macroRepeatPseudoOpNamesTbl,
+        amdPseudoOpNamesTbl, amdCL2PseudoOpNamesTbl, galliumPseudoOpNamesTbl };
+    const size_t tableSizes[ASMPOT_MAX] = {
+        sizeof(pseudoOpNamesTbl)/sizeof(char*),
+        sizeof(offlinePseudoOpNamesTbl)/sizeof(char*),
+        sizeof(macroRepeatPseudoOpNamesTbl)/sizeof(char*),
+        amdPseudoOpNamesNum, amdCL2PseudoOpNamesNum, galliumPseudoOpNamesNum };
+    // collect all names
+    std::vector<const char*> names;
+    for (cxuint t = 0; t < ASMPOT_MAX; t++)
+        names.insert(names.end(), tables[t], tables[t] + tableSizes[t]);
+    std::sort(names.begin(), names.end(), CStringLess());
+    names.resize(std::unique(names.begin(), names.end(),
+            [](const char* a, const char* b) { return ::strcmp(a, b)==0; }) -
+            names.begin());
+    
+    asmPseudoOpEntries.resize(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        asmPseudoOpEntries[i].name = names[i];
+        std::fill(asmPseudoOpEntries[i].ops, asmPseudoOpEntries[i].ops + ASMPOT_MAX,
+                  ASMPSEUDOOP_NONE);
+    }
+    for (cxuint t = 0; t < ASMPOT_MAX; t++)
+        for (size_t i = 0; i < tableSizes[t]; i++)
+        {
+            const size_t index = binaryFind(names.begin(), names.end(),
+                        tables[t][i], CStringLess()) - names.begin();
+            asmPseudoOpEntries[index].ops[t] = i;
+        }
+    
+    // hash table is filled at most in 25%
+    size_t hashSize = 16;
+    while (hashSize < (names.size()<<2))
+        hashSize <<= 1;
+    asmPseudoOpHashMask = hashSize-1;
+    asmPseudoOpHashTable.resize(hashSize);
+    std::fill(asmPseudoOpHashTable.begin(), asmPseudoOpHashTable.end(), 0);
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        size_t slot = hashPseudoOpName(names[i]) & asmPseudoOpHashMask;
+        while (asmPseudoOpHashTable[slot] != 0)
+            slot = (slot+1) & asmPseudoOpHashMask;
+        asmPseudoOpHashTable[slot] = i+1;
+    }
+}
+
+void CLRX::initializeAsmPseudoOps()
+{
+    std::call_once(asmPseudoOpsOnceFlag, buildAsmPseudoOpTable);
+}
+
+const AsmPseudoOpEntry* CLRX::findAsmPseudoOp(const CString& name)
+{
+    if (name.empty() || name[0] != '.')
+        return nullptr;
+    const char* opName = name.c_str()+1;
+    for (size_t slot = hashPseudoOpName(opName) & asmPseudoOpHashMask; ;
+                slot = (slot+1) & asmPseudoOpHashMask)
+    {
+        const uint16_t index = asmPseudoOpHashTable[slot];
+        if (index == 0)
+            return nullptr;
+        const AsmPseudoOpEntry& entry = asmPseudoOpEntries[index-1];
+        if (::strcmp(entry.name, opName)==0)
+            return &entry;
+    }
+}
+
 namespace CLRX
 {
 
@@ -424,9 +516,27 @@ void AsmPseudoOps::includeFile(Assembler& asmr, const char* pseudoOpPlace,
         sysfilename = filename;
         bool failedOpen = false;
         filesystemPath(sysfilename);
+        const CString includeName(sysfilename.c_str());
+        // if file has been already found, use that path without searching
+        auto resIt = asmr.includeResolutions.find(includeName);
+        if (resIt != asmr.includeResolutions.end())
+        {
+            try
+            {
+                asmr.includeFile(pseudoOpPlace, resIt->second.c_str());
+                return;
+            }
+            catch(const Exception&)
+            {
+                /* cached path is no longer valid (file removed or moved):
+                 * forget it and resolve the name again by searching below */
+                asmr.includeResolutions.erase(resIt);
+            }
+        }
         try
         {
-            asmr.includeFile(pseudoOpPlace, sysfilename);
+            if (asmr.includeFile(pseudoOpPlace, sysfilename))
+                asmr.includeResolutions[includeName] = includeName;
             return;
         }
         catch(const Exception& ex)
@@ -439,8 +549,10 @@ void AsmPseudoOps::includeFile(Assembler& asmr, const char* pseudoOpPlace,
             filesystemPath(incDirPath);
             try
             {
-                asmr.includeFile(pseudoOpPlace, joinPaths(
-                            std::string(incDirPath.c_str()), sysfilename));
+                const std::string path = joinPaths(
+                            std::string(incDirPath.c_str()), sysfilename);
+                if (asmr.includeFile(pseudoOpPlace, path))
+                    asmr.includeResolutions[includeName] = path.c_str();
                 break;
             }
             catch(const Exception& ex)
@@ -452,6 +564,9 @@ void AsmPseudoOps::includeFile(Assembler& asmr, const char* pseudoOpPlace,
     }
 }
 
+/* minimal size of .incbin region that is held as reference to mapped file */
+static const uint64_t minMappedBinSize = 4096;
+
 void AsmPseudoOps::includeBinFile(Assembler& asmr, const char* pseudoOpPlace,
                           const char* linePtr)
 {
@@ -519,14 +634,16 @@ void AsmPseudoOps::includeBinFile(Assembler& asmr, const char* pseudoOpPlace,
     std::ifstream ifs;
     sysfilename = filename;
     filesystemPath(sysfilename);
-    ifs.open(sysfilename.c_str(), std::ios::binary);
+    std::string path = sysfilename;
+    ifs.open(path.c_str(), std::ios::binary);
     if (!ifs)
     {
         for (const CString& incDir: asmr.includeDirs)
         {
             std::string incDirPath(incDir.c_str());
             filesystemPath(incDirPath);
-            ifs.open(joinPaths(incDirPath.c_str(), sysfilename).c_str(), std::ios::binary);
+            path = joinPaths(incDirPath.c_str(), sysfilename);
+            ifs.open(path.c_str(), std::ios::binary);
             if (ifs)
                 break;
         }
@@ -555,6 +672,20 @@ void AsmPseudoOps::includeBinFile(Assembler& asmr, const char* pseudoOpPlace,
             return; // do nothing
         ifs.seekg(offset, std::ios::beg);
         const uint64_t toRead = std::min(size-offset, count);
+        if (toRead >= minMappedBinSize && MappedFile::isMappable(path.c_str()))
+        {   /* big region of regular file is not copied,
+             * section refers to mapped file, and its data is copied while writing */
+            RefPtr<const MappedFile> mappedFile;
+            try
+            { mappedFile = RefPtr<const MappedFile>(new MappedFile(path.c_str())); }
+            catch(const Exception& ex)
+            { } // if failed, read file normally
+            if (mappedFile && mappedFile->size() >= offset+toRead)
+            {
+                asmr.putMappedData(mappedFile, offset, toRead);
+                return;
+            }
+        }
         char* output = reinterpret_cast<char*>(asmr.reserveData(toRead));
         ifs.read(output, toRead);
         if (ifs.gcount() != std::streamsize(toRead))
@@ -1058,10 +1189,15 @@ void AsmPseudoOps::doFill(Assembler& asmr, const char* pseudoOpPlace, const char
         value &= 0xffffffffUL;
     
     /* do fill */
-    cxbyte* content = asmr.reserveData(size*repeat);
     const size_t valueSize = std::min(uint64_t(8), size);
     uint64_t outValue;
     SLEV(outValue, value);
+    if (size <= 8)
+    {   // value is pattern (can be held as fill run)
+        asmr.fillData(size*repeat, size, reinterpret_cast<const cxbyte*>(&outValue));
+        return;
+    }
+    cxbyte* content = asmr.reserveData(size*repeat);
     // main filling route (slow)
     for (uint64_t r = 0; r < repeat; r++)
     {
@@ -1112,7 +1248,8 @@ void AsmPseudoOps::doSkip(Assembler& asmr, const char* pseudoOpPlace, const char
     
     if (asmr.currentSection==ASMSECT_ABS && value != 0)
         asmr.printWarning(fillValuePlace, "Fill value is ignored inside absolute section");
-    asmr.reserveData(size, value&0xff);
+    const cxbyte fillValue = value&0xff;
+    asmr.fillData(size, 1, &fillValue);
 }
 
 void AsmPseudoOps::doAlign(Assembler& asmr, const char* pseudoOpPlace,
@@ -1187,7 +1324,10 @@ void AsmPseudoOps::doAlign(Assembler& asmr, const char* pseudoOpPlace,
         asmr.printWarning(valuePlace, "Fill value is ignored inside absolute section");
     
     if (haveValue || asmr.sections[asmr.currentSection].type != AsmSectionType::CODE)
-        asmr.reserveData(bytesToFill, value&0xff);
+    {
+        const cxbyte fillValue = value&0xff;
+        asmr.fillData(bytesToFill, 1, &fillValue);
+    }
     else /* only if no value and is code section */
     {
         cxbyte* output = asmr.reserveData(bytesToFill, 0);
@@ -1925,6 +2065,57 @@ void AsmPseudoOps::purgeMacro(Assembler& asmr, const char* linePtr)
                 "' already doesn't exist").c_str());
 }
 
+void AsmPseudoOps::useMacroLibrary(Assembler& asmr, const char* linePtr)
+{
+    const char* end = asmr.line+asmr.lineSize;
+    skipSpacesToEnd(linePtr, end);
+    std::string filename, sysfilename;
+    const char* namePlace = linePtr;
+    if (!asmr.parseString(filename, linePtr) || !checkGarbagesAtEnd(asmr, linePtr))
+        return;
+    sysfilename = filename;
+    filesystemPath(sysfilename);
+    // find library in current directory and in include directories
+    std::string path;
+    if (MappedFile::isMappable(sysfilename.c_str()))
+        path = sysfilename;
+    else
+        for (const CString& incDir: asmr.includeDirs)
+        {
+            std::string incDirPath(incDir.c_str());
+            filesystemPath(incDirPath);
+            std::string incPath = joinPaths(incDirPath, sysfilename);
+            if (MappedFile::isMappable(incPath.c_str()))
+            {
+                path = incPath;
+                break;
+            }
+        }
+    if (path.empty())
+    {
+        asmr.printError(namePlace, (std::string("Macro library '") + filename +
+                    "' not found or unavailable in any directory").c_str());
+        return;
+    }
+    
+    AsmMacroList macros;
+    try
+    {
+        MappedFile libFile(path.c_str());
+        macros = readAsmMacroLibrary(libFile.size(), libFile.data());
+    }
+    catch(const Exception& ex)
+    {
+        asmr.printError(namePlace, (std::string("Can't load macro library '") +
+                    filename + "': " + ex.what()).c_str());
+        return;
+    }
+    for (const auto& entry: macros)
+        if (!asmr.macroMap.insert(entry).second)
+            asmr.printError(namePlace, (std::string("Macro '") + entry.first.c_str() +
+                    "' is already defined").c_str());
+}
+
 void AsmPseudoOps::undefSymbol(Assembler& asmr, const char* linePtr)
 {
     const char* end = asmr.line+asmr.lineSize;
@@ -2058,18 +2249,10 @@ void AsmPseudoOps::ignoreString(Assembler& asmr, const char* linePtr)
 
 bool AsmPseudoOps::checkPseudoOpName(const CString& string)
 {
-    if (string.empty() || string[0] != '.')
-        return false;
-    const size_t pseudoOp = binaryFind(pseudoOpNamesTbl, pseudoOpNamesTbl +
-                    sizeof(pseudoOpNamesTbl)/sizeof(char*), string.c_str()+1,
-                   CStringLess()) - pseudoOpNamesTbl;
-    if (pseudoOp < sizeof(pseudoOpNamesTbl)/sizeof(char*))
-        return true;
-    if (AsmGalliumPseudoOps::checkPseudoOpName(string))
-        return true;
-    if (AsmAmdPseudoOps::checkPseudoOpName(string))
-        return true;
-    return false;
+    const AsmPseudoOpEntry* entry = findAsmPseudoOp(string);
+    return entry != nullptr && (entry->ops[ASMPOT_CORE] != ASMPSEUDOOP_NONE ||
+            entry->ops[ASMPOT_GALLIUM] != ASMPSEUDOOP_NONE ||
+            entry->ops[ASMPOT_AMD] != ASMPSEUDOOP_NONE);
 }
 
 };
@@ -2077,9 +2260,9 @@ bool AsmPseudoOps::checkPseudoOpName(const CString& string)
 void Assembler::parsePseudoOps(const CString& firstName,
        const char* stmtPlace, const char* linePtr)
 {
-    const size_t pseudoOp = binaryFind(pseudoOpNamesTbl, pseudoOpNamesTbl +
-                    sizeof(pseudoOpNamesTbl)/sizeof(char*), firstName.c_str()+1,
-                   CStringLess()) - pseudoOpNamesTbl;
+    const AsmPseudoOpEntry* entry = findAsmPseudoOp(firstName);
+    const size_t pseudoOp = (entry != nullptr) ? entry->ops[ASMPOT_CORE] :
+                ASMPSEUDOOP_NONE;
     
     switch(pseudoOp)
     {
@@ -2480,6 +2663,9 @@ void Assembler::parsePseudoOps(const CString& firstName,
         case ASMOP_UNDEF:
             AsmPseudoOps::undefSymbol(*this, linePtr);
             break;
+        case ASMOP_USEMACROLIB:
+            AsmPseudoOps::useMacroLibrary(*this, linePtr);
+            break;
         case ASMOP_WARNING:
             AsmPseudoOps::doWarning(*this, stmtPlace, linePtr);
             break;
@@ -2491,9 +2677,12 @@ void Assembler::parsePseudoOps(const CString& firstName,
             break;
         default:
         {
-            bool isGalliumPseudoOp = AsmGalliumPseudoOps::checkPseudoOpName(firstName);
-            bool isAmdPseudoOp = AsmAmdPseudoOps::checkPseudoOpName(firstName);
-            bool isAmdCL2PseudoOp = AsmAmdCL2PseudoOps::checkPseudoOpName(firstName);
+            bool isGalliumPseudoOp = entry != nullptr &&
+                    entry->ops[ASMPOT_GALLIUM] != ASMPSEUDOOP_NONE;
+            bool isAmdPseudoOp = entry != nullptr &&
+                    entry->ops[ASMPOT_AMD] != ASMPSEUDOOP_NONE;
+            bool isAmdCL2PseudoOp = entry != nullptr &&
+                    entry->ops[ASMPOT_AMDCL2] != ASMPSEUDOOP_NONE;
             if (isGalliumPseudoOp || isAmdPseudoOp || isAmdCL2PseudoOp)
             {   // initialize only if gallium pseudo-op or AMD pseudo-op
                 initializeOutputFormat();
@@ -2567,9 +2756,7 @@ bool Assembler::skipClauses(bool exitm)
         CString pseudoOpName = extractSymName(linePtr, end, false);
         toLowerString(pseudoOpName);
         
-        const size_t pseudoOp = binaryFind(offlinePseudoOpNamesTbl,
-               offlinePseudoOpNamesTbl + sizeof(offlinePseudoOpNamesTbl)/sizeof(char*),
-               pseudoOpName.c_str()+1, CStringLess()) - offlinePseudoOpNamesTbl;
+        const size_t pseudoOp = getAsmPseudoOpIndex(pseudoOpName, ASMPOT_OFFLINE);
         
         // any conditional inside macro or repeat will be ignored
         bool insideMacroOrRepeat = !clauses.empty() && 
@@ -2711,10 +2898,7 @@ bool Assembler::putMacroContent(RefPtr<AsmMacro> macro)
         CString pseudoOpName = extractSymName(linePtr, end, false);
         toLowerString(pseudoOpName);
         
-        const size_t pseudoOp = binaryFind(macroRepeatPseudoOpNamesTbl,
-               macroRepeatPseudoOpNamesTbl + sizeof(macroRepeatPseudoOpNamesTbl) /
-               sizeof(char*), pseudoOpName.c_str()+1, CStringLess()) -
-               macroRepeatPseudoOpNamesTbl;
+        const size_t pseudoOp = getAsmPseudoOpIndex(pseudoOpName, ASMPOT_MACROREPEAT);
         switch(pseudoOp)
         {
             case ASMMROP_ENDM:
@@ -2772,10 +2956,7 @@ bool Assembler::putRepetitionContent(AsmRepeat& repeat)
         
         CString pseudoOpName = extractSymName(linePtr, end, false);
         toLowerString(pseudoOpName);
-        const size_t pseudoOp = binaryFind(macroRepeatPseudoOpNamesTbl,
-               macroRepeatPseudoOpNamesTbl + sizeof(macroRepeatPseudoOpNamesTbl) /
-               sizeof(char*), pseudoOpName.c_str()+1, CStringLess()) -
-               macroRepeatPseudoOpNamesTbl;
+        const size_t pseudoOp = getAsmPseudoOpIndex(pseudoOpName, ASMPOT_MACROREPEAT);
         switch(pseudoOp)
         {
             case ASMMROP_ENDM:
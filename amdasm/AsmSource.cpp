@@ -18,11 +18,22 @@
  */
 
 #include <CLRX/Config.h>
+#if defined(HAVE_ARCH_INTEL) && (defined(__SSE2__) || defined(_M_X64) || \
+        (defined(_M_IX86_FP) && _M_IX86_FP>=2))
+#  define HAVE_ASM_LINESCAN_SSE2 1
+#  include <emmintrin.h>
+#  if (defined(__GNUC__) && __GNUC__>=5) || defined(__clang__)
+#    define HAVE_ASM_LINESCAN_AVX2 1
+#    include <immintrin.h>
+#  endif
+#endif
 #include <string>
+#include <cstring>
 #include <fstream>
 #include <vector>
 #include <utility>
 #include <algorithm>
+#include <unordered_map>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/amdasm/Assembler.h>
 #include "AsmInternals.h"
@@ -46,6 +57,17 @@ AsmMacroSource::~AsmMacroSource()
 AsmRepeatSource::~AsmRepeatSource()
 { }
 
+/* AsmFilteredSource */
+
+void AsmFilteredSource::addLine(const std::vector<LineTrans>& colTrans, size_t lineSize,
+                const char* line)
+{
+    content.insert(content.end(), line, line+lineSize);
+    content.push_back('\n');
+    colTranslations.insert(colTranslations.end(), colTrans.begin(), colTrans.end());
+    colTransEnds.push_back(colTranslations.size());
+}
+
 /* Asm Macro */
 AsmMacro::AsmMacro(const AsmSourcePos& _pos, const Array<AsmMacroArg>& _args)
         : contentLineNo(0), sourcePos(_pos), args(_args)
@@ -58,10 +80,12 @@ AsmMacro::AsmMacro(const AsmSourcePos& _pos, Array<AsmMacroArg>&& _args)
 void AsmMacro::addLine(RefPtr<const AsmMacroSubst> macro, RefPtr<const AsmSource> source,
            const std::vector<LineTrans>& colTrans, size_t lineSize, const char* line)
 {
+    const size_t lineStart = content.size();
     content.insert(content.end(), line, line+lineSize);
     // line can be empty and can be not finished by newline
     if (lineSize==0 || (lineSize > 0 && line[lineSize-1] != '\n'))
         content.push_back('\n');
+    compileContent(lineStart);
     colTranslations.insert(colTranslations.end(), colTrans.begin(), colTrans.end());
     if (!macro)
     {
@@ -90,6 +114,447 @@ void AsmMacro::addLine(RefPtr<const AsmMacroSubst> macro, RefPtr<const AsmSource
     contentLineNo++;
 }
 
+AsmMacro::AsmMacro(const AsmSourcePos& _pos, Array<AsmMacroArg>&& _args,
+            std::vector<char>&& _content, std::vector<SourceTrans>&& _sourceTrans,
+            std::vector<LineTrans>&& _colTrans)
+        : contentLineNo(std::count(_content.begin(), _content.end(), '\n')),
+          sourcePos(_pos), args(std::move(_args)), content(std::move(_content)),
+          sourceTranslations(std::move(_sourceTrans)),
+          colTranslations(std::move(_colTrans))
+{
+    compileContent(0);
+}
+
+/* split lines of content into text segments and substitutions of arguments and
+ * macro count (rules of non-alternate mode), to avoid scanning lines and
+ * searching arguments at every macro substitution */
+void AsmMacro::compileContent(size_t startPos)
+{
+    const char* text = content.data();
+    const size_t contentSize = content.size();
+    size_t pos = startPos;
+    while (pos < contentSize)
+    {
+        const size_t segmentsStart = segments.size();
+        size_t textStart = pos;
+        auto addText = [this, &textStart](size_t textEnd)
+        {
+            if (textEnd != textStart)
+                segments.push_back({ SegmentType::TEXT, textStart, textEnd-textStart });
+        };
+        while (text[pos] != '\n')
+        {
+            if (text[pos] != '\\')
+            {
+                pos++;
+                continue;
+            }
+            const size_t bslashPos = pos++;
+            if (text[pos] == '(' && text[pos+1] == ')')
+            {   // skip separator
+                addText(bslashPos);
+                textStart = pos = pos+2;
+                continue;
+            }
+            const char* thisPos = text + pos;
+            const CString symName = extractSymName(thisPos, text+contentSize, false);
+            size_t argIndex = SIZE_MAX;
+            if (!symName.empty())
+                for (size_t i = 0; i < args.size(); i++)
+                    if (args[i].name == symName)
+                    {
+                        argIndex = i;
+                        break;
+                    }
+            if (argIndex != SIZE_MAX)
+            {
+                addText(bslashPos);
+                segments.push_back({ SegmentType::ARG, argIndex, 0 });
+                textStart = pos = thisPos-text;
+            }
+            else if (text[pos] == '@')
+            {
+                addText(bslashPos);
+                segments.push_back({ SegmentType::COUNT, 0, 0 });
+                textStart = ++pos;
+            }
+            // otherwise backslash is copied with text
+        }
+        addText(pos);
+        compiledLines.push_back({ segmentsStart, segments.size(), pos });
+        pos++; // skip newline
+    }
+}
+
+/* Asm macro library */
+
+/* format of macro library (all integers are little-endian):
+ * magic "CLRXMACL", uint32 version, uint32 nodes number, nodes,
+ * uint32 macros number, macros.
+ * node is source (file, macro source, repetition) or macro substitution, and
+ * refers to earlier nodes by its index+1 (0 is null). */
+
+static const char asmMacroLibMagic[8] = { 'C', 'L', 'R', 'X', 'M', 'A', 'C', 'L' };
+static const uint32_t asmMacroLibVersion = 1;
+
+enum : cxbyte
+{
+    ASMMACLIB_FILE = 0, ASMMACLIB_MACRO, ASMMACLIB_REPT, ASMMACLIB_SUBST
+};
+
+namespace
+{
+
+class AsmMacroLibWriter
+{
+private:
+    std::vector<cxbyte> nodes;
+    uint32_t nodesNum;
+    std::unordered_map<const void*, uint32_t> nodeIndices;
+public:
+    AsmMacroLibWriter() : nodesNum(0)
+    { }
+    
+    static void putInt(std::vector<cxbyte>& out, uint64_t value, cxuint bytes)
+    {
+        for (cxuint i = 0; i < bytes; i++, value >>= 8)
+            out.push_back(value & 0xff);
+    }
+    static void putString(std::vector<cxbyte>& out, const char* str, size_t size)
+    {
+        putInt(out, size, 4);
+        out.insert(out.end(), str, str+size);
+    }
+    
+    uint32_t addSource(const RefPtr<const AsmSource>& source);
+    uint32_t addMacroSubst(const RefPtr<const AsmMacroSubst>& macroSubst);
+    
+    void write(std::ostream& os, const std::vector<cxbyte>& macros, uint32_t macrosNum);
+};
+
+};
+
+uint32_t AsmMacroLibWriter::addSource(const RefPtr<const AsmSource>& source)
+{
+    if (!source)
+        return 0;
+    auto it = nodeIndices.find(source.operator->());
+    if (it != nodeIndices.end())
+        return it->second;
+    // parents must be written before this node
+    std::vector<cxbyte> node;
+    switch(source->type)
+    {
+        case AsmSourceType::FILE:
+        {
+            RefPtr<const AsmFile> file = source.staticCast<const AsmFile>();
+            const uint32_t parent = addSource(file->parent);
+            node.push_back(ASMMACLIB_FILE);
+            putInt(node, parent, 4);
+            putInt(node, file->lineNo, 8);
+            putInt(node, file->colNo, 8);
+            putString(node, file->file.c_str(), file->file.size());
+            break;
+        }
+        case AsmSourceType::MACRO:
+        {
+            RefPtr<const AsmMacroSource> macroSource =
+                    source.staticCast<const AsmMacroSource>();
+            const uint32_t macro = addMacroSubst(macroSource->macro);
+            const uint32_t contentSource = addSource(macroSource->source);
+            node.push_back(ASMMACLIB_MACRO);
+            putInt(node, macro, 4);
+            putInt(node, contentSource, 4);
+            break;
+        }
+        case AsmSourceType::REPT:
+        {
+            RefPtr<const AsmRepeatSource> repeatSource =
+                    source.staticCast<const AsmRepeatSource>();
+            const uint32_t contentSource = addSource(repeatSource->source);
+            node.push_back(ASMMACLIB_REPT);
+            putInt(node, contentSource, 4);
+            putInt(node, repeatSource->repeatCount, 8);
+            putInt(node, repeatSource->repeatsNum, 8);
+            break;
+        }
+    }
+    nodes.insert(nodes.end(), node.begin(), node.end());
+    return nodeIndices[source.operator->()] = ++nodesNum;
+}
+
+uint32_t AsmMacroLibWriter::addMacroSubst(const RefPtr<const AsmMacroSubst>& macroSubst)
+{
+    if (!macroSubst)
+        return 0;
+    auto it = nodeIndices.find(macroSubst.operator->());
+    if (it != nodeIndices.end())
+        return it->second;
+    const uint32_t parent = addMacroSubst(macroSubst->parent);
+    const uint32_t source = addSource(macroSubst->source);
+    nodes.push_back(ASMMACLIB_SUBST);
+    putInt(nodes, parent, 4);
+    putInt(nodes, source, 4);
+    putInt(nodes, macroSubst->lineNo, 8);
+    putInt(nodes, macroSubst->colNo, 8);
+    return nodeIndices[macroSubst.operator->()] = ++nodesNum;
+}
+
+void AsmMacroLibWriter::write(std::ostream& os, const std::vector<cxbyte>& macros,
+            uint32_t macrosNum)
+{
+    std::vector<cxbyte> header;
+    header.insert(header.end(), asmMacroLibMagic, asmMacroLibMagic+8);
+    putInt(header, asmMacroLibVersion, 4);
+    putInt(header, nodesNum, 4);
+    os.write((const char*)header.data(), header.size());
+    os.write((const char*)nodes.data(), nodes.size());
+    header.clear();
+    putInt(header, macrosNum, 4);
+    os.write((const char*)header.data(), header.size());
+    os.write((const char*)macros.data(), macros.size());
+}
+
+void CLRX::writeAsmMacroLibrary(std::ostream& os, const AsmMacroList& macros)
+{
+    AsmMacroLibWriter writer;
+    std::vector<cxbyte> out;
+    for (const auto& entry: macros)
+    {
+        const RefPtr<const AsmMacro>& macro = entry.second;
+        AsmMacroLibWriter::putString(out, entry.first.c_str(), entry.first.size());
+        const AsmSourcePos& pos = macro->getSourcePos();
+        AsmMacroLibWriter::putInt(out, writer.addMacroSubst(pos.macro), 4);
+        AsmMacroLibWriter::putInt(out, writer.addSource(pos.source), 4);
+        AsmMacroLibWriter::putInt(out, pos.lineNo, 8);
+        AsmMacroLibWriter::putInt(out, pos.colNo, 8);
+        // arguments
+        AsmMacroLibWriter::putInt(out, macro->getArgsNum(), 4);
+        for (size_t i = 0; i < macro->getArgsNum(); i++)
+        {
+            const AsmMacroArg& arg = macro->getArg(i);
+            AsmMacroLibWriter::putString(out, arg.name.c_str(), arg.name.size());
+            AsmMacroLibWriter::putString(out, arg.defaultValue.c_str(),
+                        arg.defaultValue.size());
+            out.push_back((arg.vararg ? 1 : 0) | (arg.required ? 2 : 0));
+        }
+        // content
+        const std::vector<char>& content = macro->getContent();
+        AsmMacroLibWriter::putInt(out, content.size(), 8);
+        out.insert(out.end(), content.begin(), content.end());
+        AsmMacroLibWriter::putInt(out, macro->getSourceTransSize(), 8);
+        for (size_t i = 0; i < macro->getSourceTransSize(); i++)
+        {
+            const AsmMacro::SourceTrans& trans = macro->getSourceTrans(i);
+            AsmMacroLibWriter::putInt(out, trans.lineNo, 8);
+            AsmMacroLibWriter::putInt(out, writer.addSource(trans.source), 4);
+        }
+        const std::vector<LineTrans>& colTrans = macro->getColTranslations();
+        AsmMacroLibWriter::putInt(out, colTrans.size(), 8);
+        for (const LineTrans& trans: colTrans)
+        {
+            AsmMacroLibWriter::putInt(out, trans.position, 8);
+            AsmMacroLibWriter::putInt(out, trans.lineNo, 8);
+        }
+    }
+    writer.write(os, out, macros.size());
+}
+
+namespace
+{
+
+class AsmMacroLibReader
+{
+private:
+    const cxbyte* data;
+    const cxbyte* end;
+    struct Node
+    {
+        RefPtr<const AsmSource> source;
+        RefPtr<const AsmMacroSubst> macroSubst;
+    };
+    std::vector<Node> nodes;
+public:
+    AsmMacroLibReader(size_t size, const cxbyte* _data) : data(_data), end(_data+size)
+    { }
+    
+    void need(uint64_t size)
+    {
+        if (uint64_t(end-data) < size)
+            throw Exception("Macro library is truncated");
+    }
+    // check whether library holds num elements of elemSize
+    void needArray(uint64_t num, size_t elemSize)
+    {
+        if (uint64_t(end-data) / elemSize < num)
+            throw Exception("Macro library is truncated");
+    }
+    uint64_t getInt(cxuint bytes)
+    {
+        need(bytes);
+        uint64_t value = 0;
+        for (cxuint i = 0; i < bytes; i++)
+            value |= uint64_t(data[i]) << (i<<3);
+        data += bytes;
+        return value;
+    }
+    CString getString()
+    {
+        const size_t size = getInt(4);
+        need(size);
+        CString str((const char*)data, (const char*)data+size);
+        data += size;
+        return str;
+    }
+    RefPtr<const AsmSource> getSource()
+    {
+        const uint32_t index = getInt(4);
+        if (index == 0)
+            return RefPtr<const AsmSource>();
+        if (index > nodes.size() || !nodes[index-1].source)
+            throw Exception("Wrong source reference in macro library");
+        return nodes[index-1].source;
+    }
+    RefPtr<const AsmMacroSubst> getMacroSubst()
+    {
+        const uint32_t index = getInt(4);
+        if (index == 0)
+            return RefPtr<const AsmMacroSubst>();
+        if (index > nodes.size() || !nodes[index-1].macroSubst)
+            throw Exception("Wrong macro substitution reference in macro library");
+        return nodes[index-1].macroSubst;
+    }
+    
+    void readNodes();
+    AsmMacroList readMacros();
+};
+
+};
+
+void AsmMacroLibReader::readNodes()
+{
+    need(16);
+    if (::memcmp(data, asmMacroLibMagic, 8) != 0)
+        throw Exception("This is not macro library");
+    data += 8;
+    if (getInt(4) != asmMacroLibVersion)
+        throw Exception("Unsupported version of macro library");
+    const uint32_t nodesNum = getInt(4);
+    for (uint32_t i = 0; i < nodesNum; i++)
+    {
+        Node node;
+        need(1);
+        const cxbyte nodeType = *data++;
+        switch(nodeType)
+        {
+            case ASMMACLIB_FILE:
+            {
+                RefPtr<const AsmSource> parent = getSource();
+                const LineNo lineNo = getInt(8);
+                const ColNo colNo = getInt(8);
+                node.source = RefPtr<const AsmSource>(
+                        new AsmFile(parent, lineNo, colNo, getString()));
+                break;
+            }
+            case ASMMACLIB_MACRO:
+            {
+                RefPtr<const AsmMacroSubst> macro = getMacroSubst();
+                node.source = RefPtr<const AsmSource>(
+                        new AsmMacroSource(macro, getSource()));
+                break;
+            }
+            case ASMMACLIB_REPT:
+            {
+                RefPtr<const AsmSource> source = getSource();
+                const uint64_t repeatCount = getInt(8);
+                node.source = RefPtr<const AsmSource>(
+                        new AsmRepeatSource(source, repeatCount, getInt(8)));
+                break;
+            }
+            case ASMMACLIB_SUBST:
+            {
+                RefPtr<const AsmMacroSubst> parent = getMacroSubst();
+                RefPtr<const AsmSource> source = getSource();
+                const LineNo lineNo = getInt(8);
+                node.macroSubst = RefPtr<const AsmMacroSubst>(
+                        new AsmMacroSubst(parent, source, lineNo, getInt(8)));
+                break;
+            }
+            default:
+                throw Exception("Unknown node type in macro library");
+        }
+        nodes.push_back(node);
+    }
+}
+
+AsmMacroList AsmMacroLibReader::readMacros()
+{
+    AsmMacroList macros;
+    const uint32_t macrosNum = getInt(4);
+    for (uint32_t i = 0; i < macrosNum; i++)
+    {
+        CString name = getString();
+        AsmSourcePos pos;
+        pos.macro = getMacroSubst();
+        pos.source = getSource();
+        pos.lineNo = getInt(8);
+        pos.colNo = getInt(8);
+        pos.exprSourcePos = nullptr;
+        // arguments
+        const uint32_t argsNum = getInt(4);
+        needArray(argsNum, 9);
+        Array<AsmMacroArg> args(argsNum);
+        for (AsmMacroArg& arg: args)
+        {
+            arg.name = getString();
+            arg.defaultValue = getString();
+            const cxbyte argFlags = getInt(1);
+            arg.vararg = (argFlags & 1) != 0;
+            arg.required = (argFlags & 2) != 0;
+        }
+        // content
+        const uint64_t contentSize = getInt(8);
+        need(contentSize);
+        std::vector<char> content((const char*)data, (const char*)data+contentSize);
+        data += contentSize;
+        const uint64_t sourceTransNum = getInt(8);
+        needArray(sourceTransNum, 12);
+        std::vector<AsmMacro::SourceTrans> sourceTrans(sourceTransNum);
+        for (AsmMacro::SourceTrans& trans: sourceTrans)
+        {
+            trans.lineNo = getInt(8);
+            trans.source = getSource();
+            if (!trans.source)
+                throw Exception("Wrong source reference in macro library");
+        }
+        const uint64_t colTransNum = getInt(8);
+        needArray(colTransNum, 16);
+        std::vector<LineTrans> colTrans(colTransNum);
+        for (LineTrans& trans: colTrans)
+        {
+            trans.position = getInt(8);
+            trans.lineNo = getInt(8);
+        }
+        // every line of content must have column translation
+        if ((!content.empty() && content.back() != '\n') || colTrans.size() <
+                uint64_t(std::count(content.begin(), content.end(), '\n')))
+            throw Exception("Inconsistent macro content in macro library");
+        macros.push_back(std::make_pair(std::move(name), RefPtr<const AsmMacro>(
+                new AsmMacro(pos, std::move(args), std::move(content),
+                        std::move(sourceTrans), std::move(colTrans)))));
+    }
+    if (data != end)
+        throw Exception("Garbages at end of macro library");
+    return macros;
+}
+
+AsmMacroList CLRX::readAsmMacroLibrary(size_t size, const cxbyte* data)
+{
+    AsmMacroLibReader reader(size, data);
+    reader.readNodes();
+    return reader.readMacros();
+}
+
 /* Asm Repeat */
 AsmRepeat::AsmRepeat(const AsmSourcePos& _pos, uint64_t _repeatsNum)
         : contentLineNo(0), sourcePos(_pos), repeatsNum(_repeatsNum)
@@ -147,15 +612,175 @@ LineCol AsmInputFilter::translatePos(size_t position) const
 
 static const size_t AsmParserLineMaxSize = 100;
 
+/*
+ * line scanning (finding characters that requires filtering)
+ */
+
+/* characters that ends run of regular characters: spaces, comments, strings,
+ * backslashes, statement separator and asterisk (for long comment) */
+static const cxbyte asmLineSpecialCharTable[256] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 0, 1, 1, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+// returns length of run of regular characters
+static size_t scanLineScalar(const char* str, size_t size)
+{
+    size_t i = 0;
+    while (i < size && asmLineSpecialCharTable[cxbyte(str[i])] == 0) i++;
+    return i;
+}
+
+#ifdef HAVE_ASM_LINESCAN_SSE2
+static inline __m128i classifyLineCharsSSE2(__m128i v)
+{
+    // spaces from '\t' to '\r': (c-9) < 5 as unsigned bytes
+    __m128i mask = _mm_cmplt_epi8(_mm_add_epi8(v, _mm_set1_epi8(0x80-9)),
+                _mm_set1_epi8(-0x80+5));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('#')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('*')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8(';')));
+    return _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+}
+
+static size_t scanLineSSE2(const char* str, size_t size)
+{
+    size_t i = 0;
+    for (; i+16 <= size; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(str+i));
+        const uint32_t mask = _mm_movemask_epi8(classifyLineCharsSSE2(v));
+        if (mask != 0)
+            return i + CTZ32(mask);
+    }
+    return i + scanLineScalar(str+i, size-i);
+}
+#endif
+
+#ifdef HAVE_ASM_LINESCAN_AVX2
+__attribute__((target("avx2")))
+static size_t scanLineAVX2(const char* str, size_t size)
+{
+    size_t i = 0;
+    for (; i+32 <= size; i += 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(str+i));
+        // spaces from '\t' to '\r': (c-9) < 5 as unsigned bytes
+        __m256i mask = _mm256_cmpgt_epi8(_mm256_set1_epi8(-0x80+5),
+                _mm256_add_epi8(v, _mm256_set1_epi8(0x80-9)));
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('#')));
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')));
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')));
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(';')));
+        mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+        const uint32_t bits = _mm256_movemask_epi8(mask);
+        if (bits != 0)
+            return i + CTZ32(bits);
+    }
+    return i + scanLineSSE2(str+i, size-i);
+}
+
+// check (by CPUID) whether CPU and operating system support AVX2
+static bool checkCPUAVX2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+typedef size_t (*AsmLineScanner)(const char* str, size_t size);
+
+static AsmLineScanner getLineScanner(AsmLineScanType scanType)
+{
+    switch (scanType)
+    {
+        case AsmLineScanType::SCALAR:
+            return scanLineScalar;
+#ifdef HAVE_ASM_LINESCAN_SSE2
+        case AsmLineScanType::SSE2:
+            return scanLineSSE2;
+#endif
+#ifdef HAVE_ASM_LINESCAN_AVX2
+        case AsmLineScanType::AVX2:
+            return AsmStreamInputFilter::isLineScanTypeSupported(scanType) ?
+                        scanLineAVX2 : nullptr;
+#endif
+        case AsmLineScanType::AUTO:
+            // choose widest implementation supported by CPU
+#ifdef HAVE_ASM_LINESCAN_AVX2
+            if (AsmStreamInputFilter::isLineScanTypeSupported(AsmLineScanType::AVX2))
+                return scanLineAVX2;
+#endif
+#ifdef HAVE_ASM_LINESCAN_SSE2
+            return scanLineSSE2;
+#else
+            return scanLineScalar;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+bool AsmStreamInputFilter::isLineScanTypeSupported(AsmLineScanType scanType)
+{
+    switch (scanType)
+    {
+        case AsmLineScanType::AUTO:
+        case AsmLineScanType::SCALAR:
+            return true;
+#ifdef HAVE_ASM_LINESCAN_SSE2
+        case AsmLineScanType::SSE2:
+            return true;
+#endif
+#ifdef HAVE_ASM_LINESCAN_AVX2
+        case AsmLineScanType::AVX2:
+        {
+            static const bool haveAVX2 = checkCPUAVX2();
+            return haveAVX2;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+void AsmStreamInputFilter::setLineScanType(AsmLineScanType scanType)
+{
+    AsmLineScanner scanner = getLineScanner(scanType);
+    if (scanner == nullptr)
+        throw Exception("Line scanning type is not supported");
+    lineScanner = scanner;
+}
+
 AsmStreamInputFilter::AsmStreamInputFilter(const CString& filename)
 try : AsmInputFilter(AsmInputFilterType::STREAM), managed(true),
-        stream(nullptr), mode(LineMode::NORMAL), stmtPos(0)
+        stream(nullptr), mappedData(nullptr), mappedSize(0), mappedPos(0),
+        mode(LineMode::NORMAL), stmtPos(0),
+        lineScanner(getLineScanner(AsmLineScanType::AUTO)), messagesPrinted(false),
+        cachedLineIndex(0), recordedTimestamp(0)
 {
     source = RefPtr<const AsmSource>(new AsmFile(filename));
-    stream = new std::ifstream(filename.c_str(), std::ios::binary);
-    if (!*stream)
-        throw Exception(std::string("Can't open source file '")+filename.c_str()+"'");
-    stream->exceptions(std::ios::badbit);
+    openFile(filename);
     buffer.reserve(AsmParserLineMaxSize);
 }
 catch(...)
@@ -165,7 +790,10 @@ catch(...)
 
 AsmStreamInputFilter::AsmStreamInputFilter(std::istream& is, const CString& filename)
     : AsmInputFilter(AsmInputFilterType::STREAM),
-      managed(false), stream(&is), mode(LineMode::NORMAL), stmtPos(0)
+      managed(false), stream(&is), mappedData(nullptr), mappedSize(0), mappedPos(0),
+      mode(LineMode::NORMAL), stmtPos(0),
+        lineScanner(getLineScanner(AsmLineScanType::AUTO)), messagesPrinted(false),
+        cachedLineIndex(0), recordedTimestamp(0)
 {
     source = RefPtr<const AsmSource>(new AsmFile(filename));
     stream->exceptions(std::ios::badbit);
@@ -175,7 +803,10 @@ AsmStreamInputFilter::AsmStreamInputFilter(std::istream& is, const CString& file
 AsmStreamInputFilter::AsmStreamInputFilter(const AsmSourcePos& pos,
            const CString& filename)
 try : AsmInputFilter(AsmInputFilterType::STREAM),
-      managed(true), stream(nullptr), mode(LineMode::NORMAL), stmtPos(0)
+      managed(true), stream(nullptr), mappedData(nullptr), mappedSize(0), mappedPos(0),
+      mode(LineMode::NORMAL), stmtPos(0),
+        lineScanner(getLineScanner(AsmLineScanType::AUTO)), messagesPrinted(false),
+        cachedLineIndex(0), recordedTimestamp(0)
 {
     if (!pos.macro)
         source = RefPtr<const AsmSource>(new AsmFile(pos.source, pos.lineNo,
@@ -185,10 +816,7 @@ try : AsmInputFilter(AsmInputFilterType::STREAM),
             RefPtr<const AsmSource>(new AsmMacroSource(pos.macro, pos.source)),
                  pos.lineNo, pos.colNo, filename));
     
-    stream = new std::ifstream(filename.c_str(), std::ios::binary);
-    if (!*stream)
-        throw Exception(std::string("Can't open source file '")+filename.c_str()+"'");
-    stream->exceptions(std::ios::badbit);
+    openFile(filename);
     buffer.reserve(AsmParserLineMaxSize);
 }
 catch(...)
@@ -198,7 +826,10 @@ catch(...)
 
 AsmStreamInputFilter::AsmStreamInputFilter(const AsmSourcePos& pos, std::istream& is,
         const CString& filename) : AsmInputFilter(AsmInputFilterType::STREAM),
-        managed(false), stream(&is), mode(LineMode::NORMAL), stmtPos(0)
+        managed(false), stream(&is), mappedData(nullptr), mappedSize(0), mappedPos(0),
+        mode(LineMode::NORMAL), stmtPos(0),
+        lineScanner(getLineScanner(AsmLineScanType::AUTO)), messagesPrinted(false),
+        cachedLineIndex(0), recordedTimestamp(0)
 {
     if (!pos.macro)
         source = RefPtr<const AsmSource>(new AsmFile(pos.source, pos.lineNo,
@@ -211,15 +842,165 @@ AsmStreamInputFilter::AsmStreamInputFilter(const AsmSourcePos& pos, std::istream
     buffer.reserve(AsmParserLineMaxSize);
 }
 
+AsmStreamInputFilter::AsmStreamInputFilter(const AsmSourcePos& pos,
+        RefPtr<const AsmFilteredSource> _cachedSource, const CString& filename)
+        : AsmInputFilter(AsmInputFilterType::STREAM),
+        managed(false), stream(nullptr), mappedData(nullptr), mappedSize(0), mappedPos(0),
+        mode(LineMode::NORMAL), stmtPos(0),
+        lineScanner(getLineScanner(AsmLineScanType::AUTO)), messagesPrinted(false),
+        cachedSource(_cachedSource), cachedLineIndex(0), recordedTimestamp(0)
+{
+    if (!pos.macro)
+        source = RefPtr<const AsmSource>(new AsmFile(pos.source, pos.lineNo,
+                             pos.colNo, filename));
+    else // if inside macro
+        source = RefPtr<const AsmSource>(new AsmFile(
+            RefPtr<const AsmSource>(new AsmMacroSource(pos.macro, pos.source)),
+                 pos.lineNo, pos.colNo, filename));
+}
+
 AsmStreamInputFilter::~AsmStreamInputFilter()
 {
     if (managed)
         delete stream;
 }
 
+void AsmStreamInputFilter::openFile(const CString& filename)
+{
+    if (MappedFile::isMappable(filename.c_str()))
+    {   // regular file: map it instead reading through stream
+        try
+        {
+            mappedFile = RefPtr<const MappedFile>(new MappedFile(filename.c_str()));
+            mappedData = (const char*)mappedFile->data();
+            mappedSize = mappedFile->size();
+            return;
+        }
+        catch(const Exception&)
+        { } // if mapping failed, just use stream
+    }
+    stream = new std::ifstream(filename.c_str(), std::ios::binary);
+    if (!*stream)
+        throw Exception(std::string("Can't open source file '")+filename.c_str()+"'");
+    stream->exceptions(std::ios::badbit);
+}
+
+size_t AsmStreamInputFilter::readInput(char* dest, size_t maxSize)
+{
+    if (!mappedFile)
+    {
+        stream->read(dest, maxSize);
+        return stream->gcount();
+    }
+    /* copy from mapped file to end of physical line only,
+     * thus next lines can be returned directly from mapping */
+    const char* mappedStart = mappedData + mappedPos;
+    size_t toRead = std::min(maxSize, mappedSize-mappedPos);
+    const char* newline = (const char*)::memchr(mappedStart, '\n', toRead);
+    if (newline != nullptr)
+        toRead = newline-mappedStart+1;
+    ::memcpy(dest, mappedStart, toRead);
+    mappedPos += toRead;
+    return toRead;
+}
+
+void AsmStreamInputFilter::recordContent(uint64_t timestamp)
+{
+    recordedSource = RefPtr<AsmFilteredSource>(new AsmFilteredSource());
+    recordedTimestamp = timestamp;
+}
+
+const char* AsmStreamInputFilter::readCachedLine(size_t& lineSize)
+{
+    if (cachedLineIndex == cachedSource->getLinesNum())
+    {
+        lineSize = 0;
+        return nullptr;
+    }
+    const char* content = cachedSource->getContent().data();
+    const char* line = content + pos;
+    const char* lineEnd = (const char*)::memchr(line, '\n',
+                cachedSource->getContent().size()-pos);
+    lineSize = lineEnd-line;
+    pos += lineSize+1;
+    
+    const LineTrans* cachedColTrans = cachedSource->getColTranslations().data();
+    colTranslations.assign(cachedColTrans + (cachedLineIndex!=0 ?
+            cachedSource->getColTransEnd(cachedLineIndex-1) : 0),
+            cachedColTrans + cachedSource->getColTransEnd(cachedLineIndex));
+    cachedLineIndex++;
+    lineNo = colTranslations.back().lineNo;
+    return line;
+}
+
 const char* AsmStreamInputFilter::readLine(Assembler& assembler, size_t& lineSize)
+{
+    if (cachedSource)
+        return readCachedLine(lineSize);
+    const char* line = readFilteredLine(assembler, lineSize);
+    if (recordedSource)
+    {
+        if (line != nullptr)
+            recordedSource->addLine(colTranslations, lineSize, line);
+        else
+        {   // end of file, content can be cached if no warnings and errors
+            if (!messagesPrinted)
+                assembler.addIncludeCache(source.staticCast<const AsmFile>()->file,
+                        recordedTimestamp,
+                        recordedSource.staticCast<const AsmFilteredSource>());
+            recordedSource.reset();
+        }
+    }
+    return line;
+}
+
+/* try to return line directly from mapped file. returns nullptr if line requires
+ * filtering (then line must be processed by regular code) */
+const char* AsmStreamInputFilter::readMappedLine(size_t& lineSize)
+{
+    const char* lineStart = mappedData + mappedPos;
+    const char* end = mappedData + mappedSize;
+    const char* p = lineStart;
+    while (true)
+    {
+        p += lineScanner(p, end-p);
+        if (p == end || *p == '\n')
+            break;
+        /* spaces (also runs of them) and asterisks not preceded by slash are
+         * regular, other special characters require filtering */
+        if (*p != ' ' && (*p != '*' || (p != lineStart && p[-1] == '/')))
+            return nullptr; // requires filtering
+        p++;
+    }
+    
+    colTranslations.push_back({0, lineNo});
+    lineSize = p-lineStart;
+    mappedPos = p-mappedData;
+    if (p != end)
+    {   // skip newline
+        mappedPos++;
+        lineNo++;
+    }
+    return lineStart;
+}
+
+const char* AsmStreamInputFilter::readFilteredLine(Assembler& assembler,
+            size_t& lineSize)
 {
     colTranslations.clear();
+    if (mappedFile && mode == LineMode::NORMAL && stmtPos == 0 && pos >= buffer.size())
+    {   // no pending filtered data, try to get line straight from mapping
+        if (mappedPos == mappedSize)
+        {
+            lineSize = 0;
+            return nullptr;
+        }
+        buffer.clear();
+        pos = 0;
+        const char* line = readMappedLine(lineSize);
+        if (line != nullptr)
+            return line;
+    }
     bool endOfLine = false;
     size_t lineStart = pos;
     size_t joinStart = pos; // join Start - physical line start
@@ -237,6 +1018,19 @@ const char* AsmStreamInputFilter::readLine(Assembler& assembler, size_t& lineSiz
                 if (pos < buffer.size() && !isSpace(buffer[pos]) && buffer[pos] != ';')
                 {   // putting regular string (no spaces)
                     do {
+                        // copy run of regular characters at once
+                        const size_t runSize = lineScanner(buffer.data()+pos,
+                                    buffer.size()-pos);
+                        if (runSize != 0)
+                        {
+                            ::memmove(buffer.data()+destPos, buffer.data()+pos, runSize);
+                            destPos += runSize;
+                            pos += runSize;
+                            backslash = false;
+                            if (pos == buffer.size() || isSpace(buffer[pos]) ||
+                                buffer[pos] == ';')
+                                break;
+                        }
                         backslash = (buffer[pos] == '\\');
                         if (buffer[pos] == '*' &&
                             destPos > 0 && buffer[destPos-1] == '/') // longComment
@@ -420,8 +1214,11 @@ const char* AsmStreamInputFilter::readLine(Assembler& assembler, size_t& lineSiz
                                 {ssize_t(destPos-lineStart), lineNo});
                         }
                         else
+                        {
+                            messagesPrinted = true;
                             assembler.printWarning({lineNo, pos-joinStart+stmtPos+1},
                                         "Unterminated string: newline inserted");
+                        }
                         pos++;
                         joinStart = pos;
                         stmtPos = 0;
@@ -451,14 +1248,16 @@ const char* AsmStreamInputFilter::readLine(Assembler& assembler, size_t& lineSiz
             if (pos == buffer.size())
                 buffer.resize(std::max(AsmParserLineMaxSize, (pos>>1)+pos));
             
-            stream->read(buffer.data()+pos, buffer.size()-pos);
-            const size_t readed = stream->gcount();
+            const size_t readed = readInput(buffer.data()+pos, buffer.size()-pos);
             buffer.resize(pos+readed);
             if (readed == 0)
             {   // end of file. check comments
                 if (mode == LineMode::LONG_COMMENT && lineStart!=pos)
+                {
+                    messagesPrinted = true;
                     assembler.printError({lineNo, pos-joinStart+stmtPos+1},
                            "Unterminated multi-line comment");
+                }
                 if (destPos-lineStart == 0)
                 {
                     lineSize = 0;
@@ -479,15 +1278,7 @@ AsmMacroInputFilter::AsmMacroInputFilter(RefPtr<const AsmMacro> _macro,
           argMap(_argMap), macroCount(_macroCount), contentLineNo(0), sourceTransIndex(0),
           realLinePos(0), alternateMacro(_alternateMacro)
 {
-    if (macro->getSourceTransSize()!=0)
-        source = macro->getSourceTrans(0).source;
-    macroSubst = RefPtr<const AsmMacroSubst>(new AsmMacroSubst(pos.macro,
-                   pos.source, pos.lineNo, pos.colNo));
-    curColTrans = macro->getColTranslations().data();
-    buffer.reserve(AsmParserLineMaxSize);
-    lineNo = !macro->getColTranslations().empty() ? curColTrans[0].lineNo : 0;
-    if (!macro->getColTranslations().empty())
-        realLinePos = -curColTrans[0].position;
+    initialize(pos);
 }
 
 AsmMacroInputFilter::AsmMacroInputFilter(RefPtr<const AsmMacro> _macro,
@@ -497,6 +1288,11 @@ AsmMacroInputFilter::AsmMacroInputFilter(RefPtr<const AsmMacro> _macro,
           argMap(std::move(_argMap)), macroCount(_macroCount),
           contentLineNo(0), sourceTransIndex(0), realLinePos(0),
           alternateMacro(_alternateMacro)
+{
+    initialize(pos);
+}
+
+void AsmMacroInputFilter::initialize(const AsmSourcePos& pos)
 {
     if (macro->getSourceTransSize()!=0)
         source = macro->getSourceTrans(0).source;
@@ -507,6 +1303,76 @@ AsmMacroInputFilter::AsmMacroInputFilter(RefPtr<const AsmMacro> _macro,
     lineNo = !macro->getColTranslations().empty() ? curColTrans[0].lineNo : 0;
     if (!macro->getColTranslations().empty())
         realLinePos = -curColTrans[0].position;
+    // values of arguments in order of macro arguments (for precompiled lines)
+    if (!alternateMacro)
+    {
+        argValues.resize(macro->getArgsNum());
+        for (size_t i = 0; i < argValues.size(); i++)
+        {
+            auto it = binaryMapFind(argMap.begin(), argMap.end(), macro->getArg(i).name);
+            argValues[i] = (it != argMap.end()) ? &it->second : nullptr;
+        }
+    }
+}
+
+/* substitute line by using precompiled segments. used only for line without
+ * column translations inside line (without joined lines) in non-alternate mode */
+const char* AsmMacroInputFilter::readCompiledLine(size_t& lineSize)
+{
+    const AsmMacro::CompiledLine& compiledLine = macro->getCompiledLine(contentLineNo);
+    const char* content = macro->getContent().data();
+    colTranslations.push_back({ ssize_t(-realLinePos), curColTrans->lineNo});
+    for (size_t i = compiledLine.segmentsStart; i < compiledLine.segmentsEnd; i++)
+    {
+        const AsmMacro::Segment& segment = macro->getSegment(i);
+        switch(segment.type)
+        {
+            case AsmMacro::SegmentType::TEXT:
+                buffer.insert(buffer.end(), content + segment.pos,
+                              content + segment.pos + segment.size);
+                break;
+            case AsmMacro::SegmentType::ARG:
+            {
+                const CString* value = argValues[segment.pos];
+                if (value != nullptr)
+                    buffer.insert(buffer.end(), value->begin(),
+                                  value->begin() + value->size());
+                break;
+            }
+            default:
+            {   // macro count
+                char numBuf[32];
+                const size_t numLen = itocstrCStyle(macroCount, numBuf, 32);
+                buffer.insert(buffer.end(), numBuf, numBuf+numLen);
+                break;
+            }
+        }
+    }
+    lineSize = buffer.size();
+    pos = compiledLine.endPos;
+    const std::vector<LineTrans>& macroColTrans = macro->getColTranslations();
+    if (curColTrans+1 != macroColTrans.data()+macroColTrans.size())
+    {
+        curColTrans++;
+        if (curColTrans->position >= 0) /// real new line, reset real line position
+            realLinePos = 0;
+        else    // otherwise determine position in destination source
+            realLinePos += lineSize+1;
+    }
+    pos++; // skip newline
+    lineNo = curColTrans->lineNo;
+    // move to next source translation
+    if (sourceTransIndex+1 < macro->getSourceTransSize())
+    {
+        const AsmMacro::SourceTrans& fpos = macro->getSourceTrans(sourceTransIndex+1);
+        if (fpos.lineNo == contentLineNo)
+        {
+            source = fpos.source;
+            sourceTransIndex++;
+        }
+    }
+    contentLineNo++;
+    return (!buffer.empty()) ? buffer.data() : "";
 }
 
 const char* AsmMacroInputFilter::readLine(Assembler& assembler, size_t& lineSize)
@@ -522,6 +1388,9 @@ const char* AsmMacroInputFilter::readLine(Assembler& assembler, size_t& lineSize
         return nullptr;
     }
     
+    if (!alternateMacro && (curColTrans+1 == colTransEnd || curColTrans[1].position <= 0))
+        return readCompiledLine(lineSize);
+    
     const char* content = macro->getContent().data();
     
     size_t nextLinePos = pos;
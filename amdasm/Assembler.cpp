@@ -18,7 +18,15 @@
  */
 
 #include <CLRX/Config.h>
+#ifndef HAVE_WINDOWS
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#endif
 #include <string>
+#include <cstring>
+#include <cerrno>
+#include <climits>
 #include <cassert>
 #include <fstream>
 #include <vector>
@@ -26,6 +34,11 @@
 #include <unordered_set>
 #include <utility>
 #include <algorithm>
+#include <memory>
+#include <sstream>
+#include <mutex>
+#include <chrono>
+#include <stdexcept>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/utils/MemAccess.h>
 #include <CLRX/utils/GPUId.h>
@@ -46,6 +59,218 @@ bool AsmSection::getRegVar(const CString& name, const AsmRegVar*& regVar) const
     return true;
 }
 
+void AsmSection::addFill(uint64_t size, cxuint patternSize, const cxbyte* pattern)
+{
+    const uint64_t offset = getSize();
+    if (!fills.empty() && patternSize == 1)
+    {   // join with previous fill run if it is at end of section and has same value
+        AsmSectionFill& last = fills.back();
+        if (last.contentPos == content.size() && last.data == nullptr &&
+            last.patternSize == 1 && last.pattern[0] == pattern[0])
+        {
+            last.size += size;
+            return;
+        }
+    }
+    AsmSectionFill fill;
+    fill.offset = offset;
+    fill.contentPos = content.size();
+    fill.size = size;
+    fill.patternSize = patternSize;
+    std::copy(pattern, pattern+patternSize, fill.pattern);
+    fill.data = nullptr;
+    fills.push_back(fill);
+}
+
+void AsmSection::addMappedData(const RefPtr<const MappedFile>& mappedFile,
+            size_t offset, size_t size)
+{
+    AsmSectionFill fill;
+    fill.offset = getSize();
+    fill.contentPos = content.size();
+    fill.size = size;
+    fill.patternSize = 1;
+    fill.pattern[0] = 0;
+    fill.data = mappedFile->data() + offset;
+    fill.mappedFile = mappedFile;
+    fills.push_back(fill);
+}
+
+cxbyte* AsmSection::getData(size_t offset)
+{
+    if (fills.empty() || offset < fills.front().offset)
+        return content.data() + offset;
+    // find last fill run before offset
+    auto it = std::upper_bound(fills.begin(), fills.end(), offset,
+            [](size_t off, const AsmSectionFill& fill)
+            { return off < fill.offset; }) - 1;
+    return content.data() + it->contentPos + (offset - it->offset - it->size);
+}
+
+/* write fill run to buffer (pattern begins at start of run) */
+static void writeFillRun(const AsmSectionFill& fill, cxbyte* out)
+{
+    if (fill.data != nullptr)
+        std::copy(fill.data, fill.data + fill.size, out);
+    else if (fill.patternSize == 1)
+        ::memset(out, fill.pattern[0], fill.size);
+    else
+        for (uint64_t i = 0; i < fill.size; i++)
+            out[i] = fill.pattern[i % fill.patternSize];
+}
+
+void AsmSection::writeContent(cxbyte* out) const
+{
+    size_t contentPos = 0;
+    for (const AsmSectionFill& fill: fills)
+    {
+        out = std::copy(content.begin()+contentPos, content.begin()+fill.contentPos, out);
+        writeFillRun(fill, out);
+        out += fill.size;
+        contentPos = fill.contentPos;
+    }
+    std::copy(content.begin()+contentPos, content.end(), out);
+}
+
+void AsmSection::flatten()
+{
+    if (fills.empty())
+        return;
+    std::vector<cxbyte> newContent(getSize());
+    writeContent(newContent.data());
+    content.swap(newContent);
+    fills.clear();
+}
+
+const cxbyte* AsmSection::getFlatData()
+{
+    if (content.empty() && fills.size() == 1 && fills[0].data != nullptr)
+        return fills[0].data; // refer directly to mapped file
+    flatten();
+    return !content.empty() ? content.data() : nullptr;
+}
+
+void AsmSection::writeContent(std::ostream& os) const
+{
+    size_t contentPos = 0;
+    const size_t maxBufSize = 65536;
+    std::unique_ptr<cxbyte[]> buffer;
+    for (const AsmSectionFill& fill: fills)
+    {
+        if (contentPos != fill.contentPos)
+            os.write((const char*)content.data()+contentPos, fill.contentPos-contentPos);
+        contentPos = fill.contentPos;
+        if (fill.data != nullptr)
+        {   // mapped data is written directly
+            os.write((const char*)fill.data, fill.size);
+            continue;
+        }
+        if (!buffer)
+            buffer.reset(new cxbyte[maxBufSize]);
+        // write run by buffer (buffer size is multiple of pattern size)
+        AsmSectionFill bufFill = fill;
+        const size_t bufSize = maxBufSize - maxBufSize%fill.patternSize;
+        bufFill.size = std::min(uint64_t(bufSize), fill.size);
+        writeFillRun(bufFill, buffer.get());
+        for (uint64_t written = 0; written < fill.size; written += bufSize)
+            os.write((const char*)buffer.get(),
+                     std::min(uint64_t(bufSize), fill.size-written));
+    }
+    if (contentPos != content.size())
+        os.write((const char*)content.data()+contentPos, content.size()-contentPos);
+}
+
+#ifndef HAVE_WINDOWS
+/* gathered writing of sections to file. content, mapped regions and buffers
+ * of pattern runs are written by writev without copying to single buffer */
+class AsmGatherWriter
+{
+private:
+    int fd;
+    const char* filename;
+    std::vector<struct iovec> iovs;
+    size_t maxIovsNum;
+    std::unique_ptr<cxbyte[]> patternBuffer;
+public:
+    AsmGatherWriter(int _fd, const char* _filename) : fd(_fd), filename(_filename)
+    {
+#ifdef IOV_MAX
+        maxIovsNum = IOV_MAX;
+#else
+        maxIovsNum = 16;
+#endif
+    }
+    
+    void add(const void* data, uint64_t size)
+    {
+        // single write is limited to SSIZE_MAX bytes
+        const size_t maxIovSize = size_t(1)<<30;
+        for (const cxbyte* p = (const cxbyte*)data; size != 0; )
+        {
+            const size_t iovSize = std::min(uint64_t(maxIovSize), size);
+            iovs.push_back({ (void*)p, iovSize });
+            p += iovSize;
+            size -= iovSize;
+        }
+    }
+    
+    void flush()
+    {
+        size_t i = 0;
+        while (i < iovs.size())
+        {
+            const ssize_t written = ::writev(fd, iovs.data()+i,
+                        std::min(iovs.size()-i, maxIovsNum));
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw Exception(std::string("Can't write output file '")+
+                            filename+"'");
+            }
+            // skip written vectors, move start of partially written vector
+            size_t toSkip = written;
+            for (; i < iovs.size() && toSkip >= iovs[i].iov_len; i++)
+                toSkip -= iovs[i].iov_len;
+            if (toSkip != 0)
+            {
+                iovs[i].iov_base = (cxbyte*)iovs[i].iov_base + toSkip;
+                iovs[i].iov_len -= toSkip;
+            }
+        }
+        iovs.clear();
+    }
+    
+    void writeSection(const AsmSection& section)
+    {
+        const size_t maxBufSize = 65536;
+        size_t contentPos = 0;
+        for (const AsmSectionFill& fill: section.fills)
+        {
+            add(section.content.data()+contentPos, fill.contentPos-contentPos);
+            contentPos = fill.contentPos;
+            if (fill.data != nullptr)
+            {   // mapped data is written directly
+                add(fill.data, fill.size);
+                continue;
+            }
+            // pattern buffer is reused, hence previous vectors must be written
+            flush();
+            if (!patternBuffer)
+                patternBuffer.reset(new cxbyte[maxBufSize]);
+            AsmSectionFill bufFill = fill;
+            const size_t bufSize = maxBufSize - maxBufSize%fill.patternSize;
+            bufFill.size = std::min(uint64_t(bufSize), fill.size);
+            writeFillRun(bufFill, patternBuffer.get());
+            for (uint64_t written = 0; written < fill.size; written += bufSize)
+                add(patternBuffer.get(), std::min(uint64_t(bufSize), fill.size-written));
+        }
+        add(section.content.data()+contentPos, section.content.size()-contentPos);
+        flush();
+    }
+};
+#endif
+
 const cxbyte CLRX::tokenCharTable[96] =
 {
     //' '   '!'   '"'   '#'   '$'   '%'   '&'   '''
@@ -169,10 +394,14 @@ bool AsmParseUtils::getAnyValueArg(Assembler& asmr, uint64_t& value,
 }
 
 bool AsmParseUtils::getJumpValueArg(Assembler& asmr, uint64_t& value,
-            std::unique_ptr<AsmExpression>& outTargetExpr, const char*& linePtr)
+            std::unique_ptr<AsmExpression>& outTargetExpr, AsmFixup& outFixup,
+            const char*& linePtr)
 {
     const char* end = asmr.line + asmr.lineSize;
     skipSpacesToEnd(linePtr, end);
+    outFixup.symbol = nullptr;
+    if (asmr.parseFixupTarget(linePtr, outFixup))
+        return true;
     const char* exprPlace = linePtr;
     std::unique_ptr<AsmExpression> expr(AsmExpression::parse(asmr, linePtr, false, false));
     if (expr == nullptr)
@@ -385,6 +614,8 @@ void AsmSymbol::removeOccurrenceInExpr(AsmExpression* expr, size_t argIndex,
     auto it = std::remove(occurrencesInExprs.begin(), occurrencesInExprs.end(),
             AsmExprSymbolOccurrence{expr, argIndex, opIndex});
     occurrencesInExprs.resize(it-occurrencesInExprs.begin());
+    if (occurrencesInExprs.empty()) // return memory to arena
+        occurrencesInExprs.clear();
 }
 
 void AsmSymbol::clearOccurrencesInExpr()
@@ -416,6 +647,166 @@ void AsmSymbol::undefine()
     onceDefined = false;
 }
 
+/*
+ * symbol map
+ */
+
+AsmSymbolMap::AsmSymbolMap() : entriesNum(0), slotsMask(0), lastChunkUsed(entryChunkSize)
+{ }
+
+AsmSymbolMap::AsmSymbolMap(std::initializer_list<std::pair<CString, AsmSymbol> > list)
+        : entriesNum(0), slotsMask(0), lastChunkUsed(entryChunkSize)
+{
+    for (const auto& entry: list)
+        insert(entry);
+}
+
+AsmSymbolMap::~AsmSymbolMap()
+{
+    for (AsmSymbolEntry* entry: entries)
+        if (entry != nullptr)
+            entry->~AsmSymbolEntry();
+}
+
+// returns index of slot with symbol or index of empty slot
+size_t AsmSymbolMap::findSlot(const char* name, size_t nameLen, size_t hash) const
+{
+    size_t i = hash & slotsMask;
+    while (slots[i].index != SIZE_MAX)
+    {
+        if (slots[i].hash == hash)
+        {
+            const CString& slotName = entries[slots[i].index]->first;
+            if (slotName.size() == nameLen && ::memcmp(slotName.c_str(), name, nameLen)==0)
+                break;
+        }
+        i = (i+1) & slotsMask;
+    }
+    return i;
+}
+
+void AsmSymbolMap::rehash(size_t newSlotsNum)
+{
+    std::unique_ptr<Slot[]> oldSlots = std::move(slots);
+    const size_t oldSlotsNum = (oldSlots) ? slotsMask+1 : 0;
+    slots.reset(new Slot[newSlotsNum]);
+    std::fill(slots.get(), slots.get()+newSlotsNum, Slot{ 0, SIZE_MAX });
+    slotsMask = newSlotsNum-1;
+    for (size_t i = 0; i < oldSlotsNum; i++)
+        if (oldSlots[i].index != SIZE_MAX)
+        {
+            size_t j = oldSlots[i].hash & slotsMask;
+            while (slots[j].index != SIZE_MAX)
+                j = (j+1) & slotsMask;
+            slots[j] = oldSlots[i];
+        }
+}
+
+AsmSymbolEntry* AsmSymbolMap::allocateEntry()
+{
+    if (!freeEntries.empty())
+    {
+        AsmSymbolEntry* entry = freeEntries.back();
+        freeEntries.pop_back();
+        return entry;
+    }
+    if (lastChunkUsed == entryChunkSize)
+    {
+        entryChunks.push_back(std::unique_ptr<EntryStorage[]>(
+                    new EntryStorage[entryChunkSize]));
+        lastChunkUsed = 0;
+    }
+    return reinterpret_cast<AsmSymbolEntry*>(&entryChunks.back()[lastChunkUsed++]);
+}
+
+std::pair<AsmSymbolMap::iterator, bool> AsmSymbolMap::insertNew(size_t hash,
+            CString&& name, const AsmSymbol& symbol)
+{
+    if (!slots || (entriesNum+1)*2 > slotsMask+1)
+        // keep load factor below 0.5
+        rehash(!slots ? size_t(64) : (slotsMask+1)*2);
+    const size_t slotIndex = findSlot(name.c_str(), name.size(), hash);
+    AsmSymbolEntry* entry = allocateEntry();
+    try
+    { new(entry) AsmSymbolEntry(std::move(name), symbol); }
+    catch(...)
+    {
+        freeEntries.push_back(entry);
+        throw;
+    }
+    entries.push_back(entry);
+    slots[slotIndex] = { hash, entries.size()-1 };
+    entriesNum++;
+    return std::make_pair(iterator(entries.data()+entries.size()-1,
+                entries.data()+entries.size()), true);
+}
+
+AsmSymbolMap::iterator AsmSymbolMap::find(const char* name, size_t nameLen)
+{
+    if (!slots)
+        return end();
+    const size_t slotIndex = findSlot(name, nameLen, hashName(name, nameLen));
+    if (slots[slotIndex].index == SIZE_MAX)
+        return end();
+    return iterator(entries.data()+slots[slotIndex].index,
+                entries.data()+entries.size());
+}
+
+AsmSymbol& AsmSymbolMap::at(const CString& name)
+{
+    iterator it = find(name);
+    if (it == end())
+        throw std::out_of_range("Symbol not found");
+    return it->second;
+}
+
+std::pair<AsmSymbolMap::iterator, bool> AsmSymbolMap::insert(
+            const std::pair<CString, AsmSymbol>& entry)
+{
+    iterator it = find(entry.first.c_str(), entry.first.size());
+    if (it != end())
+        return std::make_pair(it, false);
+    return insertNew(hashName(entry.first.c_str(), entry.first.size()),
+                CString(entry.first), entry.second);
+}
+
+std::pair<AsmSymbolMap::iterator, bool> AsmSymbolMap::insert(const char* name,
+            size_t nameLen)
+{
+    iterator it = find(name, nameLen);
+    if (it != end())
+        return std::make_pair(it, false);
+    return insertNew(hashName(name, nameLen), CString(name, name+nameLen), AsmSymbol());
+}
+
+void AsmSymbolMap::erase(iterator it)
+{
+    AsmSymbolEntry* entry = *it.ptr;
+    size_t i = findSlot(entry->first.c_str(), entry->first.size(),
+                hashName(entry->first.c_str(), entry->first.size()));
+    // remove slot and move back following slots (backward shift deletion)
+    size_t j = i;
+    while (true)
+    {
+        slots[i].index = SIZE_MAX;
+        size_t k;
+        do {
+            j = (j+1) & slotsMask;
+            if (slots[j].index == SIZE_MAX)
+                break;
+            k = slots[j].hash & slotsMask;
+        } while ((i <= j) ? (i < k && k <= j) : (i < k || k <= j));
+        if (slots[j].index == SIZE_MAX)
+            break;
+        slots[i] = slots[j];
+        i = j;
+    }
+    entries[it.ptr - entries.data()] = nullptr;
+    entry->~AsmSymbolEntry();
+    freeEntries.push_back(entry);
+    entriesNum--;
+}
+
 /*
  * Assembler
  */
@@ -427,9 +818,9 @@ Assembler::Assembler(const CString& filename, std::istream& input, Flags _flags,
           deviceType(_deviceType),
           driverVersion(0),
           _64bit(false),
-          isaAssembler(nullptr),
+          isaAssembler(nullptr), flatSectionsReady(false),
           symbolMap({std::make_pair(".", AsmSymbol(0, uint64_t(0)))}),
-          flags(_flags), 
+          pendingFixupsNum(0), flags(_flags), stats(), binGenThreadsNum(0),
           lineSize(0), line(nullptr),
           endOfAssembly(false),
           messageStream(msgStream),
@@ -447,6 +838,7 @@ Assembler::Assembler(const CString& filename, std::istream& input, Flags _flags,
     good = true;
     resolvingRelocs = false;
     formatHandler = nullptr;
+    initializeAsmPseudoOps();
     input.exceptions(std::ios::badbit);
     std::unique_ptr<AsmInputFilter> thatInputFilter(
                     new AsmStreamInputFilter(input, filename));
@@ -461,9 +853,9 @@ Assembler::Assembler(const Array<CString>& _filenames, Flags _flags,
           deviceType(_deviceType),
           driverVersion(0),
           _64bit(false),
-          isaAssembler(nullptr),
+          isaAssembler(nullptr), flatSectionsReady(false),
           symbolMap({std::make_pair(".", AsmSymbol(0, uint64_t(0)))}),
-          flags(_flags), 
+          pendingFixupsNum(0), flags(_flags), stats(), binGenThreadsNum(0),
           lineSize(0), line(nullptr),
           endOfAssembly(false),
           messageStream(msgStream),
@@ -482,6 +874,7 @@ Assembler::Assembler(const Array<CString>& _filenames, Flags _flags,
     good = true;
     resolvingRelocs = false;
     formatHandler = nullptr;
+    initializeAsmPseudoOps();
     std::unique_ptr<AsmInputFilter> thatInputFilter(
                 new AsmStreamInputFilter(filenames[filenameIndex++]));
     asmInputFilters.push(thatInputFilter.get());
@@ -779,40 +1172,68 @@ bool Assembler::parseLiteral(uint64_t& value, const char*& linePtr)
     return true;
 }
 
+AsmSymbolEntry* Assembler::getLocalLabelSymbol(const char* digits, size_t digitsNum,
+            bool forward)
+{
+    /* symbols of local labels with small numbers (without leading zeroes)
+     * are held in array, hence finding them does not require hashing */
+    AsmSymbolEntry** cached = nullptr;
+    if (digitsNum <= 5 && (digitsNum == 1 || digits[0] != '0'))
+    {
+        size_t number = 0;
+        for (size_t i = 0; i < digitsNum; i++)
+            number = number*10 + digits[i]-'0';
+        if (number >= localLabels.size())
+            localLabels.resize(number+1, LocalLabel{ nullptr, nullptr });
+        cached = forward ? &localLabels[number].next : &localLabels[number].prev;
+        if (*cached != nullptr)
+            return *cached;
+    }
+    std::string symName(digits, digits+digitsNum);
+    symName.push_back(forward ? 'f' : 'b');
+    AsmSymbolEntry* entry = &*symbolMap.insert(symName.c_str(), symName.size()).first;
+    if (cached != nullptr)
+        *cached = entry;
+    return entry;
+}
+
 Assembler::ParseState Assembler::parseSymbol(const char*& linePtr,
                 AsmSymbolEntry*& entry, bool localLabel, bool dontCreateSymbol)
 {
     const char* startPlace = linePtr;
-    const CString symName = extractSymName(linePtr, line+lineSize, localLabel);
-    if (symName.empty())
+    skipSymName(linePtr, line+lineSize, localLabel);
+    const size_t symNameLen = linePtr-startPlace;
+    if (symNameLen == 0)
     {   // this is not symbol or a missing symbol
         while (linePtr != line+lineSize && !isSpace(*linePtr) && *linePtr != ',')
             linePtr++;
         entry = nullptr;
         return Assembler::ParseState::MISSING;
     }
-    if (symName == ".") // any usage of '.' causes format initialization
+    if (symNameLen == 1 && *startPlace == '.')
+        // any usage of '.' causes format initialization
         initializeOutputFormat();
     
     Assembler::ParseState state = Assembler::ParseState::PARSED;
     bool symHasValue;
+    const bool isLocalLabel = isDigit(*startPlace);
     if (!dontCreateSymbol)
     {   // create symbol if not found
-        std::pair<AsmSymbolMap::iterator, bool> res =
-                symbolMap.insert(std::make_pair(symName, AsmSymbol()));
-        entry = &*res.first;
-        symHasValue = res.first->second.hasValue;
+        entry = isLocalLabel ? getLocalLabelSymbol(startPlace, symNameLen-1,
+                        linePtr[-1] == 'f') :
+                &*symbolMap.insert(startPlace, symNameLen).first;
+        symHasValue = entry->second.hasValue;
     }
     else
     {   // only find symbol and set isDefined and entry
-        AsmSymbolMap::iterator it = symbolMap.find(symName);
+        AsmSymbolMap::iterator it = symbolMap.find(startPlace, symNameLen);
         entry = (it != symbolMap.end()) ? &*it : nullptr;
         symHasValue = (it != symbolMap.end() && it->second.hasValue);
     }
-    if (isDigit(symName.front()) && symName[linePtr-startPlace-1] == 'b' && !symHasValue)
+    if (isLocalLabel && linePtr[-1] == 'b' && !symHasValue)
     {   // failed at finding
         std::string error = "Undefined previous local label '";
-        error.append(symName.begin(), linePtr-startPlace);
+        error.append(startPlace, symNameLen);
         error += "'";
         printError(linePtr, error.c_str());
         state = Assembler::ParseState::FAILED;
@@ -821,6 +1242,54 @@ Assembler::ParseState Assembler::parseSymbol(const char*& linePtr,
     return state;
 }
 
+bool Assembler::parseFixupTarget(const char*& linePtr, AsmFixup& fixup)
+{
+    const char* end = line+lineSize;
+    const char* startPlace = linePtr;
+    // check syntax before parsing symbol (symbol can be created only if it will be used)
+    const char* ptr = linePtr;
+    skipSymName(ptr, end, true);
+    if (ptr == linePtr || (isDigit(*linePtr) && ptr[-1] != 'f'))
+        return false; // not symbol or backward local label
+    skipSpacesToEnd(ptr, end);
+    uint64_t addend = 0;
+    if (ptr != end && (*ptr == '+' || *ptr == '-'))
+    {
+        const bool negate = (*ptr == '-');
+        skipCharAndSpacesToEnd(ptr, end);
+        const char* valuePlace = ptr;
+        skipSymName(ptr, end, true);
+        if (ptr != valuePlace || ptr == end || !isDigit(*ptr))
+            return false; // not constant
+        try
+        { addend = cstrtovCStyle<uint64_t>(valuePlace, end, ptr); }
+        catch(const ParseException&)
+        { return false; }
+        if (negate)
+            addend = -addend;
+        skipSpacesToEnd(ptr, end);
+    }
+    if (ptr != end && *ptr != ',')
+        return false;
+    
+    AsmSymbolEntry* symEntry;
+    const char* symPtr = linePtr;
+    if (parseSymbol(symPtr, symEntry, true, false) != ParseState::PARSED ||
+        symEntry == nullptr)
+        return false;
+    const AsmSymbol& symbol = symEntry->second;
+    // fixups only for undefined symbols that are not used in expressions
+    if (symbol.hasValue || symbol.expression != nullptr || symbol.regRange ||
+        symbol.base || symbol.snapshot || !symbol.occurrencesInExprs.empty())
+        return false;
+    
+    fixup.sourcePos = getSourcePos(startPlace);
+    fixup.symbol = symEntry;
+    fixup.addend = addend;
+    linePtr = ptr;
+    return true;
+}
+
 bool Assembler::parseMacroArgValue(const char*& string, std::string& outStr)
 {
     const char* end = line+lineSize;
@@ -931,6 +1400,8 @@ bool Assembler::setSymbol(AsmSymbolEntry& symEntry, uint64_t value, cxuint secti
     if (!symEntry.second.hasValue) // if not resolved we just return
         return true; // no error
     bool good = true;
+    if (symEntry.second.firstFixup != SIZE_MAX)
+        good = resolveFixups(symEntry);
     
     // resolve value of pending symbols
     std::stack<std::pair<AsmSymbolEntry*, size_t> > symbolStack;
@@ -1003,7 +1474,7 @@ bool Assembler::setSymbol(AsmSymbolEntry& symEntry, uint64_t value, cxuint secti
                         else
                         {
                             printWarningForRange(8, value, expr->getSourcePos());
-                            sections[target.sectionId].content[target.offset] =
+                            *sections[target.sectionId].getData(target.offset) =
                                     cxbyte(value);
                         }
                         break;
@@ -1018,7 +1489,7 @@ bool Assembler::setSymbol(AsmSymbolEntry& symEntry, uint64_t value, cxuint secti
                         {
                             printWarningForRange(16, value, expr->getSourcePos());
                             SULEV(*reinterpret_cast<uint16_t*>(sections[target.sectionId]
-                                    .content.data() + target.offset), uint16_t(value));
+                                    .getData(target.offset)), uint16_t(value));
                         }
                         break;
                     case ASMXTGT_DATA32:
@@ -1032,7 +1503,7 @@ bool Assembler::setSymbol(AsmSymbolEntry& symEntry, uint64_t value, cxuint secti
                         {
                             printWarningForRange(32, value, expr->getSourcePos());
                             SULEV(*reinterpret_cast<uint32_t*>(sections[target.sectionId]
-                                    .content.data() + target.offset), uint32_t(value));
+                                    .getData(target.offset)), uint32_t(value));
                         }
                         break;
                     case ASMXTGT_DATA64:
@@ -1044,9 +1515,11 @@ bool Assembler::setSymbol(AsmSymbolEntry& symEntry, uint64_t value, cxuint secti
                         }
                         else
                             SULEV(*reinterpret_cast<uint64_t*>(sections[target.sectionId]
-                                    .content.data() + target.offset), uint64_t(value));
+                                    .getData(target.offset)), uint64_t(value));
                         break;
                     default: // ISA assembler resolves this dependency
+                        /* code is assembled only into flattened sections, hence
+                         * it is placed before fill runs */
                         if (!isaAssembler->resolveCode(expr->getSourcePos(),
                                 target.sectionId, sections[target.sectionId].content.data(),
                                 target.offset, target.type, sectionId, value))
@@ -1073,9 +1546,104 @@ bool Assembler::setSymbol(AsmSymbolEntry& symEntry, uint64_t value, cxuint secti
     return good;
 }
 
+void Assembler::addFixup(const AsmFixup& fixup, AsmExprTargetType type,
+            cxuint sectionId, size_t offset)
+{
+    AsmSymbol& symbol = fixup.symbol->second;
+    std::vector<AsmFixup>& fixups = sections[sectionId].fixups;
+    const size_t index = fixups.size();
+    fixups.push_back(fixup);
+    AsmFixup& newFixup = fixups.back();
+    newFixup.type = type;
+    newFixup.sectionId = sectionId;
+    newFixup.offset = offset;
+    newFixup.nextSectionId = 0;
+    newFixup.nextFixup = SIZE_MAX;
+    // add to end of chain of symbol's fixups
+    if (symbol.lastFixup != SIZE_MAX)
+    {
+        AsmFixup& lastFixup = sections[symbol.lastFixupSectionId].fixups[symbol.lastFixup];
+        lastFixup.nextSectionId = sectionId;
+        lastFixup.nextFixup = index;
+    }
+    else
+    {
+        symbol.firstFixupSectionId = sectionId;
+        symbol.firstFixup = index;
+    }
+    symbol.lastFixupSectionId = sectionId;
+    symbol.lastFixup = index;
+    pendingFixupsNum++;
+    if ((flags & ASM_STATS) != 0)
+        stats.fixupsNum++;
+}
+
+bool Assembler::resolveFixups(AsmSymbolEntry& symEntry)
+{
+    AsmSymbol& symbol = symEntry.second;
+    const cxuint sectionId = (!isAbsoluteSymbol(symbol)) ? symbol.sectionId : ASMSECT_ABS;
+    bool good = true;
+    cxuint fixupSectionId = symbol.firstFixupSectionId;
+    for (size_t i = symbol.firstFixup; i != SIZE_MAX; )
+    {
+        AsmFixup& fixup = sections[fixupSectionId].fixups[i];
+        if (!isaAssembler->resolveCode(fixup.sourcePos, fixup.sectionId,
+                    sections[fixup.sectionId].content.data(), fixup.offset,
+                    fixup.type, sectionId, symbol.value + fixup.addend))
+            good = false;
+        fixup.symbol = nullptr;
+        pendingFixupsNum--;
+        fixupSectionId = fixup.nextSectionId;
+        i = fixup.nextFixup;
+    }
+    symbol.firstFixup = symbol.lastFixup = SIZE_MAX;
+    return good;
+}
+
+void Assembler::makeFixupExprs(AsmSymbolEntry& symEntry)
+{
+    AsmSymbol& symbol = symEntry.second;
+    if (symbol.firstFixup == SIZE_MAX)
+        return;
+    // expressions of fixups will be before other occurrences (fixups are earlier)
+    std::vector<AsmExprSymbolOccurrence> occurrences;
+    cxuint fixupSectionId = symbol.firstFixupSectionId;
+    for (size_t i = symbol.firstFixup; i != SIZE_MAX; )
+    {
+        AsmFixup& fixup = sections[fixupSectionId].fixups[i];
+        const AsmExprOp ops[3] = { AsmExprOp::ARG_SYMBOL, AsmExprOp::ARG_VALUE,
+                AsmExprOp::ADDITION };
+        AsmExprArg args[2];
+        args[0].symbol = &symEntry;
+        args[1].relValue.value = fixup.addend;
+        args[1].relValue.sectionId = ASMSECT_ABS;
+        const bool withAddend = (fixup.addend != 0);
+        std::unique_ptr<AsmExpression> expr(new(exprArena) AsmExpression(&exprArena));
+        expr->sourcePos = fixup.sourcePos;
+        expr->setParams(1, false, withAddend ? 3 : 1, ops, 0, nullptr,
+                    withAddend ? 2 : 1, args);
+        expr->setTarget(AsmExprTarget(fixup.type, fixup.sectionId, fixup.offset));
+        occurrences.push_back({ expr.release(), 0, 0 });
+        fixup.symbol = nullptr;
+        pendingFixupsNum--;
+        fixupSectionId = fixup.nextSectionId;
+        i = fixup.nextFixup;
+    }
+    symbol.occurrencesInExprs.insertFront(&exprArena, occurrences.data(),
+                occurrences.data()+occurrences.size());
+    symbol.firstFixup = symbol.lastFixup = SIZE_MAX;
+}
+
 bool Assembler::assignSymbol(const CString& symbolName, const char* symbolPlace,
              const char* linePtr, bool reassign, bool baseExpr)
 {
+    if (pendingFixupsNum != 0)
+    {   // pending fixups of symbol must be expressions, because symbol can be
+        // register range or can be defined by unresolved expression
+        AsmSymbolMap::iterator it = symbolMap.find(symbolName);
+        if (it != symbolMap.end())
+            makeFixupExprs(*it);
+    }
     skipSpacesToEnd(linePtr, line+lineSize);
     if (linePtr!=line+lineSize && *linePtr=='%')
     {
@@ -1216,10 +1784,9 @@ bool Assembler::assignSymbol(const CString& symbolName, const char* symbolPlace,
             if (!AsmExpression::makeSymbolSnapshot(*this, symEntry, tempSymEntry,
                     &symEntry.second.occurrencesInExprs[0].expression->getSourcePos()))
                 return false;
+            // move occurrences to snapshot
             tempSymEntry->second.occurrencesInExprs =
-                        symEntry.second.occurrencesInExprs;
-            // clear occurrences after copy
-            symEntry.second.occurrencesInExprs.clear();
+                        std::move(symEntry.second.occurrencesInExprs);
             if (tempSymEntry->second.hasValue) // set symbol chain
                 setSymbol(*tempSymEntry, tempSymEntry->second.value,
                           tempSymEntry->second.sectionId);
@@ -1251,7 +1818,7 @@ bool Assembler::assignOutputCounter(const char* symbolPlace, uint64_t value,
     if (currentSection==ASMSECT_ABS && fillValue!=0)
         printWarning(symbolPlace, "Fill value is ignored inside absolute section");
     if (value-currentOutPos!=0)
-        reserveData(value-currentOutPos, fillValue);
+        fillData(value-currentOutPos, 1, &fillValue);
     currentOutPos = value;
     return true;
 }
@@ -1565,6 +2132,64 @@ Assembler::ParseState Assembler::makeMacroSubstitution(const char* linePtr)
     return ParseState::PARSED;
 }
 
+/*
+ * process-wide cache of included files (filtered contents)
+ */
+
+struct AsmIncludeCacheEntry
+{
+    uint64_t timestamp;
+    RefPtr<const AsmFilteredSource> source;
+};
+
+static std::mutex includeCacheMutex;
+static std::unordered_map<CString, AsmIncludeCacheEntry> includeCacheMap;
+static size_t includeCacheSize = 0;
+static const size_t includeCacheMaxSize = size_t(256)<<20;
+
+static RefPtr<const AsmFilteredSource> findIncludeCache(const CString& filename,
+            uint64_t timestamp)
+{
+    std::lock_guard<std::mutex> lock(includeCacheMutex);
+    auto it = includeCacheMap.find(filename);
+    if (it == includeCacheMap.end() || it->second.timestamp != timestamp)
+        return RefPtr<const AsmFilteredSource>();
+    return it->second.source;
+}
+
+void Assembler::clearIncludeCache()
+{
+    std::lock_guard<std::mutex> lock(includeCacheMutex);
+    includeCacheMap.clear();
+    includeCacheSize = 0;
+}
+
+void Assembler::addIncludeCache(const CString& filename, uint64_t timestamp,
+            RefPtr<const AsmFilteredSource> source)
+{
+    includedSources[filename] = source;
+    const size_t sourceSize = source->getContent().size() +
+            source->getColTranslations().size()*sizeof(LineTrans);
+    std::lock_guard<std::mutex> lock(includeCacheMutex);
+    auto it = includeCacheMap.find(filename);
+    if (it != includeCacheMap.end())
+    {   // replace older content
+        includeCacheSize -= it->second.source->getContent().size() +
+            it->second.source->getColTranslations().size()*sizeof(LineTrans);
+        includeCacheMap.erase(it);
+    }
+    if (sourceSize > includeCacheMaxSize)
+        return;
+    if (includeCacheSize + sourceSize > includeCacheMaxSize)
+    {   // simple eviction: drop all cached files
+        includeCacheMap.clear();
+        includeCacheSize = 0;
+    }
+    includeCacheMap.insert(std::make_pair(filename,
+                AsmIncludeCacheEntry{ timestamp, source }));
+    includeCacheSize += sourceSize;
+}
+
 bool Assembler::includeFile(const char* pseudoOpPlace, const std::string& filename)
 {
     if (inclusionLevel == 500)
@@ -1572,8 +2197,29 @@ bool Assembler::includeFile(const char* pseudoOpPlace, const std::string& filena
         printError(pseudoOpPlace, "Inclusion level is greater than 500");
         return false;
     }
-    std::unique_ptr<AsmInputFilter> newInputFilter(new AsmStreamInputFilter(
-                getSourcePos(pseudoOpPlace), filename));
+    const CString cfilename(filename.c_str());
+    std::unique_ptr<AsmStreamInputFilter> newInputFilter;
+    RefPtr<const AsmFilteredSource> cachedSource;
+    auto it = includedSources.find(cfilename);
+    if (it != includedSources.end())
+        // already included in this assembly
+        cachedSource = it->second;
+    else
+    {
+        const uint64_t timestamp = getFileTimestamp(filename.c_str());
+        cachedSource = findIncludeCache(cfilename, timestamp);
+        if (cachedSource)
+            includedSources.insert(std::make_pair(cfilename, cachedSource));
+        else
+        {   // read file and record its content for next inclusions
+            newInputFilter.reset(new AsmStreamInputFilter(
+                    getSourcePos(pseudoOpPlace), cfilename));
+            newInputFilter->recordContent(timestamp);
+        }
+    }
+    if (cachedSource)
+        newInputFilter.reset(new AsmStreamInputFilter(getSourcePos(pseudoOpPlace),
+                    cachedSource, cfilename));
     asmInputFilters.push(newInputFilter.release());
     currentInputFilter = asmInputFilters.top();
     inclusionLevel++;
@@ -1609,6 +2255,8 @@ bool Assembler::readLine()
                 line = currentInputFilter->readLine(*this, lineSize);
             } while (line==nullptr && filenameIndex<filenames.size());
             
+            if (line!=nullptr && (flags & ASM_STATS) != 0)
+                stats.linesNum++;
             return (line!=nullptr);
         }
         else
@@ -1616,6 +2264,8 @@ bool Assembler::readLine()
         currentInputFilter = asmInputFilters.top();
         line = currentInputFilter->readLine(*this, lineSize);
     }
+    if ((flags & ASM_STATS) != 0)
+        stats.linesNum++;
     return true;
 }
 
@@ -1623,7 +2273,6 @@ cxbyte* Assembler::reserveData(size_t size, cxbyte fillValue)
 {
     if (currentSection != ASMSECT_ABS)
     {
-        size_t oldOutPos = currentOutPos;
         AsmSection& section = sections[currentSection];
         if ((section.flags & ASMSECT_WRITEABLE) == 0) // non writeable
         {
@@ -1635,7 +2284,7 @@ cxbyte* Assembler::reserveData(size_t size, cxbyte fillValue)
         {
             section.content.insert(section.content.end(), size, fillValue);
             currentOutPos += size;
-            return section.content.data() + oldOutPos;
+            return section.content.data() + section.content.size() - size;
         }
     }
     else
@@ -1645,6 +2294,76 @@ cxbyte* Assembler::reserveData(size_t size, cxbyte fillValue)
     }
 }
 
+/* minimal size of fill that is held as fill run (smaller fills are put to content) */
+static const uint64_t minFillRunSize = 256;
+
+void Assembler::fillData(uint64_t size, cxuint patternSize, const cxbyte* pattern)
+{
+    if (currentSection == ASMSECT_ABS ||
+        (sections[currentSection].flags & ASMSECT_WRITEABLE) == 0 || size < minFillRunSize)
+    {   // small fill
+        cxbyte* data = reserveData(size);
+        if (data != nullptr)
+            for (size_t i = 0; i < size; i++)
+                data[i] = pattern[i % patternSize];
+        return;
+    }
+    sections[currentSection].addFill(size, patternSize, pattern);
+    currentOutPos += size;
+}
+
+void Assembler::putMappedData(const RefPtr<const MappedFile>& mappedFile,
+            size_t offset, size_t size)
+{
+    if (currentSection == ASMSECT_ABS ||
+        (sections[currentSection].flags & ASMSECT_WRITEABLE) == 0 || size < minFillRunSize)
+    {   // small region is copied
+        cxbyte* data = reserveData(size);
+        if (data != nullptr)
+            std::copy(mappedFile->data()+offset, mappedFile->data()+offset+size, data);
+        return;
+    }
+    sections[currentSection].addMappedData(mappedFile, offset, size);
+    currentOutPos += size;
+}
+
+void Assembler::checkMappedFiles() const
+{
+    for (const AsmSection& section: sections)
+        for (const AsmSectionFill& fill: section.fills)
+            if (fill.mappedFile && fill.mappedFile->isChanged())
+                throw Exception(std::string("Binary file '") +
+                        fill.mappedFile->getFilename().c_str() +
+                        "' has been changed while assembling");
+}
+
+bool Assembler::isMappedFile(const char* filename) const
+{
+    for (const AsmSection& section: sections)
+        for (const AsmSectionFill& fill: section.fills)
+            if (fill.mappedFile && fill.mappedFile->isSameFile(filename))
+                return true;
+    return false;
+}
+
+const std::vector<AsmSection>& Assembler::getSections() const
+{
+    std::lock_guard<std::mutex> lock(flatSectionsMutex);
+    if (!flatSectionsReady)
+    {
+        /* sections are not changed, because binary can be written concurrently
+         * from them. fill runs are expanded in copy of sections */
+        if (std::any_of(sections.begin(), sections.end(),
+                [](const AsmSection& section) { return !section.fills.empty(); }))
+        {
+            flatSections = sections;
+            for (AsmSection& section: flatSections)
+                section.flatten();
+        }
+        flatSectionsReady = true;
+    }
+    return flatSections.empty() ? sections : flatSections;
+}
 
 void Assembler::goToMain(const char* pseudoOpPlace)
 {
@@ -1811,17 +2530,55 @@ void Assembler::initializeOutputFormat()
 bool Assembler::assemble()
 {
     resolvingRelocs = false;
+    flatSectionsReady = false;
+    flatSections.clear();
     
     for (const DefSym& defSym: defSyms)
         if (defSym.first!=".")
-            symbolMap[defSym.first] = AsmSymbol(ASMSECT_ABS, defSym.second);
+            symbolMap.insert(defSym.first.c_str(), defSym.first.size()).first->second =
+                        AsmSymbol(ASMSECT_ABS, defSym.second);
         else if ((flags & ASM_WARNINGS) != 0)// ignore for '.'
             messageStream << "<command-line>: Warning: Definition for symbol '.' "
                     "was ignored" << std::endl;
     
     good = true;
+    /* statistics: time of statement is measured from end of reading line to
+     * reading next line. statement that pushes macro substitution or repetition
+     * is counted as macro time, also lines read from these filters */
+    const bool collectStats = (flags & ASM_STATS) != 0;
+    std::chrono::steady_clock::time_point statsTime;
+    size_t stmtFiltersNum = asmInputFilters.size();
+    bool stmtEncoded = false;
+    auto addStatsTime = [&statsTime](double& time)
+    {
+        const std::chrono::steady_clock::time_point now =
+                    std::chrono::steady_clock::now();
+        time += std::chrono::duration<double>(now - statsTime).count();
+        statsTime = now;
+    };
+    auto addStmtStatsTime = [&]()
+    {
+        if (asmInputFilters.size() > stmtFiltersNum)
+        {   // new input filter has been pushed by statement
+            const AsmInputFilterType type = asmInputFilters.top()->getType();
+            if (type == AsmInputFilterType::MACROSUBST)
+                stats.macroSubstsNum++;
+            else if (type == AsmInputFilterType::REPEAT)
+                stats.repetitionsNum++;
+            addStatsTime(type != AsmInputFilterType::STREAM ? stats.macroTime :
+                        stats.parsingTime);
+        }
+        else
+            addStatsTime(stmtEncoded ? stats.encodingTime : stats.parsingTime);
+        stmtEncoded = false;
+    };
+    if (collectStats)
+        statsTime = std::chrono::steady_clock::now();
+    
     while (!endOfAssembly)
     {
+        if (collectStats)
+            addStmtStatsTime();
         if (!lineAlreadyRead)
         {   // read line
             if (!readLine())
@@ -1833,6 +2590,12 @@ bool Assembler::assemble()
             if (line == nullptr)
                 break; // end of stream
         }
+        if (collectStats)
+        {
+            addStatsTime(currentInputFilter->getType() != AsmInputFilterType::STREAM ?
+                        stats.macroTime : stats.readingTime);
+            stmtFiltersNum = asmInputFilters.size();
+        }
         
         const char* linePtr = line; // string points to place of line
         const char* end = line+lineSize;
@@ -1869,21 +2632,19 @@ bool Assembler::assemble()
                 }
                 /* prevLRes - iterator to previous instance of local label (with 'b)
                  * nextLRes - iterator to next instance of local label (with 'f) */
-                std::pair<AsmSymbolMap::iterator, bool> prevLRes =
-                        symbolMap.insert(std::make_pair(
-                            std::string(firstName.c_str())+"b", AsmSymbol()));
-                std::pair<AsmSymbolMap::iterator, bool> nextLRes =
-                        symbolMap.insert(std::make_pair(
-                            std::string(firstName.c_str())+"f", AsmSymbol()));
+                AsmSymbolEntry* prevLabel = getLocalLabelSymbol(firstName.c_str(),
+                            firstName.size(), false);
+                AsmSymbolEntry* nextLabel = getLocalLabelSymbol(firstName.c_str(),
+                            firstName.size(), true);
                 /* resolve forward symbol of label now */
-                assert(setSymbol(*nextLRes.first, currentOutPos, currentSection));
+                setSymbol(*nextLabel, currentOutPos, currentSection);
                 // move symbol value from next local label into previous local label
                 // clearOccurrences - obsolete - back local labels are undefined!
-                prevLRes.first->second.value = nextLRes.first->second.value;
-                prevLRes.first->second.hasValue = isResolvableSection();
-                prevLRes.first->second.sectionId = currentSection;
+                prevLabel->second.value = nextLabel->second.value;
+                prevLabel->second.hasValue = isResolvableSection();
+                prevLabel->second.sectionId = currentSection;
                 /// make forward symbol of label as undefined
-                nextLRes.first->second.hasValue = false;
+                nextLabel->second.hasValue = false;
             }
             else
             {   // regular labels
@@ -1968,12 +2729,22 @@ bool Assembler::assemble()
                        "Writing data into non-writeable section is illegal");
                     continue;
                 }
+                // positions in code are positions in content
+                sections[currentSection].flatten();
                 isaAssembler->assemble(firstName, stmtPlace, linePtr, end,
                            sections[currentSection].content);
                 currentOutPos = sections[currentSection].getSize();
+                stmtEncoded = true;
             }
         }
     }
+    if (collectStats)
+    {   // statement before '.end' or reading after last line
+        if (endOfAssembly)
+            addStmtStatsTime();
+        else
+            addStatsTime(stats.readingTime);
+    }
     /* check clauses and print errors */
     while (!clauses.empty())
     {
@@ -2002,6 +2773,14 @@ bool Assembler::assemble()
         clauses.pop();
     }
     
+    if (collectStats)
+        addStatsTime(stats.parsingTime);
+    
+    // remaining fixups will be resolved by standard way (also as relocations)
+    if (pendingFixupsNum != 0)
+        for (AsmSymbolEntry& symEntry: symbolMap)
+            makeFixupExprs(symEntry);
+    
     resolvingRelocs = true;
     for (AsmSymbolEntry& symEntry: symbolMap)
         if (!symEntry.second.occurrencesInExprs.empty() || 
@@ -2021,23 +2800,93 @@ bool Assembler::assemble()
                     printError(occur.expression->getSourcePos(),(std::string(
                         "Unresolved symbol '")+symEntry.first.c_str()+"'").c_str());
     
+    if (collectStats)
+        addStatsTime(stats.resolvingTime);
+    
     if (good && formatHandler!=nullptr)
         formatHandler->prepareBinary();
+    if (collectStats)
+    {
+        addStatsTime(stats.preparingTime);
+        stats.symbolsNum = symbolMap.size();
+        stats.sectionsSize = 0;
+        for (const AsmSection& section: sections)
+            stats.sectionsSize += section.getSize();
+    }
     return good;
 }
 
+/* adds time elapsed to end of scope to given statistics time (if not null) */
+struct CLRX_INTERNAL AsmStatsTimer
+{
+    double* time;
+    std::chrono::steady_clock::time_point start;
+    
+    explicit AsmStatsTimer(double* _time) : time(_time)
+    {
+        if (time != nullptr)
+            start = std::chrono::steady_clock::now();
+    }
+    ~AsmStatsTimer()
+    {
+        if (time != nullptr)
+            *time += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start).count();
+    }
+};
+
 void Assembler::writeBinary(const char* filename) const
 {
     if (good)
     {
+        AsmStatsTimer timer((flags & ASM_STATS)!=0 ? &stats.writingTime : nullptr);
         const AsmFormatHandler* formatHandler = getFormatHandler();
         if (formatHandler!=nullptr)
         {
+            checkMappedFiles();
+            std::string output;
+            const bool outputIsMapped = isMappedFile(filename);
+            if (outputIsMapped)
+            {   /* output file holds mapped data, thus binary must be generated
+                 * before truncating output file */
+                std::ostringstream oss;
+                formatHandler->writeBinary(oss);
+                output = oss.str();
+            }
+#ifndef HAVE_WINDOWS
+            if (!outputIsMapped && format == BinaryFormat::RAWCODE)
+            {   /* raw code is written directly from section content and
+                 * mapped regions without copying */
+                const int fd = ::open(filename, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+                if (fd < 0)
+                    throw Exception(std::string("Can't open output file '")+
+                                filename+"'");
+                try
+                {
+                    AsmGatherWriter writer(fd, filename);
+                    writer.writeSection(sections[0]);
+                }
+                catch(...)
+                {
+                    ::close(fd);
+                    throw;
+                }
+                if (::close(fd) != 0)
+                    throw Exception(std::string("Can't write output file '")+
+                                filename+"'");
+                return;
+            }
+#endif
             std::ofstream ofs(filename, std::ios::binary);
-            if (ofs)
-                formatHandler->writeBinary(ofs);
-            else
+            if (!ofs)
                 throw Exception(std::string("Can't open output file '")+filename+"'");
+            if (outputIsMapped)
+                ofs.write(output.data(), output.size());
+            else
+                formatHandler->writeBinary(ofs);
+            ofs.close();
+            if (!ofs)
+                throw Exception(std::string("Can't write output file '")+filename+"'");
         }
         else
             throw Exception("No output binary");
@@ -2050,9 +2899,15 @@ void Assembler::writeBinary(std::ostream& outStream) const
 {
     if (good)
     {
+        AsmStatsTimer timer((flags & ASM_STATS)!=0 ? &stats.writingTime : nullptr);
         const AsmFormatHandler* formatHandler = getFormatHandler();
         if (formatHandler!=nullptr)
+        {
+            checkMappedFiles();
             formatHandler->writeBinary(outStream);
+            if (!outStream)
+                throw Exception("Can't write output binary");
+        }
         else
             throw Exception("No output binary");
     }
@@ -2064,12 +2919,38 @@ void Assembler::writeBinary(Array<cxbyte>& array) const
 {
     if (good)
     {
+        AsmStatsTimer timer((flags & ASM_STATS)!=0 ? &stats.writingTime : nullptr);
         const AsmFormatHandler* formatHandler = getFormatHandler();
         if (formatHandler!=nullptr)
+        {
+            checkMappedFiles();
             formatHandler->writeBinary(array);
+        }
         else
             throw Exception("No output binary");
     }
     else // failed
         throw Exception("Assembler failed!");
 }
+
+void Assembler::writeMacroLibrary(const char* filename) const
+{
+    std::ofstream ofs(filename, std::ios::binary);
+    if (ofs)
+        writeMacroLibrary(ofs);
+    else
+        throw Exception(std::string("Can't open output file '")+filename+"'");
+}
+
+void Assembler::writeMacroLibrary(std::ostream& outStream) const
+{
+    if (!good)
+        throw Exception("Assembler failed!");
+    // sort macros by name to get same library for same sources
+    AsmMacroList macros(macroMap.begin(), macroMap.end());
+    std::sort(macros.begin(), macros.end(),
+        [](const std::pair<CString, RefPtr<const AsmMacro> >& a,
+           const std::pair<CString, RefPtr<const AsmMacro> >& b)
+        { return a.first < b.first; });
+    writeAsmMacroLibrary(outStream, macros);
+}
@@ -1490,6 +1490,31 @@ static void dumpAmdKernelConfig(std::ostream& output, const AmdKernelConfig& con
     }
 }
 
+static void disassembleAmdKernel(std::ostream& output, const AmdDisasmInput* amdInput,
+       const AmdDisasmKernelInput& kinput, ISADisassembler* isaDisassembler, Flags flags)
+{
+    output.write(".kernel ", 8);
+    output.write(kinput.kernelName.c_str(), kinput.kernelName.size());
+    output.put('\n');
+    if ((flags & DISASM_CONFIG) == 0) // if not config
+        dumpAmdKernelDatas(output, kinput, flags);
+    else
+    {
+        AmdKernelConfig config = getAmdKernelConfig(kinput.metadataSize,
+                kinput.metadata, kinput.calNotes, amdInput->driverInfo,
+                kinput.header);
+        dumpAmdKernelConfig(output, config);
+    }
+    
+    if ((flags & DISASM_DUMPCODE) != 0 && kinput.code != nullptr && kinput.codeSize != 0)
+    {   // input kernel code (main disassembly)
+        output.write("    .text\n", 10);
+        isaDisassembler->setInput(kinput.codeSize, kinput.code);
+        isaDisassembler->beforeDisassemble();
+        isaDisassembler->disassemble();
+    }
+}
+
 void CLRX::disassembleAmd(std::ostream& output, const AmdDisasmInput* amdInput,
        ISADisassembler* isaDisassembler, size_t& sectionCount, Flags flags)
 {
@@ -1521,28 +1546,17 @@ void CLRX::disassembleAmd(std::ostream& output, const AmdDisasmInput* amdInput,
         printDisasmData(amdInput->globalDataSize, amdInput->globalData, output);
     }
     
-    for (const AmdDisasmKernelInput& kinput: amdInput->kernels)
-    {
-        output.write(".kernel ", 8);
-        output.write(kinput.kernelName.c_str(), kinput.kernelName.size());
-        output.put('\n');
-        if ((flags & DISASM_CONFIG) == 0) // if not config
-            dumpAmdKernelDatas(output, kinput, flags);
-        else
+    // kernels can be disassembled in parallel threads
+    disassembleKernels(output, isaDisassembler, amdInput->kernels.size(), sectionCount,
+        [amdInput, doDumpCode](size_t i)
         {
-            AmdKernelConfig config = getAmdKernelConfig(kinput.metadataSize,
-                    kinput.metadata, kinput.calNotes, amdInput->driverInfo,
-                    kinput.header);
-            dumpAmdKernelConfig(output, config);
-        }
-        
-        if (doDumpCode && kinput.code != nullptr && kinput.codeSize != 0)
-        {   // input kernel code (main disassembly)
-            output.write("    .text\n", 10);
-            isaDisassembler->setInput(kinput.codeSize, kinput.code);
-            isaDisassembler->beforeDisassemble();
-            isaDisassembler->disassemble();
-            sectionCount++;
-        }
-    }
+            const AmdDisasmKernelInput& kinput = amdInput->kernels[i];
+            return doDumpCode && kinput.code != nullptr && kinput.codeSize != 0;
+        },
+        [amdInput, flags](size_t i, std::ostream& kernelOutput,
+                    ISADisassembler* kernelDisasm)
+        {
+            disassembleAmdKernel(kernelOutput, amdInput, amdInput->kernels[i],
+                        kernelDisasm, flags);
+        });
 }
@@ -803,6 +803,70 @@ static void dumpAmdCL2KernelConfig(std::ostream& output, const AmdCL2KernelConfi
     }
 }
 
+static void disassembleAmdCL2Kernel(std::ostream& output,
+       const AmdCL2DisasmKernelInput& kinput, ISADisassembler* isaDisassembler,
+       const std::vector<size_t>& samplerOffsets, Flags flags)
+{
+    const bool doMetadata = ((flags & DISASM_METADATA) != 0);
+    const bool doDumpCode = ((flags & DISASM_DUMPCODE) != 0);
+    const bool doDumpConfig = ((flags & DISASM_CONFIG) != 0);
+    const bool doSetup = ((flags & DISASM_SETUP) != 0);
+    
+    output.write(".kernel ", 8);
+    output.write(kinput.kernelName.c_str(), kinput.kernelName.size());
+    output.put('\n');
+    if (doMetadata && !doDumpConfig)
+    {
+        if (kinput.metadata != nullptr && kinput.metadataSize != 0)
+        {   // if kernel metadata available
+            output.write("    .metadata\n", 14);
+            printDisasmData(kinput.metadataSize, kinput.metadata, output, true);
+        }
+        if (kinput.isaMetadata != nullptr && kinput.isaMetadataSize != 0)
+        {   // if kernel isametadata available
+            output.write("    .isametadata\n", 17);
+            printDisasmData(kinput.isaMetadataSize, kinput.isaMetadata, output, true);
+        }
+    }
+    if (doSetup && !doDumpConfig)
+    {
+        if (kinput.stub != nullptr && kinput.stubSize != 0)
+        {   // if kernel setup available
+            output.write("    .stub\n", 10);
+            printDisasmData(kinput.stubSize, kinput.stub, output, true);
+        }
+        if (kinput.setup != nullptr && kinput.setupSize != 0)
+        {   // if kernel setup available
+            output.write("    .setup\n", 11);
+            printDisasmData(kinput.setupSize, kinput.setup, output, true);
+        }
+    }
+    
+    if (doDumpConfig)
+    {
+        const AmdCL2KernelConfig config = genKernelConfig(kinput.metadataSize,
+                kinput.metadata, kinput.setupSize, kinput.setup, samplerOffsets,
+                kinput.textRelocs);
+        dumpAmdCL2KernelConfig(output, config);
+    }
+    
+    if (doDumpCode && kinput.code != nullptr && kinput.codeSize != 0)
+    {   // input kernel code (main disassembly)
+        isaDisassembler->clearRelocations();
+        isaDisassembler->addRelSymbol(".gdata");
+        isaDisassembler->addRelSymbol(".ddata"); // rw data
+        isaDisassembler->addRelSymbol(".bdata"); // .bss data
+        for (const AmdCL2RelaEntry& entry: kinput.textRelocs)
+            isaDisassembler->addRelocation(entry.offset, entry.type, 
+                           cxuint(entry.symbol), entry.addend);
+
+        output.write("    .text\n", 10);
+        isaDisassembler->setInput(kinput.codeSize, kinput.code);
+        isaDisassembler->beforeDisassemble();
+        isaDisassembler->disassemble();
+    }
+}
+
 void CLRX::disassembleAmdCL2(std::ostream& output, const AmdCL2DisasmInput* amdCL2Input,
        ISADisassembler* isaDisassembler, size_t& sectionCount, Flags flags)
 {
@@ -908,61 +972,17 @@ void CLRX::disassembleAmdCL2(std::ostream& output, const AmdCL2DisasmInput* amdC
         }
     }
     
-    for (const AmdCL2DisasmKernelInput& kinput: amdCL2Input->kernels)
-    {
-        output.write(".kernel ", 8);
-        output.write(kinput.kernelName.c_str(), kinput.kernelName.size());
-        output.put('\n');
-        if (doMetadata && !doDumpConfig)
-        {
-            if (kinput.metadata != nullptr && kinput.metadataSize != 0)
-            {   // if kernel metadata available
-                output.write("    .metadata\n", 14);
-                printDisasmData(kinput.metadataSize, kinput.metadata, output, true);
-            }
-            if (kinput.isaMetadata != nullptr && kinput.isaMetadataSize != 0)
-            {   // if kernel isametadata available
-                output.write("    .isametadata\n", 17);
-                printDisasmData(kinput.isaMetadataSize, kinput.isaMetadata, output, true);
-            }
-        }
-        if (doSetup && !doDumpConfig)
+    // kernels can be disassembled in parallel threads
+    disassembleKernels(output, isaDisassembler, amdCL2Input->kernels.size(), sectionCount,
+        [amdCL2Input, doDumpCode](size_t i)
         {
-            if (kinput.stub != nullptr && kinput.stubSize != 0)
-            {   // if kernel setup available
-                output.write("    .stub\n", 10);
-                printDisasmData(kinput.stubSize, kinput.stub, output, true);
-            }
-            if (kinput.setup != nullptr && kinput.setupSize != 0)
-            {   // if kernel setup available
-                output.write("    .setup\n", 11);
-                printDisasmData(kinput.setupSize, kinput.setup, output, true);
-            }
-        }
-        
-        if (doDumpConfig)
+            const AmdCL2DisasmKernelInput& kinput = amdCL2Input->kernels[i];
+            return doDumpCode && kinput.code != nullptr && kinput.codeSize != 0;
+        },
+        [amdCL2Input, &samplerOffsets, flags](size_t i, std::ostream& kernelOutput,
+                    ISADisassembler* kernelDisasm)
         {
-            const AmdCL2KernelConfig config = genKernelConfig(kinput.metadataSize,
-                    kinput.metadata, kinput.setupSize, kinput.setup, samplerOffsets,
-                    kinput.textRelocs);
-            dumpAmdCL2KernelConfig(output, config);
-        }
-        
-        if (doDumpCode && kinput.code != nullptr && kinput.codeSize != 0)
-        {   // input kernel code (main disassembly)
-            isaDisassembler->clearRelocations();
-            isaDisassembler->addRelSymbol(".gdata");
-            isaDisassembler->addRelSymbol(".ddata"); // rw data
-            isaDisassembler->addRelSymbol(".bdata"); // .bss data
-            for (const AmdCL2RelaEntry& entry: kinput.textRelocs)
-                isaDisassembler->addRelocation(entry.offset, entry.type, 
-                               cxuint(entry.symbol), entry.addend);
-    
-            output.write("    .text\n", 10);
-            isaDisassembler->setInput(kinput.codeSize, kinput.code);
-            isaDisassembler->beforeDisassemble();
-            isaDisassembler->disassemble();
-            sectionCount++;
-        }
-    }
+            disassembleAmdCL2Kernel(kernelOutput, amdCL2Input->kernels[i], kernelDisasm,
+                        samplerOffsets, flags);
+        });
 }
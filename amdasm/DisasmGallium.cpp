@@ -274,6 +274,7 @@ void CLRX::disassembleGallium(std::ostream& output,
     if (doDumpCode && galliumInput->code != nullptr && galliumInput->codeSize != 0)
     {   // print text
         output.write(".text\n", 6);
+        isaDisassembler->setSectionIndex(sectionCount);
         isaDisassembler->setInput(galliumInput->codeSize, galliumInput->code);
         isaDisassembler->beforeDisassemble();
         isaDisassembler->disassemble();
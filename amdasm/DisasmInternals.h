@@ -25,6 +25,7 @@
 #include <string>
 #include <ostream>
 #include <utility>
+#include <functional>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/amdbin/AmdBinaries.h>
 #include <CLRX/amdbin/AmdCL2Binaries.h>
@@ -44,6 +45,15 @@ extern CLRX_INTERNAL void printDisasmDataU32(size_t size, const uint32_t* data,
 extern CLRX_INTERNAL void printDisasmLongString(size_t size, const char* data,
             std::ostream& output, bool secondAlign = false);
 
+/* disassemble kernels (in parallel threads if disassembler has more threads).
+ * kernelFunc writes whole kernel to output by using supplied ISA disassembler,
+ * hasCode returns true if kernel code will be disassembled (uses next section).
+ * output is same as for serial disassemblying */
+extern CLRX_INTERNAL void disassembleKernels(std::ostream& output,
+        ISADisassembler* isaDisassembler, size_t kernelsNum, size_t& sectionCount,
+        const std::function<bool(size_t)>& hasCode,
+        const std::function<void(size_t, std::ostream&, ISADisassembler*)>& kernelFunc);
+
 extern CLRX_INTERNAL void disassembleAmd(std::ostream& output,
        const AmdDisasmInput* amdInput, ISADisassembler* isaDisassembler,
        size_t& sectionCount, Flags flags);
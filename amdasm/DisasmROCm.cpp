@@ -433,6 +433,7 @@ void CLRX::disassembleROCm(std::ostream& output, const ROCmDisasmInput* rocmInpu
     {
         const cxbyte* code = rocmInput->code;
         output.write(".text\n", 6);
+        isaDisassembler->setSectionIndex(sectionCount);
         // clear labels
         isaDisassembler->clearNumberedLabels();
         
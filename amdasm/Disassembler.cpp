@@ -21,6 +21,7 @@
 #include <string>
 #include <cstring>
 #include <ostream>
+#include <sstream>
 #include <cstring>
 #include <memory>
 #include <vector>
@@ -37,7 +38,14 @@ using namespace CLRX;
 
 ISADisassembler::ISADisassembler(Disassembler& _disassembler, cxuint outBufSize)
         : disassembler(_disassembler), startOffset(0), labelStartOffset(0),
-          dontPrintLabelsAfterCode(false), output(outBufSize, _disassembler.getOutput())
+          dontPrintLabelsAfterCode(false), sectionIndex(0),
+          output(outBufSize, _disassembler.getOutput())
+{ }
+
+ISADisassembler::ISADisassembler(Disassembler& _disassembler, std::ostream& _output,
+          cxuint outBufSize) : disassembler(_disassembler), startOffset(0),
+          labelStartOffset(0), dontPrintLabelsAfterCode(false), sectionIndex(0),
+          output(outBufSize, _output)
 { }
 
 ISADisassembler::~ISADisassembler()
@@ -81,7 +89,7 @@ void ISADisassembler::writeLabelsToPosition(size_t pos, LabelIter& labelIter,
                 buf[bufPos++] = 'L';
                 bufPos += itocstrCStyle(*labelIter, buf+bufPos, 22, 10, 0, false);
                 buf[bufPos++] = '_';
-                bufPos += itocstrCStyle(disassembler.sectionCount,
+                bufPos += itocstrCStyle(sectionIndex,
                                 buf+bufPos, 22, 10, 0, false);
                 if (curPos != pos)
                 {   // if label shifted back by some bytes before encoded instruction
@@ -161,7 +169,7 @@ void ISADisassembler::writeLabelsToEnd(size_t start, LabelIter labelIter,
             buf[bufPos++] = 'L';
             bufPos += itocstrCStyle(*labelIter, buf+bufPos, 22, 10, 0, false);
             buf[bufPos++] = '_';
-            bufPos += itocstrCStyle(disassembler.sectionCount,
+            bufPos += itocstrCStyle(sectionIndex,
                             buf+bufPos, 22, 10, 0, false);
             buf[bufPos++] = ':';
             buf[bufPos++] = '\n';
@@ -204,7 +212,7 @@ void ISADisassembler::writeLocation(size_t pos)
     buf[bufPos++] = 'L';
     bufPos += itocstrCStyle(pos, buf+bufPos, 22, 10, 0, false);
     buf[bufPos++] = '_';
-    bufPos += itocstrCStyle(disassembler.sectionCount, buf+bufPos, 22, 10, 0, false);
+    bufPos += itocstrCStyle(sectionIndex, buf+bufPos, 22, 10, 0, false);
     output.forward(bufPos);
 }
 
@@ -268,7 +276,8 @@ void ISADisassembler::beforeDisassemble()
 
 Disassembler::Disassembler(const AmdMainGPUBinary32& binary, std::ostream& _output,
             Flags _flags) : fromBinary(true), binaryFormat(BinaryFormat::AMD),
-            amdInput(nullptr), output(_output), flags(_flags), sectionCount(0)
+            amdInput(nullptr), output(_output), flags(_flags), sectionCount(0),
+            threadsNum(1)
 {
     isaDisassembler.reset(new GCNDisassembler(*this));
     amdInput = getAmdDisasmInputFromBinary32(binary, flags);
@@ -276,7 +285,8 @@ Disassembler::Disassembler(const AmdMainGPUBinary32& binary, std::ostream& _outp
 
 Disassembler::Disassembler(const AmdMainGPUBinary64& binary, std::ostream& _output,
             Flags _flags) : fromBinary(true), binaryFormat(BinaryFormat::AMD),
-            amdInput(nullptr), output(_output), flags(_flags), sectionCount(0)
+            amdInput(nullptr), output(_output), flags(_flags), sectionCount(0),
+            threadsNum(1)
 {
     isaDisassembler.reset(new GCNDisassembler(*this));
     amdInput = getAmdDisasmInputFromBinary64(binary, flags);
@@ -284,7 +294,8 @@ Disassembler::Disassembler(const AmdMainGPUBinary64& binary, std::ostream& _outp
 
 Disassembler::Disassembler(const AmdCL2MainGPUBinary& binary, std::ostream& _output,
            Flags _flags) : fromBinary(true), binaryFormat(BinaryFormat::AMDCL2),
-            amdCL2Input(nullptr), output(_output), flags(_flags), sectionCount(0)
+            amdCL2Input(nullptr), output(_output), flags(_flags), sectionCount(0),
+            threadsNum(1)
 {
     isaDisassembler.reset(new GCNDisassembler(*this));
     amdCL2Input = getAmdCL2DisasmInputFromBinary(binary);
@@ -292,7 +303,8 @@ Disassembler::Disassembler(const AmdCL2MainGPUBinary& binary, std::ostream& _out
 
 Disassembler::Disassembler(const ROCmBinary& binary, std::ostream& _output, Flags _flags)
          : fromBinary(true), binaryFormat(BinaryFormat::ROCM),
-           rocmInput(nullptr), output(_output), flags(_flags), sectionCount(0)
+           rocmInput(nullptr), output(_output), flags(_flags), sectionCount(0),
+            threadsNum(1)
 {
     isaDisassembler.reset(new GCNDisassembler(*this));
     rocmInput = getROCmDisasmInputFromBinary(binary);
@@ -300,21 +312,24 @@ Disassembler::Disassembler(const ROCmBinary& binary, std::ostream& _output, Flag
 
 Disassembler::Disassembler(const AmdDisasmInput* disasmInput, std::ostream& _output,
             Flags _flags) : fromBinary(false), binaryFormat(BinaryFormat::AMD),
-            amdInput(disasmInput), output(_output), flags(_flags), sectionCount(0)
+            amdInput(disasmInput), output(_output), flags(_flags), sectionCount(0),
+            threadsNum(1)
 {
     isaDisassembler.reset(new GCNDisassembler(*this));
 }
 
 Disassembler::Disassembler(const AmdCL2DisasmInput* disasmInput, std::ostream& _output,
             Flags _flags) : fromBinary(false), binaryFormat(BinaryFormat::AMDCL2),
-            amdCL2Input(disasmInput), output(_output), flags(_flags), sectionCount(0)
+            amdCL2Input(disasmInput), output(_output), flags(_flags), sectionCount(0),
+            threadsNum(1)
 {
     isaDisassembler.reset(new GCNDisassembler(*this));
 }
 
 Disassembler::Disassembler(const ROCmDisasmInput* disasmInput, std::ostream& _output,
                  Flags _flags) : fromBinary(false), binaryFormat(BinaryFormat::ROCM),
-            rocmInput(disasmInput), output(_output), flags(_flags), sectionCount(0)
+            rocmInput(disasmInput), output(_output), flags(_flags), sectionCount(0),
+            threadsNum(1)
 {
     isaDisassembler.reset(new GCNDisassembler(*this));
 }
@@ -322,7 +337,8 @@ Disassembler::Disassembler(const ROCmDisasmInput* disasmInput, std::ostream& _ou
 Disassembler::Disassembler(GPUDeviceType deviceType, const GalliumBinary& binary,
            std::ostream& _output, Flags _flags) :
            fromBinary(true), binaryFormat(BinaryFormat::GALLIUM),
-           galliumInput(nullptr), output(_output), flags(_flags), sectionCount(0)
+           galliumInput(nullptr), output(_output), flags(_flags), sectionCount(0),
+            threadsNum(1)
 {
     isaDisassembler.reset(new GCNDisassembler(*this));
     galliumInput = getGalliumDisasmInputFromBinary(deviceType, binary);
@@ -330,7 +346,8 @@ Disassembler::Disassembler(GPUDeviceType deviceType, const GalliumBinary& binary
 
 Disassembler::Disassembler(const GalliumDisasmInput* disasmInput, std::ostream& _output,
              Flags _flags) : fromBinary(false), binaryFormat(BinaryFormat::GALLIUM),
-            galliumInput(disasmInput), output(_output), flags(_flags), sectionCount(0)
+            galliumInput(disasmInput), output(_output), flags(_flags), sectionCount(0),
+            threadsNum(1)
 {
     isaDisassembler.reset(new GCNDisassembler(*this));
 }
@@ -338,7 +355,8 @@ Disassembler::Disassembler(const GalliumDisasmInput* disasmInput, std::ostream&
 Disassembler::Disassembler(GPUDeviceType deviceType, size_t rawCodeSize,
            const cxbyte* rawCode, std::ostream& _output, Flags _flags)
        : fromBinary(true), binaryFormat(BinaryFormat::RAWCODE),
-         output(_output), flags(_flags), sectionCount(0)
+         output(_output), flags(_flags), sectionCount(0),
+            threadsNum(1)
 {
     isaDisassembler.reset(new GCNDisassembler(*this));
     rawInput = new RawCodeInput{ deviceType, rawCodeSize, rawCode };
@@ -537,12 +555,66 @@ void CLRX::printDisasmLongString(size_t size, const char* data, std::ostream& ou
     }
 }
 
+void CLRX::disassembleKernels(std::ostream& output, ISADisassembler* isaDisassembler,
+        size_t kernelsNum, size_t& sectionCount, const std::function<bool(size_t)>& hasCode,
+        const std::function<void(size_t, std::ostream&, ISADisassembler*)>& kernelFunc)
+{
+    Disassembler& disassembler = isaDisassembler->getDisassembler();
+    const cxuint threadsNum = disassembler.getThreadsNum();
+    if (threadsNum <= 1 || kernelsNum <= 1)
+    {
+        for (size_t i = 0; i < kernelsNum; i++)
+        {
+            isaDisassembler->setSectionIndex(sectionCount);
+            kernelFunc(i, output, isaDisassembler);
+            if (hasCode(i))
+                sectionCount++;
+        }
+        return;
+    }
+    
+    // section indices must be same as in serial disassemblying
+    std::vector<size_t> sectionIndices(kernelsNum);
+    for (size_t i = 0; i < kernelsNum; i++)
+    {
+        sectionIndices[i] = sectionCount;
+        if (hasCode(i))
+            sectionCount++;
+    }
+    /* kernels are disassembled in batches to output, every kernel to own buffer
+     * by own ISA disassembler. buffers are written in kernels order */
+    const size_t batchSize = size_t(threadsNum)*16;
+    std::vector<std::string> kernelOutputs(std::min(batchSize, kernelsNum));
+    for (size_t batchStart = 0; batchStart < kernelsNum; batchStart += batchSize)
+    {
+        const size_t batchEnd = std::min(batchStart + batchSize, kernelsNum);
+        runInParallel(threadsNum, batchEnd - batchStart, [&](size_t k)
+        {
+            const size_t i = batchStart + k;
+            std::ostringstream kernelOutput;
+            kernelOutput.exceptions(std::ios::failbit | std::ios::badbit);
+            GCNDisassembler kernelDisasm(disassembler, kernelOutput);
+            kernelDisasm.setSectionIndex(sectionIndices[i]);
+            // kernels are already decoded in parallel
+            kernelDisasm.setDecodeChunkSize(0);
+            kernelFunc(i, kernelOutput, &kernelDisasm);
+            kernelOutputs[k] = kernelOutput.str();
+        });
+        for (size_t k = 0; k < batchEnd - batchStart; k++)
+        {
+            output.write(kernelOutputs[k].c_str(), kernelOutputs[k].size());
+            kernelOutputs[k].clear();
+        }
+    }
+}
+
 static void disassembleRawCode(std::ostream& output, const RawCodeInput* rawInput,
        ISADisassembler* isaDisassembler, size_t& sectionCount, Flags flags)
 {
     if ((flags & DISASM_DUMPCODE) != 0)
     {
         output.write(".text\n", 6);
+        isaDisassembler->setSectionIndex(sectionCount);
         isaDisassembler->setInput(rawInput->codeSize, rawInput->code);
         isaDisassembler->beforeDisassemble();
         isaDisassembler->disassemble();
@@ -23,6 +23,7 @@
 #include <vector>
 #include <memory>
 #include <cstring>
+#include <climits>
 #include <algorithm>
 #include <mutex>
 #include <CLRX/amdasm/Assembler.h>
@@ -33,6 +34,123 @@ using namespace CLRX;
 static std::once_flag clrxGCNAssemblerOnceFlag;
 static Array<GCNAsmInstruction> gcnInstrSortedTable;
 
+/* perfect hash table of mnemonics for single GPU architecture.
+ * first level hash chooses bucket, and displacement of bucket chooses slot
+ * (hash and displace method). every slot holds index to first instruction of sorted
+ * table whose mnemonic is matched and which is available for architecture */
+class GCNInstrHashTable
+{
+private:
+    Array<uint32_t> displacements;
+    Array<cxuint> slots;
+    
+    static uint64_t hashMnemonic(const char* mnemonic, size_t length)
+    {   // FNV-1a
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < length; i++)
+            hash = (hash ^ cxbyte(mnemonic[i])) * 0x100000001b3ULL;
+        return hash;
+    }
+    static uint32_t slotHash(uint64_t hash, uint32_t displacement)
+    {   // murmur3 finalizer
+        uint32_t h = uint32_t(hash) ^ (displacement * 0x9e3779b9U);
+        h ^= h >> 16;
+        h *= 0x85ebca6bU;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35U;
+        h ^= h >> 16;
+        return h;
+    }
+public:
+    void build(uint16_t archMask);
+    
+    /// find instruction for mnemonic (length is length of mnemonic without suffix)
+    const GCNAsmInstruction* find(const char* mnemonic, size_t length) const
+    {
+        if (slots.empty())
+            return nullptr;
+        const uint64_t hash = hashMnemonic(mnemonic, length);
+        const uint32_t displacement = displacements[(hash>>32) % displacements.size()];
+        const GCNAsmInstruction& insn = gcnInstrSortedTable[
+                    slots[slotHash(hash, displacement) % slots.size()]];
+        if (::strncmp(insn.mnemonic, mnemonic, length)!=0 || insn.mnemonic[length]!=0)
+            return nullptr;
+        return &insn;
+    }
+};
+
+void GCNInstrHashTable::build(uint16_t archMask)
+{
+    // collect first instructions of mnemonics available for architecture
+    std::vector<cxuint> insnIndices;
+    for (cxuint i = 0; i < gcnInstrSortedTable.size(); i++)
+        if ((gcnInstrSortedTable[i].archMask & archMask) != 0 &&
+            (insnIndices.empty() || ::strcmp(gcnInstrSortedTable[
+                    insnIndices.back()].mnemonic, gcnInstrSortedTable[i].mnemonic)!=0))
+            insnIndices.push_back(i);
+    const size_t keysNum = insnIndices.size();
+    if (keysNum == 0)
+        return;
+    
+    const size_t bucketsNum = (keysNum+3)>>2;
+    std::vector<uint64_t> hashes(keysNum);
+    std::vector<std::vector<cxuint> > buckets(bucketsNum);
+    for (cxuint k = 0; k < keysNum; k++)
+    {
+        const char* mnemonic = gcnInstrSortedTable[insnIndices[k]].mnemonic;
+        hashes[k] = hashMnemonic(mnemonic, ::strlen(mnemonic));
+        buckets[(hashes[k]>>32) % bucketsNum].push_back(k);
+    }
+    // place biggest buckets first
+    std::vector<cxuint> bucketOrder(bucketsNum);
+    for (cxuint b = 0; b < bucketsNum; b++)
+        bucketOrder[b] = b;
+    std::sort(bucketOrder.begin(), bucketOrder.end(), [&buckets](cxuint b1, cxuint b2)
+            { return buckets[b1].size() > buckets[b2].size() ||
+                (buckets[b1].size() == buckets[b2].size() && b1 < b2); });
+    
+    const size_t slotsNum = keysNum + (keysNum>>3) + 1;
+    displacements.resize(bucketsNum);
+    std::fill(displacements.begin(), displacements.end(), 0);
+    std::vector<cxuint> slotKeys(slotsNum, UINT_MAX);
+    std::vector<uint32_t> bucketSlots;
+    for (cxuint b: bucketOrder)
+    {
+        const std::vector<cxuint>& bucket = buckets[b];
+        if (bucket.empty())
+            break;
+        for (uint32_t displacement = 0; ; displacement++)
+        {
+            bucketSlots.clear();
+            bool fit = true;
+            for (cxuint k: bucket)
+            {
+                const uint32_t slot = slotHash(hashes[k], displacement) % slotsNum;
+                if (slotKeys[slot] != UINT_MAX ||
+                    std::find(bucketSlots.begin(), bucketSlots.end(), slot) !=
+                            bucketSlots.end())
+                {
+                    fit = false;
+                    break;
+                }
+                bucketSlots.push_back(slot);
+            }
+            if (!fit)
+                continue;
+            for (size_t i = 0; i < bucket.size(); i++)
+                slotKeys[bucketSlots[i]] = bucket[i];
+            displacements[b] = displacement;
+            break;
+        }
+    }
+    // empty slots points to first key (mnemonic will be compared anyway)
+    slots.resize(slotsNum);
+    for (size_t i = 0; i < slotsNum; i++)
+        slots[i] = insnIndices[slotKeys[i] != UINT_MAX ? slotKeys[i] : 0];
+}
+
+static GCNInstrHashTable gcnInstrHashTables[cxuint(GPUArchitecture::GPUARCH_MAX)+1];
+
 static void initializeGCNAssembler()
 {
     size_t tableSize = 0;
@@ -112,6 +230,9 @@ static void initializeGCNAssembler()
         std::cout << "{ " << instr.mnemonic << ", " << cxuint(instr.encoding) <<
                 std::hex << ", 0x" << instr.mode << ", 0x" << instr.code1 << ", 0x" <<
                 instr.code2 << std::dec << ", " << instr.archMask << " }" << std::endl;*/
+    
+    for (cxuint arch = 0; arch <= cxuint(GPUArchitecture::GPUARCH_MAX); arch++)
+        gcnInstrHashTables[arch].build(1U<<arch);
 }
 
 GCNAssembler::GCNAssembler(Assembler& assembler): ISAAssembler(assembler),
@@ -322,13 +443,15 @@ void GCNAsmUtils::parseSOPKEncoding(Assembler& asmr, const GCNAsmInstruction& gc
     
     uint16_t imm16 = 0;
     std::unique_ptr<AsmExpression> imm16Expr;
+    AsmFixup jumpFixup;
+    jumpFixup.symbol = nullptr;
     
     if ((gcnInsn.mode&GCN_MASK1) == GCN_IMM_REL)
     {
         uint64_t value = 0;
-        if (!getJumpValueArg(asmr, value, imm16Expr, linePtr))
+        if (!getJumpValueArg(asmr, value, imm16Expr, jumpFixup, linePtr))
             return;
-        if (imm16Expr==nullptr)
+        if (imm16Expr==nullptr && jumpFixup.symbol==nullptr)
         {
             int64_t offset = (int64_t(value)-int64_t(output.size())-4);
             if (offset & 3)
@@ -435,6 +558,8 @@ void GCNAsmUtils::parseSOPKEncoding(Assembler& asmr, const GCNAsmInstruction& gc
     if (imm16Expr!=nullptr)
         imm16Expr->setTarget(AsmExprTarget(((gcnInsn.mode&GCN_MASK1) == GCN_IMM_REL) ?
                 GCNTGT_SOPJMP : GCNTGT_SOPKSIMM16, asmr.currentSection, output.size()));
+    if (jumpFixup.symbol!=nullptr)
+        asmr.addFixup(jumpFixup, GCNTGT_SOPJMP, asmr.currentSection, output.size());
     
     output.insert(output.end(), reinterpret_cast<cxbyte*>(words), 
             reinterpret_cast<cxbyte*>(words + wordsNum));
@@ -543,14 +668,16 @@ void GCNAsmUtils::parseSOPPEncoding(Assembler& asmr, const GCNAsmInstruction& gc
     
     uint16_t imm16 = 0;
     std::unique_ptr<AsmExpression> imm16Expr;
+    AsmFixup jumpFixup;
+    jumpFixup.symbol = nullptr;
     switch (gcnInsn.mode&GCN_MASK1)
     {
         case GCN_IMM_REL:
         {
             uint64_t value = 0;
-            if (!getJumpValueArg(asmr, value, imm16Expr, linePtr))
+            if (!getJumpValueArg(asmr, value, imm16Expr, jumpFixup, linePtr))
                 return;
-            if (imm16Expr==nullptr)
+            if (imm16Expr==nullptr && jumpFixup.symbol==nullptr)
             {
                 int64_t offset = (int64_t(value)-int64_t(output.size())-4);
                 if (offset & 3)
@@ -759,6 +886,8 @@ void GCNAsmUtils::parseSOPPEncoding(Assembler& asmr, const GCNAsmInstruction& gc
     if (imm16Expr!=nullptr)
         imm16Expr->setTarget(AsmExprTarget(((gcnInsn.mode&GCN_MASK1) == GCN_IMM_REL) ?
                 GCNTGT_SOPJMP : GCNTGT_SOPKSIMM16, asmr.currentSection, output.size()));
+    if (jumpFixup.symbol!=nullptr)
+        asmr.addFixup(jumpFixup, GCNTGT_SOPJMP, asmr.currentSection, output.size());
     
     output.insert(output.end(), reinterpret_cast<cxbyte*>(&word), 
             reinterpret_cast<cxbyte*>(&word)+4);
@@ -2725,48 +2854,37 @@ void GCNAsmUtils::parseFLATEncoding(Assembler& asmr, const GCNAsmInstruction& gc
 void GCNAssembler::assemble(const CString& inMnemonic, const char* mnemPlace,
             const char* linePtr, const char* lineEnd, std::vector<cxbyte>& output)
 {
-    CString mnemonic;
-    size_t inMnemLen = inMnemonic.size();
+    const char* mnemonic = inMnemonic.c_str();
+    size_t mnemLen = inMnemonic.size();
     GCNEncSize gcnEncSize = GCNEncSize::UNKNOWN;
     GCNVOPEnc vopEnc = GCNVOPEnc::NORMAL;
-    if (inMnemLen>4 && ::strcasecmp(inMnemonic.c_str()+inMnemLen-4, "_e64")==0)
+    if (mnemLen>4 && ::strcasecmp(mnemonic+mnemLen-4, "_e64")==0)
     {
         gcnEncSize = GCNEncSize::BIT64;
-        mnemonic = inMnemonic.substr(0, inMnemLen-4);
+        mnemLen -= 4;
     }
-    else if (inMnemLen>4 && ::strcasecmp(inMnemonic.c_str()+inMnemLen-4, "_e32")==0)
+    else if (mnemLen>4 && ::strcasecmp(mnemonic+mnemLen-4, "_e32")==0)
     {
         gcnEncSize = GCNEncSize::BIT32;
-        mnemonic = inMnemonic.substr(0, inMnemLen-4);
+        mnemLen -= 4;
     }
-    else if (inMnemLen>6 && toLower(inMnemonic[0])=='v' && inMnemonic[1]=='_' &&
-        ::strcasecmp(inMnemonic.c_str()+inMnemLen-4, "_dpp")==0)
+    else if (mnemLen>6 && toLower(mnemonic[0])=='v' && mnemonic[1]=='_' &&
+        ::strcasecmp(mnemonic+mnemLen-4, "_dpp")==0)
     {
         vopEnc = GCNVOPEnc::DPP;
-        mnemonic = inMnemonic.substr(0, inMnemLen-4);
+        mnemLen -= 4;
     }
-    else if (inMnemLen>7 && toLower(inMnemonic[0])=='v' && inMnemonic[1]=='_' &&
-        ::strcasecmp(inMnemonic.c_str()+inMnemLen-5, "_sdwa")==0)
+    else if (mnemLen>7 && toLower(mnemonic[0])=='v' && mnemonic[1]=='_' &&
+        ::strcasecmp(mnemonic+mnemLen-5, "_sdwa")==0)
     {
         vopEnc = GCNVOPEnc::SDWA;
-        mnemonic = inMnemonic.substr(0, inMnemLen-5);
+        mnemLen -= 5;
     }
-    else
-        mnemonic = inMnemonic;
     
-    auto it = binaryFind(gcnInstrSortedTable.begin(), gcnInstrSortedTable.end(),
-               GCNAsmInstruction{mnemonic.c_str()},
-               [](const GCNAsmInstruction& instr1, const GCNAsmInstruction& instr2)
-               { return ::strcmp(instr1.mnemonic, instr2.mnemonic)<0; });
-    
-    // find matched entry
-    if (it != gcnInstrSortedTable.end() && (it->archMask & curArchMask)==0)
-        // if not match current arch mask
-        for (++it ;it != gcnInstrSortedTable.end() &&
-               ::strcmp(it->mnemonic, mnemonic.c_str())==0 &&
-               (it->archMask & curArchMask)==0; ++it);
-
-    if (it == gcnInstrSortedTable.end() || ::strcmp(it->mnemonic, mnemonic.c_str())!=0)
+    // find entry matched to mnemonic and to current architecture
+    const GCNAsmInstruction* it = gcnInstrHashTables[CTZ32(curArchMask)].find(
+                mnemonic, mnemLen);
+    if (it == nullptr)
     {   // unrecognized mnemonic
         printError(mnemPlace, "Unknown instruction");
         return;
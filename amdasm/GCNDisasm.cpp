@@ -22,6 +22,8 @@
 #include <cstring>
 #include <mutex>
 #include <memory>
+#include <string>
+#include <sstream>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/utils/GPUId.h>
 #include <CLRX/amdasm/Disassembler.h>
@@ -218,7 +220,15 @@ static void initializeGCNDisassembler()
 }
 
 GCNDisassembler::GCNDisassembler(Disassembler& disassembler)
-        : ISADisassembler(disassembler), instrOutOfCode(false)
+        : ISADisassembler(disassembler), instrOutOfCode(false),
+          decodeChunkSize(256U<<10), indexInput(nullptr), indexInputSize(0)
+{
+    std::call_once(clrxGCNDisasmOnceFlag, initializeGCNDisassembler);
+}
+
+GCNDisassembler::GCNDisassembler(Disassembler& disassembler, std::ostream& output)
+        : ISADisassembler(disassembler, output), instrOutOfCode(false),
+          decodeChunkSize(256U<<10), indexInput(nullptr), indexInputSize(0)
 {
     std::call_once(clrxGCNDisasmOnceFlag, initializeGCNDisassembler);
 }
@@ -266,107 +276,6 @@ static const bool gcnSize12Table[16] =
     false // GCNENC_NONE   // 1111 - illegal
 };
 
-void GCNDisassembler::analyzeBeforeDisassemble()
-{
-    const uint32_t* codeWords = reinterpret_cast<const uint32_t*>(input);
-    const size_t codeWordsNum = (inputSize>>2);
-
-    const GPUArchitecture arch = getGPUArchitectureFromDeviceType(
-                disassembler.getDeviceType());
-    const bool isGCN11 = (arch == GPUArchitecture::GCN1_1);
-    const bool isGCN12 = (arch == GPUArchitecture::GCN1_2);
-    size_t pos;
-    for (pos = 0; pos < codeWordsNum; pos++)
-    {   /* scan all instructions and get jump addresses */
-        const uint32_t insnCode = ULEV(codeWords[pos]);
-        if ((insnCode & 0x80000000U) != 0)
-        {   
-            if ((insnCode & 0x40000000U) == 0)
-            {   // SOP???
-                if  ((insnCode & 0x30000000U) == 0x30000000U)
-                {   // SOP1/SOPK/SOPC/SOPP
-                    const uint32_t encPart = (insnCode & 0x0f800000U);
-                    if (encPart == 0x0e800000U)
-                    {   // SOP1
-                        if ((insnCode&0xff) == 0xff) // literal
-                            pos++;
-                    }
-                    else if (encPart == 0x0f000000U)
-                    {   // SOPC
-                        if ((insnCode&0xff) == 0xff ||
-                            (insnCode&0xff00) == 0xff00) // literal
-                            pos++;
-                    }
-                    else if (encPart == 0x0f800000U)
-                    {   // SOPP
-                        const cxuint opcode = (insnCode>>16)&0x7f;
-                        if (opcode == 2 || (opcode >= 4 && opcode <= 9) ||
-                            // GCN1.1 and GCN1.2 opcodes
-                            ((isGCN11 || isGCN12) &&
-                                    (opcode >= 23 && opcode <= 26))) // if jump
-                            labels.push_back(startOffset +
-                                    ((pos+int16_t(insnCode&0xffff)+1)<<2));
-                    }
-                    else
-                    {   // SOPK
-                        const cxuint opcode = (insnCode>>23)&0x1f;
-                        if ((!isGCN12 && opcode == 17) ||
-                            (isGCN12 && opcode == 16)) // if branch fork
-                            labels.push_back(startOffset +
-                                    ((pos+int16_t(insnCode&0xffff)+1)<<2));
-                        else if ((!isGCN12 && opcode == 21) ||
-                            (isGCN12 && opcode == 20))
-                            pos++; // additional literal
-                    }
-                }
-                else
-                {   // SOP2
-                    if ((insnCode&0xff) == 0xff || (insnCode&0xff00) == 0xff00)
-                        pos++;  // literal
-                }
-            }
-            else
-            {   // SMRD and others
-                const uint32_t encPart = (insnCode&0x3c000000U)>>26;
-                if ((!isGCN12 && gcnSize11Table[encPart] && (encPart != 7 || isGCN11)) ||
-                    (isGCN12 && gcnSize12Table[encPart]))
-                    pos++;
-            }
-        }
-        else
-        {   // some vector instructions
-            if ((insnCode & 0x7e000000U) == 0x7c000000U)
-            {   // VOPC
-                if ((insnCode&0x1ff) == 0xff || // literal
-                    // SDWA, DDP
-                    (isGCN12 && ((insnCode&0x1ff) == 0xf9 || (insnCode&0x1ff) == 0xfa)))
-                    pos++;
-            }
-            else if ((insnCode & 0x7e000000U) == 0x7e000000U)
-            {   // VOP1
-                if ((insnCode&0x1ff) == 0xff || // literal
-                    // SDWA, DDP
-                    (isGCN12 && ((insnCode&0x1ff) == 0xf9 || (insnCode&0x1ff) == 0xfa)))
-                    pos++;
-            }
-            else
-            {   // VOP2
-                const cxuint opcode = (insnCode >> 25)&0x3f;
-                if ((!isGCN12 && (opcode == 32 || opcode == 33)) ||
-                    (isGCN12 && (opcode == 23 || opcode == 24 ||
-                    opcode == 36 || opcode == 37))) // V_MADMK and V_MADAK
-                    pos++;  // inline 32-bit constant
-                else if ((insnCode&0x1ff) == 0xff || // literal
-                    // SDWA, DDP
-                    (isGCN12 && ((insnCode&0x1ff) == 0xf9 || (insnCode&0x1ff) == 0xfa)))
-                    pos++;  // literal
-            }
-        }
-    }
-    
-    instrOutOfCode = (pos != codeWordsNum);
-}
-
 static const cxbyte gcnEncoding11Table[16] =
 {
     GCNENC_SMRD, // 0000
@@ -460,6 +369,167 @@ static const GCNEncodingOpcodeBits gcnEncodingOpcode12Table[GCNENC_MAXVAL+1] =
     { 18, 8 } /* GCNENC_FLAT, opcode = (8bit)<<18 (???8bit) */
 };
 
+void GCNDisassembler::buildInstrIndex()
+{
+    const uint32_t* codeWords = reinterpret_cast<const uint32_t*>(input);
+    const size_t codeWordsNum = (inputSize>>2);
+
+    const GPUArchitecture arch = getGPUArchitectureFromDeviceType(
+                disassembler.getDeviceType());
+    const bool isGCN11 = (arch == GPUArchitecture::GCN1_1);
+    const bool isGCN12 = (arch == GPUArchitecture::GCN1_2);
+    const GCNEncodingOpcodeBits* encodingOpcodeTable = 
+            (isGCN12) ? gcnEncodingOpcode12Table : gcnEncodingOpcodeTable;
+    
+    if (inputSize > size_t(INT32_MAX))
+        throw Exception("Code is too big for instruction index");
+    instrIndex.clear();
+    instrIndex.startOffset = startOffset;
+    size_t pos;
+    for (pos = 0; pos < codeWordsNum;)
+    {   /* scan all instructions and get encodings, sizes and jump addresses */
+        const uint32_t insnCode = ULEV(codeWords[pos]);
+        cxbyte gcnEncoding = GCNENC_NONE;
+        bool twoWords = false;
+        cxbyte flags = 0;
+        uint32_t branchTarget = UINT32_MAX;
+        if ((insnCode & 0x80000000U) != 0)
+        {   
+            if ((insnCode & 0x40000000U) == 0)
+            {   // SOP???
+                if  ((insnCode & 0x30000000U) == 0x30000000U)
+                {   // SOP1/SOPK/SOPC/SOPP
+                    const uint32_t encPart = (insnCode & 0x0f800000U);
+                    if (encPart == 0x0e800000U)
+                    {   // SOP1
+                        if ((insnCode&0xff) == 0xff) // literal
+                            flags |= GCNINSTR_LITERAL;
+                        gcnEncoding = GCNENC_SOP1;
+                    }
+                    else if (encPart == 0x0f000000U)
+                    {   // SOPC
+                        if ((insnCode&0xff) == 0xff ||
+                            (insnCode&0xff00) == 0xff00) // literal
+                            flags |= GCNINSTR_LITERAL;
+                        gcnEncoding = GCNENC_SOPC;
+                    }
+                    else if (encPart == 0x0f800000U)
+                    {   // SOPP
+                        const cxuint opcode = (insnCode>>16)&0x7f;
+                        if (opcode == 2 || (opcode >= 4 && opcode <= 9) ||
+                            // GCN1.1 and GCN1.2 opcodes
+                            ((isGCN11 || isGCN12) &&
+                                    (opcode >= 23 && opcode <= 26))) // if jump
+                        {
+                            flags |= GCNINSTR_BRANCH;
+                            branchTarget = uint32_t(
+                                    (pos+int16_t(insnCode&0xffff)+1)<<2);
+                        }
+                        gcnEncoding = GCNENC_SOPP;
+                    }
+                    else
+                    {   // SOPK
+                        const cxuint opcode = (insnCode>>23)&0x1f;
+                        if ((!isGCN12 && opcode == 17) ||
+                            (isGCN12 && opcode == 16)) // if branch fork
+                        {
+                            flags |= GCNINSTR_BRANCH;
+                            branchTarget = uint32_t(
+                                    (pos+int16_t(insnCode&0xffff)+1)<<2);
+                        }
+                        else if ((!isGCN12 && opcode == 21) ||
+                            (isGCN12 && opcode == 20))
+                            flags |= GCNINSTR_LITERAL; // additional literal
+                        gcnEncoding = GCNENC_SOPK;
+                    }
+                }
+                else
+                {   // SOP2
+                    if ((insnCode&0xff) == 0xff || (insnCode&0xff00) == 0xff00)
+                        flags |= GCNINSTR_LITERAL;  // literal
+                    gcnEncoding = GCNENC_SOP2;
+                }
+            }
+            else
+            {   // SMRD and others
+                const uint32_t encPart = (insnCode&0x3c000000U)>>26;
+                if ((!isGCN12 && gcnSize11Table[encPart] && (encPart != 7 || isGCN11)) ||
+                    (isGCN12 && gcnSize12Table[encPart]))
+                    twoWords = true;
+                if (isGCN12)
+                    gcnEncoding = gcnEncoding12Table[encPart];
+                else
+                    gcnEncoding = gcnEncoding11Table[encPart];
+                if (gcnEncoding == GCNENC_FLAT && !isGCN11 && !isGCN12)
+                    gcnEncoding = GCNENC_NONE; // illegal if not GCN1.1
+            }
+        }
+        else
+        {   // some vector instructions
+            if ((insnCode & 0x7e000000U) == 0x7c000000U)
+            {   // VOPC
+                if ((insnCode&0x1ff) == 0xff) // literal
+                    flags |= GCNINSTR_LITERAL;
+                else if (isGCN12 && ((insnCode&0x1ff) == 0xf9 ||
+                            (insnCode&0x1ff) == 0xfa)) // SDWA, DDP
+                    twoWords = true;
+                gcnEncoding = GCNENC_VOPC;
+            }
+            else if ((insnCode & 0x7e000000U) == 0x7e000000U)
+            {   // VOP1
+                if ((insnCode&0x1ff) == 0xff) // literal
+                    flags |= GCNINSTR_LITERAL;
+                else if (isGCN12 && ((insnCode&0x1ff) == 0xf9 ||
+                            (insnCode&0x1ff) == 0xfa)) // SDWA, DDP
+                    twoWords = true;
+                gcnEncoding = GCNENC_VOP1;
+            }
+            else
+            {   // VOP2
+                const cxuint opcode = (insnCode >> 25)&0x3f;
+                if ((!isGCN12 && (opcode == 32 || opcode == 33)) ||
+                    (isGCN12 && (opcode == 23 || opcode == 24 ||
+                    opcode == 36 || opcode == 37))) // V_MADMK and V_MADAK
+                    flags |= GCNINSTR_LITERAL;  // inline 32-bit constant
+                else if ((insnCode&0x1ff) == 0xff) // literal
+                    flags |= GCNINSTR_LITERAL;
+                else if (isGCN12 && ((insnCode&0x1ff) == 0xf9 ||
+                            (insnCode&0x1ff) == 0xfa)) // SDWA, DDP
+                    twoWords = true;
+                gcnEncoding = GCNENC_VOP2;
+            }
+        }
+        if ((flags & GCNINSTR_LITERAL) != 0)
+            twoWords = true;
+        
+        instrIndex.offsets.push_back(pos<<2);
+        instrIndex.encodings.push_back(gcnEncoding);
+        instrIndex.opcodes.push_back(
+                (insnCode>>encodingOpcodeTable[gcnEncoding].bitPos) & 
+                ((1U<<encodingOpcodeTable[gcnEncoding].bits)-1U));
+        instrIndex.sizes.push_back(twoWords ? 8 : 4);
+        instrIndex.flags.push_back(flags);
+        instrIndex.branchTargets.push_back(branchTarget);
+        pos += twoWords ? 2 : 1;
+    }
+    
+    indexInput = input;
+    indexInputSize = inputSize;
+}
+
+void GCNDisassembler::analyzeBeforeDisassemble()
+{
+    buildInstrIndex();
+    // get jump addresses
+    for (size_t i = 0; i < instrIndex.size(); i++)
+        if ((instrIndex.flags[i] & GCNINSTR_BRANCH) != 0)
+            labels.push_back(instrIndex.getBranchTarget(i));
+    
+    const size_t n = instrIndex.size();
+    instrOutOfCode = (n != 0 && instrIndex.offsets[n-1] + instrIndex.sizes[n-1] >
+                ((inputSize>>2)<<2));
+}
+
 static inline void putChars(char*& buf, const char* input, size_t size)
 {
     ::memcpy(buf, input, size);
@@ -770,29 +840,51 @@ static size_t addSpacesOld(char* bufPtr, cxuint spacesToAdd)
     return spacesToAdd;
 }
 
+/* fields of instructions are extracted by these routines. both disassembler text output
+ * and instruction records (decodeInstr) are built from the same fields */
+
+/* fields of SOPC/SOPP/SOP1/SOP2/SOPK instruction */
+struct CLRX_INTERNAL GCNSOPFields
+{
+    cxuint sdst;    // destination (SOP1, SOP2, SOPK)
+    cxuint ssrc0;
+    cxuint ssrc1;
+    cxuint imm16;   // immediate (SOPP, SOPK)
+    cxuint dregsNum;
+    cxuint s0regsNum;
+    cxuint s1regsNum;
+};
+
+static inline GCNSOPFields getGCNSOPFields(uint16_t mode, uint32_t insnCode)
+{
+    return { (insnCode>>16)&0x7f, insnCode&0xff, (insnCode>>8)&0xff, insnCode&0xffff,
+        cxuint((mode&GCN_REG_DST_64)?2:1), cxuint((mode&GCN_REG_SRC0_64)?2:1),
+        cxuint((mode&GCN_REG_SRC1_64)?2:1) };
+}
+
 void GCNDisasmUtils::decodeSOPCEncoding(GCNDisassembler& dasm, size_t codePos,
          RelocIter& relocIter, cxuint spacesToAdd, uint16_t arch,
          const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t literal)
 {
     FastOutputBuffer& output = dasm.output;
+    const GCNSOPFields f = getGCNSOPFields(gcnInsn.mode, insnCode);
     char* bufStart = output.reserve(80);
     char* bufPtr = bufStart;
     addSpaces(bufPtr, spacesToAdd);
     output.forward(bufPtr-bufStart);
-    bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, insnCode&0xff,
-                     (gcnInsn.mode&GCN_REG_SRC0_64)?2:1, arch, literal);
+    bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, f.ssrc0,
+                     f.s0regsNum, arch, literal);
     *bufPtr++ = ',';
     *bufPtr++ = ' ';
     if ((gcnInsn.mode & GCN_SRC1_IMM) != 0)
     {
-        putHexByteToBuf((insnCode>>8)&0xff, bufPtr);
+        putHexByteToBuf(f.ssrc1, bufPtr);
         output.forward(bufPtr-bufStart);
     }
     else
     {
         output.forward(bufPtr-bufStart);
-        decodeGCNOperand(dasm, codePos, relocIter, (insnCode>>8)&0xff,
-               (gcnInsn.mode&GCN_REG_SRC1_64)?2:1, arch, literal);
+        decodeGCNOperand(dasm, codePos, relocIter, f.ssrc1, f.s1regsNum, arch, literal);
     }
 }
 
@@ -804,7 +896,7 @@ void GCNDisasmUtils::decodeSOPPEncoding(GCNDisassembler& dasm, cxuint spacesToAd
     FastOutputBuffer& output = dasm.output;
     char* bufStart = output.reserve(60);
     char* bufPtr = bufStart;
-    const cxuint imm16 = insnCode&0xffff;
+    const cxuint imm16 = getGCNSOPFields(gcnInsn.mode, insnCode).imm16;
     switch(gcnInsn.mode&GCN_MASK1)
     {
         case GCN_IMM_REL:
@@ -925,6 +1017,7 @@ void GCNDisasmUtils::decodeSOP1Encoding(GCNDisassembler& dasm, size_t codePos,
          const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t literal)
 {
     FastOutputBuffer& output = dasm.output;
+    const GCNSOPFields f = getGCNSOPFields(gcnInsn.mode, insnCode);
     char* bufStart = output.reserve(70);
     char* bufPtr = bufStart;
     addSpaces(bufPtr, spacesToAdd);
@@ -932,8 +1025,8 @@ void GCNDisasmUtils::decodeSOP1Encoding(GCNDisassembler& dasm, size_t codePos,
     if (isDst)
     {
         output.forward(bufPtr-bufStart);
-        bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, (insnCode>>16)&0x7f,
-                         (gcnInsn.mode&GCN_REG_DST_64)?2:1, arch);
+        bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, f.sdst,
+                         f.dregsNum, arch);
     }
     
     if ((gcnInsn.mode & GCN_MASK1) != GCN_SRC_NONE)
@@ -944,19 +1037,19 @@ void GCNDisasmUtils::decodeSOP1Encoding(GCNDisassembler& dasm, size_t codePos,
             *bufPtr++ = ' ';
         }
         output.forward(bufPtr-bufStart);
-        bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, insnCode&0xff,
-                         (gcnInsn.mode&GCN_REG_SRC0_64)?2:1, arch, literal);
+        bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, f.ssrc0,
+                         f.s0regsNum, arch, literal);
     }
-    else if ((insnCode&0xff) != 0)
+    else if (f.ssrc0 != 0)
     {   // print value, if some are not used, but values is not default
         putChars(bufPtr," ssrc=", 6);
-        bufPtr += itocstrCStyle((insnCode&0xff), bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.ssrc0, bufPtr, 6, 16);
     }
     // print value, if some are not used, but values is not default
-    if (!isDst && ((insnCode>>16)&0x7f) != 0)
+    if (!isDst && f.sdst != 0)
     {
         putChars(bufPtr, " sdst=", 6);
-        bufPtr += itocstrCStyle(((insnCode>>16)&0x7f), bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.sdst, bufPtr, 6, 16);
     }
     output.forward(bufPtr-bufStart);
 }
@@ -966,31 +1059,32 @@ void GCNDisasmUtils::decodeSOP2Encoding(GCNDisassembler& dasm, size_t codePos,
          const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t literal)
 {
     FastOutputBuffer& output = dasm.output;
+    const GCNSOPFields f = getGCNSOPFields(gcnInsn.mode, insnCode);
     char* bufStart = output.reserve(80);
     char* bufPtr = bufStart;
     addSpaces(bufPtr, spacesToAdd);
     if ((gcnInsn.mode & GCN_MASK1) != GCN_DST_NONE)
     {
         output.forward(bufPtr-bufStart);
-        bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, (insnCode>>16)&0x7f,
-                         (gcnInsn.mode&GCN_REG_DST_64)?2:1, arch);
+        bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, f.sdst,
+                         f.dregsNum, arch);
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
     }
     output.forward(bufPtr-bufStart);
-    bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, insnCode&0xff,
-                     (gcnInsn.mode&GCN_REG_SRC0_64)?2:1, arch, literal);
+    bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, f.ssrc0,
+                     f.s0regsNum, arch, literal);
     *bufPtr++ = ',';
     *bufPtr++ = ' ';
     output.forward(bufPtr-bufStart);
-    bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, (insnCode>>8)&0xff,
-                 (gcnInsn.mode&GCN_REG_SRC1_64)?2:1, arch, literal);
+    bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, f.ssrc1,
+                 f.s1regsNum, arch, literal);
     
     // print value, if some are not used, but values is not default
-    if ((gcnInsn.mode & GCN_MASK1) == GCN_DST_NONE && ((insnCode>>16)&0x7f) != 0)
+    if ((gcnInsn.mode & GCN_MASK1) == GCN_DST_NONE && f.sdst != 0)
     {
         putChars(bufPtr, " sdst=", 6);
-        bufPtr += itocstrCStyle(((insnCode>>16)&0x7f), bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.sdst, bufPtr, 6, 16);
     }
     output.forward(bufPtr-bufStart);
 }
@@ -1009,18 +1103,19 @@ void GCNDisasmUtils::decodeSOPKEncoding(GCNDisassembler& dasm, size_t codePos,
          const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t literal)
 {
     FastOutputBuffer& output = dasm.output;
+    const GCNSOPFields f = getGCNSOPFields(gcnInsn.mode, insnCode);
     char* bufStart = output.reserve(80);
     char* bufPtr = bufStart;
     addSpaces(bufPtr, spacesToAdd);
     if ((gcnInsn.mode & GCN_IMM_DST) == 0)
     {
         output.forward(bufPtr-bufStart);
-        bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, (insnCode>>16)&0x7f,
-                         (gcnInsn.mode&GCN_REG_DST_64)?2:1, arch);
+        bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter, f.sdst,
+                         f.dregsNum, arch);
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
     }
-    const cxuint imm16 = insnCode&0xffff;
+    const cxuint imm16 = f.imm16;
     if ((gcnInsn.mode&GCN_MASK1) == GCN_IMM_REL)
     {
         const size_t branchPos = dasm.startOffset + ((codePos + int16_t(imm16))<<2);
@@ -1059,22 +1154,62 @@ void GCNDisasmUtils::decodeSOPKEncoding(GCNDisassembler& dasm, size_t codePos,
         if (gcnInsn.mode & GCN_SOPK_CONST)
         {
             bufPtr += itocstrCStyle(literal, bufPtr, 11, 16);
-            if (((insnCode>>16)&0x7f) != 0)
+            if (f.sdst != 0)
             {
                 putChars(bufPtr, " sdst=", 6);
-                bufPtr += itocstrCStyle((insnCode>>16)&0x7f, bufPtr, 6, 16);
+                bufPtr += itocstrCStyle(f.sdst, bufPtr, 6, 16);
             }
         }
         else
         {
             output.forward(bufPtr-bufStart);
             bufPtr = bufStart = decodeGCNOperand(dasm, codePos, relocIter,
-                     (insnCode>>16)&0x7f, (gcnInsn.mode&GCN_REG_DST_64)?2:1, arch);
+                     f.sdst, f.dregsNum, arch);
         }
     }
     output.forward(bufPtr-bufStart);
 }
 
+/* fields of SMRD (GCN 1.0/1.1) and SMEM (GCN 1.2) instruction */
+struct CLRX_INTERNAL GCNSMEMFields
+{
+    cxuint sdst;    // sdst or sdata
+    cxuint sbase;   // first register of sbase
+    cxuint offset;  // immediate offset or soffset register
+    bool immOffset;
+    uint32_t flags; // GCNREC_GLC
+    cxuint dregsNum;
+    cxuint sbaseRegsNum;
+};
+
+static inline GCNSMEMFields getGCNSMEMFields(bool isGCN12, uint16_t mode,
+            uint32_t insnCode, uint32_t insnCode2)
+{
+    GCNSMEMFields f;
+    if (!isGCN12)
+    {
+        f.sdst = (insnCode>>15)&0x7f;
+        f.sbase = (insnCode>>8)&0x7e;
+        f.immOffset = (insnCode&0x100) != 0;
+        f.offset = insnCode&0xff;
+        f.flags = 0;
+    }
+    else
+    {
+        f.sdst = (insnCode>>6)&0x7f;
+        f.sbase = (insnCode<<1)&0x7e;
+        f.immOffset = (insnCode&0x20000) != 0;
+        f.offset = f.immOffset ? insnCode2&0xfffff : insnCode2&0xff;
+        f.flags = (insnCode&0x10000) ? GCNREC_GLC : 0;
+    }
+    if ((mode & GCN_MASK1) == GCN_SMRD_ONLYDST)
+        f.dregsNum = (mode&GCN_REG_DST_64)?2:1;
+    else
+        f.dregsNum = 1<<((mode & GCN_DSIZE_MASK)>>GCN_SHIFT2);
+    f.sbaseRegsNum = (mode&GCN_SBASE4)?4:2;
+    return f;
+}
+
 void GCNDisasmUtils::decodeSMRDEncoding(GCNDisassembler& dasm, cxuint spacesToAdd,
              uint16_t arch, const GCNInstruction& gcnInsn, uint32_t insnCode)
 {
@@ -1082,6 +1217,7 @@ void GCNDisasmUtils::decodeSMRDEncoding(GCNDisassembler& dasm, cxuint spacesToAd
     char* bufStart = output.reserve(100);
     char* bufPtr = bufStart;
     const uint16_t mode1 = (gcnInsn.mode & GCN_MASK1);
+    const GCNSMEMFields f = getGCNSMEMFields(false, gcnInsn.mode, insnCode, 0);
     bool useDst = false;
     bool useOthers = false;
     
@@ -1089,26 +1225,23 @@ void GCNDisasmUtils::decodeSMRDEncoding(GCNDisassembler& dasm, cxuint spacesToAd
     if (mode1 == GCN_SMRD_ONLYDST)
     {
         addSpaces(bufPtr, spacesToAdd);
-        decodeGCNOperandNoLit(dasm, (insnCode>>15)&0x7f, (gcnInsn.mode&GCN_REG_DST_64)?2:1,
-                         bufPtr, arch);
+        decodeGCNOperandNoLit(dasm, f.sdst, f.dregsNum, bufPtr, arch);
         useDst = true;
         spacesAdded = true;
     }
     else if (mode1 != GCN_ARG_NONE)
     {
-        const cxuint dregsNum = 1<<((gcnInsn.mode & GCN_DSIZE_MASK)>>GCN_SHIFT2);
         addSpaces(bufPtr, spacesToAdd);
-        decodeGCNOperandNoLit(dasm, (insnCode>>15)&0x7f, dregsNum, bufPtr, arch);
+        decodeGCNOperandNoLit(dasm, f.sdst, f.dregsNum, bufPtr, arch);
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
-        decodeGCNOperandNoLit(dasm, (insnCode>>8)&0x7e, (gcnInsn.mode&GCN_SBASE4)?4:2,
-                          bufPtr, arch);
+        decodeGCNOperandNoLit(dasm, f.sbase, f.sbaseRegsNum, bufPtr, arch);
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
-        if (insnCode&0x100) // immediate value
-            bufPtr += itocstrCStyle(insnCode&0xff, bufPtr, 11, 16);
+        if (f.immOffset) // immediate value
+            bufPtr += itocstrCStyle(f.offset, bufPtr, 11, 16);
         else // S register
-            decodeGCNOperandNoLit(dasm, insnCode&0xff, 1, bufPtr, arch);
+            decodeGCNOperandNoLit(dasm, f.offset, 1, bufPtr, arch);
         useDst = true;
         useOthers = true;
         spacesAdded = true;
@@ -1156,41 +1289,39 @@ void GCNDisasmUtils::decodeSMEMEncoding(GCNDisassembler& dasm, cxuint spacesToAd
     char* bufStart = output.reserve(100);
     char* bufPtr = bufStart;
     const uint16_t mode1 = (gcnInsn.mode & GCN_MASK1);
+    const GCNSMEMFields f = getGCNSMEMFields(true, gcnInsn.mode, insnCode, insnCode2);
     bool useDst = false;
     bool useOthers = false;
     bool spacesAdded = false;
     if (mode1 == GCN_SMRD_ONLYDST)
     {
         addSpaces(bufPtr, spacesToAdd);
-        decodeGCNOperandNoLit(dasm, (insnCode>>6)&0x7f, (gcnInsn.mode&GCN_REG_DST_64)?2:1,
-                         bufPtr, arch);
+        decodeGCNOperandNoLit(dasm, f.sdst, f.dregsNum, bufPtr, arch);
         useDst = true;
         spacesAdded = true;
     }
     else if (mode1 != GCN_ARG_NONE)
     {
-        const cxuint dregsNum = 1<<((gcnInsn.mode & GCN_DSIZE_MASK)>>GCN_SHIFT2);
         addSpaces(bufPtr, spacesToAdd);
         if (mode1 & GCN_SMEM_SDATA_IMM)
-            putHexByteToBuf((insnCode>>6)&0x7f, bufPtr);
+            putHexByteToBuf(f.sdst, bufPtr);
         else
-            decodeGCNOperandNoLit(dasm, (insnCode>>6)&0x7f, dregsNum, bufPtr , arch);
+            decodeGCNOperandNoLit(dasm, f.sdst, f.dregsNum, bufPtr , arch);
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
-        decodeGCNOperandNoLit(dasm, (insnCode<<1)&0x7e, (gcnInsn.mode&GCN_SBASE4)?4:2,
-                          bufPtr, arch);
+        decodeGCNOperandNoLit(dasm, f.sbase, f.sbaseRegsNum, bufPtr, arch);
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
-        if (insnCode&0x20000) // immediate value
-            bufPtr += itocstrCStyle(insnCode2&0xfffff, bufPtr, 11, 16);
+        if (f.immOffset) // immediate value
+            bufPtr += itocstrCStyle(f.offset, bufPtr, 11, 16);
         else // S register
-            decodeGCNOperandNoLit(dasm, insnCode2&0xff, 1, bufPtr, arch);
+            decodeGCNOperandNoLit(dasm, f.offset, 1, bufPtr, arch);
         useDst = true;
         useOthers = true;
         spacesAdded = true;
     }
     
-    if ((insnCode & 0x10000) != 0)
+    if ((f.flags & GCNREC_GLC) != 0)
     {
         if (!spacesAdded)
             addSpaces(bufPtr, spacesToAdd-1);
@@ -1403,6 +1534,45 @@ static void decodeVOPDPP(FastOutputBuffer& output, uint32_t insnCode2,
     output.forward(bufPtr-bufStart);
 }
 
+/* fields of VOPC/VOP1/VOP2 instruction, src0 and modifiers can come from SDWA/DPP word */
+struct CLRX_INTERNAL GCNVOPFields
+{
+    VOPExtraWordOut extra;
+    uint32_t flags; // GCNREC_SDWA, GCNREC_DPP and GCNREC_CLAMP
+    cxuint vdst;
+    cxuint vsrc1;
+    cxuint dregsNum;
+    cxuint s0regsNum;
+    cxuint s1regsNum;
+};
+
+static inline GCNVOPFields getGCNVOPFields(bool isGCN12, uint16_t mode,
+            uint32_t insnCode, uint32_t literal)
+{
+    GCNVOPFields f;
+    const cxuint src0Field = (insnCode&0x1ff);
+    f.extra = { 0, 0, 0, 0, 0, 0, 0 };
+    f.flags = 0;
+    if (isGCN12 && src0Field == 0xf9)
+    {
+        f.extra = decodeVOPSDWAFlags(literal);
+        f.flags = GCNREC_SDWA | ((literal & 0x2000) ? GCNREC_CLAMP : 0);
+    }
+    else if (isGCN12 && src0Field == 0xfa)
+    {
+        f.extra = decodeVOPDPPFlags(literal);
+        f.flags = GCNREC_DPP;
+    }
+    else
+        f.extra.src0 = src0Field;
+    f.vdst = (insnCode>>17)&0xff;
+    f.vsrc1 = (insnCode>>9)&0xff;
+    f.dregsNum = (mode&GCN_REG_DST_64)?2:1;
+    f.s0regsNum = (mode&GCN_REG_SRC0_64)?2:1;
+    f.s1regsNum = (mode&GCN_REG_SRC1_64)?2:1;
+    return f;
+}
+
 void GCNDisasmUtils::decodeVOPCEncoding(GCNDisassembler& dasm, size_t codePos,
          RelocIter& relocIter, cxuint spacesToAdd, uint16_t arch,
          const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t literal,
@@ -1414,20 +1584,9 @@ void GCNDisasmUtils::decodeVOPCEncoding(GCNDisassembler& dasm, size_t codePos,
     char* bufPtr = bufStart;
     addSpaces(bufPtr, spacesToAdd);
     
-    const cxuint src0Field = (insnCode&0x1ff);
-    VOPExtraWordOut extraFlags = { 0, 0, 0, 0, 0, 0, 0 };
+    const GCNVOPFields f = getGCNVOPFields(isGCN12, gcnInsn.mode, insnCode, literal);
+    const VOPExtraWordOut& extraFlags = f.extra;
     putChars(bufPtr, "vcc, ", 5);
-    if (isGCN12)
-    {
-        if (src0Field == 0xf9)
-            extraFlags = decodeVOPSDWAFlags(literal);
-        else if (src0Field == 0xfa)
-            extraFlags = decodeVOPDPPFlags(literal);
-        else
-            extraFlags.src0 = src0Field;
-    }
-    else
-        extraFlags.src0 = src0Field;
     
     if (extraFlags.sextSrc0)
         putChars(bufPtr, "sext(", 5);
@@ -1438,7 +1597,7 @@ void GCNDisasmUtils::decodeVOPCEncoding(GCNDisassembler& dasm, size_t codePos,
     
     output.forward(bufPtr-bufStart);
     bufStart = bufPtr = decodeGCNOperand(dasm, codePos, relocIter, extraFlags.src0,
-                 (gcnInsn.mode&GCN_REG_SRC0_64)?2:1, arch, literal, displayFloatLits);
+                 f.s0regsNum, arch, literal, displayFloatLits);
     if (extraFlags.absSrc0)
         *bufPtr++ = ')';
     if (extraFlags.sextSrc0)
@@ -1454,20 +1613,17 @@ void GCNDisasmUtils::decodeVOPCEncoding(GCNDisassembler& dasm, size_t codePos,
     if (extraFlags.absSrc1)
         putChars(bufPtr, "abs(", 4);
     
-    decodeGCNVRegOperand(((insnCode>>9)&0xff), (gcnInsn.mode&GCN_REG_SRC1_64)?2:1, bufPtr);
+    decodeGCNVRegOperand(f.vsrc1, f.s1regsNum, bufPtr);
     if (extraFlags.absSrc1)
         *bufPtr++ = ')';
     if (extraFlags.sextSrc1)
         *bufPtr++ = ')';
     
     output.forward(bufPtr-bufStart);
-    if (isGCN12)
-    {
-        if (src0Field == 0xf9)
-            decodeVOPSDWA(output, literal, true, true);
-        else if (src0Field == 0xfa)
-            decodeVOPDPP(output, literal, true, true);
-    }
+    if ((f.flags & GCNREC_SDWA) != 0)
+        decodeVOPSDWA(output, literal, true, true);
+    else if ((f.flags & GCNREC_DPP) != 0)
+        decodeVOPDPP(output, literal, true, true);
 }
 
 void GCNDisasmUtils::decodeVOP1Encoding(GCNDisassembler& dasm, size_t codePos,
@@ -1480,31 +1636,17 @@ void GCNDisasmUtils::decodeVOP1Encoding(GCNDisassembler& dasm, size_t codePos,
     char* bufStart = output.reserve(110);
     char* bufPtr = bufStart;
     
-    const cxuint src0Field = (insnCode&0x1ff);
-    VOPExtraWordOut extraFlags = { 0, 0, 0, 0, 0, 0, 0 };
-    
-    if (isGCN12)
-    {
-        if (src0Field == 0xf9)
-            extraFlags = decodeVOPSDWAFlags(literal);
-        else if (src0Field == 0xfa)
-            extraFlags = decodeVOPDPPFlags(literal);
-        else
-            extraFlags.src0 = src0Field;
-    }
-    else
-        extraFlags.src0 = src0Field;
+    const GCNVOPFields f = getGCNVOPFields(isGCN12, gcnInsn.mode, insnCode, literal);
+    const VOPExtraWordOut& extraFlags = f.extra;
     
     bool argsUsed = true;
     if ((gcnInsn.mode & GCN_MASK1) != GCN_VOP_ARG_NONE)
     {
         addSpaces(bufPtr, spacesToAdd);
         if ((gcnInsn.mode & GCN_MASK1) != GCN_DST_SGPR)
-            decodeGCNVRegOperand(((insnCode>>17)&0xff),
-                     (gcnInsn.mode&GCN_REG_DST_64)?2:1, bufPtr);
+            decodeGCNVRegOperand(f.vdst, f.dregsNum, bufPtr);
         else
-            decodeGCNOperandNoLit(dasm, ((insnCode>>17)&0xff),
-                          (gcnInsn.mode&GCN_REG_DST_64)?2:1, bufPtr, arch);
+            decodeGCNOperandNoLit(dasm, f.vdst, f.dregsNum, bufPtr, arch);
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
         if (extraFlags.sextSrc0)
@@ -1516,7 +1658,7 @@ void GCNDisasmUtils::decodeVOP1Encoding(GCNDisassembler& dasm, size_t codePos,
             putChars(bufPtr, "abs(", 4);
         output.forward(bufPtr-bufStart);
         bufStart = bufPtr = decodeGCNOperand(dasm, codePos, relocIter, extraFlags.src0,
-                     (gcnInsn.mode&GCN_REG_SRC0_64)?2:1, arch, literal, displayFloatLits);
+                     f.s0regsNum, arch, literal, displayFloatLits);
         if (extraFlags.absSrc0)
             *bufPtr++ = ')';
         if (extraFlags.sextSrc0)
@@ -1540,13 +1682,10 @@ void GCNDisasmUtils::decodeVOP1Encoding(GCNDisassembler& dasm, size_t codePos,
         argsUsed = false;
     }
     output.forward(bufPtr-bufStart);
-    if (isGCN12)
-    {
-        if (src0Field == 0xf9)
-            decodeVOPSDWA(output, literal, argsUsed, false);
-        else if (src0Field == 0xfa)
-            decodeVOPDPP(output, literal, argsUsed, false);
-    }
+    if ((f.flags & GCNREC_SDWA) != 0)
+        decodeVOPSDWA(output, literal, argsUsed, false);
+    else if ((f.flags & GCNREC_DPP) != 0)
+        decodeVOPDPP(output, literal, argsUsed, false);
 }
 
 void GCNDisasmUtils::decodeVOP2Encoding(GCNDisassembler& dasm, size_t codePos,
@@ -1562,27 +1701,13 @@ void GCNDisasmUtils::decodeVOP2Encoding(GCNDisassembler& dasm, size_t codePos,
     addSpaces(bufPtr, spacesToAdd);
     const uint16_t mode1 = (gcnInsn.mode & GCN_MASK1);
     
-    const cxuint src0Field = (insnCode&0x1ff);
-    VOPExtraWordOut extraFlags = { 0, 0, 0, 0, 0, 0, 0 };
-    
-    if (isGCN12)
-    {
-        if (src0Field == 0xf9)
-            extraFlags = decodeVOPSDWAFlags(literal);
-        else if (src0Field == 0xfa)
-            extraFlags = decodeVOPDPPFlags(literal);
-        else
-            extraFlags.src0 = src0Field;
-    }
-    else
-        extraFlags.src0 = src0Field;
+    const GCNVOPFields f = getGCNVOPFields(isGCN12, gcnInsn.mode, insnCode, literal);
+    const VOPExtraWordOut& extraFlags = f.extra;
     
     if (mode1 != GCN_DS1_SGPR)
-        decodeGCNVRegOperand(((insnCode>>17)&0xff),
-                     (gcnInsn.mode&GCN_REG_DST_64)?2:1, bufPtr);
+        decodeGCNVRegOperand(f.vdst, f.dregsNum, bufPtr);
     else
-        decodeGCNOperandNoLit(dasm, ((insnCode>>17)&0xff),
-                 (gcnInsn.mode&GCN_REG_DST_64)?2:1, bufPtr, arch);
+        decodeGCNOperandNoLit(dasm, f.vdst, f.dregsNum, bufPtr, arch);
     if (mode1 == GCN_DS2_VCC || mode1 == GCN_DST_VCC)
         putChars(bufPtr, ", vcc", 5);
     *bufPtr++ = ',';
@@ -1595,7 +1720,7 @@ void GCNDisasmUtils::decodeVOP2Encoding(GCNDisassembler& dasm, size_t codePos,
         putChars(bufPtr, "abs(", 4);
     output.forward(bufPtr-bufStart);
     bufStart = bufPtr = decodeGCNOperand(dasm, codePos, relocIter, extraFlags.src0,
-                 (gcnInsn.mode&GCN_REG_SRC0_64)?2:1, arch, literal, displayFloatLits);
+                 f.s0regsNum, arch, literal, displayFloatLits);
     if (extraFlags.absSrc0)
         *bufPtr++ = ')';
     if (extraFlags.sextSrc0)
@@ -1621,11 +1746,10 @@ void GCNDisasmUtils::decodeVOP2Encoding(GCNDisassembler& dasm, size_t codePos,
     {
         output.forward(bufPtr-bufStart);
         bufStart = bufPtr = decodeGCNOperand(dasm, codePos, relocIter,
-                 ((insnCode>>9)&0xff), (gcnInsn.mode&GCN_REG_SRC1_64)?2:1, arch);
+                 f.vsrc1, f.s1regsNum, arch);
     }
     else
-        decodeGCNVRegOperand(((insnCode>>9)&0xff),
-                     (gcnInsn.mode&GCN_REG_SRC1_64)?2:1, bufPtr);
+        decodeGCNVRegOperand(f.vsrc1, f.s1regsNum, bufPtr);
     if (extraFlags.absSrc1)
         *bufPtr++ = ')';
     if (extraFlags.sextSrc1)
@@ -1644,13 +1768,10 @@ void GCNDisasmUtils::decodeVOP2Encoding(GCNDisassembler& dasm, size_t codePos,
     }
     else
         output.forward(bufPtr-bufStart);
-    if (isGCN12)
-    {
-        if (src0Field == 0xf9)
-            decodeVOPSDWA(output, literal, true, true);
-        else if (src0Field == 0xfa)
-            decodeVOPDPP(output, literal, true, true);
-    }
+    if ((f.flags & GCNREC_SDWA) != 0)
+        decodeVOPSDWA(output, literal, true, true);
+    else if ((f.flags & GCNREC_DPP) != 0)
+        decodeVOPDPP(output, literal, true, true);
 }
 
 static const char* vintrpParamsTbl[] =
@@ -1667,6 +1788,76 @@ static void decodeVINTRPParam(uint16_t p, char*& bufPtr)
         putChars(bufPtr, vintrpParamsTbl[p], ::strlen(vintrpParamsTbl[p]));
 }
 
+/* fields of VOP3A/VOP3B instruction (also VOP1/VOP2/VOPC/VINTRP encoded as VOP3) */
+struct CLRX_INTERNAL GCNVOP3Fields
+{
+    cxuint opcode;
+    cxuint vdst;
+    cxuint vsrc0;
+    cxuint vsrc1;
+    cxuint vsrc2;
+    cxuint sdst;    // second destination (VOP3B)
+    cxuint absFlags;    // abs modifiers for sources (VOP3A)
+    cxuint negFlags;    // neg modifiers for sources
+    cxuint omod;
+    bool clamp;
+    bool dstSGPR;   // destination is scalar register (compares, readlane)
+    bool useSdst;   // second destination is used (VOP3B)
+    bool useVsrc2;  // third source is used
+    bool vsrc2CC;   // third source is scalar register pair (carry)
+    cxuint dregsNum;
+    cxuint s0regsNum;
+    cxuint s1regsNum;
+    cxuint s2regsNum;
+};
+
+static GCNVOP3Fields getGCNVOP3Fields(bool isGCN12, const GCNInstruction& gcnInsn,
+            uint32_t insnCode, uint32_t insnCode2)
+{
+    GCNVOP3Fields f;
+    const uint16_t mode = gcnInsn.mode;
+    const uint16_t mode1 = (mode & GCN_MASK1);
+    const bool isVINTRP = (mode & GCN_VOP3_MASK2) == GCN_VOP3_VINTRP;
+    // for V_MQSAD_U32 SRC2 is 128-bit
+    const bool is128Ops = (mode&0xf000)==GCN_VOP3_DS2_128;
+    f.opcode = (isGCN12) ? ((insnCode>>16)&0x3ff) : ((insnCode>>17)&0x1ff);
+    f.vdst = insnCode&0xff;
+    f.vsrc0 = insnCode2&0x1ff;
+    f.vsrc1 = (insnCode2>>9)&0x1ff;
+    f.vsrc2 = (insnCode2>>18)&0x1ff;
+    f.sdst = (insnCode>>8)&0x7f;
+    f.absFlags = (gcnInsn.encoding == GCNENC_VOP3A) ? (insnCode>>8)&7 : 0;
+    f.negFlags = (insnCode2>>29)&7;
+    f.omod = (insnCode2>>27)&3;
+    f.clamp = (!isGCN12 && gcnInsn.encoding == GCNENC_VOP3A &&
+            (insnCode&0x800) != 0) || (isGCN12 && (insnCode&0x8000) != 0);
+    
+    f.dstSGPR = (f.opcode < 256 || (mode&GCN_VOP3_DST_SGPR)!=0);
+    f.useSdst = gcnInsn.encoding == GCNENC_VOP3B &&
+            (mode1 == GCN_DS2_VCC || mode1 == GCN_DST_VCC || mode1 == GCN_DST_VCC_VSRC2 ||
+             mode1 == GCN_S0EQS12);
+    if (mode1 == GCN_VOP_ARG_NONE)
+        f.useVsrc2 = false;
+    else if (isVINTRP)
+        f.useVsrc2 = (mode & GCN_VOP3_MASK3) == GCN_VINTRP_SRC2;
+    else /* GCN_DST_VCC - only sdst is used, no vsrc2 */
+        f.useVsrc2 = mode1 != GCN_SRC12_NONE && mode1 != GCN_SRC2_NONE &&
+                mode1 != GCN_DST_VCC && f.opcode >= 256;
+    f.vsrc2CC = !isVINTRP && (mode1 == GCN_DS2_VCC || mode1 == GCN_SRC2_VCC);
+    
+    if (f.dstSGPR)
+        f.dregsNum = ((mode&GCN_VOP3_DST_SGPR)==0)?2:1;
+    else
+        f.dregsNum = (is128Ops) ? 4 : ((mode&GCN_REG_DST_64)?2:1);
+    f.s0regsNum = (mode&GCN_REG_SRC0_64)?2:1;
+    f.s1regsNum = isVINTRP ? 1 : ((mode&GCN_REG_SRC1_64)?2:1);
+    if (f.vsrc2CC)
+        f.s2regsNum = 2;
+    else
+        f.s2regsNum = isVINTRP ? 1 : (is128Ops ? 4 : ((mode&GCN_REG_SRC2_64)?2:1));
+    return f;
+}
+
 void GCNDisasmUtils::decodeVOP3Encoding(GCNDisassembler& dasm, cxuint spacesToAdd,
          uint16_t arch, const GCNInstruction& gcnInsn, uint32_t insnCode,
          uint32_t insnCode2, FloatLitType displayFloatLits)
@@ -1675,13 +1866,7 @@ void GCNDisasmUtils::decodeVOP3Encoding(GCNDisassembler& dasm, cxuint spacesToAd
     char* bufStart = output.reserve(140);
     char* bufPtr = bufStart;
     const bool isGCN12 = ((arch&ARCH_RX3X0)!=0);
-    const cxuint opcode = (isGCN12) ? ((insnCode>>16)&0x3ff) : ((insnCode>>17)&0x1ff);
-    
-    const cxuint vdst = insnCode&0xff;
-    const cxuint vsrc0 = insnCode2&0x1ff;
-    const cxuint vsrc1 = (insnCode2>>9)&0x1ff;
-    const cxuint vsrc2 = (insnCode2>>18)&0x1ff;
-    const cxuint sdst = (insnCode>>8)&0x7f;
+    const GCNVOP3Fields f = getGCNVOP3Fields(isGCN12, gcnInsn, insnCode, insnCode2);
     const uint16_t mode1 = (gcnInsn.mode & GCN_MASK1);
     const uint16_t vop3Mode = (gcnInsn.mode&GCN_VOP3_MASK2);
     
@@ -1689,82 +1874,72 @@ void GCNDisasmUtils::decodeVOP3Encoding(GCNDisassembler& dasm, cxuint spacesToAd
     bool vsrc0Used = false;
     bool vsrc1Used = false;
     bool vsrc2Used = false;
-    bool vsrc2CC = false;
-    cxuint absFlags = 0;
-    
-    if (gcnInsn.encoding == GCNENC_VOP3A)
-        absFlags = (insnCode>>8)&7;
-    
-    const bool is128Ops = (gcnInsn.mode&0xf000)==GCN_VOP3_DS2_128;
     
     if (mode1 != GCN_VOP_ARG_NONE)
     {
         addSpaces(bufPtr, spacesToAdd);
         
-        if (opcode < 256 || (gcnInsn.mode&GCN_VOP3_DST_SGPR)!=0) /* if compares */
-            decodeGCNOperandNoLit(dasm, vdst, ((gcnInsn.mode&GCN_VOP3_DST_SGPR)==0)?2:1,
-                              bufPtr, arch);
+        if (f.dstSGPR) /* if compares */
+            decodeGCNOperandNoLit(dasm, f.vdst, f.dregsNum, bufPtr, arch);
         else /* regular instruction */
-            // for V_MQSAD_U32 SRC2 is 128-bit
-            decodeGCNVRegOperand(vdst, (is128Ops) ? 4 : 
-                                 ((gcnInsn.mode&GCN_REG_DST_64)?2:1), bufPtr);
+            decodeGCNVRegOperand(f.vdst, f.dregsNum, bufPtr);
         
-        if (gcnInsn.encoding == GCNENC_VOP3B &&
-            (mode1 == GCN_DS2_VCC || mode1 == GCN_DST_VCC || mode1 == GCN_DST_VCC_VSRC2 ||
-             mode1 == GCN_S0EQS12)) /* VOP3b */
+        if (f.useSdst) /* VOP3b */
         {
             *bufPtr++ = ',';
             *bufPtr++ = ' ';
-            decodeGCNOperandNoLit(dasm, ((insnCode>>8)&0x7f), 2, bufPtr, arch);
+            decodeGCNOperandNoLit(dasm, f.sdst, 2, bufPtr, arch);
         }
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
         if (vop3Mode != GCN_VOP3_VINTRP)
         {
-            if ((insnCode2 & (1U<<29)) != 0)
+            if ((f.negFlags & 1) != 0)
                 *bufPtr++ = '-';
-            if (absFlags & 1)
+            if (f.absFlags & 1)
                 putChars(bufPtr, "abs(", 4);
-            decodeGCNOperandNoLit(dasm, vsrc0, (gcnInsn.mode&GCN_REG_SRC0_64)?2:1,
+            decodeGCNOperandNoLit(dasm, f.vsrc0, f.s0regsNum,
                                    bufPtr, arch, displayFloatLits);
-            if (absFlags & 1)
+            if (f.absFlags & 1)
                 *bufPtr++ = ')';
             vsrc0Used = true;
         }
         
         if (vop3Mode == GCN_VOP3_VINTRP)
         {
-            if ((insnCode2 & (1U<<30)) != 0)
+            if ((f.negFlags & 2) != 0)
                 *bufPtr++ = '-';
-            if (absFlags & 2)
+            if (f.absFlags & 2)
                 putChars(bufPtr, "abs(", 4);
             if (mode1 == GCN_P0_P10_P20)
-                decodeVINTRPParam(vsrc1, bufPtr);
+                decodeVINTRPParam(f.vsrc1, bufPtr);
             else
-                decodeGCNOperandNoLit(dasm, vsrc1, 1, bufPtr, arch, displayFloatLits);
-            if (absFlags & 2)
+                decodeGCNOperandNoLit(dasm, f.vsrc1, f.s1regsNum, bufPtr, arch,
+                            displayFloatLits);
+            if (f.absFlags & 2)
                 *bufPtr++ = ')';
             putChars(bufPtr, ", attr", 6);
-            const cxuint attr = vsrc0&63;
+            const cxuint attr = f.vsrc0&63;
             putByteToBuf(attr, bufPtr);
             *bufPtr++ = '.';
-            *bufPtr++ = "xyzw"[((vsrc0>>6)&3)]; // attrchannel
+            *bufPtr++ = "xyzw"[((f.vsrc0>>6)&3)]; // attrchannel
             
-            if ((gcnInsn.mode & GCN_VOP3_MASK3) == GCN_VINTRP_SRC2)
+            if (f.useVsrc2)
             {
                 *bufPtr++ = ',';
                 *bufPtr++ = ' ';
-                if ((insnCode2 & (1U<<31)) != 0)
+                if ((f.negFlags & 4) != 0)
                     *bufPtr++ = '-';
-                if (absFlags & 4)
+                if (f.absFlags & 4)
                     putChars(bufPtr, "abs(", 4);
-                decodeGCNOperandNoLit(dasm, vsrc2, 1, bufPtr, arch, displayFloatLits);
-                if (absFlags & 4)
+                decodeGCNOperandNoLit(dasm, f.vsrc2, f.s2regsNum, bufPtr, arch,
+                            displayFloatLits);
+                if (f.absFlags & 4)
                     *bufPtr++ = ')';
                 vsrc2Used = true;
             }
             
-            if (vsrc0 & 0x100)
+            if (f.vsrc0 & 0x100)
                 putChars(bufPtr, " high", 5);
             vsrc0Used = true;
             vsrc1Used = true;
@@ -1773,36 +1948,30 @@ void GCNDisasmUtils::decodeVOP3Encoding(GCNDisassembler& dasm, cxuint spacesToAd
         {
             *bufPtr++ = ',';
             *bufPtr++ = ' ';
-            if ((insnCode2 & (1U<<30)) != 0)
+            if ((f.negFlags & 2) != 0)
                 *bufPtr++ = '-';
-            if (absFlags & 2)
+            if (f.absFlags & 2)
                 putChars(bufPtr, "abs(", 4);
-            decodeGCNOperandNoLit(dasm, vsrc1, (gcnInsn.mode&GCN_REG_SRC1_64)?2:1,
+            decodeGCNOperandNoLit(dasm, f.vsrc1, f.s1regsNum,
                       bufPtr, arch, displayFloatLits);
-            if (absFlags & 2)
+            if (f.absFlags & 2)
                 *bufPtr++ = ')';
-            /* GCN_DST_VCC - only sdst is used, no vsrc2 */
-            if (mode1 != GCN_SRC2_NONE && mode1 != GCN_DST_VCC && opcode >= 256)
+            if (f.useVsrc2)
             {
                 *bufPtr++ = ',';
                 *bufPtr++ = ' ';
                 
-                if (mode1 == GCN_DS2_VCC || mode1 == GCN_SRC2_VCC)
-                {
-                    decodeGCNOperandNoLit(dasm, vsrc2, 2, bufPtr, arch);
-                    vsrc2CC = true;
-                }
+                if (f.vsrc2CC)
+                    decodeGCNOperandNoLit(dasm, f.vsrc2, f.s2regsNum, bufPtr, arch);
                 else
                 {
-                    if ((insnCode2 & (1U<<31)) != 0)
+                    if ((f.negFlags & 4) != 0)
                         *bufPtr++ = '-';
-                    if (absFlags & 4)
+                    if (f.absFlags & 4)
                         putChars(bufPtr, "abs(", 4);
-                    // for V_MQSAD_U32 SRC2 is 128-bit
-                    decodeGCNOperandNoLit(dasm, vsrc2, is128Ops ? 4 :
-                                (gcnInsn.mode&GCN_REG_SRC2_64)?2:1,
+                    decodeGCNOperandNoLit(dasm, f.vsrc2, f.s2regsNum,
                                  bufPtr, arch, displayFloatLits);
-                    if (absFlags & 4)
+                    if (f.absFlags & 4)
                         *bufPtr++ = ')';
                 }
                 vsrc2Used = true;
@@ -1815,100 +1984,97 @@ void GCNDisasmUtils::decodeVOP3Encoding(GCNDisassembler& dasm, cxuint spacesToAd
     else
         addSpaces(bufPtr, spacesToAdd-1);
     
-    const cxuint omod = (insnCode2>>27)&3;
-    if (omod != 0)
+    if (f.omod != 0)
     {
-        const char* omodStr = (omod==3)?" div:2":(omod==2)?" mul:4":" mul:2";
+        const char* omodStr = (f.omod==3)?" div:2":(f.omod==2)?" mul:4":" mul:2";
         putChars(bufPtr, omodStr, 6);
     }
     
-    const bool clamp = (!isGCN12 && gcnInsn.encoding == GCNENC_VOP3A &&
-            (insnCode&0x800) != 0) || (isGCN12 && (insnCode&0x8000) != 0);
-    if (clamp)
+    if (f.clamp)
         putChars(bufPtr, " clamp", 6);
     
     /* print unused values of parts if not values are not default */
-    if (!vdstUsed && vdst != 0)
+    if (!vdstUsed && f.vdst != 0)
     {
         putChars(bufPtr, " dst=", 5);
-        bufPtr += itocstrCStyle(vdst, bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.vdst, bufPtr, 6, 16);
     }
     
     if (!vsrc0Used)
     {
-        if (vsrc0 != 0)
+        if (f.vsrc0 != 0)
         {
             putChars(bufPtr, " src0=", 6);
-            bufPtr += itocstrCStyle(vsrc0, bufPtr, 6, 16);
+            bufPtr += itocstrCStyle(f.vsrc0, bufPtr, 6, 16);
         }
-        if (absFlags & 1)
+        if (f.absFlags & 1)
             putChars(bufPtr, " abs0", 5);
-        if ((insnCode2 & (1U<<29)) != 0)
+        if ((f.negFlags & 1) != 0)
             putChars(bufPtr, " neg0", 5);
     }
     if (!vsrc1Used)
     {
-        if (vsrc1 != 0)
+        if (f.vsrc1 != 0)
         {
             putChars(bufPtr, " vsrc1=", 7);
-            bufPtr += itocstrCStyle(vsrc1, bufPtr, 6, 16);
+            bufPtr += itocstrCStyle(f.vsrc1, bufPtr, 6, 16);
         }
-        if (absFlags & 2)
+        if (f.absFlags & 2)
             putChars(bufPtr, " abs1", 5);
-        if ((insnCode2 & (1U<<30)) != 0)
+        if ((f.negFlags & 2) != 0)
             putChars(bufPtr, " neg1", 5);
     }
     if (!vsrc2Used)
     {
-        if (vsrc2 != 0)
+        if (f.vsrc2 != 0)
         {
             putChars(bufPtr, " vsrc2=", 7);
-            bufPtr += itocstrCStyle(vsrc2, bufPtr, 6, 16);
+            bufPtr += itocstrCStyle(f.vsrc2, bufPtr, 6, 16);
         }
-        if (absFlags & 4)
+        if (f.absFlags & 4)
             putChars(bufPtr, " abs2", 5);
-        if ((insnCode2 & (1U<<31)) != 0)
+        if ((f.negFlags & 4) != 0)
             putChars(bufPtr, " neg2", 5);
     }
     
-    const cxuint usedMask = 7 & ~(vsrc2CC?4:0);
+    const cxuint usedMask = 7 & ~((vsrc2Used && f.vsrc2CC)?4:0);
     /* check whether instruction is this same like VOP2/VOP1/VOPC */
     bool isVOP1Word = false; // if can be write in single VOP dword
     if (vop3Mode == GCN_VOP3_VINTRP)
     {
         if (mode1 != GCN_NEW_OPCODE) /* check clamp and abs flags */
             isVOP1Word = !((insnCode&(7<<8)) != 0 || (insnCode2&(7<<29)) != 0 ||
-                    clamp || ((vsrc1 < 256 && mode1!=GCN_P0_P10_P20) ||
-                    (mode1==GCN_P0_P10_P20 && vsrc1 >= 256)) ||
-                    vsrc0 >= 256 || vsrc2 != 0);
+                    f.clamp || ((f.vsrc1 < 256 && mode1!=GCN_P0_P10_P20) ||
+                    (mode1==GCN_P0_P10_P20 && f.vsrc1 >= 256)) ||
+                    f.vsrc0 >= 256 || f.vsrc2 != 0);
     }
     else if (mode1 != GCN_ARG1_IMM && mode1 != GCN_ARG2_IMM)
     {
-        const bool reqForVOP1Word = omod==0 && ((insnCode2&(usedMask<<29)) == 0);
+        const bool reqForVOP1Word = f.omod==0 && ((insnCode2&(usedMask<<29)) == 0);
         if (gcnInsn.encoding != GCNENC_VOP3B)
         {   /* for VOPC */
-            if (opcode < 256 && vdst == 106 /* vcc */ && vsrc1 >= 256 && vsrc2 == 0)
+            if (f.opcode < 256 && f.vdst == 106 /* vcc */ && f.vsrc1 >= 256 && f.vsrc2 == 0)
                 isVOP1Word = true;
             /* for VOP1 */
-            else if (vop3Mode == GCN_VOP3_VOP1 && vsrc1 == 0 && vsrc2 == 0)
+            else if (vop3Mode == GCN_VOP3_VOP1 && f.vsrc1 == 0 && f.vsrc2 == 0)
                 isVOP1Word = true;
             /* for VOP2 */
-            else if (vop3Mode == GCN_VOP3_VOP2 && ((!vsrc1Used && vsrc1 == 0) || 
+            else if (vop3Mode == GCN_VOP3_VOP2 && ((!vsrc1Used && f.vsrc1 == 0) || 
                 /* distinguish for v_read/writelane and other vop2 encoded as vop3 */
-                (((gcnInsn.mode&GCN_VOP3_SRC1_SGPR)==0) && vsrc1 >= 256) ||
-                (((gcnInsn.mode&GCN_VOP3_SRC1_SGPR)!=0) && vsrc1 < 256)) &&
-                ((mode1 != GCN_SRC2_VCC && vsrc2 == 0) ||
-                (vsrc2 == 106 && mode1 == GCN_SRC2_VCC)))
+                (((gcnInsn.mode&GCN_VOP3_SRC1_SGPR)==0) && f.vsrc1 >= 256) ||
+                (((gcnInsn.mode&GCN_VOP3_SRC1_SGPR)!=0) && f.vsrc1 < 256)) &&
+                ((mode1 != GCN_SRC2_VCC && f.vsrc2 == 0) ||
+                (f.vsrc2 == 106 && mode1 == GCN_SRC2_VCC)))
                 isVOP1Word = true;
             /* check clamp and abs and neg flags */
-            if ((insnCode&(usedMask<<8)) != 0 || (insnCode2&(usedMask<<29)) != 0 || clamp)
+            if ((insnCode&(usedMask<<8)) != 0 || (insnCode2&(usedMask<<29)) != 0 || f.clamp)
                 isVOP1Word = false;
         }
         /* for VOP2 encoded as VOP3b (v_addc....) */
         else if (gcnInsn.encoding == GCNENC_VOP3B && vop3Mode == GCN_VOP3_VOP2 &&
-                vsrc1 >= 256 && sdst == 106 /* vcc */ &&
-                ((vsrc2 == 106 && mode1 == GCN_DS2_VCC) || 
-                    (vsrc2 == 0 && mode1 != GCN_DS2_VCC))) /* VOP3b */
+                f.vsrc1 >= 256 && f.sdst == 106 /* vcc */ &&
+                ((f.vsrc2 == 106 && mode1 == GCN_DS2_VCC) || 
+                    (f.vsrc2 == 0 && mode1 != GCN_DS2_VCC))) /* VOP3b */
             isVOP1Word = true;
         
         if (isVOP1Word && !reqForVOP1Word)
@@ -1945,72 +2111,98 @@ void GCNDisasmUtils::decodeVINTRPEncoding(GCNDisassembler& dasm, cxuint spacesTo
     output.forward(bufPtr-bufStart);
 }
 
-void GCNDisasmUtils::decodeDSEncoding(GCNDisassembler& dasm, cxuint spacesToAdd,
-          uint16_t arch, const GCNInstruction& gcnInsn, uint32_t insnCode,
-          uint32_t insnCode2)
+/* fields of DS instruction */
+struct CLRX_INTERNAL GCNDSFields
 {
-    FastOutputBuffer& output = dasm.output;
-    char* bufStart = output.reserve(90);
-    char* bufPtr = bufStart;
+    cxuint vaddr;
+    cxuint vdata0;
+    cxuint vdata1;
+    cxuint vdst;
+    cxuint offset;
+    uint32_t flags; // GCNREC_GDS
+    bool useVdst;
+    bool useVaddr;
+    bool useVdata0;
+    bool useVdata1;
+    cxuint dstRegsNum;
+    cxuint data0RegsNum;
+    cxuint data1RegsNum;
+};
+
+static GCNDSFields getGCNDSFields(bool isGCN12, uint16_t mode, uint32_t insnCode,
+            uint32_t insnCode2)
+{
+    GCNDSFields f;
+    f.vaddr = insnCode2&0xff;
+    f.vdata0 = (insnCode2>>8)&0xff;
+    f.vdata1 = (insnCode2>>16)&0xff;
+    f.vdst = insnCode2>>24;
+    f.offset = insnCode&0xffff;
+    f.flags = ((!isGCN12 && (insnCode&0x20000)!=0) ||
+            (isGCN12 && (insnCode&0x10000)!=0)) ? GCNREC_GDS : 0;
+    
+    const uint16_t srcMode = (mode & GCN_SRCS_MASK);
+    f.useVdst = (mode & GCN_ADDR_SRC) != 0 || (mode & GCN_ONLYDST) != 0;
+    f.useVaddr = (mode & GCN_ONLYDST) == 0;
+    f.useVdata0 = (mode & GCN_ONLYDST) == 0 &&
+        (mode & (GCN_ADDR_DST|GCN_ADDR_SRC)) != 0 && srcMode != GCN_NOSRC;
+    f.useVdata1 = f.useVdata0 && srcMode == GCN_2SRCS;
+    
+    f.dstRegsNum = (mode&GCN_REG_DST_64)?2:1;
+    if ((mode&GCN_DS_96) != 0)
+        f.dstRegsNum = 3;
+    if ((mode&GCN_DS_128) != 0 || (mode&GCN_DST128) != 0)
+        f.dstRegsNum = 4;
+    f.data0RegsNum = (mode&GCN_REG_SRC0_64)?2:1;
+    if ((mode&GCN_DS_96) != 0)
+        f.data0RegsNum = 3;
+    if ((mode&GCN_DS_128) != 0)
+        f.data0RegsNum = 4;
+    f.data1RegsNum = (mode&GCN_REG_SRC1_64)?2:1;
+    return f;
+}
+
+void GCNDisasmUtils::decodeDSEncoding(GCNDisassembler& dasm, cxuint spacesToAdd,
+          uint16_t arch, const GCNInstruction& gcnInsn, uint32_t insnCode,
+          uint32_t insnCode2)
+{
+    FastOutputBuffer& output = dasm.output;
+    char* bufStart = output.reserve(90);
+    char* bufPtr = bufStart;
     const bool isGCN12 = ((arch&ARCH_RX3X0)!=0);
+    const GCNDSFields f = getGCNDSFields(isGCN12, gcnInsn.mode, insnCode, insnCode2);
     addSpaces(bufPtr, spacesToAdd);
-    bool vdstUsed = false;
-    bool vaddrUsed = false;
-    bool vdata0Used = false;
-    bool vdata1Used = false;
-    const cxuint vaddr = insnCode2&0xff;
-    const cxuint vdata0 = (insnCode2>>8)&0xff;
-    const cxuint vdata1 = (insnCode2>>16)&0xff;
-    const cxuint vdst = insnCode2>>24;
-    
-    if ((gcnInsn.mode & GCN_ADDR_SRC) != 0 || (gcnInsn.mode & GCN_ONLYDST) != 0)
-    {   /* vdst is dst */
-        cxuint regsNum = (gcnInsn.mode&GCN_REG_DST_64)?2:1;
-        if ((gcnInsn.mode&GCN_DS_96) != 0)
-            regsNum = 3;
-        if ((gcnInsn.mode&GCN_DS_128) != 0 || (gcnInsn.mode&GCN_DST128) != 0)
-            regsNum = 4;
-        decodeGCNVRegOperand(vdst, regsNum, bufPtr);
-        vdstUsed = true;
-    }
-    if ((gcnInsn.mode & GCN_ONLYDST) == 0)
+    
+    if (f.useVdst)
+        /* vdst is dst */
+        decodeGCNVRegOperand(f.vdst, f.dstRegsNum, bufPtr);
+    if (f.useVaddr)
     {   /// print VADDR
-        if (vdstUsed)
+        if (f.useVdst)
         {
             *bufPtr++ = ',';
             *bufPtr++ = ' ';
         }
-        decodeGCNVRegOperand(vaddr, 1, bufPtr);
-        vaddrUsed = true;
+        decodeGCNVRegOperand(f.vaddr, 1, bufPtr);
     }
     
-    const uint16_t srcMode = (gcnInsn.mode & GCN_SRCS_MASK);
-    
-    if ((gcnInsn.mode & GCN_ONLYDST) == 0 &&
-        (gcnInsn.mode & (GCN_ADDR_DST|GCN_ADDR_SRC)) != 0 && srcMode != GCN_NOSRC)
+    if (f.useVdata0)
     {   /* two vdata */
-        if (vaddrUsed || vdstUsed)
+        if (f.useVaddr || f.useVdst)
         {   // comma after previous argument (VDST, VADDR)
             *bufPtr++ = ',';
             *bufPtr++ = ' ';
         }
-        cxuint regsNum = (gcnInsn.mode&GCN_REG_SRC0_64)?2:1;
-        if ((gcnInsn.mode&GCN_DS_96) != 0)
-            regsNum = 3;
-        if ((gcnInsn.mode&GCN_DS_128) != 0)
-            regsNum = 4;
-        decodeGCNVRegOperand(vdata0, regsNum, bufPtr);
-        vdata0Used = true;
-        if (srcMode == GCN_2SRCS)
+        decodeGCNVRegOperand(f.vdata0, f.data0RegsNum, bufPtr);
+        if (f.useVdata1)
         {
             *bufPtr++ = ',';
             *bufPtr++ = ' ';
-            decodeGCNVRegOperand(vdata1, (gcnInsn.mode&GCN_REG_SRC1_64)?2:1, bufPtr);
-            vdata1Used = true;
+            decodeGCNVRegOperand(f.vdata1, f.data1RegsNum, bufPtr);
         }
     }
     
-    const cxuint offset = (insnCode&0xffff);
+    const cxuint offset = f.offset;
     if (offset != 0)
     {
         if ((gcnInsn.mode & GCN_2OFFSETS) == 0) /* single offset */
@@ -2033,29 +2225,29 @@ void GCNDisasmUtils::decodeDSEncoding(GCNDisassembler& dasm, cxuint spacesToAdd,
         }
     }
     
-    if ((!isGCN12 && (insnCode&0x20000)!=0) || (isGCN12 && (insnCode&0x10000)!=0))
+    if ((f.flags & GCNREC_GDS) != 0)
         putChars(bufPtr, " gds", 4);
     
     // print value, if some are not used, but values is not default
-    if (!vaddrUsed && vaddr != 0)
+    if (!f.useVaddr && f.vaddr != 0)
     {
         putChars(bufPtr, " vaddr=", 7);
-        bufPtr += itocstrCStyle(vaddr, bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.vaddr, bufPtr, 6, 16);
     }
-    if (!vdata0Used && vdata0 != 0)
+    if (!f.useVdata0 && f.vdata0 != 0)
     {
         putChars(bufPtr, " vdata0=", 8);
-        bufPtr += itocstrCStyle(vdata0, bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.vdata0, bufPtr, 6, 16);
     }
-    if (!vdata1Used && vdata1 != 0)
+    if (!f.useVdata1 && f.vdata1 != 0)
     {
         putChars(bufPtr, " vdata1=", 8);
-        bufPtr += itocstrCStyle(vdata1, bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.vdata1, bufPtr, 6, 16);
     }
-    if (!vdstUsed && vdst != 0)
+    if (!f.useVdst && f.vdst != 0)
     {
         putChars(bufPtr, " vdst=", 6);
-        bufPtr += itocstrCStyle(vdst, bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.vdst, bufPtr, 6, 16);
     }
     output.forward(bufPtr-bufStart);
 }
@@ -2073,6 +2265,61 @@ static const char* mtbufNFMTTable[] =
     "uint", "sint", "snorm_ogl", "float"
 };
 
+/* fields of MUBUF and MTBUF instruction */
+struct CLRX_INTERNAL GCNMUBUFFields
+{
+    cxuint vaddr;
+    cxuint vdata;
+    cxuint srsrc;   // first register of srsrc
+    cxuint soffset;
+    cxuint offset;
+    cxuint dfmt;    // MTBUF data format
+    cxuint nfmt;    // MTBUF number format
+    uint32_t flags; // GCNREC_OFFEN, IDXEN, GLC, SLC, ADDR64, LDS and TFE
+    cxuint dregsNum;
+    cxuint aregsNum;
+};
+
+static GCNMUBUFFields getGCNMUBUFFields(bool isGCN12, const GCNInstruction& gcnInsn,
+            uint32_t insnCode, uint32_t insnCode2)
+{
+    GCNMUBUFFields f;
+    const bool isMTBUF = (gcnInsn.encoding == GCNENC_MTBUF);
+    f.vaddr = insnCode2&0xff;
+    f.vdata = (insnCode2>>8)&0xff;
+    f.srsrc = ((insnCode2>>16)&0x1f)<<2;
+    f.soffset = insnCode2>>24;
+    f.offset = insnCode&0xfff;
+    f.dfmt = isMTBUF ? (insnCode>>19)&15 : 0;
+    f.nfmt = isMTBUF ? (insnCode>>23)&7 : 0;
+    f.flags = 0;
+    if (insnCode & 0x1000U)
+        f.flags |= GCNREC_OFFEN;
+    if (insnCode & 0x2000U)
+        f.flags |= GCNREC_IDXEN;
+    if (insnCode & 0x4000U)
+        f.flags |= GCNREC_GLC;
+    if (((!isGCN12 || isMTBUF) && (insnCode2 & 0x400000U)!=0) ||
+        ((isGCN12 && !isMTBUF) && (insnCode & 0x20000)!=0))
+        f.flags |= GCNREC_SLC;
+    /* addr64 only for older GCN than 1.2 */
+    if (!isGCN12 && (insnCode & 0x8000U)!=0)
+        f.flags |= GCNREC_ADDR64;
+    if (!isMTBUF && (insnCode & 0x10000U) != 0)
+        f.flags |= GCNREC_LDS;
+    if (insnCode2 & 0x800000U)
+        f.flags |= GCNREC_TFE;
+    
+    f.dregsNum = ((gcnInsn.mode&GCN_DSIZE_MASK)>>GCN_SHIFT2)+1;
+    if ((f.flags & GCNREC_TFE) != 0)
+        f.dregsNum++; // tfe
+    // determine number of vaddr registers
+    /* for addr32 - idxen+offen or 1, for addr64 - 2 (idxen and offen is illegal) */
+    f.aregsNum = ((f.flags & (GCNREC_OFFEN|GCNREC_IDXEN)) == (GCNREC_OFFEN|GCNREC_IDXEN) ||
+            (f.flags & GCNREC_ADDR64) != 0) ? 2 : 1;
+    return f;
+}
+
 void GCNDisasmUtils::decodeMUBUFEncoding(GCNDisassembler& dasm, cxuint spacesToAdd,
           uint16_t arch, const GCNInstruction& gcnInsn, uint32_t insnCode,
           uint32_t insnCode2)
@@ -2081,69 +2328,52 @@ void GCNDisasmUtils::decodeMUBUFEncoding(GCNDisassembler& dasm, cxuint spacesToA
     char* bufStart = output.reserve(150);
     char* bufPtr = bufStart;
     const bool isGCN12 = ((arch&ARCH_RX3X0)!=0);
-    const cxuint vaddr = insnCode2&0xff;
-    const cxuint vdata = (insnCode2>>8)&0xff;
-    const cxuint srsrc = (insnCode2>>16)&0x1f;
-    const cxuint soffset = insnCode2>>24;
+    const GCNMUBUFFields f = getGCNMUBUFFields(isGCN12, gcnInsn, insnCode, insnCode2);
     const uint16_t mode1 = (gcnInsn.mode & GCN_MASK1);
     if (mode1 != GCN_ARG_NONE)
     {
         addSpaces(bufPtr, spacesToAdd);
         if (mode1 != GCN_MUBUF_NOVAD)
         {
-            cxuint dregsNum = ((gcnInsn.mode&GCN_DSIZE_MASK)>>GCN_SHIFT2)+1;
-            if (insnCode2 & 0x800000U)
-                dregsNum++; // tfe
-            
-            decodeGCNVRegOperand(vdata, dregsNum, bufPtr);
+            decodeGCNVRegOperand(f.vdata, f.dregsNum, bufPtr);
             *bufPtr++ = ',';
             *bufPtr++ = ' ';
-            // determine number of vaddr registers
-            /* for addr32 - idxen+offen or 1, for addr64 - 2 (idxen and offen is illegal) */
-            const cxuint aregsNum = ((insnCode & 0x3000U)==0x3000U ||
-                    /* addr64 only for older GCN than 1.2 */
-                    (!isGCN12 && (insnCode & 0x8000U)))? 2 : 1;
-            
-            decodeGCNVRegOperand(vaddr, aregsNum, bufPtr);
+            decodeGCNVRegOperand(f.vaddr, f.aregsNum, bufPtr);
             *bufPtr++ = ',';
             *bufPtr++ = ' ';
         }
-        decodeGCNOperandNoLit(dasm, srsrc<<2, 4, bufPtr, arch);
+        decodeGCNOperandNoLit(dasm, f.srsrc, 4, bufPtr, arch);
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
-        decodeGCNOperandNoLit(dasm, soffset, 1, bufPtr, arch);
+        decodeGCNOperandNoLit(dasm, f.soffset, 1, bufPtr, arch);
     }
     else
         addSpaces(bufPtr, spacesToAdd-1);
     
-    if (insnCode & 0x1000U)
+    if (f.flags & GCNREC_OFFEN)
         putChars(bufPtr, " offen", 6);
-    if (insnCode & 0x2000U)
+    if (f.flags & GCNREC_IDXEN)
         putChars(bufPtr, " idxen", 6);
-    const cxuint offset = insnCode&0xfff;
-    if (offset != 0)
+    if (f.offset != 0)
     {
         putChars(bufPtr, " offset:", 8);
-        bufPtr += itocstrCStyle(offset, bufPtr, 7, 10);
+        bufPtr += itocstrCStyle(f.offset, bufPtr, 7, 10);
     }
-    if (insnCode & 0x4000U)
+    if (f.flags & GCNREC_GLC)
         putChars(bufPtr, " glc", 4);
-    
-    if (((!isGCN12 || gcnInsn.encoding==GCNENC_MTBUF) && (insnCode2 & 0x400000U)!=0) ||
-        ((isGCN12 && gcnInsn.encoding!=GCNENC_MTBUF) && (insnCode & 0x20000)!=0))
+    if (f.flags & GCNREC_SLC)
         putChars(bufPtr, " slc", 4);
-    
-    if (!isGCN12 && (insnCode & 0x8000U)!=0)
+    if (f.flags & GCNREC_ADDR64)
         putChars(bufPtr, " addr64", 7);
-    if (gcnInsn.encoding!=GCNENC_MTBUF && (insnCode & 0x10000U) != 0)
+    if (f.flags & GCNREC_LDS)
         putChars(bufPtr, " lds", 4);
-    if (insnCode2 & 0x800000U)
+    if (f.flags & GCNREC_TFE)
         putChars(bufPtr, " tfe", 4);
     // routine to decode MTBUF format (include default values)
     if (gcnInsn.encoding==GCNENC_MTBUF)
     {
-        const cxuint dfmt = (insnCode>>19)&15;
-        const cxuint nfmt = (insnCode>>23)&7;
+        const cxuint dfmt = f.dfmt;
+        const cxuint nfmt = f.nfmt;
         if (dfmt!=1 || nfmt!=0)
         {
             putChars(bufPtr, " format:[", 9);
@@ -2165,33 +2395,81 @@ void GCNDisasmUtils::decodeMUBUFEncoding(GCNDisassembler& dasm, cxuint spacesToA
     // print value, if some are not used, but values is not default
     if (mode1 == GCN_ARG_NONE || mode1 == GCN_MUBUF_NOVAD)
     {
-        if (vaddr != 0)
+        if (f.vaddr != 0)
         {
             putChars(bufPtr, " vaddr=", 7);
-            bufPtr += itocstrCStyle(vaddr, bufPtr, 6, 16);
+            bufPtr += itocstrCStyle(f.vaddr, bufPtr, 6, 16);
         }
-        if (vdata != 0)
+        if (f.vdata != 0)
         {
             putChars(bufPtr, " vdata=", 7);
-            bufPtr += itocstrCStyle(vdata, bufPtr, 6, 16);
+            bufPtr += itocstrCStyle(f.vdata, bufPtr, 6, 16);
         }
     }
     if (mode1 == GCN_ARG_NONE)
     {
-        if (srsrc != 0)
+        if (f.srsrc != 0)
         {
             putChars(bufPtr, " srsrc=", 7);
-            bufPtr += itocstrCStyle(srsrc, bufPtr, 6, 16);
+            bufPtr += itocstrCStyle(f.srsrc>>2, bufPtr, 6, 16);
         }
-        if (soffset != 0)
+        if (f.soffset != 0)
         {
             putChars(bufPtr, " soffset=", 9);
-            bufPtr += itocstrCStyle(soffset, bufPtr, 6, 16);
+            bufPtr += itocstrCStyle(f.soffset, bufPtr, 6, 16);
         }
     }
     output.forward(bufPtr-bufStart);
 }
 
+/* fields of MIMG instruction */
+struct CLRX_INTERNAL GCNMIMGFields
+{
+    cxuint vaddr;
+    cxuint vdata;
+    cxuint srsrc;   // first register of srsrc
+    cxuint ssamp;   // first register of ssamp
+    cxuint dmask;
+    uint32_t flags; // GCNREC_UNORM, GLC, SLC, R128, TFE, LWE, DA and D16
+    cxuint dregsNum;
+    cxuint aregsNum;
+    cxuint srsrcRegsNum;
+};
+
+static GCNMIMGFields getGCNMIMGFields(bool isGCN12, uint16_t mode, uint32_t insnCode,
+            uint32_t insnCode2)
+{
+    static const uint32_t mimgFlagsTbl[7][2] =
+    {
+        { 0x1000, GCNREC_UNORM }, { 0x2000, GCNREC_GLC }, { 0x2000000, GCNREC_SLC },
+        { 0x8000, GCNREC_R128 }, { 0x10000, GCNREC_TFE }, { 0x20000, GCNREC_LWE },
+        { 0x4000, GCNREC_DA }
+    };
+    GCNMIMGFields f;
+    f.vaddr = insnCode2&0xff;
+    f.vdata = (insnCode2>>8)&0xff;
+    f.srsrc = (insnCode2>>14)&0x7c;
+    f.ssamp = ((insnCode2>>21)&0x1f)<<2;
+    f.dmask = (insnCode>>8)&15;
+    f.flags = 0;
+    for (const auto& entry: mimgFlagsTbl)
+        if ((insnCode & entry[0]) != 0)
+            f.flags |= entry[1];
+    if (isGCN12 && (insnCode2 & (1U<<31)) != 0)
+        f.flags |= GCNREC_D16;
+    
+    f.dregsNum = 4;
+    if ((mode & GCN_MIMG_VDATA4) == 0)
+        f.dregsNum = ((f.dmask & 1)?1:0) + ((f.dmask & 2)?1:0) + ((f.dmask & 4)?1:0) +
+                ((f.dmask & 8)?1:0);
+    f.dregsNum = (f.dregsNum == 0) ? 1 : f.dregsNum;
+    if ((f.flags & GCNREC_TFE) != 0)
+        f.dregsNum++; // tfe
+    f.aregsNum = std::max(4, (mode&GCN_MIMG_VA_MASK)+1);
+    f.srsrcRegsNum = ((f.flags & GCNREC_R128) != 0) ? 4 : 8;
+    return f;
+}
+
 void GCNDisasmUtils::decodeMIMGEncoding(GCNDisassembler& dasm, cxuint spacesToAdd,
          uint16_t arch, const GCNInstruction& gcnInsn, uint32_t insnCode,
          uint32_t insnCode2)
@@ -2201,32 +2479,22 @@ void GCNDisasmUtils::decodeMIMGEncoding(GCNDisassembler& dasm, cxuint spacesToAd
     char* bufPtr = bufStart;
     addSpaces(bufPtr, spacesToAdd);
     
-    const cxuint dmask = (insnCode>>8)&15;
-    cxuint dregsNum = 4;
-    if ((gcnInsn.mode & GCN_MIMG_VDATA4) == 0)
-        dregsNum = ((dmask & 1)?1:0) + ((dmask & 2)?1:0) + ((dmask & 4)?1:0) +
-                ((dmask & 8)?1:0);
-    
-    dregsNum = (dregsNum == 0) ? 1 : dregsNum;
-    if (insnCode & 0x10000)
-        dregsNum++; // tfe
-    
-    decodeGCNVRegOperand((insnCode2>>8)&0xff, dregsNum, bufPtr);
+    const GCNMIMGFields f = getGCNMIMGFields((arch & ARCH_RX3X0)!=0, gcnInsn.mode,
+                    insnCode, insnCode2);
+    const cxuint dmask = f.dmask;
+    decodeGCNVRegOperand(f.vdata, f.dregsNum, bufPtr);
     *bufPtr++ = ',';
     *bufPtr++ = ' ';
-    decodeGCNVRegOperand(insnCode2&0xff,
-                 std::max(4, (gcnInsn.mode&GCN_MIMG_VA_MASK)+1), bufPtr);
+    decodeGCNVRegOperand(f.vaddr, f.aregsNum, bufPtr);
     *bufPtr++ = ',';
     *bufPtr++ = ' ';
-    decodeGCNOperandNoLit(dasm, ((insnCode2>>14)&0x7c), (insnCode & 0x8000)?4:8,
-                          bufPtr, arch);
+    decodeGCNOperandNoLit(dasm, f.srsrc, f.srsrcRegsNum, bufPtr, arch);
     
-    const cxuint ssamp = (insnCode2>>21)&0x1f;
     if ((gcnInsn.mode & GCN_MIMG_SAMPLE) != 0)
     {
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
-        decodeGCNOperandNoLit(dasm, ssamp<<2, 4, bufPtr, arch);
+        decodeGCNOperandNoLit(dasm, f.ssamp, 4, bufPtr, arch);
     }
     if (dmask != 1)
     {
@@ -2240,36 +2508,77 @@ void GCNDisasmUtils::decodeMIMGEncoding(GCNDisassembler& dasm, cxuint spacesToAd
             *bufPtr++ = '0' + dmask;
     }
     
-    if (insnCode & 0x1000)
+    if (f.flags & GCNREC_UNORM)
         putChars(bufPtr, " unorm", 6);
-    if (insnCode & 0x2000)
+    if (f.flags & GCNREC_GLC)
         putChars(bufPtr, " glc", 4);
-    if (insnCode & 0x2000000)
+    if (f.flags & GCNREC_SLC)
         putChars(bufPtr, " slc", 4);
-    if (insnCode & 0x8000)
+    if (f.flags & GCNREC_R128)
         putChars(bufPtr, " r128", 5);
-    if (insnCode & 0x10000)
+    if (f.flags & GCNREC_TFE)
         putChars(bufPtr, " tfe", 4);
-    if (insnCode & 0x20000)
+    if (f.flags & GCNREC_LWE)
         putChars(bufPtr, " lwe", 4);
-    if (insnCode & 0x4000)
+    if (f.flags & GCNREC_DA)
     {
         *bufPtr++ = ' ';
         *bufPtr++ = 'd';
         *bufPtr++ = 'a';
     }
-    if ((arch & ARCH_RX3X0)!=0 && (insnCode2 & (1U<<31)) != 0)
+    if (f.flags & GCNREC_D16)
         putChars(bufPtr, " d16", 4);
     
     // print value, if some are not used, but values is not default
-    if ((gcnInsn.mode & GCN_MIMG_SAMPLE) == 0 && ssamp != 0)
+    if ((gcnInsn.mode & GCN_MIMG_SAMPLE) == 0 && f.ssamp != 0)
     {
         putChars(bufPtr, " ssamp=", 7);
-        bufPtr += itocstrCStyle(ssamp, bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.ssamp>>2, bufPtr, 6, 16);
     }
     output.forward(bufPtr-bufStart);
 }
 
+/* fields of EXP instruction */
+struct CLRX_INTERNAL GCNEXPFields
+{
+    cxuint target;
+    cxuint vsrcs[4];    // registers of sources (if enabled)
+    cxuint enMask;      // enabled sources
+    cxuint vsrcsUsed;   // mask of used vsrc fields (compr uses only first two)
+    uint32_t flags;     // GCNREC_DONE, COMPR and VM
+};
+
+static GCNEXPFields getGCNEXPFields(uint32_t insnCode, uint32_t insnCode2)
+{
+    GCNEXPFields f;
+    f.target = (insnCode>>4)&63;
+    f.enMask = insnCode&15;
+    f.vsrcsUsed = 0;
+    for (cxuint i = 0; i < 4; i++)
+    {
+        if ((insnCode&0x400)==0)
+        {
+            f.vsrcs[i] = (insnCode2>>(i<<3))&0xff;
+            if (f.enMask & (1U<<i))
+                f.vsrcsUsed |= 1U<<i;
+        }
+        else // if compr=1
+        {
+            f.vsrcs[i] = ((i>=2)?(insnCode2>>8):insnCode2)&0xff;
+            if (f.enMask & (1U<<i))
+                f.vsrcsUsed |= 1U<<(i>>1);
+        }
+    }
+    f.flags = 0;
+    if (insnCode&0x800)
+        f.flags |= GCNREC_DONE;
+    if (insnCode&0x400)
+        f.flags |= GCNREC_COMPR;
+    if (insnCode&0x1000)
+        f.flags |= GCNREC_VM;
+    return f;
+}
+
 void GCNDisasmUtils::decodeEXPEncoding(GCNDisassembler& dasm, cxuint spacesToAdd,
             uint16_t arch, const GCNInstruction& gcnInsn, uint32_t insnCode,
             uint32_t insnCode2)
@@ -2278,8 +2587,9 @@ void GCNDisasmUtils::decodeEXPEncoding(GCNDisassembler& dasm, cxuint spacesToAdd
     char* bufStart = output.reserve(90);
     char* bufPtr = bufStart;
     addSpaces(bufPtr, spacesToAdd);
+    const GCNEXPFields f = getGCNEXPFields(insnCode, insnCode2);
     /* export target */
-    const cxuint target = (insnCode>>4)&63;
+    const cxuint target = f.target;
     if (target >= 32)
     {
         putChars(bufPtr, "param", 5);
@@ -2312,33 +2622,21 @@ void GCNDisasmUtils::decodeEXPEncoding(GCNDisassembler& dasm, cxuint spacesToAdd
     }
     
     /* vdata registers */
-    cxuint vsrcsUsed = 0;
     for (cxuint i = 0; i < 4; i++)
     {
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
-        if (insnCode & (1U<<i))
-        {
-            if ((insnCode&0x400)==0)
-            {
-                decodeGCNVRegOperand((insnCode2>>(i<<3))&0xff, 1, bufPtr);
-                vsrcsUsed |= 1<<i;
-            }
-            else // if compr=1
-            {
-                decodeGCNVRegOperand(((i>=2)?(insnCode2>>8):insnCode2)&0xff, 1, bufPtr);
-                vsrcsUsed |= 1U<<(i>>1);
-            }
-        }
+        if (f.enMask & (1U<<i))
+            decodeGCNVRegOperand(f.vsrcs[i], 1, bufPtr);
         else
             putChars(bufPtr, "off", 3);
     }
     
-    if (insnCode&0x800)
+    if (f.flags & GCNREC_DONE)
         putChars(bufPtr, " done", 5);
-    if (insnCode&0x400)
+    if (f.flags & GCNREC_COMPR)
         putChars(bufPtr, " compr", 6);
-    if (insnCode&0x1000)
+    if (f.flags & GCNREC_VM)
     {
         *bufPtr++ = ' ';
         *bufPtr++ = 'v';
@@ -2349,7 +2647,7 @@ void GCNDisasmUtils::decodeEXPEncoding(GCNDisassembler& dasm, cxuint spacesToAdd
     for (cxuint i = 0; i < 4; i++)
     {
         const cxuint val = (insnCode2>>(i<<3))&0xff;
-        if ((vsrcsUsed&(1U<<i))==0 && val!=0)
+        if ((f.vsrcsUsed&(1U<<i))==0 && val!=0)
         {
             putChars(bufPtr, " vsrc0=", 7);
             bufPtr[-2] += i; // number
@@ -2359,6 +2657,35 @@ void GCNDisasmUtils::decodeEXPEncoding(GCNDisassembler& dasm, cxuint spacesToAdd
     output.forward(bufPtr-bufStart);
 }
 
+/* fields of FLAT instruction */
+struct CLRX_INTERNAL GCNFLATFields
+{
+    cxuint vaddr;
+    cxuint vdata;
+    cxuint vdst;
+    uint32_t flags; // GCNREC_GLC, SLC and TFE
+    cxuint dregsNum;
+    cxuint dstRegsNum;
+};
+
+static inline GCNFLATFields getGCNFLATFields(uint16_t mode, uint32_t insnCode,
+            uint32_t insnCode2)
+{
+    GCNFLATFields f;
+    f.vaddr = insnCode2&0xff;
+    f.vdata = (insnCode2>>8)&0xff;
+    f.vdst = insnCode2>>24;
+    f.flags = ((insnCode & 0x10000U) ? GCNREC_GLC : 0) |
+            ((insnCode & 0x20000U) ? GCNREC_SLC : 0) |
+            ((insnCode2 & 0x800000U) ? GCNREC_TFE : 0);
+    f.dregsNum = ((mode&GCN_DSIZE_MASK)>>GCN_SHIFT2)+1;
+    /// cmpswap store only to half of number of data registers
+    f.dstRegsNum = ((mode & GCN_CMPSWAP)!=0) ? (f.dregsNum>>1) :  f.dregsNum;
+    // tfe
+    f.dstRegsNum = (f.flags & GCNREC_TFE) ? f.dstRegsNum+1 : f.dstRegsNum;
+    return f;
+}
+
 void GCNDisasmUtils::decodeFLATEncoding(GCNDisassembler& dasm ,cxuint spacesToAdd,
             uint16_t arch, const GCNInstruction& gcnInsn, uint32_t insnCode,
             uint32_t insnCode2)
@@ -2369,29 +2696,25 @@ void GCNDisasmUtils::decodeFLATEncoding(GCNDisassembler& dasm ,cxuint spacesToAd
     addSpaces(bufPtr, spacesToAdd);
     bool vdstUsed = false;
     bool vdataUsed = false;
-    const cxuint dregsNum = ((gcnInsn.mode&GCN_DSIZE_MASK)>>GCN_SHIFT2)+1;
-    /// cmpswap store only to half of number of data registers
-    cxuint dstRegsNum = ((gcnInsn.mode & GCN_CMPSWAP)!=0) ? (dregsNum>>1) :  dregsNum;
-    // tfe
-    dstRegsNum = (insnCode2 & 0x800000U)?dstRegsNum+1:dstRegsNum;
+    const GCNFLATFields f = getGCNFLATFields(gcnInsn.mode, insnCode, insnCode2);
     
     if ((gcnInsn.mode & GCN_FLAT_ADST) == 0)
     {
         vdstUsed = true;
-        decodeGCNVRegOperand(insnCode2>>24, dstRegsNum, bufPtr);
+        decodeGCNVRegOperand(f.vdst, f.dstRegsNum, bufPtr);
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
-        decodeGCNVRegOperand(insnCode2&0xff, 2, bufPtr); // addr
+        decodeGCNVRegOperand(f.vaddr, 2, bufPtr); // addr
     }
     else
     {   /* two vregs, because 64-bitness stored in PTR32 mode (at runtime) */
-        decodeGCNVRegOperand(insnCode2&0xff, 2, bufPtr); // addr
+        decodeGCNVRegOperand(f.vaddr, 2, bufPtr); // addr
         if ((gcnInsn.mode & GCN_FLAT_NODST) == 0)
         {
             vdstUsed = true;
             *bufPtr++ = ',';
             *bufPtr++ = ' ';
-            decodeGCNVRegOperand(insnCode2>>24, dstRegsNum, bufPtr);
+            decodeGCNVRegOperand(f.vdst, f.dstRegsNum, bufPtr);
         }
     }
     
@@ -2400,33 +2723,563 @@ void GCNDisasmUtils::decodeFLATEncoding(GCNDisassembler& dasm ,cxuint spacesToAd
         vdataUsed = true;
         *bufPtr++ = ',';
         *bufPtr++ = ' ';
-        decodeGCNVRegOperand((insnCode2>>8)&0xff, dregsNum, bufPtr);
+        decodeGCNVRegOperand(f.vdata, f.dregsNum, bufPtr);
     }
     
-    if (insnCode & 0x10000U)
+    if (f.flags & GCNREC_GLC)
         putChars(bufPtr, " glc", 4);
-    if (insnCode & 0x20000U)
+    if (f.flags & GCNREC_SLC)
         putChars(bufPtr, " slc", 4);
-    if (insnCode2 & 0x800000U)
+    if (f.flags & GCNREC_TFE)
         putChars(bufPtr, " tfe", 4);
     
     // print value, if some are not used, but values is not default
-    if (!vdataUsed && ((insnCode2>>8)&0xff) != 0)
+    if (!vdataUsed && f.vdata != 0)
     {
         putChars(bufPtr, " vdata=", 7);
-        bufPtr += itocstrCStyle((insnCode2>>8)&0xff, bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.vdata, bufPtr, 6, 16);
     }
-    if (!vdstUsed && (insnCode2>>24) != 0)
+    if (!vdstUsed && f.vdst != 0)
     {
         putChars(bufPtr, " vdst=", 6);
-        bufPtr += itocstrCStyle(insnCode2>>24, bufPtr, 6, 16);
+        bufPtr += itocstrCStyle(f.vdst, bufPtr, 6, 16);
     }
     output.forward(bufPtr-bufStart);
 }
 
+/* find instruction in table by encoding and opcode. returns null if instruction
+ * is illegal for current architecture. tableEncoding receives encoding of
+ * table entry (used while decoding illegal instructions) */
+static const GCNInstruction* findGCNInstruction(cxbyte gcnEncoding, cxuint opcode,
+            bool isGCN12, uint16_t curArchMask, cxbyte& tableEncoding)
+{
+    const GCNEncodingSpace& encSpace = 
+        (isGCN12) ? gcnInstrTableByCodeSpaces[GCNENC_MAXVAL+3 + gcnEncoding] :
+          gcnInstrTableByCodeSpaces[gcnEncoding];
+    const GCNInstruction* gcnInsn = gcnInstrTableByCode.get() + encSpace.offset + opcode;
+    tableEncoding = gcnInsn->encoding;
+    if (!isGCN12 && gcnInsn->mnemonic != nullptr &&
+        (curArchMask & gcnInsn->archMask) == 0 && gcnEncoding == GCNENC_VOP3A)
+    {    /* new overrides */
+        const GCNEncodingSpace& encSpace2 = gcnInstrTableByCodeSpaces[GCNENC_MAXVAL+1];
+        gcnInsn = gcnInstrTableByCode.get() + encSpace2.offset + opcode;
+    }
+    if (gcnInsn->mnemonic == nullptr || (curArchMask & gcnInsn->archMask) == 0)
+        return nullptr; // illegal
+    return gcnInsn;
+}
+
+/*
+ * decoding instructions to records
+ */
+
+/* add operand from operand space (0-255 - scalar operands, 256-511 - VGPRs) */
+static void addGCNRecOperand(GCNInstrRecord& record, cxuint code, cxuint regsNum,
+            uint32_t literal = 0, cxbyte modifiers = 0)
+{
+    GCNOperand& operand = record.operands[record.operandsNum++];
+    if (code < 128 || (code >= 251 && code < 255) || code >= 256)
+        operand.kind = GCNOP_REG;
+    else if (code == 255)
+        operand.kind = GCNOP_LITERAL;
+    else
+        operand.kind = GCNOP_INLINE;
+    operand.regsNum = regsNum;
+    operand.modifiers = modifiers;
+    operand.code = code;
+    operand.value = (code == 255) ? literal : 0;
+}
+
+static inline void addGCNRecVReg(GCNInstrRecord& record, cxuint vreg, cxuint regsNum,
+            cxbyte modifiers = 0)
+{ addGCNRecOperand(record, vreg+256, regsNum, 0, modifiers); }
+
+static void addGCNRecImm(GCNInstrRecord& record, uint32_t value,
+            cxbyte kind = GCNOP_IMM)
+{
+    GCNOperand& operand = record.operands[record.operandsNum++];
+    operand.kind = kind;
+    operand.regsNum = 0;
+    operand.modifiers = 0;
+    operand.code = 0;
+    operand.value = value;
+}
+
+static void decodeSOPRecord(GCNInstrRecord& record, const GCNInstruction& gcnInsn,
+            uint32_t insnCode, uint32_t literal)
+{
+    const uint16_t mode = gcnInsn.mode;
+    const uint16_t mode1 = (mode & GCN_MASK1);
+    const GCNSOPFields f = getGCNSOPFields(mode, insnCode);
+    switch(record.encoding)
+    {
+        case GCNENC_SOPC:
+            addGCNRecOperand(record, f.ssrc0, f.s0regsNum, literal);
+            if ((mode & GCN_SRC1_IMM) != 0)
+                addGCNRecImm(record, f.ssrc1);
+            else
+                addGCNRecOperand(record, f.ssrc1, f.s1regsNum, literal);
+            break;
+        case GCNENC_SOPP:
+            if (mode1 != GCN_IMM_NONE || f.imm16 != 0)
+                addGCNRecImm(record, f.imm16);
+            break;
+        case GCNENC_SOP1:
+            if (mode1 != GCN_DST_NONE)
+                addGCNRecOperand(record, f.sdst, f.dregsNum);
+            if (mode1 != GCN_SRC_NONE)
+                addGCNRecOperand(record, f.ssrc0, f.s0regsNum, literal);
+            break;
+        case GCNENC_SOP2:
+            if (mode1 != GCN_DST_NONE)
+                addGCNRecOperand(record, f.sdst, f.dregsNum);
+            addGCNRecOperand(record, f.ssrc0, f.s0regsNum, literal);
+            addGCNRecOperand(record, f.ssrc1, f.s1regsNum, literal);
+            break;
+        case GCNENC_SOPK:
+            if ((mode & GCN_IMM_DST) == 0)
+                addGCNRecOperand(record, f.sdst, f.dregsNum);
+            addGCNRecImm(record, f.imm16);
+            if ((mode & GCN_IMM_DST) != 0)
+            {
+                if ((mode & GCN_SOPK_CONST) != 0)
+                    addGCNRecImm(record, literal, GCNOP_LITERAL);
+                else
+                    addGCNRecOperand(record, f.sdst, f.dregsNum);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void decodeSMRDRecord(GCNInstrRecord& record, bool isGCN12,
+            const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t insnCode2)
+{
+    const uint16_t mode1 = (gcnInsn.mode & GCN_MASK1);
+    const GCNSMEMFields f = getGCNSMEMFields(isGCN12, gcnInsn.mode, insnCode, insnCode2);
+    if (mode1 == GCN_SMRD_ONLYDST)
+        addGCNRecOperand(record, f.sdst, f.dregsNum);
+    else if (mode1 != GCN_ARG_NONE)
+    {
+        if (isGCN12 && (mode1 & GCN_SMEM_SDATA_IMM))
+            addGCNRecImm(record, f.sdst);
+        else
+            addGCNRecOperand(record, f.sdst, f.dregsNum);
+        addGCNRecOperand(record, f.sbase, f.sbaseRegsNum);
+        if (f.immOffset) // immediate value
+            addGCNRecImm(record, f.offset);
+        else
+            addGCNRecOperand(record, f.offset, 1);
+    }
+    record.flags |= f.flags;
+}
+
+static void decodeVOPRecord(GCNInstrRecord& record, bool isGCN12,
+            const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t literal)
+{
+    const uint16_t mode = gcnInsn.mode;
+    const uint16_t mode1 = (mode & GCN_MASK1);
+    const GCNVOPFields f = getGCNVOPFields(isGCN12, mode, insnCode, literal);
+    const VOPExtraWordOut& extraFlags = f.extra;
+    record.flags |= f.flags;
+    if ((f.flags & (GCNREC_SDWA|GCNREC_DPP)) != 0)
+        record.extra = literal;
+    const cxbyte src0Mods = (extraFlags.absSrc0 ? GCNOPMOD_ABS : 0) |
+            (extraFlags.negSrc0 ? GCNOPMOD_NEG : 0) |
+            (extraFlags.sextSrc0 ? GCNOPMOD_SEXT : 0);
+    const cxbyte src1Mods = (extraFlags.absSrc1 ? GCNOPMOD_ABS : 0) |
+            (extraFlags.negSrc1 ? GCNOPMOD_NEG : 0) |
+            (extraFlags.sextSrc1 ? GCNOPMOD_SEXT : 0);
+    
+    if (record.encoding == GCNENC_VOPC)
+    {
+        addGCNRecOperand(record, 106, 2); // vcc
+        addGCNRecOperand(record, extraFlags.src0, f.s0regsNum, literal, src0Mods);
+        addGCNRecVReg(record, f.vsrc1, f.s1regsNum, src1Mods);
+    }
+    else if (record.encoding == GCNENC_VOP1)
+    {
+        if (mode1 != GCN_VOP_ARG_NONE)
+        {
+            if (mode1 != GCN_DST_SGPR)
+                addGCNRecVReg(record, f.vdst, f.dregsNum);
+            else
+                addGCNRecOperand(record, f.vdst, f.dregsNum);
+            addGCNRecOperand(record, extraFlags.src0, f.s0regsNum, literal, src0Mods);
+        }
+    }
+    else
+    {   // VOP2
+        if (mode1 != GCN_DS1_SGPR)
+            addGCNRecVReg(record, f.vdst, f.dregsNum);
+        else
+            addGCNRecOperand(record, f.vdst, f.dregsNum);
+        if (mode1 == GCN_DS2_VCC || mode1 == GCN_DST_VCC)
+            addGCNRecOperand(record, 106, 2); // vcc
+        addGCNRecOperand(record, extraFlags.src0, f.s0regsNum, literal, src0Mods);
+        if (mode1 == GCN_ARG1_IMM)
+            addGCNRecImm(record, literal, GCNOP_LITERAL);
+        if (mode1 == GCN_DS1_SGPR || mode1 == GCN_SRC1_SGPR)
+            addGCNRecOperand(record, f.vsrc1, f.s1regsNum, 0, src1Mods);
+        else
+            addGCNRecVReg(record, f.vsrc1, f.s1regsNum, src1Mods);
+        if (mode1 == GCN_ARG2_IMM)
+            addGCNRecImm(record, literal, GCNOP_LITERAL);
+        else if (mode1 == GCN_DS2_VCC || mode1 == GCN_SRC2_VCC)
+            addGCNRecOperand(record, 106, 2); // vcc
+    }
+}
+
+static void decodeVOP3Record(GCNInstrRecord& record, bool isGCN12,
+            const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t insnCode2)
+{
+    const uint16_t mode = gcnInsn.mode;
+    const uint16_t mode1 = (mode & GCN_MASK1);
+    const uint16_t vop3Mode = (mode & GCN_VOP3_MASK2);
+    const GCNVOP3Fields f = getGCNVOP3Fields(isGCN12, gcnInsn, insnCode, insnCode2);
+    cxbyte srcMods[3];
+    for (cxuint k = 0; k < 3; k++)
+        srcMods[k] = (((f.absFlags>>k)&1) ? GCNOPMOD_ABS : 0) |
+                (((f.negFlags>>k)&1) ? GCNOPMOD_NEG : 0);
+    
+    if (mode1 != GCN_VOP_ARG_NONE)
+    {
+        if (f.dstSGPR) /* if compares */
+            addGCNRecOperand(record, f.vdst, f.dregsNum);
+        else
+            addGCNRecVReg(record, f.vdst, f.dregsNum);
+        if (f.useSdst) /* VOP3b */
+            addGCNRecOperand(record, f.sdst, 2);
+        
+        if (vop3Mode == GCN_VOP3_VINTRP)
+        {
+            if (mode1 == GCN_P0_P10_P20)
+                addGCNRecImm(record, f.vsrc1);
+            else
+                addGCNRecOperand(record, f.vsrc1, f.s1regsNum, 0, srcMods[1]);
+            // attribute: (attr<<2) | channel
+            addGCNRecImm(record, ((f.vsrc0&63)<<2) | ((f.vsrc0>>6)&3));
+            if (f.useVsrc2)
+                addGCNRecOperand(record, f.vsrc2, f.s2regsNum, 0, srcMods[2]);
+            if (f.vsrc0 & 0x100)
+                record.flags |= GCNREC_HIGH;
+        }
+        else
+        {
+            addGCNRecOperand(record, f.vsrc0, f.s0regsNum, 0, srcMods[0]);
+            if (mode1 != GCN_SRC12_NONE)
+            {
+                addGCNRecOperand(record, f.vsrc1, f.s1regsNum, 0, srcMods[1]);
+                if (f.useVsrc2)
+                    addGCNRecOperand(record, f.vsrc2, f.s2regsNum, 0,
+                            f.vsrc2CC ? 0 : srcMods[2]);
+            }
+        }
+    }
+    record.omod = f.omod;
+    if (f.clamp)
+        record.flags |= GCNREC_CLAMP;
+}
+
+static void decodeDSRecord(GCNInstrRecord& record, bool isGCN12,
+            const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t insnCode2)
+{
+    const GCNDSFields f = getGCNDSFields(isGCN12, gcnInsn.mode, insnCode, insnCode2);
+    if (f.useVdst)  /* vdst is dst */
+        addGCNRecVReg(record, f.vdst, f.dstRegsNum);
+    if (f.useVaddr)
+        addGCNRecVReg(record, f.vaddr, 1);
+    if (f.useVdata0)
+    {   /* vdata */
+        addGCNRecVReg(record, f.vdata0, f.data0RegsNum);
+        if (f.useVdata1)
+            addGCNRecVReg(record, f.vdata1, f.data1RegsNum);
+    }
+    record.memOffset = f.offset;
+    record.flags |= f.flags;
+}
+
+static void decodeMUBUFRecord(GCNInstrRecord& record, bool isGCN12,
+            const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t insnCode2)
+{
+    const uint16_t mode1 = (gcnInsn.mode & GCN_MASK1);
+    const GCNMUBUFFields f = getGCNMUBUFFields(isGCN12, gcnInsn, insnCode, insnCode2);
+    if (mode1 != GCN_ARG_NONE)
+    {
+        if (mode1 != GCN_MUBUF_NOVAD)
+        {
+            addGCNRecVReg(record, f.vdata, f.dregsNum);
+            addGCNRecVReg(record, f.vaddr, f.aregsNum);
+        }
+        addGCNRecOperand(record, f.srsrc, 4);
+        addGCNRecOperand(record, f.soffset, 1);
+    }
+    record.memOffset = f.offset;
+    record.flags |= f.flags;
+    record.dfmt = f.dfmt;
+    record.nfmt = f.nfmt;
+}
+
+static void decodeMIMGRecord(GCNInstrRecord& record, bool isGCN12,
+            const GCNInstruction& gcnInsn, uint32_t insnCode, uint32_t insnCode2)
+{
+    const GCNMIMGFields f = getGCNMIMGFields(isGCN12, gcnInsn.mode, insnCode, insnCode2);
+    addGCNRecVReg(record, f.vdata, f.dregsNum);
+    addGCNRecVReg(record, f.vaddr, f.aregsNum);
+    addGCNRecOperand(record, f.srsrc, f.srsrcRegsNum);
+    if ((gcnInsn.mode & GCN_MIMG_SAMPLE) != 0)
+        addGCNRecOperand(record, f.ssamp, 4);
+    record.dmask = f.dmask;
+    record.flags |= f.flags;
+}
+
+static void decodeEXPRecord(GCNInstrRecord& record, uint32_t insnCode,
+            uint32_t insnCode2)
+{
+    const GCNEXPFields f = getGCNEXPFields(insnCode, insnCode2);
+    addGCNRecImm(record, f.target);
+    for (cxuint i = 0; i < 4; i++)
+        if ((f.enMask & (1U<<i)) != 0)
+            addGCNRecVReg(record, f.vsrcs[i], 1);
+        else // off
+            addGCNRecImm(record, 0, GCNOP_NONE);
+    record.flags |= f.flags;
+}
+
+static void decodeFLATRecord(GCNInstrRecord& record, const GCNInstruction& gcnInsn,
+            uint32_t insnCode, uint32_t insnCode2)
+{
+    const GCNFLATFields f = getGCNFLATFields(gcnInsn.mode, insnCode, insnCode2);
+    if ((gcnInsn.mode & GCN_FLAT_ADST) == 0)
+    {
+        addGCNRecVReg(record, f.vdst, f.dstRegsNum);
+        addGCNRecVReg(record, f.vaddr, 2); // addr
+    }
+    else
+    {
+        addGCNRecVReg(record, f.vaddr, 2); // addr
+        if ((gcnInsn.mode & GCN_FLAT_NODST) == 0)
+            addGCNRecVReg(record, f.vdst, f.dstRegsNum);
+    }
+    if ((gcnInsn.mode & GCN_FLAT_NODATA) == 0)
+        addGCNRecVReg(record, f.vdata, f.dregsNum);
+    record.flags |= f.flags;
+}
+
+void GCNDisassembler::decodeInstr(size_t i, GCNInstrRecord& record) const
+{
+    const uint32_t* codeWords = reinterpret_cast<const uint32_t*>(input);
+    const size_t codeWordsNum = (inputSize>>2);
+    const GPUArchitecture arch = getGPUArchitectureFromDeviceType(
+                disassembler.getDeviceType());
+    const bool isGCN12 = (arch == GPUArchitecture::GCN1_2);
+    const uint16_t curArchMask = 1U<<int(arch);
+    
+    const size_t pos = instrIndex.offsets[i]>>2;
+    const uint32_t insnCode = ULEV(codeWords[pos]);
+    uint32_t insnCode2 = 0;
+    if (instrIndex.sizes[i] > 4 && pos+1 < codeWordsNum)
+        insnCode2 = ULEV(codeWords[pos+1]);
+    
+    record.offset = instrIndex.getOffset(i);
+    record.mnemonic = nullptr;
+    record.encoding = instrIndex.encodings[i];
+    record.opcode = instrIndex.opcodes[i];
+    record.size = instrIndex.sizes[i];
+    record.operandsNum = 0;
+    record.flags = 0;
+    record.memOffset = 0;
+    record.extra = 0;
+    record.omod = 0;
+    record.dmask = 0;
+    record.dfmt = 0;
+    record.nfmt = 0;
+    record.branchTarget = instrIndex.getBranchTarget(i);
+    if (record.encoding == GCNENC_NONE || insnCode == 0)
+        return; // invalid encoding or zero word (no instruction)
+    
+    cxbyte tableEncoding;
+    const GCNInstruction* gcnInsn = findGCNInstruction(record.encoding, record.opcode,
+                isGCN12, curArchMask, tableEncoding);
+    if (gcnInsn == nullptr)
+        return; // illegal
+    record.mnemonic = gcnInsn->mnemonic;
+    switch(record.encoding)
+    {
+        case GCNENC_SOPC:
+        case GCNENC_SOPP:
+        case GCNENC_SOP1:
+        case GCNENC_SOP2:
+        case GCNENC_SOPK:
+            decodeSOPRecord(record, *gcnInsn, insnCode, insnCode2);
+            break;
+        case GCNENC_SMRD:
+            decodeSMRDRecord(record, isGCN12, *gcnInsn, insnCode, insnCode2);
+            break;
+        case GCNENC_VOPC:
+        case GCNENC_VOP1:
+        case GCNENC_VOP2:
+            decodeVOPRecord(record, isGCN12, *gcnInsn, insnCode, insnCode2);
+            break;
+        case GCNENC_VOP3A:
+            record.encoding = gcnInsn->encoding;
+            decodeVOP3Record(record, isGCN12, *gcnInsn, insnCode, insnCode2);
+            break;
+        case GCNENC_VINTRP:
+            addGCNRecVReg(record, (insnCode>>18)&0xff, 1);
+            if ((gcnInsn->mode & GCN_MASK1) == GCN_P0_P10_P20)
+                addGCNRecImm(record, insnCode&0xff);
+            else
+                addGCNRecVReg(record, insnCode&0xff, 1);
+            // attribute: (attr<<2) | channel
+            addGCNRecImm(record, (((insnCode>>10)&63)<<2) | ((insnCode>>8)&3));
+            break;
+        case GCNENC_DS:
+            decodeDSRecord(record, isGCN12, *gcnInsn, insnCode, insnCode2);
+            break;
+        case GCNENC_MUBUF:
+        case GCNENC_MTBUF:
+            decodeMUBUFRecord(record, isGCN12, *gcnInsn, insnCode, insnCode2);
+            break;
+        case GCNENC_MIMG:
+            decodeMIMGRecord(record, isGCN12, *gcnInsn, insnCode, insnCode2);
+            break;
+        case GCNENC_EXP:
+            decodeEXPRecord(record, insnCode, insnCode2);
+            break;
+        case GCNENC_FLAT:
+            decodeFLATRecord(record, *gcnInsn, insnCode, insnCode2);
+            break;
+        default:
+            break;
+    }
+}
+
+void GCNDisassembler::decodeInstrs(
+            const std::function<void(const GCNInstrRecord&)>& visitor)
+{
+    if (indexInput != input || indexInputSize != inputSize ||
+        instrIndex.startOffset != startOffset)
+        buildInstrIndex();
+    GCNInstrRecord record;
+    for (size_t i = 0; i < instrIndex.size(); i++)
+    {
+        decodeInstr(i, record);
+        visitor(record);
+    }
+}
+
+/* decode code chunks in parallel threads. chunks are decoded in batches,
+ * every chunk by own GCN disassembler to own buffer. buffers are written in order */
+void GCNDisassembler::disassembleInChunks(const std::vector<size_t>& chunkFirsts)
+{
+    const size_t codeWordsNum = (inputSize>>2);
+    const size_t chunksNum = chunkFirsts.size();
+    const cxuint threadsNum = disassembler.getThreadsNum();
+    const size_t batchSize = size_t(threadsNum)*4;
+    std::vector<std::string> chunkOutputs(std::min(batchSize, chunksNum));
+    for (size_t batchStart = 0; batchStart < chunksNum; batchStart += batchSize)
+    {
+        const size_t batchEnd = std::min(batchStart + batchSize, chunksNum);
+        runInParallel(threadsNum, batchEnd - batchStart, [&](size_t k)
+        {
+            const size_t i = batchStart + k;
+            const bool lastChunk = (i+1 == chunksNum);
+            const size_t firstInstr = chunkFirsts[i];
+            const size_t lastInstr = (!lastChunk) ? chunkFirsts[i+1] : instrIndex.size();
+            const size_t chunkOffset = instrIndex.getOffset(firstInstr);
+            const size_t chunkEndOffset = (!lastChunk) ?
+                        instrIndex.getOffset(lastInstr) : startOffset + (codeWordsNum<<2);
+            // labels at chunk start are written by previous chunk (at its end)
+            const size_t labelStart = (i!=0) ? chunkOffset+1 : labelStartOffset;
+            const size_t labelEnd = (!lastChunk) ? chunkEndOffset : SIZE_MAX;
+            
+            std::ostringstream chunkOutput;
+            chunkOutput.exceptions(std::ios::failbit | std::ios::badbit);
+            GCNDisassembler chunkDisasm(disassembler, chunkOutput);
+            chunkDisasm.setSectionIndex(sectionIndex);
+            chunkDisasm.setInput(chunkEndOffset-chunkOffset,
+                        input + (chunkOffset-startOffset), chunkOffset, labelStart);
+            chunkDisasm.setDontPrintLabels(!lastChunk || dontPrintLabelsAfterCode);
+            /* copy labels and relocations of this chunk.
+             * all named labels are needed to print branch targets */
+            auto relocLess = [](const std::pair<size_t,Relocation>& a,
+                       const std::pair<size_t, Relocation>& b)
+                    { return a.first < b.first; };
+            chunkDisasm.labels.assign(
+                std::lower_bound(labels.begin(), labels.end(), labelStart),
+                std::upper_bound(labels.begin(), labels.end(), labelEnd));
+            chunkDisasm.namedLabels = namedLabels;
+            chunkDisasm.relocations.assign(
+                std::lower_bound(relocations.begin(), relocations.end(),
+                    std::make_pair(chunkOffset, Relocation()), relocLess),
+                (!lastChunk) ? std::lower_bound(relocations.begin(), relocations.end(),
+                    std::make_pair(chunkEndOffset, Relocation()), relocLess) :
+                    relocations.end());
+            chunkDisasm.relSymbols = relSymbols;
+            // decode instructions of chunk from index of this disassembler
+            chunkDisasm.disassembleInstrs(instrIndex, firstInstr, lastInstr);
+            chunkDisasm.flushOutput();
+            chunkOutputs[k] = chunkOutput.str();
+        });
+        for (size_t k = 0; k < batchEnd - batchStart; k++)
+        {
+            output.write(chunkOutputs[k].size(), chunkOutputs[k].c_str());
+            chunkOutputs[k].clear();
+        }
+    }
+}
+
 /* main routine */
 
 void GCNDisassembler::disassemble()
+{
+    // index built while analyzing can be used only for same code
+    if (indexInput != input || indexInputSize != inputSize ||
+        instrIndex.startOffset != startOffset)
+        buildInstrIndex();
+    indexInput = nullptr; // index will be rebuilt at next disassemblying
+    
+    const size_t codeWordsNum = (inputSize>>2);
+    if ((inputSize&3) != 0)
+        output.write(64,
+           "        /* WARNING: Code size is not aligned to 4-byte word! */\n");
+    if (instrOutOfCode)
+        output.write(54, "        /* WARNING: Unfinished instruction at end! */\n");
+    
+    const size_t chunkWords = (decodeChunkSize+3)>>2;
+    if (chunkWords != 0 && disassembler.getThreadsNum() > 1 && codeWordsNum > chunkWords)
+    {   /* split code to chunks. every chunk begins at instruction
+         * and it does not break sequence of zeroes (printed as single .fill) */
+        const uint32_t* codeWords = reinterpret_cast<const uint32_t*>(input);
+        std::vector<size_t> chunkFirsts(1, 0);
+        auto it = instrIndex.offsets.begin();
+        while (true)
+        {
+            it = std::lower_bound(it, instrIndex.offsets.end(),
+                    instrIndex.offsets[chunkFirsts.back()] + uint32_t(chunkWords<<2));
+            while (it != instrIndex.offsets.end() && codeWords[*it>>2] == 0)
+                ++it;
+            if (it == instrIndex.offsets.end())
+                break;
+            chunkFirsts.push_back(it - instrIndex.offsets.begin());
+        }
+        if (chunkFirsts.size() > 1)
+            disassembleInChunks(chunkFirsts);
+        else
+            disassembleInstrs(instrIndex, 0, instrIndex.size());
+    }
+    else
+        disassembleInstrs(instrIndex, 0, instrIndex.size());
+    output.flush();
+    output.getOStream().flush();
+}
+
+/* decode instructions from index (from first to last) and labels placed
+ * between them. instruction offsets from index must be in this input code */
+void GCNDisassembler::disassembleInstrs(const GCNInstrIndex& index, size_t first,
+                size_t last)
 {
     LabelIter curLabel = std::lower_bound(labels.begin(), labels.end(), labelStartOffset);
     RelocIter curReloc = std::lower_bound(relocations.begin(), relocations.end(),
@@ -2442,35 +3295,30 @@ void GCNDisassembler::disassemble()
 
     const GPUArchitecture arch = getGPUArchitectureFromDeviceType(
                 disassembler.getDeviceType());
-    const bool isGCN11 = (arch == GPUArchitecture::GCN1_1);
     const bool isGCN12 = (arch == GPUArchitecture::GCN1_2);
     const uint16_t curArchMask = 
             1U<<int(getGPUArchitectureFromDeviceType(disassembler.getDeviceType()));
     const size_t codeWordsNum = (inputSize>>2);
     
-    if ((inputSize&3) != 0)
-        output.write(64,
-           "        /* WARNING: Code size is not aligned to 4-byte word! */\n");
-    if (instrOutOfCode)
-        output.write(54, "        /* WARNING: Unfinished instruction at end! */\n");
-    
     bool prevIsTwoWord = false;
     
-    size_t pos = 0;
+    size_t i = first;
     while (true)
     {
-        writeLabelsToPosition(pos<<2, curLabel, curNamedLabel);
-        if (pos >= codeWordsNum)
+        const size_t oldPos = (i < last) ? (index.getOffset(i)-startOffset)>>2 :
+                    codeWordsNum;
+        writeLabelsToPosition(oldPos<<2, curLabel, curNamedLabel);
+        if (i >= last)
             break;
         
-        const size_t oldPos = pos;
-        cxbyte gcnEncoding = GCNENC_NONE;
-        const uint32_t insnCode = ULEV(codeWords[pos++]);
+        size_t pos = oldPos+1;
+        const uint32_t insnCode = ULEV(codeWords[oldPos]);
         if (insnCode == 0)
         {   /* fix for GalliumCOmpute disassemblying (assembler doesn't accep 
              * with two scalar operands */
             size_t count;
-            for (count = 1; pos < codeWordsNum && codeWords[pos]==0; count++, pos++);
+            for (count = 1, i++; i < last &&
+                        codeWords[(index.getOffset(i)-startOffset)>>2]==0; count++, i++);
             // put to output
             char* buf = output.reserve(40);
             size_t bufPos = 0;
@@ -2482,121 +3330,12 @@ void GCNDisassembler::disassemble()
             output.forward(bufPos);
             continue;
         }
+        const cxbyte gcnEncoding = index.encodings[i];
+        const cxuint opcode = index.opcodes[i];
         uint32_t insnCode2 = 0;
-        
-        
-        /* determine GCN encoding */
-        if ((insnCode & 0x80000000U) != 0)
-        {
-            if ((insnCode & 0x40000000U) == 0)
-            {   // SOP???
-                if  ((insnCode & 0x30000000U) == 0x30000000U)
-                {   // SOP1/SOPK/SOPC/SOPP
-                    const uint32_t encPart = (insnCode & 0x0f800000U);
-                    if (encPart == 0x0e800000U)
-                    {   // SOP1
-                        if ((insnCode&0xff) == 0xff) // literal
-                        {
-                            if (pos < codeWordsNum)
-                                insnCode2 = ULEV(codeWords[pos++]);
-                        }
-                        gcnEncoding = GCNENC_SOP1;
-                    }
-                    else if (encPart == 0x0f000000U)
-                    {   // SOPC
-                        if ((insnCode&0xff) == 0xff ||
-                            (insnCode&0xff00) == 0xff00) // literal
-                        {
-                            if (pos < codeWordsNum)
-                                insnCode2 = ULEV(codeWords[pos++]);
-                        }
-                        gcnEncoding = GCNENC_SOPC;
-                    }
-                    else if (encPart == 0x0f800000U) // SOPP
-                        gcnEncoding = GCNENC_SOPP;
-                    else // SOPK
-                    {
-                        gcnEncoding = GCNENC_SOPK;
-                        const uint32_t opcode = ((insnCode>>23)&0x1f);
-                        if ((!isGCN12 && opcode == 21) ||
-                            (isGCN12 && opcode == 20))
-                        {
-                            if (pos < codeWordsNum)
-                                insnCode2 = ULEV(codeWords[pos++]);
-                        }
-                    }
-                }
-                else
-                {   // SOP2
-                    if ((insnCode&0xff) == 0xff || (insnCode&0xff00) == 0xff00)
-                    {   // literal
-                        if (pos < codeWordsNum)
-                            insnCode2 = ULEV(codeWords[pos++]);
-                    }
-                    gcnEncoding = GCNENC_SOP2;
-                }
-            }
-            else
-            {   // SMRD and others
-                const uint32_t encPart = (insnCode&0x3c000000U)>>26;
-                if ((!isGCN12 && gcnSize11Table[encPart] && (encPart != 7 || isGCN11)) ||
-                    (isGCN12 && gcnSize12Table[encPart]))
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                if (isGCN12)
-                    gcnEncoding = gcnEncoding12Table[encPart];
-                else
-                    gcnEncoding = gcnEncoding11Table[encPart];
-                if (gcnEncoding == GCNENC_FLAT && !isGCN11 && !isGCN12)
-                    gcnEncoding = GCNENC_NONE; // illegal if not GCN1.1
-            }
-        }
-        else
-        {   // some vector instructions
-            if ((insnCode & 0x7e000000U) == 0x7c000000U)
-            {   // VOPC
-                if ((insnCode&0x1ff) == 0xff || // literal
-                    // SDWA, DDP
-                    (isGCN12 && ((insnCode&0x1ff) == 0xf9 || (insnCode&0x1ff) == 0xfa)))
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                gcnEncoding = GCNENC_VOPC;
-            }
-            else if ((insnCode & 0x7e000000U) == 0x7e000000U)
-            {   // VOP1
-                if ((insnCode&0x1ff) == 0xff || // literal
-                    // SDWA, DDP
-                    (isGCN12 && ((insnCode&0x1ff) == 0xf9 || (insnCode&0x1ff) == 0xfa)))
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                gcnEncoding = GCNENC_VOP1;
-            }
-            else
-            {   // VOP2
-                const cxuint opcode = (insnCode >> 25)&0x3f;
-                if ((!isGCN12 && (opcode == 32 || opcode == 33)) ||
-                    (isGCN12 && (opcode == 23 || opcode == 24 ||
-                    opcode == 36 || opcode == 37))) // V_MADMK and V_MADAK
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                else if ((insnCode&0x1ff) == 0xff || // literal
-                    // SDWA, DDP
-                    (isGCN12 && ((insnCode&0x1ff) == 0xf9 || (insnCode&0x1ff) == 0xfa)))
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                gcnEncoding = GCNENC_VOP2;
-            }
-        }
+        if (index.sizes[i] > 4 && pos < codeWordsNum)
+            insnCode2 = ULEV(codeWords[pos++]);
+        i++;
         
         prevIsTwoWord = (oldPos+2 == pos);
         
@@ -2637,39 +3376,15 @@ void GCNDisassembler::disassemble()
         }
         else
         {
-            const GCNEncodingOpcodeBits* encodingOpcodeTable = 
-                    (isGCN12) ? gcnEncodingOpcode12Table : gcnEncodingOpcodeTable;
-            const cxuint opcode =
-                    (insnCode>>encodingOpcodeTable[gcnEncoding].bitPos) & 
-                    ((1U<<encodingOpcodeTable[gcnEncoding].bits)-1U);
-            
             /* decode instruction and put to output */
-            const GCNEncodingSpace& encSpace = 
-                (isGCN12) ? gcnInstrTableByCodeSpaces[GCNENC_MAXVAL+3 + gcnEncoding] :
-                  gcnInstrTableByCodeSpaces[gcnEncoding];
-            const GCNInstruction* gcnInsn = gcnInstrTableByCode.get() +
-                    encSpace.offset + opcode;
+            cxbyte tableEncoding;
+            const GCNInstruction* gcnInsn = findGCNInstruction(gcnEncoding, opcode,
+                        isGCN12, curArchMask, tableEncoding);
             
-            const GCNInstruction defaultInsn = { nullptr, gcnInsn->encoding, GCN_STDMODE,
+            const GCNInstruction defaultInsn = { nullptr, tableEncoding, GCN_STDMODE,
                         0, 0 };
             cxuint spacesToAdd = 16;
-            bool isIllegal = false;
-            if (!isGCN12 && gcnInsn->mnemonic != nullptr &&
-                (curArchMask & gcnInsn->archMask) == 0 &&
-                gcnEncoding == GCNENC_VOP3A)
-            {    /* new overrides */
-                const GCNEncodingSpace& encSpace2 =
-                        gcnInstrTableByCodeSpaces[GCNENC_MAXVAL+1];
-                gcnInsn = gcnInstrTableByCode.get() + encSpace2.offset + opcode;
-                if (gcnInsn->mnemonic == nullptr ||
-                        (curArchMask & gcnInsn->archMask) == 0)
-                    isIllegal = true; // illegal
-            }
-            else if (gcnInsn->mnemonic == nullptr ||
-                (curArchMask & gcnInsn->archMask) == 0)
-                isIllegal = true;
-            
-            if (!isIllegal)
+            if (gcnInsn != nullptr)
             {
                 size_t k = ::strlen(gcnInsn->mnemonic);
                 output.writeString(gcnInsn->mnemonic);
@@ -2780,6 +3495,4 @@ void GCNDisassembler::disassemble()
     }
     if (!dontPrintLabelsAfterCode)
         writeLabelsToEnd(codeWordsNum<<2, curLabel, curNamedLabel);
-    output.flush();
-    disassembler.getOutput().flush();
 }
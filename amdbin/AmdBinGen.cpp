@@ -29,6 +29,7 @@
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <CLRX/utils/Containers.h>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/utils/MemAccess.h>
@@ -163,17 +164,20 @@ void AmdInput::addEmptyKernel(const char* kernelName)
     kernels.push_back(std::move(kernel));
 }
 
-AmdGPUBinGenerator::AmdGPUBinGenerator() : manageable(false), input(nullptr)
+AmdGPUBinGenerator::AmdGPUBinGenerator() : manageable(false), input(nullptr), threadsNum(1),
+        deduplication(false), dedupSavedSize(0)
 { }
 
 AmdGPUBinGenerator::AmdGPUBinGenerator(const AmdInput* amdInput)
-        : manageable(false), input(amdInput)
+        : manageable(false), input(amdInput), threadsNum(1), deduplication(false),
+        dedupSavedSize(0)
 { }
 
 AmdGPUBinGenerator::AmdGPUBinGenerator(bool _64bitMode, GPUDeviceType deviceType,
        uint32_t driverVersion, size_t globalDataSize, const cxbyte* globalData,
        const std::vector<AmdKernelInput>& kernelInputs)
-        : manageable(true), input(nullptr)
+        : manageable(true), input(nullptr), threadsNum(1), deduplication(false),
+        dedupSavedSize(0)
 {
     input = new AmdInput{_64bitMode, deviceType, globalDataSize, globalData,
                 driverVersion, "", "", kernelInputs };
@@ -182,7 +186,8 @@ AmdGPUBinGenerator::AmdGPUBinGenerator(bool _64bitMode, GPUDeviceType deviceType
 AmdGPUBinGenerator::AmdGPUBinGenerator(bool _64bitMode, GPUDeviceType deviceType,
        uint32_t driverVersion, size_t globalDataSize, const cxbyte* globalData,
        std::vector<AmdKernelInput>&& kernelInputs)
-        : manageable(true), input(nullptr)
+        : manageable(true), input(nullptr), threadsNum(1), deduplication(false),
+        dedupSavedSize(0)
 {
     input = new AmdInput{_64bitMode, deviceType, globalDataSize, globalData,
                 driverVersion, "", "", std::move(kernelInputs) };
@@ -379,6 +384,11 @@ struct CLRX_INTERNAL TempAmdKernelData
     ElfBinaryGen32 elfBinGen; // for kernel
     CALEncodingEntry calEncEntry;
     uint32_t header[8];
+    cxuint uniqueId;
+    cxuint argSamplersNum;
+    Array<cxbyte> innerBin; // inner binary generated before writing (if not empty)
+    size_t textOffset; // offset of inner binary in main text
+    bool duplicate; // inner binary is identical with inner binary of previous kernel
 };
 
 // fast and memory efficient String table generator for main binary
@@ -482,7 +492,6 @@ public:
             rodataPos += input->globalDataSize;
         }
         
-        size_t textPos = 0;
         for (size_t i = 0; i < input->kernels.size(); i++)
         {
             const AmdKernelInput& kernel = input->kernels[i];
@@ -502,12 +511,11 @@ public:
             SLEV(sym.st_name, nameOffset);
             SLEV(sym.st_shndx, 5);
             SLEV(sym.st_size, tempDatas[i].innerBinSize);
-            SLEV(sym.st_value, textPos);
+            SLEV(sym.st_value, tempDatas[i].textOffset);
             sym.st_info = ELF32_ST_INFO(STB_LOCAL, STT_FUNC);
             sym.st_other = 0;
             fob.writeObject(sym);
             nameOffset += kernel.kernelName.size() + 17;
-            textPos += tempDatas[i].innerBinSize;
             // kernel
             const size_t headerSize = (kernel.useConfig) ? 32 : kernel.headerSize;
             SLEV(sym.st_name, nameOffset);
@@ -578,7 +586,12 @@ public:
     void operator()(FastOutputBuffer& fob) const
     {
         for (TempAmdKernelData& kernel: tempDatas)
-            kernel.elfBinGen.generate(fob);
+            if (kernel.duplicate)
+                continue; // stored only once
+            else if (!kernel.innerBin.empty())
+                fob.writeArray(kernel.innerBin.size(), kernel.innerBin.data());
+            else
+                kernel.elfBinGen.generate(fob);
     }
 };
 
@@ -1556,6 +1569,11 @@ void AmdGPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>
     cxuint uniqueId = 1024;
     std::vector<cxuint> uniqueIds = collectUniqueIdsAndFunctionIds(input);
     
+    /* if parallel, then metadatas and inner binaries are generated by threads
+     * after preparing kernels. inner binaries are also generated before writing
+     * if they will be deduplicated */
+    const bool parallel = threadsNum > 1 && kernelsNum > 1;
+    const bool preGenerate = parallel || (deduplication && kernelsNum > 1);
     uint64_t allInnerBinSize = 0;
     size_t rodataSize = 0;
     for (size_t i = 0; i < kernelsNum; i++)
@@ -1611,15 +1629,19 @@ void AmdGPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>
             TempAmdKernelConfig& tempConfig = tempAmdKernelConfigs[i];
             tempConfig.uavsNum = uavsNum;
             
-            tempAmdKernelDatas[i].metadata = generateMetadata(driverVersion, input, kinput,
-                     tempConfig, argSamplersNum, uniqueId);
+            tempData.uniqueId = uniqueId;
+            tempData.argSamplersNum = argSamplersNum;
+            if (!parallel)
+                tempData.metadata = generateMetadata(driverVersion, input, kinput,
+                         tempConfig, argSamplersNum, uniqueId);
             
             calNotesSize = uint64_t(20*17) /*calNoteHeaders*/ + 16 + 128 + (18+32 +
                 4*((isOlderThan1124)?16:config.userDatas.size()))*8 /* proginfo */ +
                     readOnlyImages*4 /* inputs */ + 16*uavsNum /* uavs */ +
                     8*samplersNum /* samplers */ + 8*constBuffersNum /* cbids */;
             
-            metadataSize = tempData.metadata.size() + 32 /* header size */;
+            // size of metadata generated by threads will be added later
+            metadataSize = (!parallel) ? tempData.metadata.size() + 32 /* header */ : 0;
             
             tempData.header[0] = LEV((driverVersion >= 164205)?tempConfig.uavPrivate:0);
             tempData.header[1] = 0U;
@@ -1691,12 +1713,70 @@ void AmdGPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>
         const uint64_t innerBinSize = kelfBinGen.countSize();
         if (innerBinSize > UINT32_MAX)
             throw Exception("Inner binary size is too big!");
-        allInnerBinSize += tempAmdKernelDatas[i].innerBinSize = innerBinSize;
+        tempAmdKernelDatas[i].innerBinSize = innerBinSize;
         
         tempAmdKernelDatas[i].calEncEntry =
             { LEV(uint32_t(gpuDeviceInnerCodeTable[cxuint(input->deviceType)])), LEV(4U), 
                 LEV(0x1c0U), LEV(uint32_t(tempAmdKernelDatas[i].innerBinSize - 0x1c0U)) };
     }
+    if (preGenerate)
+    {
+        runInParallel(parallel ? threadsNum : 1, kernelsNum, [&](size_t i)
+        {
+            const AmdKernelInput& kinput = input->kernels[i];
+            TempAmdKernelData& tempData = tempAmdKernelDatas[i];
+            if (parallel && kinput.useConfig)
+                tempData.metadata = generateMetadata(driverVersion, input, kinput,
+                         tempAmdKernelConfigs[i], tempData.argSamplersNum,
+                         tempData.uniqueId);
+            // inner binary will be only copied to output
+            tempData.innerBin.resize(tempData.innerBinSize);
+            FastOutputBuffer fob(tempData.innerBin.size(),
+                        reinterpret_cast<char*>(tempData.innerBin.data()));
+            tempData.elfBinGen.generate(fob);
+        });
+        if (parallel)
+            for (size_t i = 0; i < kernelsNum; i++)
+                if (input->kernels[i].useConfig)
+                    rodataSize += tempAmdKernelDatas[i].metadata.size() + 32;
+    }
+    
+    /* put inner binaries into main text. if deduplication enabled, then
+     * inner binary identical with previous inner binary is not stored and
+     * kernel symbol points to previous copy */
+    dedupSavedSize = 0;
+    std::unordered_multimap<size_t, size_t> innerBinHashMap;
+    for (size_t i = 0; i < kernelsNum; i++)
+    {
+        TempAmdKernelData& tempData = tempAmdKernelDatas[i];
+        tempData.duplicate = false;
+        tempData.textOffset = allInnerBinSize;
+        if (preGenerate && deduplication)
+        {
+            const size_t hash = calculateDataHash(tempData.innerBin.size(),
+                        tempData.innerBin.data());
+            auto range = innerBinHashMap.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                const TempAmdKernelData& prevData = tempAmdKernelDatas[it->second];
+                if (prevData.innerBin.size() == tempData.innerBin.size() &&
+                    ::memcmp(prevData.innerBin.data(), tempData.innerBin.data(),
+                             tempData.innerBin.size()) == 0)
+                {   // found identical inner binary
+                    tempData.duplicate = true;
+                    tempData.textOffset = prevData.textOffset;
+                    break;
+                }
+            }
+            if (tempData.duplicate)
+            {
+                dedupSavedSize += tempData.innerBinSize;
+                continue;
+            }
+            innerBinHashMap.insert(std::make_pair(hash, i));
+        }
+        allInnerBinSize += tempData.innerBinSize;
+    }
     if (input->globalData!=nullptr)
         rodataSize += input->globalDataSize;
     
@@ -1728,29 +1808,18 @@ void AmdGPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>
     /****
      * prepare for write binary to output
      ****/
-    std::unique_ptr<std::ostream> outStreamHolder;
-    std::ostream* os = nullptr;
-    if (aPtr != nullptr)
-    {
-        aPtr->resize(binarySize);
-        outStreamHolder.reset(
-            new ArrayOStream(binarySize, reinterpret_cast<char*>(aPtr->data())));
-        os = outStreamHolder.get();
-    }
-    else if (vPtr != nullptr)
-    {
-        vPtr->resize(binarySize);
-        outStreamHolder.reset(new VectorOStream(*vPtr));
-        os = outStreamHolder.get();
-    }
-    else // from argument
-        os = osPtr;
+    // array and vector are written directly (allocated with exact size)
+    std::ostream* os = (aPtr == nullptr && vPtr == nullptr) ? osPtr : nullptr;
+    std::unique_ptr<FastOutputBuffer> fobHolder = createFastOutputBuffer(
+                binarySize, os, aPtr, vPtr);
+    FastOutputBuffer& fob = *fobHolder;
     
-    const std::ios::iostate oldExceptions = os->exceptions();
-    FastOutputBuffer fob(256, *os);
+    const std::ios::iostate oldExceptions = (os != nullptr) ? os->exceptions() :
+                std::ios::goodbit;
     try
     {
-        os->exceptions(std::ios::failbit | std::ios::badbit);
+        if (os != nullptr)
+            os->exceptions(std::ios::failbit | std::ios::badbit);
         if (input->is64Bit)
             elfBinGen64->generate(fob);
         else
@@ -1758,10 +1827,12 @@ void AmdGPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>
     }
     catch(...)
     {
-        os->exceptions(oldExceptions);
+        if (os != nullptr)
+            os->exceptions(oldExceptions);
         throw;
     }
-    os->exceptions(oldExceptions);
+    if (os != nullptr)
+        os->exceptions(oldExceptions);
     assert(fob.getWritten() == binarySize);
 }
 
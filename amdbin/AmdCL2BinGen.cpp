@@ -27,6 +27,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include <CLRX/utils/Containers.h>
 #include <CLRX/utils/InputOutput.h>
 #include <CLRX/amdbin/AmdCL2Binaries.h>
@@ -47,11 +48,13 @@ void AmdCL2Input::addEmptyKernel(const char* kernelName)
     kernels.push_back(std::move(kernel));
 }
 
-AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator() : manageable(false), input(nullptr)
+AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator() : manageable(false), input(nullptr), threadsNum(1),
+        deduplication(false), dedupSavedSize(0)
 { }
 
 AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator(const AmdCL2Input* amdInput)
-        : manageable(false), input(amdInput)
+        : manageable(false), input(amdInput), threadsNum(1), deduplication(false),
+        dedupSavedSize(0)
 { }
 
 AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator(GPUDeviceType deviceType,
@@ -59,7 +62,8 @@ AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator(GPUDeviceType deviceType,
        uint32_t driverVersion, size_t globalDataSize, const cxbyte* globalData,
        size_t rwDataSize, const cxbyte* rwData, 
        const std::vector<AmdCL2KernelInput>& kernelInputs)
-        : manageable(true), input(nullptr)
+        : manageable(true), input(nullptr), threadsNum(1), deduplication(false),
+        dedupSavedSize(0)
 {
     input = new AmdCL2Input{deviceType, archMinor, archStepping,
                 globalDataSize, globalData, rwDataSize, rwData, 0, 0, 0,
@@ -71,7 +75,8 @@ AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator(GPUDeviceType deviceType,
        uint32_t driverVersion, size_t globalDataSize, const cxbyte* globalData,
        size_t rwDataSize, const cxbyte* rwData,
        std::vector<AmdCL2KernelInput>&& kernelInputs)
-        : manageable(true), input(nullptr)
+        : manageable(true), input(nullptr), threadsNum(1), deduplication(false),
+        dedupSavedSize(0)
 {
     input = new AmdCL2Input{deviceType, archMinor, archStepping,
                 globalDataSize, globalData, rwDataSize, rwData, 0, 0, 0,
@@ -103,6 +108,12 @@ struct CLRX_INTERNAL TempAmdCL2KernelData
     bool useLocals;
     uint32_t pipesUsed;
     Array<uint16_t> argResIds;
+    // generated before writing (if not empty)
+    Array<cxbyte> metadata;
+    Array<cxbyte> setup;
+    Array<cxbyte> stub;
+    size_t textOffset; // offset of setup and code in inner text (new binaries)
+    bool duplicate; // setup and code are identical with code of previous kernel
 };
 
 struct CLRX_INTERNAL ArgTypeSizes
@@ -906,8 +917,11 @@ public:
         for (size_t i = 0; i < input->kernels.size(); i++)
         {
             const AmdCL2KernelInput& kernel = input->kernels[i];
-            if (kernel.useConfig)
-                writeMetadata(i, tempDatas[i], kernel.config, fob);
+            const TempAmdCL2KernelData& tempData = tempDatas[i];
+            if (!tempData.metadata.empty()) // already generated
+                fob.writeArray(tempData.metadata.size(), tempData.metadata.data());
+            else if (kernel.useConfig)
+                writeMetadata(i, tempData, kernel.config, fob);
             else
                 fob.writeArray(kernel.metadataSize, kernel.metadata);
         }
@@ -1384,6 +1398,11 @@ public:
                     fob.writeArray(tempData.stubSize, kernel.stub);
                     fob.writeArray(tempData.setupSize, kernel.setup);
                 }
+                else if (!tempData.stub.empty())
+                {   // already generated
+                    fob.writeArray(tempData.stub.size(), tempData.stub.data());
+                    fob.writeArray(tempData.setup.size(), tempData.setup.data());
+                }
                 else // generate stub, setup from kernel config
                 {
                     generateKernelStub(arch, kernel.config, fob, tempData.codeSize,
@@ -1412,11 +1431,8 @@ public:
     {
         size_t out = 0;
         for (const TempAmdCL2KernelData& tempData: tempDatas)
-        {
-            if ((out & 255) != 0)
-                out += 256-(out&255);
-            out += tempData.setupSize + tempData.codeSize;
-        }
+            if (!tempData.duplicate)
+                out = tempData.textOffset + tempData.setupSize + tempData.codeSize;
         return out;
     }
     
@@ -1428,14 +1444,14 @@ public:
         {
             const AmdCL2KernelInput& kernel = input->kernels[i];
             const TempAmdCL2KernelData& tempData = tempDatas[i];
-            if ((outSize & 255) != 0)
-            {
-                size_t toFill = 256-(outSize&255);
-                fob.fill(toFill, 0);
-                outSize += toFill;
-            }
+            if (tempData.duplicate)
+                continue; // stored only once
+            fob.fill(tempData.textOffset - outSize, 0);
+            outSize = tempData.textOffset;
             if (!kernel.useConfig)
                 fob.writeArray(tempData.setupSize, kernel.setup);
+            else if (!tempData.setup.empty()) // already generated
+                fob.writeArray(tempData.setup.size(), tempData.setup.data());
             else
                 generateKernelSetup(arch, kernel.config, fob, true, tempData.useLocals,
                             tempData.pipesUsed!=0);
@@ -1562,15 +1578,15 @@ public:
     size_t size() const
     {
         size_t out = 0;
-        for (const AmdCL2KernelInput& kernel: input->kernels)
-            out += kernel.relocations.size()*sizeof(Elf64_Rela);
+        for (size_t i = 0; i < input->kernels.size(); i++)
+            if (!tempDatas[i].duplicate)
+                out += input->kernels[i].relocations.size()*sizeof(Elf64_Rela);
         return out;
     }
     
     void operator()(FastOutputBuffer& fob) const
     {
         Elf64_Rela rela;
-        size_t codeOffset = 0;
         uint32_t adataSymIndex = 0;
         cxuint samplersNum = (input->samplerConfig) ?
                 input->samplers.size() : (input->samplerInitSize>>3);
@@ -1592,8 +1608,10 @@ public:
         {
             const AmdCL2KernelInput& kernel = input->kernels[i];
             const TempAmdCL2KernelData& tempData = tempDatas[i];
+            if (tempData.duplicate)
+                continue; // relocations of shared code are already written
             
-            codeOffset += tempData.setupSize;
+            const size_t codeOffset = tempData.textOffset + tempData.setupSize;
             for (const AmdCL2RelInput inRel: kernel.relocations)
             {
                 SLEV(rela.r_offset, inRel.offset + codeOffset);
@@ -1604,7 +1622,6 @@ public:
                 SLEV(rela.r_addend, inRel.addend);
                 fob.writeObject(rela);
             }
-            codeOffset += (kernel.codeSize+255)&~size_t(255);
         }
     }
 };
@@ -1684,6 +1701,9 @@ static void putInnerSymbols(ElfBinaryGen64& innerBinGen, const AmdCL2Input* inpu
     // put kernel symbols
     std::vector<bool> samplerMask(samplersNum);
     size_t samplerOffset = input->globalDataSize - samplersNum;
+    // positions of kernel codes before deduplication
+    std::vector<size_t> origCodePos(input->kernels.size());
+    bool hasDuplicates = false;
     size_t codePos = 0;
     const uint16_t textSectId = builtinSectionTable[ELFSECTID_TEXT-ELFSECTID_START];
     const uint16_t globalSectId = builtinSectionTable[ELFSECTID_RODATA-ELFSECTID_START];
@@ -1715,6 +1735,8 @@ static void putInnerSymbols(ElfBinaryGen64& innerBinGen, const AmdCL2Input* inpu
         const TempAmdCL2KernelData& tempData = tempDatas[i];
         if ((codePos & 255) != 0)
             codePos += 256-(codePos&255);
+        origCodePos[i] = codePos;
+        hasDuplicates |= tempData.duplicate;
         
         if (kernel.useConfig)
             for (cxuint samp: kernel.config.samplers)
@@ -1737,7 +1759,7 @@ static void putInnerSymbols(ElfBinaryGen64& innerBinGen, const AmdCL2Input* inpu
                         7, "_kernel");
         
         innerBinGen.addSymbol(ElfSymbol64(stringPool[nameIdx].c_str(), textSectId,
-                  ELF64_ST_INFO(STB_GLOBAL, 10), 0, false, codePos, 
+                  ELF64_ST_INFO(STB_GLOBAL, 10), 0, false, tempData.textOffset,
                   kernel.codeSize + tempData.setupSize));
         nameIdx++;
         codePos += kernel.codeSize + tempData.setupSize;
@@ -1775,8 +1797,44 @@ static void putInnerSymbols(ElfBinaryGen64& innerBinGen, const AmdCL2Input* inpu
                       0, false, i*8, 0));
     /// add extra inner symbols
     for (const BinSymbol& extraSym: input->innerExtraSymbols)
-        innerBinGen.addSymbol(ElfSymbol64(extraSym, builtinSectionTable, AMDCL2SECTID_MAX,
-                                  extraSeciontIndex));
+    {
+        ElfSymbol64 elfSym(extraSym, builtinSectionTable, AMDCL2SECTID_MAX,
+                           extraSeciontIndex);
+        if (hasDuplicates && extraSym.sectionId == ELFSECTID_TEXT)
+        {   // move symbol to kernel code in deduplicated text
+            size_t k = std::upper_bound(origCodePos.begin(), origCodePos.end(),
+                        size_t(extraSym.value)) - origCodePos.begin();
+            if (k != 0)
+                elfSym.value = extraSym.value - origCodePos[k-1] +
+                        tempDatas[k-1].textOffset;
+        }
+        innerBinGen.addSymbol(elfSym);
+    }
+}
+
+// check whether kernels have identical setups, codes and text relocations
+static bool isSameKernelCode(const AmdCL2KernelInput& kernel1,
+            const TempAmdCL2KernelData& tempData1, const AmdCL2KernelInput& kernel2,
+            const TempAmdCL2KernelData& tempData2)
+{
+    if (tempData1.setupSize != tempData2.setupSize ||
+        tempData1.codeSize != tempData2.codeSize ||
+        kernel1.relocations.size() != kernel2.relocations.size())
+        return false;
+    const cxbyte* setup1 = (kernel1.useConfig) ? tempData1.setup.data() : kernel1.setup;
+    const cxbyte* setup2 = (kernel2.useConfig) ? tempData2.setup.data() : kernel2.setup;
+    if (::memcmp(setup1, setup2, tempData1.setupSize) != 0 ||
+        ::memcmp(kernel1.code, kernel2.code, tempData1.codeSize) != 0)
+        return false;
+    for (size_t i = 0; i < kernel1.relocations.size(); i++)
+    {
+        const AmdCL2RelInput& rel1 = kernel1.relocations[i];
+        const AmdCL2RelInput& rel2 = kernel2.relocations[i];
+        if (rel1.offset != rel2.offset || rel1.type != rel2.type ||
+            rel1.symbol != rel2.symbol || rel1.addend != rel2.addend)
+            return false;
+    }
+    return true;
 }
 
 /// main routine to generate OpenCL 2.0 binary
@@ -1856,6 +1914,67 @@ void AmdCL2GPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<ch
     Array<TempAmdCL2KernelData> tempDatas(kernelsNum);
     prepareKernelTempData(input, tempDatas);
     
+    /* determine positions of kernel codes in inner text. if deduplication enabled,
+     * then identical codes (with setups and relocations) are stored once and
+     * kernel symbols points to first copy */
+    const bool dedupCodes = deduplication && newBinaries && kernelsNum > 1;
+    if (dedupCodes)
+        // generate setups to compare them
+        runInParallel(threadsNum, kernelsNum, [&](size_t i)
+        {
+            const AmdCL2KernelInput& kernel = input->kernels[i];
+            TempAmdCL2KernelData& tempData = tempDatas[i];
+            if (!kernel.useConfig)
+                return;
+            tempData.setup.resize(tempData.setupSize);
+            FastOutputBuffer setupFob(tempData.setup.size(),
+                        reinterpret_cast<char*>(tempData.setup.data()));
+            generateKernelSetup(arch, kernel.config, setupFob, true,
+                        tempData.useLocals, tempData.pipesUsed!=0);
+        });
+    dedupSavedSize = 0;
+    std::unordered_multimap<size_t, size_t> codeHashMap;
+    size_t textPos = 0;
+    size_t textSize = 0;
+    size_t origTextSize = 0; // text size without deduplication
+    for (size_t i = 0; i < kernelsNum; i++)
+    {
+        const AmdCL2KernelInput& kernel = input->kernels[i];
+        TempAmdCL2KernelData& tempData = tempDatas[i];
+        tempData.duplicate = false;
+        if ((origTextSize & 255) != 0)
+            origTextSize += 256-(origTextSize&255);
+        origTextSize += tempData.setupSize + tempData.codeSize;
+        if ((textPos & 255) != 0)
+            textPos += 256-(textPos&255);
+        tempData.textOffset = textPos;
+        if (dedupCodes)
+        {
+            const cxbyte* setup = (kernel.useConfig) ? tempData.setup.data() :
+                        kernel.setup;
+            size_t hash = calculateDataHash(tempData.setupSize, setup);
+            hash = calculateDataHash(tempData.codeSize, kernel.code, hash);
+            auto range = codeHashMap.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it)
+                if (isSameKernelCode(input->kernels[it->second], tempDatas[it->second],
+                            kernel, tempData))
+                {   // found identical code
+                    tempData.duplicate = true;
+                    tempData.textOffset = tempDatas[it->second].textOffset;
+                    break;
+                }
+            if (tempData.duplicate)
+            {   // relocations are also not stored
+                dedupSavedSize += kernel.relocations.size()*sizeof(Elf64_Rela);
+                continue;
+            }
+            codeHashMap.insert(std::make_pair(hash, i));
+        }
+        textPos += tempData.setupSize + tempData.codeSize;
+        textSize = textPos;
+    }
+    dedupSavedSize += origTextSize - textSize;
+    
     const size_t dataSymbolsNum = std::count_if(input->innerExtraSymbols.begin(),
         input->innerExtraSymbols.end(), [](const BinSymbol& symbol)
         { return symbol.sectionId==ELFSECTID_RODATA || symbol.sectionId==ELFSECTID_DATA ||
@@ -2114,40 +2233,61 @@ void AmdCL2GPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<ch
     elfBinGen.addRegion(ElfRegion64::sectionHeaderTable());
     
     const uint64_t binarySize = elfBinGen.countSize();
+    
+    if (threadsNum > 1 && kernelsNum > 1)
+        // generate metadatas, setups and stubs of kernels in parallel threads
+        runInParallel(threadsNum, kernelsNum, [&](size_t i)
+        {
+            const AmdCL2KernelInput& kernel = input->kernels[i];
+            TempAmdCL2KernelData& tempData = tempDatas[i];
+            if (!kernel.useConfig)
+                return;
+            tempData.metadata.resize(tempData.metadataSize);
+            FastOutputBuffer metadataFob(tempData.metadata.size(),
+                        reinterpret_cast<char*>(tempData.metadata.data()));
+            mainRodataGen.writeMetadata(i, tempData, kernel.config, metadataFob);
+            if (tempData.setup.empty())
+            {   // if not generated for deduplication
+                tempData.setup.resize(tempData.setupSize);
+                FastOutputBuffer setupFob(tempData.setup.size(),
+                            reinterpret_cast<char*>(tempData.setup.data()));
+                generateKernelSetup(arch, kernel.config, setupFob, newBinaries,
+                            tempData.useLocals, tempData.pipesUsed!=0);
+            }
+            if (!newBinaries)
+            {
+                tempData.stub.resize(tempData.stubSize);
+                FastOutputBuffer stubFob(tempData.stub.size(),
+                            reinterpret_cast<char*>(tempData.stub.data()));
+                generateKernelStub(arch, kernel.config, stubFob, tempData.codeSize,
+                        kernel.code, tempData.useLocals, tempData.pipesUsed!=0);
+            }
+        });
     /****
      * prepare for write binary to output
      ****/
-    std::unique_ptr<std::ostream> outStreamHolder;
-    std::ostream* os = nullptr;
-    if (aPtr != nullptr)
-    {
-        aPtr->resize(binarySize);
-        outStreamHolder.reset(
-            new ArrayOStream(binarySize, reinterpret_cast<char*>(aPtr->data())));
-        os = outStreamHolder.get();
-    }
-    else if (vPtr != nullptr)
-    {
-        vPtr->resize(binarySize);
-        outStreamHolder.reset(new VectorOStream(*vPtr));
-        os = outStreamHolder.get();
-    }
-    else // from argument
-        os = osPtr;
+    // array and vector are written directly (allocated with exact size)
+    std::ostream* os = (aPtr == nullptr && vPtr == nullptr) ? osPtr : nullptr;
+    std::unique_ptr<FastOutputBuffer> fobHolder = createFastOutputBuffer(
+                binarySize, os, aPtr, vPtr);
+    FastOutputBuffer& fob = *fobHolder;
     
-    const std::ios::iostate oldExceptions = os->exceptions();
-    FastOutputBuffer fob(256, *os);
+    const std::ios::iostate oldExceptions = (os != nullptr) ? os->exceptions() :
+                std::ios::goodbit;
     try
     {
-        os->exceptions(std::ios::failbit | std::ios::badbit);
+        if (os != nullptr)
+            os->exceptions(std::ios::failbit | std::ios::badbit);
         elfBinGen.generate(fob);
     }
     catch(...)
     {
-        os->exceptions(oldExceptions);
+        if (os != nullptr)
+            os->exceptions(oldExceptions);
         throw;
     }
-    os->exceptions(oldExceptions);
+    if (os != nullptr)
+        os->exceptions(oldExceptions);
     assert(fob.getWritten() == binarySize);
 }
 
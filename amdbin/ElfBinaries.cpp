@@ -1146,7 +1146,8 @@ void ElfBinaryGenTemplate<Types>::generate(FastOutputBuffer& fob)
         }
     }
     fob.flush();
-    fob.getOStream().flush();
+    if (fob.hasOStream())
+        fob.getOStream().flush();
     assert(size == fob.getWritten()-startOffset);
 }
 
@@ -649,32 +649,21 @@ void GalliumBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char
     /****
      * prepare for write binary to output
      ****/
-    std::unique_ptr<std::ostream> outStreamHolder;
-    std::ostream* os = nullptr;
-    if (aPtr != nullptr)
-    {
-        aPtr->resize(binarySize);
-        outStreamHolder.reset(
-                new ArrayOStream(binarySize, reinterpret_cast<char*>(aPtr->data())));
-        os = outStreamHolder.get();
-    }
-    else if (vPtr != nullptr)
-    {
-        vPtr->resize(binarySize);
-        outStreamHolder.reset(new VectorOStream(*vPtr));
-        os = outStreamHolder.get();
-    }
-    else // from argument
-        os = osPtr;
+    // array and vector are written directly (allocated with exact size)
+    std::ostream* os = (aPtr == nullptr && vPtr == nullptr) ? osPtr : nullptr;
+    std::unique_ptr<FastOutputBuffer> fobHolder = createFastOutputBuffer(
+                binarySize, os, aPtr, vPtr);
+    FastOutputBuffer& bos = *fobHolder;
     
-    const std::ios::iostate oldExceptions = os->exceptions();
+    const std::ios::iostate oldExceptions = (os != nullptr) ? os->exceptions() :
+                std::ios::goodbit;
     try
     {
-    os->exceptions(std::ios::failbit | std::ios::badbit);
+    if (os != nullptr)
+        os->exceptions(std::ios::failbit | std::ios::badbit);
     /****
      * write binary to output
      ****/
-    FastOutputBuffer bos(256, *os);
     bos.writeObject<uint32_t>(LEV(kernelsNum));
     for (uint32_t korder: kernelsOrder)
     {
@@ -710,10 +699,12 @@ void GalliumBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char
     }
     catch(...)
     {
-        os->exceptions(oldExceptions);
+        if (os != nullptr)
+            os->exceptions(oldExceptions);
         throw;
     }
-    os->exceptions(oldExceptions);
+    if (os != nullptr)
+        os->exceptions(oldExceptions);
 }
 
 void GalliumBinGenerator::generate(Array<cxbyte>& array) const
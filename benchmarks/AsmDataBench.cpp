@@ -0,0 +1,96 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2016 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/amdasm/Assembler.h>
+#include "BenchUtils.h"
+
+/* microbenchmark of data-heavy sources (mostly .byte/.int/.fill statements).
+ * usage: AsmDataBench [LINES [REPEATS]] */
+
+static const char* dataStatements[] =
+{
+    "    .byte 1, 2, 3, 4, 0x55, 0xaa, 7, 8\n",
+    "    .int 0x12345678, 1000, -5, 0xffffffff\n",
+    "    .fill 4, 2, 0x1234\n",
+    "    .short 11, 22, 33, 44\n",
+    "    .int 77, 88\n",
+    "    .byte 100\n",
+    "    .quad 0x1122334455667788\n",
+    "    .fill 3, 1, 0xcc\n",
+    "    .word 0xdeadbeef\n",
+    "    .hword 5\n"
+};
+
+static std::string generateDataSource(size_t linesNum)
+{
+    std::string source;
+    source.reserve(linesNum*32);
+    const size_t statementsNum = sizeof(dataStatements)/sizeof(char*);
+    uint32_t rnd = 1;
+    for (size_t i = 0; i < linesNum; i++)
+    {
+        rnd = rnd*1103515245U + 12345U;
+        source += dataStatements[(rnd>>16) % statementsNum];
+    }
+    return source;
+}
+
+int main(int argc, const char** argv)
+{
+    size_t linesNum = 1000000;
+    cxuint repeatsNum = 5;
+    if (argc >= 2)
+        linesNum = ::strtoul(argv[1], nullptr, 10);
+    if (argc >= 3)
+        repeatsNum = ::strtoul(argv[2], nullptr, 10);
+
+    const std::string source = generateDataSource(linesNum);
+    bool good = true;
+    size_t outputSize = 0;
+    const BenchResult result = runBenchmark(repeatsNum, [&]()
+    {
+        std::istringstream input(source);
+        std::ostringstream msgStream;
+        Assembler assembler("data.s", input, ASM_TESTRUN, BinaryFormat::RAWCODE,
+                    GPUDeviceType::CAPE_VERDE, msgStream, msgStream);
+        BenchTimer timer;
+        if (!assembler.assemble())
+        {
+            if (good)
+                std::cerr << "Assembler failed:\n" << msgStream.str() << std::endl;
+            good = false;
+        }
+        const double time = timer.elapsed();
+        outputSize = assembler.getSections()[0].getSize();
+        return time;
+    });
+    if (!good)
+        return 1;
+    std::cout << "AsmDataBench: lines=" << linesNum << ", output=" << outputSize <<
+            " bytes" << std::endl;
+    printBenchResult("AsmDataBench", result, linesNum, "lines");
+    printBenchResult("AsmDataBench", result, source.size()/1048576.0, "MB");
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2016 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/amdasm/Assembler.h>
+#include "BenchUtils.h"
+
+/* microbenchmark of label-heavy sources (unrolled loops with local labels
+ * and many named labels). usage: AsmLabelBench [LOOPS [REPEATS]] */
+
+static std::string generateLabelSource(size_t loopsNum)
+{
+    std::string source;
+    source.reserve(loopsNum*200);
+    char buf[300];
+    for (size_t i = 0; i < loopsNum; i++)
+    {
+        // local labels numbers are reused by every loop
+        snprintf(buf, sizeof buf,
+            "loop_%u:\n"
+            "%u:  s_add_u32 s0, s0, 1\n"
+            "    s_cmp_lt_u32 s0, 100\n"
+            "    s_cbranch_scc1 %ub\n"
+            "    s_branch %uf\n"
+            "    v_mov_b32 v1, v2\n"
+            "%u:  v_add_f32 v1, v2, v3\n"
+            "    s_cbranch_vccnz loop_%u\n"
+            "    s_branch 1f\n"
+            "1:  s_nop 0\n", cxuint(i), cxuint(i&7), cxuint(i&7),
+            cxuint(i&7)+8, cxuint(i&7)+8, cxuint(i));
+        source += buf;
+    }
+    return source;
+}
+
+int main(int argc, const char** argv)
+{
+    size_t loopsNum = 100000;
+    cxuint repeatsNum = 5;
+    if (argc >= 2)
+        loopsNum = ::strtoul(argv[1], nullptr, 10);
+    if (argc >= 3)
+        repeatsNum = ::strtoul(argv[2], nullptr, 10);
+
+    const std::string source = generateLabelSource(loopsNum);
+    bool good = true;
+    size_t outputSize = 0;
+    const BenchResult result = runBenchmark(repeatsNum, [&]()
+    {
+        std::istringstream input(source);
+        std::ostringstream msgStream;
+        Assembler assembler("labels.s", input, ASM_TESTRUN, BinaryFormat::RAWCODE,
+                    GPUDeviceType::CAPE_VERDE, msgStream, msgStream);
+        BenchTimer timer;
+        if (!assembler.assemble())
+        {
+            if (good)
+                std::cerr << "Assembler failed:\n" << msgStream.str() << std::endl;
+            good = false;
+        }
+        const double time = timer.elapsed();
+        outputSize = assembler.getSections()[0].getSize();
+        return time;
+    });
+    if (!good)
+        return 1;
+    std::cout << "AsmLabelBench: loops=" << loopsNum << ", output=" << outputSize <<
+            " bytes" << std::endl;
+    printBenchResult("AsmLabelBench", result, loopsNum, "loops");
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2016 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __CLRXBENCH_BENCHUTILS_H__
+#define __CLRXBENCH_BENCHUTILS_H__
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <streambuf>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <CLRX/utils/Utilities.h>
+
+using namespace CLRX;
+
+/// stream buffer that drops all output (counts only written characters)
+class NullStreamBuf: public std::streambuf
+{
+private:
+    size_t size;
+protected:
+    int_type overflow(int_type c)
+    {
+        size++;
+        return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char_type*, std::streamsize n)
+    {
+        size += n;
+        return n;
+    }
+public:
+    NullStreamBuf() : size(0)
+    { }
+    size_t getSize() const
+    { return size; }
+};
+
+/// time measurement
+class BenchTimer
+{
+private:
+    std::chrono::steady_clock::time_point start;
+public:
+    BenchTimer() : start(std::chrono::steady_clock::now())
+    { }
+    /// get elapsed time in seconds
+    double elapsed() const
+    {
+        return std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+/// result of the benchmark (times in seconds)
+struct BenchResult
+{
+    double minTime;
+    double medianTime;
+    double p90Time;
+    double maxTime;
+};
+
+/* get percentile from sorted times (nearest rank method) */
+static inline double getPercentile(const std::vector<double>& times, double percent)
+{
+    size_t rank = size_t(std::ceil(percent*0.01*times.size()));
+    if (rank != 0)
+        rank--;
+    return times[std::min(rank, times.size()-1)];
+}
+
+/* run benchmark. single run returns its measured time (setup is not measured).
+ * first run is warming up and it is not counted */
+template<typename F>
+static BenchResult runBenchmark(cxuint repeatsNum, F run)
+{
+    run();
+    std::vector<double> times;
+    for (cxuint r = 0; r < std::max(repeatsNum, 1U); r++)
+        times.push_back(run());
+    std::sort(times.begin(), times.end());
+    return { times.front(), getPercentile(times, 50.0), getPercentile(times, 90.0),
+            times.back() };
+}
+
+/* print result of benchmark. throughput is computed from median time */
+static inline void printBenchResult(const char* name, const BenchResult& result,
+            double amount, const char* unit)
+{
+    std::cout << name << ": min=" << result.minTime << " s, median=" <<
+            result.medianTime << " s, p90=" << result.p90Time << " s, max=" <<
+            result.maxTime << " s, " << (amount / result.medianTime) << " " <<
+            unit << "/s" << std::endl;
+}
+
+#endif
@@ -0,0 +1,571 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2016 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/utils/Containers.h>
+#include <CLRX/amdbin/AmdBinaries.h>
+#include <CLRX/amdbin/AmdCL2Binaries.h>
+#include <CLRX/amdbin/GalliumBinaries.h>
+#include <CLRX/amdasm/Assembler.h>
+#include <CLRX/amdasm/Disassembler.h>
+#include "BenchUtils.h"
+
+using namespace CLRX;
+
+/* benchmark suite of the assembler, the disassembler, the binary generators and
+ * parsers and the number conversions. workloads are generated synthetically.
+ * usage: ClrxBench [SCALE [REPEATS [FILTER]]]
+ * SCALE - thousands of lines (or numbers) of single workload (default: 200)
+ * REPEATS - number of measured runs (default: 5)
+ * FILTER - run only benchmarks whose name contains this string */
+
+/* simple LCG to get same workloads at every run */
+class BenchRandom
+{
+private:
+    uint32_t state;
+public:
+    explicit BenchRandom(uint32_t seed = 1) : state(seed)
+    { }
+    cxuint next(cxuint range)
+    {
+        state = state*1103515245U + 12345U;
+        return (state>>8) % range;
+    }
+};
+
+/* templates of instruction of single encoding family. in template, '%0'-'%8' are
+ * replaced by register numbers: %0=a, %1=a+1, %2=b, %3=b+1, %4=c, %5=c+1, %6=a+3,
+ * %7=c+3, %8=c+7, where a,b,c are random and aligned to 4 */
+struct GCNFamilyWorkload
+{
+    const char* name;
+    GPUDeviceType deviceType;
+    const char* templates[8];
+};
+
+static const GCNFamilyWorkload gcnFamilyWorkloads[] =
+{
+    { "SOP2", GPUDeviceType::PITCAIRN, {
+        "s_add_u32 s%0, s%2, s%4", "s_and_b64 s[%0:%1], s[%2:%3], s[%4:%5]",
+        "s_lshl_b32 s%0, s%2, 5", "s_cselect_b32 s%0, s%2, 0x12345",
+        "s_bfe_u32 s%2, s%4, s%0", nullptr } },
+    { "SOPK", GPUDeviceType::PITCAIRN, {
+        "s_movk_i32 s%0, 0x1234", "s_addk_i32 s%2, 0x100", "s_cmpk_eq_i32 s%4, 77",
+        "s_mulk_i32 s%0, 3", "s_cmovk_i32 s%2, 11", nullptr } },
+    { "SOP1", GPUDeviceType::PITCAIRN, {
+        "s_mov_b32 s%0, s%2", "s_mov_b64 s[%0:%1], s[%2:%3]", "s_not_b32 s%0, s%4",
+        "s_brev_b32 s%2, 0x4567", "s_bcnt1_i32_b32 s%0, s%2",
+        "s_and_saveexec_b64 s[%0:%1], s[%4:%5]", nullptr } },
+    { "SOPC", GPUDeviceType::PITCAIRN, {
+        "s_cmp_eq_i32 s%0, s%2", "s_cmp_lt_u32 s%2, 100", "s_bitcmp1_b32 s%4, 3",
+        "s_cmp_ge_i32 s%0, -5", nullptr } },
+    { "SOPP", GPUDeviceType::PITCAIRN, {
+        "s_nop 3", "s_waitcnt vmcnt(0) & lgkmcnt(0)", "s_barrier", "s_branch .+8",
+        "s_cbranch_scc0 .+4", "s_sendmsg sendmsg(interrupt)", "s_setprio 1",
+        nullptr } },
+    { "SMRD", GPUDeviceType::PITCAIRN, {
+        "s_load_dword s%0, s[%2:%3], 0x10", "s_load_dwordx2 s[%0:%1], s[%2:%3], s%4",
+        "s_buffer_load_dwordx4 s[%0:%6], s[%4:%7], 0x20", "s_memtime s[%0:%1]",
+        "s_dcache_inv", nullptr } },
+    { "VOP2", GPUDeviceType::PITCAIRN, {
+        "v_add_f32 v%0, v%2, v%4", "v_sub_i32 v%0, vcc, v%2, v%4",
+        "v_and_b32 v%0, s%2, v%4", "v_mac_f32 v%0, 1.0, v%2",
+        "v_cndmask_b32 v%0, v%2, v%4, vcc", "v_max_f32 v%0, 0x3f800011, v%4",
+        nullptr } },
+    { "VOP1", GPUDeviceType::PITCAIRN, {
+        "v_mov_b32 v%0, v%2", "v_cvt_f32_i32 v%0, s%2", "v_rcp_f32 v%0, v%4",
+        "v_sqrt_f64 v[%0:%1], v[%2:%3]", "v_readfirstlane_b32 s%2, v%4",
+        "v_fract_f32 v%0, 0.5", nullptr } },
+    { "VOPC", GPUDeviceType::PITCAIRN, {
+        "v_cmp_eq_f32 vcc, v%0, v%2", "v_cmp_lt_i32 vcc, s%2, v%4",
+        "v_cmpx_gt_u32 vcc, 5, v%0", "v_cmp_class_f32 vcc, v%0, v%2", nullptr } },
+    { "VOP3", GPUDeviceType::PITCAIRN, {
+        "v_mad_f32 v%0, v%2, v%4, v%0", "v_add_f32 v%0, -v%2, |v%4| clamp",
+        "v_cmp_eq_i32 s[%0:%1], v%2, v%4", "v_fma_f64 v[%0:%1], v[%2:%3], v[%4:%5], 1.0",
+        "v_mul_lo_u32 v%0, v%2, s%4", "v_bfe_u32 v%0, v%2, 8, 5", nullptr } },
+    { "VINTRP", GPUDeviceType::PITCAIRN, {
+        "v_interp_p1_f32 v%0, v%2, attr0.x", "v_interp_p2_f32 v%0, v%2, attr3.w",
+        "v_interp_mov_f32 v%0, p10, attr1.y", nullptr } },
+    { "DS", GPUDeviceType::PITCAIRN, {
+        "ds_write_b32 v%0, v%2 offset:16", "ds_read_b32 v%0, v%2",
+        "ds_add_u32 v%0, v%2", "ds_read2_b32 v[%0:%1], v%2 offset0:1 offset1:3",
+        "ds_write2_b64 v%0, v[%2:%3], v[%4:%5] offset0:2 offset1:5", nullptr } },
+    { "MUBUF", GPUDeviceType::PITCAIRN, {
+        "buffer_load_dword v%0, v%2, s[%4:%7], 0 offen",
+        "buffer_store_dwordx2 v[%0:%1], v%2, s[%4:%7], s%0 idxen offset:16",
+        "buffer_atomic_add v%0, v%2, s[%4:%7], 0 offen glc",
+        "buffer_load_ubyte v%0, v%2, s[%4:%7], s%2 offen offset:4 slc", nullptr } },
+    { "MTBUF", GPUDeviceType::PITCAIRN, {
+        "tbuffer_load_format_x v%0, v%2, s[%4:%7], 0 offen format:[8,sint]",
+        "tbuffer_store_format_xy v[%0:%1], v%2, s[%4:%7], s%0 idxen offset:32 "
+            "format:[16_16,float]", nullptr } },
+    { "MIMG", GPUDeviceType::PITCAIRN, {
+        "image_load v[%0:%6], v[%2:%3], s[%4:%8] dmask:15 unorm",
+        "image_sample v%0, v[%2:%3], s[%4:%8], s[%0:%6] dmask:1",
+        "image_store v[%0:%1], v%2, s[%4:%8] dmask:3 unorm glc", nullptr } },
+    { "EXP", GPUDeviceType::PITCAIRN, {
+        "exp param5, v%0, v%2, v%4, v%1 done vm", "exp mrt0, v%0, v%1, v%2, v%3",
+        "exp pos0, v%4, v%5, v%0, v%2 done", nullptr } },
+    { "SMEM", GPUDeviceType::TONGA, {
+        "s_load_dword s%0, s[%2:%3], 0x1345b", "s_load_dwordx2 s[%0:%1], s[%2:%3], s%4",
+        "s_buffer_load_dwordx4 s[%0:%6], s[%4:%7], 0x20 glc",
+        "s_store_dword s%0, s[%2:%3], 0x100", nullptr } },
+    { "FLAT", GPUDeviceType::TONGA, {
+        "flat_load_dword v%0, v[%2:%3]", "flat_store_dwordx2 v[%0:%1], v[%2:%3] glc",
+        "flat_atomic_add v%0, v[%2:%3], v%4 glc", nullptr } },
+    { "SDWA_DPP", GPUDeviceType::TONGA, {
+        "v_mov_b32_sdwa v%0, sext(v%2)", "v_add_f32_sdwa v%0, v%2, v%4 dst_sel:word1",
+        "v_cndmask_b32_dpp v%0, v%2, v%4, vcc bank_mask:0 row_mask:0",
+        "v_add_f32_dpp v%0, v%2, v%4 row_shl:1", nullptr } }
+};
+
+/* expand instruction template with random register numbers */
+static void expandGCNTemplate(std::string& source, const char* tmpl, BenchRandom& random)
+{
+    const cxuint a = random.next(24)<<2;
+    const cxuint b = random.next(24)<<2;
+    const cxuint c = random.next(23)<<2;
+    const cxuint regs[9] = { a, a+1, b, b+1, c, c+1, a+3, c+3, c+7 };
+    char buf[16];
+    source += "    ";
+    for (const char* p = tmpl; *p != 0; p++)
+        if (*p == '%' && p[1] >= '0' && p[1] <= '8')
+        {
+            const size_t len = itocstrCStyle(regs[p[1]-'0'], buf, 16);
+            source.append(buf, len);
+            p++;
+        }
+        else
+            source.push_back(*p);
+    source.push_back('\n');
+}
+
+static std::string generateGCNSource(const GCNFamilyWorkload& workload, size_t linesNum)
+{
+    std::string source;
+    source.reserve(linesNum*40);
+    cxuint templatesNum = 0;
+    while (workload.templates[templatesNum] != nullptr)
+        templatesNum++;
+    BenchRandom random;
+    for (size_t i = 0; i < linesNum; i++)
+        expandGCNTemplate(source, workload.templates[random.next(templatesNum)], random);
+    return source;
+}
+
+/* source with many macro substitutions (nested macros) */
+static std::string generateMacroSource(size_t linesNum)
+{
+    std::string source =
+        ".macro vadd dst, src0, src1\n"
+        "    v_add_f32 v\\dst, v\\src0, v\\src1\n"
+        ".endm\n"
+        ".macro sload dst, base, offset=0x10\n"
+        "    s_load_dword s\\dst, s[\\base:\\base+1], \\offset\n"
+        ".endm\n"
+        ".macro step dst, src\n"
+        "    vadd \\dst, \\src, \\dst\n"
+        "    sload \\dst, 4\n"
+        "    s_add_u32 s\\dst, s\\dst, \\@\n"
+        ".endm\n";
+    char buf[64];
+    BenchRandom random;
+    // any 'step' expands to 3 instructions
+    for (size_t i = 0; i < linesNum; i += 3)
+    {
+        snprintf(buf, sizeof buf, "    step %u, %u\n", random.next(60), random.next(60));
+        source += buf;
+    }
+    return source;
+}
+
+/* source with many repetitions (nested .rept and .irp) */
+static std::string generateRepeatSource(size_t linesNum)
+{
+    std::string source;
+    char buf[300];
+    // any block expands to 4*(2+3) = 20 instructions
+    for (size_t i = 0; i < linesNum; i += 20)
+    {
+        snprintf(buf, sizeof buf,
+            ".rept 4\n"
+            "    v_mul_f32 v%u, v%u, v%u\n"
+            "    s_add_u32 s%u, s%u, 1\n"
+            "    .irp reg, 1, 2, 3\n"
+            "        v_mov_b32 v\\reg, s%u\n"
+            "    .endr\n"
+            ".endr\n", cxuint(i%100), cxuint((i+7)%100), cxuint((i+13)%100),
+            cxuint(i%50), cxuint(i%50), cxuint(i%50));
+        source += buf;
+    }
+    return source;
+}
+
+static const char* dataStatements[] =
+{
+    "    .byte 1, 2, 3, 4, 0x55, 0xaa, 7, 8\n",
+    "    .int 0x12345678, 1000, -5, 0xffffffff\n",
+    "    .fill 4, 2, 0x1234\n",
+    "    .short 11, 22, 33, 44\n",
+    "    .float 1.5, -2.25e3, 0x1.8p3\n",
+    "    .quad 0x1122334455667788\n",
+    "    .double 3.14159265358979, 1e-10\n",
+    "    .ascii \"some text\\n\"\n"
+};
+
+static std::string generateDataSource(size_t linesNum)
+{
+    std::string source;
+    source.reserve(linesNum*32);
+    const size_t statementsNum = sizeof(dataStatements)/sizeof(char*);
+    BenchRandom random;
+    for (size_t i = 0; i < linesNum; i++)
+        source += dataStatements[random.next(statementsNum)];
+    return source;
+}
+
+/* source of binary with many kernels for given binary format */
+static std::string generateBinarySource(BinaryFormat binFormat, size_t kernelsNum,
+            size_t kernelLinesNum)
+{
+    std::string source;
+    char buf[100];
+    if (binFormat == BinaryFormat::AMD)
+        source += ".amd\n.gpu Pitcairn\n.driver_version 200406\n";
+    else if (binFormat == BinaryFormat::AMDCL2)
+        source += ".amdcl2\n.gpu Bonaire\n.driver_version 191205\n";
+    else
+        source += ".gallium\n.gpu Pitcairn\n";
+
+    const GCNFamilyWorkload& workload = gcnFamilyWorkloads[6]; // VOP2
+    BenchRandom random;
+    for (size_t k = 0; k < kernelsNum; k++)
+    {
+        snprintf(buf, sizeof buf, ".kernel kernel%u\n", cxuint(k));
+        source += buf;
+        source += "    .config\n        .dims x\n";
+        if (binFormat != BinaryFormat::GALLIUM)
+            source +=
+                "        .arg n, uint\n"
+                "        .arg in, float*, global, const\n"
+                "        .arg out, float*, global\n";
+        else
+            source +=
+                "        .args\n"
+                "        .arg scalar, 4\n"
+                "        .arg global, 8\n"
+                "        .arg global, 8\n";
+        source += "    .text\n";
+        if (binFormat == BinaryFormat::GALLIUM)
+        {
+            snprintf(buf, sizeof buf, "kernel%u:\n", cxuint(k));
+            source += buf;
+        }
+        for (size_t i = 0; i < kernelLinesNum; i++)
+            expandGCNTemplate(source, workload.templates[random.next(4)], random);
+        source += "    s_endpgm\n";
+    }
+    return source;
+}
+
+static bool assembleSource(const std::string& source, BinaryFormat binFormat,
+            GPUDeviceType deviceType, Array<cxbyte>* output, double& time)
+{
+    std::istringstream input(source);
+    std::ostringstream msgStream;
+    Assembler assembler("bench.s", input, 0, binFormat, deviceType,
+                msgStream, msgStream);
+    BenchTimer timer;
+    if (!assembler.assemble())
+    {
+        std::cerr << "Assembler failed:\n" << msgStream.str().substr(0, 2000) << std::endl;
+        return false;
+    }
+    if (output != nullptr)
+        assembler.writeBinary(*output);
+    time = timer.elapsed();
+    return true;
+}
+
+static bool benchAssembler(const char* name, const std::string& source,
+            size_t linesNum, cxuint repeatsNum, BinaryFormat binFormat,
+            GPUDeviceType deviceType, Array<cxbyte>* output = nullptr)
+{
+    bool good = true;
+    const BenchResult result = runBenchmark(repeatsNum, [&]()
+    {
+        double time = 0.0;
+        if (!assembleSource(source, binFormat, deviceType, output, time))
+            good = false;
+        return time;
+    });
+    if (good)
+        printBenchResult(name, result, linesNum, "lines");
+    return good;
+}
+
+static void benchDisassembler(const char* name, GPUDeviceType deviceType,
+            const Array<cxbyte>& code, size_t instrsNum, cxuint repeatsNum)
+{
+    const BenchResult result = runBenchmark(repeatsNum, [&]()
+    {
+        NullStreamBuf nullBuf;
+        std::ostream nullStream(&nullBuf);
+        Disassembler disasm(deviceType, code.size(), code.data(), nullStream,
+                    DISASM_DUMPCODE);
+        BenchTimer timer;
+        disasm.disassemble();
+        return timer.elapsed();
+    });
+    printBenchResult(name, result, instrsNum, "instrs");
+}
+
+template<typename BinaryType>
+static void benchBinaryParse(const char* name, Array<cxbyte>& binary, cxuint repeatsNum)
+{
+    const BenchResult result = runBenchmark(repeatsNum, [&binary]()
+    {
+        BenchTimer timer;
+        BinaryType parsed(binary.size(), binary.data(), AMDBIN_CREATE_ALL);
+        return timer.elapsed();
+    });
+    printBenchResult(name, result, binary.size()/1048576.0, "MB");
+}
+
+static void benchGalliumBinaryParse(const char* name, Array<cxbyte>& binary,
+            cxuint repeatsNum)
+{
+    const BenchResult result = runBenchmark(repeatsNum, [&binary]()
+    {
+        BenchTimer timer;
+        GalliumBinary parsed(binary.size(), binary.data(), GALLIUM_CREATE_ALL);
+        return timer.elapsed();
+    });
+    printBenchResult(name, result, binary.size()/1048576.0, "MB");
+}
+
+/* corpus of the floating point numbers (decimal and hexadecimal). exponents are
+ * chosen to keep values in range of floating point format */
+static std::string generateFloatCorpus(size_t numbersNum, cxuint expBits)
+{
+    std::string corpus;
+    corpus.reserve(numbersNum*24);
+    char buf[64];
+    BenchRandom random;
+    const int maxBinExp = (1<<(expBits-1))-2;
+    const int maxDecExp = (maxBinExp*3)/10;
+    for (size_t i = 0; i < numbersNum; i++)
+    {
+        const cxuint mantisa = random.next(100000000);
+        switch (random.next(4))
+        {
+            case 0:
+                snprintf(buf, sizeof buf, "%u.%ue%d", mantisa%10, mantisa,
+                         int(random.next(2*maxDecExp))-maxDecExp);
+                break;
+            case 1:
+                snprintf(buf, sizeof buf, "0x1.%xp%d", mantisa,
+                         int(random.next(2*maxBinExp))-maxBinExp);
+                break;
+            case 2:
+                snprintf(buf, sizeof buf, "%u.%u", mantisa%100, mantisa%10000);
+                break;
+            default:
+                snprintf(buf, sizeof buf, "0.%u%u", mantisa, mantisa);
+                break;
+        }
+        corpus += buf;
+        corpus.push_back(' ');
+    }
+    return corpus;
+}
+
+static void benchFloatParse(const char* name, const std::string& corpus,
+            size_t numbersNum, cxuint expBits, cxuint mantisaBits, cxuint repeatsNum)
+{
+    uint64_t checksum = 0;
+    const BenchResult result = runBenchmark(repeatsNum, [&]()
+    {
+        BenchTimer timer;
+        const char* p = corpus.c_str();
+        const char* end = p + corpus.size();
+        while (p != end)
+        {
+            const char* outend;
+            checksum += cstrtofXCStyle(p, end, outend, expBits, mantisaBits);
+            p = outend+1; // skip space
+        }
+        return timer.elapsed();
+    });
+    if (checksum == 1) // prevent removing loop by compiler
+        std::cout << "checksum" << std::endl;
+    printBenchResult(name, result, numbersNum, "numbers");
+}
+
+static bool matchFilter(const char* filter, const char* name)
+{ return filter == nullptr || ::strstr(name, filter) != nullptr; }
+
+int main(int argc, const char** argv)
+try
+{
+    size_t scale = 200;
+    cxuint repeatsNum = 5;
+    const char* filter = nullptr;
+    if (argc >= 2)
+        scale = std::max(::strtoul(argv[1], nullptr, 10), 1UL);
+    if (argc >= 3)
+        repeatsNum = ::strtoul(argv[2], nullptr, 10);
+    if (argc >= 4)
+        filter = argv[3];
+    const size_t linesNum = scale*1000;
+    int ret = 0;
+    char name[64];
+
+    // assembler and disassembler for any encoding family
+    for (const GCNFamilyWorkload& workload: gcnFamilyWorkloads)
+    {
+        char disasmName[64];
+        snprintf(name, sizeof name, "asm-%s", workload.name);
+        snprintf(disasmName, sizeof disasmName, "disasm-%s", workload.name);
+        const bool doAsm = matchFilter(filter, name);
+        if (!doAsm && !matchFilter(filter, disasmName))
+            continue;
+        const std::string source = generateGCNSource(workload, linesNum);
+        if (doAsm && !benchAssembler(name, source, linesNum, repeatsNum,
+                    BinaryFormat::RAWCODE, workload.deviceType))
+        {
+            ret = 1;
+            continue;
+        }
+        if (matchFilter(filter, disasmName))
+        {
+            Array<cxbyte> code;
+            double time;
+            if (!assembleSource(source, BinaryFormat::RAWCODE, workload.deviceType,
+                        &code, time))
+            {
+                ret = 1;
+                continue;
+            }
+            benchDisassembler(disasmName, workload.deviceType, code, linesNum,
+                        repeatsNum);
+        }
+    }
+
+    if (matchFilter(filter, "asm-macro") && !benchAssembler("asm-macro",
+            generateMacroSource(linesNum), linesNum, repeatsNum,
+            BinaryFormat::RAWCODE, GPUDeviceType::PITCAIRN))
+        ret = 1;
+    if (matchFilter(filter, "asm-repeat") && !benchAssembler("asm-repeat",
+            generateRepeatSource(linesNum), linesNum, repeatsNum,
+            BinaryFormat::RAWCODE, GPUDeviceType::PITCAIRN))
+        ret = 1;
+    if (matchFilter(filter, "asm-data") && !benchAssembler("asm-data",
+            generateDataSource(linesNum), linesNum, repeatsNum,
+            BinaryFormat::RAWCODE, GPUDeviceType::PITCAIRN))
+        ret = 1;
+
+    // binary generators and parsers
+    const size_t kernelsNum = std::max(scale/2, size_t(1));
+    const struct {
+        const char* name;
+        BinaryFormat format;
+        GPUDeviceType deviceType;
+    } binWorkloads[3] =
+    {
+        { "amd", BinaryFormat::AMD, GPUDeviceType::PITCAIRN },
+        { "amdcl2", BinaryFormat::AMDCL2, GPUDeviceType::BONAIRE },
+        { "gallium", BinaryFormat::GALLIUM, GPUDeviceType::PITCAIRN }
+    };
+    for (const auto& binWorkload: binWorkloads)
+    {
+        char parseName[64];
+        snprintf(name, sizeof name, "bin-%s-gen", binWorkload.name);
+        snprintf(parseName, sizeof parseName, "bin-%s-parse", binWorkload.name);
+        const bool doGen = matchFilter(filter, name);
+        if (!doGen && !matchFilter(filter, parseName))
+            continue;
+        const std::string source = generateBinarySource(binWorkload.format,
+                    kernelsNum, 1000);
+        Array<cxbyte> binary;
+        if (doGen)
+        {
+            if (!benchAssembler(name, source, kernelsNum*1000, repeatsNum,
+                    binWorkload.format, binWorkload.deviceType, &binary))
+            {
+                ret = 1;
+                continue;
+            }
+        }
+        else
+        {
+            double time;
+            if (!assembleSource(source, binWorkload.format, binWorkload.deviceType,
+                        &binary, time))
+            {
+                ret = 1;
+                continue;
+            }
+        }
+        if (!matchFilter(filter, parseName))
+            continue;
+        if (binWorkload.format == BinaryFormat::AMD)
+            benchBinaryParse<AmdMainGPUBinary32>(parseName, binary, repeatsNum);
+        else if (binWorkload.format == BinaryFormat::AMDCL2)
+            benchBinaryParse<AmdCL2MainGPUBinary>(parseName, binary, repeatsNum);
+        else
+            benchGalliumBinaryParse(parseName, binary, repeatsNum);
+    }
+
+    // number conversions
+    const struct {
+        const char* name;
+        cxuint expBits;
+        cxuint mantisaBits;
+    } floatWorkloads[3] =
+    {
+        { "cstrtof-half", 5, 10 },
+        { "cstrtof-float", 8, 23 },
+        { "cstrtof-double", 11, 52 }
+    };
+    for (const auto& floatWorkload: floatWorkloads)
+    {
+        if (!matchFilter(filter, floatWorkload.name))
+            continue;
+        const std::string floatCorpus = generateFloatCorpus(linesNum,
+                    floatWorkload.expBits);
+        benchFloatParse(floatWorkload.name, floatCorpus, linesNum,
+                    floatWorkload.expBits, floatWorkload.mantisaBits, repeatsNum);
+    }
+    return ret;
+}
+catch(const std::exception& ex)
+{
+    std::cerr << ex.what() << std::endl;
+    return 1;
+}
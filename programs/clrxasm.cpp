@@ -19,9 +19,21 @@
 
 #include <CLRX/Config.h>
 #include <iostream>
+#include <sstream>
 #include <memory>
 #include <fstream>
 #include <cstring>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <system_error>
+#ifndef HAVE_WINDOWS
+#include <sys/resource.h>
+#endif
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/utils/CLIParser.h>
 #include <CLRX/amdbin/AmdBinaries.h>
@@ -54,6 +66,18 @@ static const CLIOption programOptions[] =
     { "buggyFPLit", 0, CLIArgType::NONE, false, false,
         "use old and buggy fplit rules", nullptr },
     { "noWarnings", 'w', CLIArgType::NONE, false, false, "disable warnings", nullptr },
+    { "macroLibrary", 0, CLIArgType::STRING, false, false,
+        "write defined macros to precompiled macro library", "FILENAME" },
+    { "batch", 0, CLIArgType::STRING, false, false,
+        "assemble jobs listed in manifest file", "FILENAME" },
+    { "jobs", 'j', CLIArgType::UINT, false, false,
+        "set number of parallel jobs for batch mode", "JOBS" },
+    { "binGenThreads", 0, CLIArgType::UINT, false, false,
+        "set number of threads that generate kernel's binaries", "THREADS" },
+    { "dedup", 0, CLIArgType::NONE, false, false,
+        "store identical kernel codes once in binary", nullptr },
+    { "stats", 0, CLIArgType::TRIMMED_STRING, true, false,
+        "print assembler statistics in text or JSON format", "FORMAT" },
     CLRX_CLI_AUTOHELP
     { nullptr, 0 }
 };
@@ -68,14 +92,85 @@ static bool verifySymbolName(const CString& symbolName)
     return *c==0;
 }
 
-int main(int argc, const char** argv)
-try
+/* get peak resident memory of process in bytes (0 if unknown) */
+static uint64_t getPeakMemory()
 {
-    CLIParser cli("clrxasm", programOptions, argc, argv);
-    cli.parse();
-    if (cli.handleHelpOrUsage())
-        return 0;
+#ifndef HAVE_WINDOWS
+    struct rusage usage;
+    if (::getrusage(RUSAGE_SELF, &usage) == 0)
+        return uint64_t(usage.ru_maxrss)*1024U;
+#endif
+    return 0;
+}
+
+/* print phase timings and counters collected by assembler.
+ * memory peak is measured for whole process, hence it is not printed for batch jobs */
+static void printStats(std::ostream& os, const Assembler& assembler, bool json,
+            bool batchJob)
+{
+    const AsmStats& stats = assembler.getStats();
+    const double totalTime = stats.readingTime + stats.parsingTime + stats.macroTime +
+            stats.encodingTime + stats.resolvingTime + stats.preparingTime +
+            stats.writingTime;
+    const struct { const char* name; const char* jsonName; double time; } times[] =
+    {
+        { "Reading and filtering", "reading", stats.readingTime },
+        { "Parsing statements", "parsing", stats.parsingTime },
+        { "Macros and repetitions", "macros", stats.macroTime },
+        { "Encoding instructions", "encoding", stats.encodingTime },
+        { "Resolving symbols", "resolving", stats.resolvingTime },
+        { "Preparing binary", "preparing", stats.preparingTime },
+        { "Writing binary", "writing", stats.writingTime },
+        { "Total", "total", totalTime }
+    };
+    const struct { const char* name; const char* jsonName; uint64_t value; } counters[] =
+    {
+        { "Lines", "lines", stats.linesNum },
+        { "Macro substitutions", "macroSubsts", stats.macroSubstsNum },
+        { "Repetitions", "repetitions", stats.repetitionsNum },
+        { "Symbols", "symbols", stats.symbolsNum },
+        { "Expressions", "expressions", stats.expressionsNum },
+        { "Fixups", "fixups", stats.fixupsNum },
+        { "Sections size", "sectionsSize", stats.sectionsSize },
+        { "Deduplicated bytes", "dedupSaved", stats.dedupSavedSize },
+        { "Expressions memory peak", "exprMemoryPeak",
+            assembler.getExpressionArenaStats().maxUsedSize },
+        { "Memory peak", "memoryPeak", batchJob ? 0 : getPeakMemory() }
+    };
+    // memory peak is last counter
+    const size_t countersNum = sizeof(counters)/sizeof(counters[0]) - (batchJob ? 1 : 0);
     
+    std::ostringstream oss;
+    oss.setf(std::ios::fixed, std::ios::floatfield);
+    oss.precision(6);
+    if (json)
+    {
+        oss << "{ \"times\": { ";
+        for (size_t i = 0; i < sizeof(times)/sizeof(times[0]); i++)
+            oss << (i!=0 ? ", " : "") << '"' << times[i].jsonName << "\": " <<
+                        times[i].time;
+        oss << " }";
+        for (size_t i = 0; i < countersNum; i++)
+            oss << ", \"" << counters[i].jsonName << "\": " << counters[i].value;
+        oss << " }\n";
+    }
+    else
+    {
+        oss << "Assembler statistics:\n";
+        for (size_t i = 0; i < sizeof(times)/sizeof(times[0]); i++)
+            oss << "  " << times[i].name << ": " << times[i].time << " s\n";
+        for (size_t i = 0; i < countersNum; i++)
+            oss << "  " << counters[i].name << ": " << counters[i].value << "\n";
+    }
+    os << oss.str();
+    os.flush();
+}
+
+/* assemble single job described by parsed command line.
+ * errors and warnings are printed to msgStream */
+static int assembleFromCLI(const CLIParser& cli, std::ostream& msgStream,
+            std::ostream& printStream, bool batchJob)
+{
     int ret = 0;
     bool is64Bit = false;
     BinaryFormat binFormat = BinaryFormat::AMD;
@@ -113,6 +208,21 @@ try
         flags |= ASM_ALTMACRO;
     if (cli.hasLongOption("buggyFPLit"))
         flags |= ASM_BUGGYFPLIT;
+    if (cli.hasLongOption("dedup"))
+        flags |= ASM_DEDUP;
+    bool statsJson = false;
+    if (cli.hasLongOption("stats"))
+    {
+        flags |= ASM_STATS;
+        if (cli.hasLongOptArg("stats"))
+        {
+            const char* statsFormat = cli.getLongOptArg<const char*>("stats");
+            if (::strcasecmp(statsFormat, "json")==0)
+                statsJson = true;
+            else if (::strcasecmp(statsFormat, "text")!=0)
+                throw Exception("Unknown statistics format");
+        }
+    }
     
     cxuint argsNum = cli.getArgsNum();
     Array<CString> filenames(argsNum);
@@ -121,11 +231,22 @@ try
     
     std::unique_ptr<Assembler> assembler;
     if (!filenames.empty())
-        assembler.reset(new Assembler(filenames, flags, binFormat, deviceType));
-    else // if from stdin
-        assembler.reset(new Assembler(nullptr, std::cin, flags, binFormat, deviceType));
+        assembler.reset(new Assembler(filenames, flags, binFormat, deviceType,
+                    msgStream, printStream));
+    else if (!batchJob) // if from stdin
+        assembler.reset(new Assembler(nullptr, std::cin, flags, binFormat, deviceType,
+                    msgStream, printStream));
+    else
+        throw Exception("No input files in batch job");
     assembler->set64Bit(is64Bit);
     assembler->setDriverVersion(driverVersion);
+    if (cli.hasLongOption("binGenThreads"))
+    {
+        cxuint binGenThreadsNum = cli.getLongOptArg<cxuint>("binGenThreads");
+        if (binGenThreadsNum == 0)
+            binGenThreadsNum = std::max(std::thread::hardware_concurrency(), 1U);
+        assembler->setBinGenThreadsNum(binGenThreadsNum);
+    }
     
     size_t defSymsNum = 0;
     const char* const* defSyms = nullptr;
@@ -154,7 +275,7 @@ try
             { value = cstrtovCStyle<uint64_t>(eqPlace, nullptr, outEnd); }
             catch(const ParseException& ex)
             {
-                std::cerr << "For symbol '" << symName << "': " << ex.what() << std::endl;
+                msgStream << "For symbol '" << symName << "': " << ex.what() << std::endl;
                 ret = 1;
                 parsed = false;
             }
@@ -163,7 +284,7 @@ try
                 while (isSpace(*outEnd)) outEnd++;
                 if (*outEnd!=0)
                 {
-                    std::cerr << "Garbages at symbol '" << symName <<
+                    msgStream << "Garbages at symbol '" << symName <<
                                     "' value" << std::endl;
                     ret = 1;
                 }
@@ -175,7 +296,7 @@ try
             assembler->addInitialDefSym(symName, value);
         else
         {
-            std::cerr << "Invalid symbol name '" << symName << "'" << std::endl;
+            msgStream << "Invalid symbol name '" << symName << "'" << std::endl;
             ret = 1;
         }
     }
@@ -184,13 +305,206 @@ try
     /// run assembling
     if (!assembler->assemble())
         return 1;
+    if (cli.hasLongOption("macroLibrary"))
+    {   /// write macro library, binary is written only if output is given
+        assembler->writeMacroLibrary(cli.getLongOptArg<const char*>("macroLibrary"));
+        if (!cli.hasShortOption('o'))
+        {
+            if ((flags & ASM_STATS) != 0)
+                printStats(msgStream, *assembler, statsJson, batchJob);
+            return 0;
+        }
+    }
     /// write output to file
     const char* outputName = "a.out";
     if (cli.hasShortOption('o'))
         outputName = cli.getShortOptArg<const char*>('o');
     assembler->writeBinary(outputName);
+    if ((flags & ASM_STATS) != 0)
+        printStats(msgStream, *assembler, statsJson, batchJob);
     return 0;
 }
+
+/*
+ * batch mode
+ */
+
+struct BatchJob
+{
+    LineNo lineNo;  // line number in manifest
+    std::vector<std::string> args;
+};
+
+/* split manifest line to arguments. arguments are separated by spaces,
+ * can be quoted by '"' or '\'' and characters can be escaped by backslash */
+static std::vector<std::string> splitManifestLine(const std::string& line, LineNo lineNo)
+{
+    std::vector<std::string> args;
+    const char* p = line.c_str();
+    while (true)
+    {
+        while (isSpace(*p)) p++;
+        if (*p == 0 || *p == '#') // end of line or comment
+            break;
+        std::string arg;
+        char quote = 0;
+        for (; *p != 0 && (quote != 0 || !isSpace(*p)); p++)
+        {
+            if (quote != 0 && *p == quote)
+                quote = 0;
+            else if (quote == 0 && (*p == '"' || *p == '\''))
+                quote = *p;
+            else if (*p == '\\' && p[1] != 0 && quote != '\'')
+                arg.push_back(*++p);
+            else
+                arg.push_back(*p);
+        }
+        if (quote != 0)
+            throw ParseException(lineNo, "Unterminated quoted argument");
+        args.push_back(arg);
+    }
+    return args;
+}
+
+static std::vector<BatchJob> readBatchManifest(const char* filename)
+{
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs)
+        throw Exception(std::string("Can't open batch manifest '")+filename+"'");
+    std::vector<BatchJob> jobs;
+    std::string line;
+    LineNo lineNo = 0;
+    while (std::getline(ifs, line))
+    {
+        lineNo++;
+        std::vector<std::string> args = splitManifestLine(line, lineNo);
+        if (!args.empty())
+            jobs.push_back({ lineNo, std::move(args) });
+    }
+    return jobs;
+}
+
+struct BatchJobResult
+{
+    bool done;
+    int ret;
+    std::string messages;
+    std::string printed;
+};
+
+static int runBatchJob(const char* manifestName, const BatchJob& job,
+            BatchJobResult& result)
+{
+    std::ostringstream msgOss;
+    std::ostringstream printOss;
+    int ret = 0;
+    try
+    {
+        std::vector<const char*> argv(job.args.size()+1);
+        argv[0] = "clrxasm";
+        for (size_t i = 0; i < job.args.size(); i++)
+            argv[i+1] = job.args[i].c_str();
+        CLIParser cli("clrxasm", programOptions, argv.size(), argv.data());
+        cli.parse();
+        if (cli.hasLongOption("batch") || cli.hasShortOption('j'))
+            throw Exception("Batch options are not allowed in batch job");
+        ret = assembleFromCLI(cli, msgOss, printOss, true);
+    }
+    catch(const std::bad_alloc& ex)
+    {
+        msgOss << "Out of memory" << std::endl;
+        ret = 1;
+    }
+    catch(const std::exception& ex)
+    {
+        msgOss << ex.what() << std::endl;
+        ret = 1;
+    }
+    if (ret != 0)
+        msgOss << manifestName << ":" << job.lineNo << ": Batch job failed" << std::endl;
+    result.messages = msgOss.str();
+    result.printed = printOss.str();
+    return ret;
+}
+
+/* assemble jobs from manifest in worker threads. messages and printed texts
+ * are written in manifest order after finishing job */
+static int runBatch(const char* manifestName, cxuint jobsNum)
+{
+    const std::vector<BatchJob> jobs = readBatchManifest(manifestName);
+    std::vector<BatchJobResult> results(jobs.size());
+    for (BatchJobResult& result: results)
+        result.done = false;
+    if (jobsNum == 0)
+        jobsNum = std::max(std::thread::hardware_concurrency(), 1U);
+    jobsNum = std::min(size_t(jobsNum), jobs.size());
+    
+    std::atomic<size_t> nextJob(0);
+    std::mutex resultMutex;
+    std::condition_variable resultCond;
+    auto worker = [&]()
+    {
+        size_t i;
+        while ((i = nextJob.fetch_add(1)) < jobs.size())
+        {
+            BatchJobResult result;
+            result.ret = runBatchJob(manifestName, jobs[i], result);
+            std::lock_guard<std::mutex> lock(resultMutex);
+            result.done = true;
+            results[i] = std::move(result);
+            resultCond.notify_all();
+        }
+    };
+    
+    std::vector<std::thread> workers;
+    workers.reserve(jobsNum);
+    for (cxuint t = 0; t < jobsNum; t++)
+        try
+        { workers.push_back(std::thread(worker)); }
+        catch(const std::system_error&)
+        { break; } // if thread can not be created, started workers take all jobs
+    if (workers.empty())
+        worker(); // no thread has been created, run jobs in this thread
+    
+    int ret = 0;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        std::unique_lock<std::mutex> lock(resultMutex);
+        resultCond.wait(lock, [&results,i]() { return results[i].done; });
+        const BatchJobResult result = std::move(results[i]);
+        lock.unlock();
+        std::cout << result.printed;
+        std::cerr << result.messages;
+        if (result.ret != 0)
+            ret = 1;
+    }
+    std::cout.flush();
+    for (std::thread& thread: workers)
+        thread.join();
+    return ret;
+}
+
+int main(int argc, const char** argv)
+try
+{
+    CLIParser cli("clrxasm", programOptions, argc, argv);
+    cli.parse();
+    if (cli.handleHelpOrUsage())
+        return 0;
+    
+    if (cli.hasLongOption("batch"))
+    {
+        if (cli.getArgsNum() != 0)
+            throw Exception("Input files can not be given with batch manifest");
+        cxuint jobsNum = 0;
+        if (cli.hasShortOption('j'))
+            jobsNum = cli.getShortOptArg<cxuint>('j');
+        return runBatch(cli.getLongOptArg<const char*>("batch"), jobsNum);
+    }
+    if (cli.hasShortOption('j'))
+        throw Exception("Number of jobs can be given only with batch manifest");
+    return assembleFromCLI(cli, std::cerr, std::cout, false);
+}
 catch(const Exception& ex)
 {
     std::cerr << ex.what() << std::endl;
@@ -19,7 +19,9 @@
 
 #include <CLRX/Config.h>
 #include <iostream>
+#include <algorithm>
 #include <memory>
+#include <thread>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/utils/CLIParser.h>
 #include <CLRX/amdbin/AmdBinaries.h>
@@ -49,6 +51,8 @@ static const CLIOption programOptions[] =
         "set GPU architecture for Gallium/raw binaries", "ARCH" },
     { "buggyFPLit", 0, CLIArgType::NONE, false, false,
         "use old and buggy fplit rules", nullptr },
+    { "threads", 0, CLIArgType::UINT, false, false,
+        "set number of threads that disassemble kernels and big code", "THREADS" },
     CLRX_CLI_AUTOHELP
     { nullptr, 0 }
 };
@@ -87,6 +91,13 @@ try
     else if (cli.hasShortOption('A'))
         gpuDeviceType = getLowestGPUDeviceTypeFromArchitecture(
                     getGPUArchitectureFromName(cli.getShortOptArg<const char*>('A')));
+    cxuint threadsNum = 1;
+    if (cli.hasLongOption("threads"))
+    {
+        threadsNum = cli.getLongOptArg<cxuint>("threads");
+        if (threadsNum == 0)
+            threadsNum = std::max(std::thread::hardware_concurrency(), 1U);
+    }
     
     int ret = 0;
     for (const char* const* args = cli.getArgs();*args != nullptr; args++)
@@ -117,6 +128,7 @@ try
                         AmdMainGPUBinary32* amdGpuBin =
                                 static_cast<AmdMainGPUBinary32*>(base.get());
                         Disassembler disasm(*amdGpuBin, std::cout, disasmFlags);
+                        disasm.setThreadsNum(threadsNum);
                         disasm.disassemble();
                     }
                     else if (base->getType() == AmdMainType::GPU_64_BINARY)
@@ -124,6 +136,7 @@ try
                         AmdMainGPUBinary64* amdGpuBin =
                                 static_cast<AmdMainGPUBinary64*>(base.get());
                         Disassembler disasm(*amdGpuBin, std::cout, disasmFlags);
+                        disasm.setThreadsNum(threadsNum);
                         disasm.disassemble();
                     }
                     else
@@ -137,18 +150,21 @@ try
                     AmdCL2MainGPUBinary amdBin(binaryData.size(),
                                        binaryData.data(), binFlags);
                     Disassembler disasm(amdBin, std::cout, disasmFlags);
+                    disasm.setThreadsNum(threadsNum);
                     disasm.disassemble();
                 }
                 else if (isROCmBinary(binaryData.size(), binaryData.data()))
                 {   // ROCm binary
                     ROCmBinary rocmBin(binaryData.size(), binaryData.data(), 0);
                     Disassembler disasm(rocmBin, std::cout, disasmFlags);
+                    disasm.setThreadsNum(threadsNum);
                     disasm.disassemble();
                 }
                 else // if gallium binary
                 {
                     GalliumBinary galliumBin(binaryData.size(),binaryData.data(), 0);
                     Disassembler disasm(gpuDeviceType, galliumBin, std::cout, disasmFlags);
+                    disasm.setThreadsNum(threadsNum);
                     disasm.disassemble();
                 }
             }
@@ -156,6 +172,7 @@ try
             {   /* raw binaries */
                 Disassembler disasm(gpuDeviceType, binaryData.size(), binaryData.data(),
                         std::cout, disasmFlags);
+                disasm.setThreadsNum(threadsNum);
                 disasm.disassemble();
             }
         }
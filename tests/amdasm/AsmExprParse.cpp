@@ -22,7 +22,10 @@
 #include <string>
 #include <cstring>
 #include <sstream>
+#include <memory>
+#include <algorithm>
 #include <CLRX/amdasm/Assembler.h>
+#include "../TestUtils.h"
 
 using namespace CLRX;
 
@@ -404,6 +407,13 @@ static AsmExprParseCase asmExprParseCases[] =
         ":cd:4%2Qf:hab<;<@" },
     { "( ala + .,. )", "", false, 0, "<stdin>:1:11: Error: Garbages at end of expression\n"
         "<stdin>:1:12: Error: Garbages at end of expression\n", "" },
+    /* constant folding */
+    { "a+3*4", "a 12 +", false, 0, "", "" },
+    { "(2<<3)+a-(7>>1)", "16 a + 3 -", false, 0, "", "" },
+    { "!(0)+b*(5%%3)", "1 b 2 * +", false, 0, "", "" },
+    { "1?a:(4+5)", "1 a 9 ?", false, 0, "", "" },
+    /* not folded if message will be printed */
+    { "a*(1/0)+(1<<70)", "a 1 0 / * 1 70 << +", false, 0, "", "" },
     /* with ',' */
     { "123+45*,", "", false, 0, "<stdin>:1:8: Error: Unterminated expression\n", "," }
 };
@@ -582,11 +592,59 @@ static void testAsmExprParse(cxuint i, const AsmExprParseCase& testCase, bool ma
                 ", extra='" << testCase.extra << "'.\n";
         throw Exception(oss.str());
     }
+    // all memory of expression must be returned to arena
+    expr.reset();
+    if (assembler.getExpressionArenaStats().usedSize != 0)
+    {
+        std::ostringstream oss;
+        oss << "FAILED for parseExpr#" << i << " snapshot=" << makeBase <<
+                ": arena still holds " << assembler.getExpressionArenaStats().usedSize <<
+                " bytes after freeing expression\n";
+        throw Exception(oss.str());
+    }
+}
+
+static void testSymbolOccurrencesInArena()
+{
+    std::istringstream iss("x+y*x-x");
+    std::ostringstream resultErrorsOut;
+    MyAssembler assembler(iss, resultErrorsOut);
+    size_t linePos = 0;
+    std::unique_ptr<AsmExpression> expr(AsmExpression::parse(assembler, linePos));
+    assertTrue("symOccursInArena", "parsed", expr != nullptr);
+    const AsmSymbolMap& symbolMap = assembler.getSymbolMap();
+    AsmSymbolMap::const_iterator xEntry = symbolMap.find(CString("x"));
+    AsmSymbolMap::const_iterator yEntry = symbolMap.find(CString("y"));
+    assertTrue("symOccursInArena", "symbols",
+               xEntry != symbolMap.end() && yEntry != symbolMap.end());
+    assertValue("symOccursInArena", "xOccurs", size_t(3),
+                xEntry->second.occurrencesInExprs.size());
+    assertValue("symOccursInArena", "yOccurs", size_t(1),
+                yEntry->second.occurrencesInExprs.size());
+    // operators can be still bound to reference to Array (as in older versions)
+    const Array<AsmExprOp>& opsArray = expr->getOps();
+    assertTrue("symOccursInArena", "opsArray", opsArray.size() == expr->getOpsNum() &&
+               std::equal(opsArray.begin(), opsArray.end(), expr->getOps().begin()));
+    const AsmArenaStats& stats = assembler.getExpressionArenaStats();
+    // expression, its arrays and occurrence lists (x list has been grown)
+    assertValue("symOccursInArena", "allocsNum", size_t(5), stats.allocsNum);
+    assertValue("symOccursInArena", "heapAllocsNum", size_t(0), stats.heapAllocsNum);
+    expr.reset();
+    assertTrue("symOccursInArena", "xOccursFreed",
+               xEntry->second.occurrencesInExprs.empty());
+    assertValue("symOccursInArena", "usedSize", size_t(0), stats.usedSize);
 }
 
 int main(int argc, const char** argv)
 {
     int retVal = 0;
+    try
+    { testSymbolOccurrencesInArena(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
     for (cxuint i = 0; i < sizeof(asmExprParseCases)/sizeof(AsmExprParseCase); i++)
     {
         try
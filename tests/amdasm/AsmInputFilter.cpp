@@ -0,0 +1,463 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2016 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <CLRX/utils/Containers.h>
+#include <CLRX/amdasm/Assembler.h>
+#include "../TestUtils.h"
+
+using namespace CLRX;
+
+struct FilteredLine
+{
+    std::string line;
+    std::vector<LineTrans> colTrans;
+};
+
+struct AsmInputFilterTestCase
+{
+    const char* input;
+    Array<FilteredLine> lines;
+    const char* messages;
+};
+
+static const AsmInputFilterTestCase asmInputFilterTestCasesTbl[] =
+{
+    {   /* 0 */
+        "  .byte 1, 2 , 3\n\tv_add_f32 v1, v2, v3   # comment\n",
+        {
+            { "  .byte 1, 2 , 3", { { 0, 1 } } },
+            { " v_add_f32 v1, v2, v3            ", { { 0, 2 } } },
+        },
+        ""
+    },
+    {   /* 1 */
+        "a = 1 /* long\n comment */ b = 2 ; c = 3;d=4\n",
+        {
+            { "a = 1        ", { { 0, 1 } } },
+            { "            b = 2 ", { { 0, 2 } } },
+            { " c = 3", { { -19, 2 } } },
+            { "d=4", { { -26, 2 } } },
+        },
+        ""
+    },
+    {   /* 2 */
+        ".ascii \"ab;c#d\\\"e\" , 'x\\'y' \"unterminated\nnext\n",
+        {
+            { ".ascii \"ab;c#d\\\"e\" , 'x\\'y' \"unterminated", { { 0, 1 } } },
+            { "next", { { 0, 2 } } },
+        },
+        "<stdin>:2:42: Warning: Unterminated string: newline inserted\n<stdin>:3:5: Warning: Unterminated string: newline inserted\n"
+    },
+    {   /* 3 */
+        "s_mov_b32 s1, \\\n  s2 \\\n  ; x\n.byte 1 # aaa \\\n bbb\n",
+        {
+            { "s_mov_b32 s1,   s2   ", { { 0, 1 }, { 14, 2 }, { 19, 3 } } },
+            { " x", { { -3, 3 } } },
+            { ".byte 1           ", { { 0, 4 }, { 14, 5 } } },
+        },
+        ""
+    },
+    {   /* 4 */
+        "v_mad_f32_very_long_identifier_name_that_exceeds_thirty_two_bytes_and_more v1,v2,v3*/*x*/5\n",
+        {
+            { "v_mad_f32_very_long_identifier_name_that_exceeds_thirty_two_bytes_and_more v1,v2,v3*     5", { { 0, 1 } } },
+        },
+        ""
+    },
+    {   /* 5 */
+        "/* unterminated\n long comment",
+        {
+            { "               ", { { 0, 1 } } },
+            { "             ", { { 0, 2 } } },
+        },
+        "<stdin>:2:14: Error: Unterminated multi-line comment\n"
+    },
+    {   /* 6 */
+        "x=1\r\ny=2\r\n\v\fz=3",
+        {
+            { "x=1 ", { { 0, 1 } } },
+            { "y=2 ", { { 0, 2 } } },
+            { "  z=3", { { 0, 3 } } },
+        },
+        ""
+    },
+    {   /* 7 */
+        "\"string\\\ncontinued\" ; 'a\\\nb'\nlast",
+        {
+            { "\"stringcontinued\" ", { { 0, 1 }, { 7, 2 } } },
+            { " 'ab'", { { -12, 2 }, { 3, 3 } } },
+            { "last", { { 0, 4 } } },
+        },
+        ""
+    },
+    {   /* 8 */
+        "a/**/b/*\\\n*/c /\\\n* d */ e**f\n",
+        {
+            { "a    b    c         e**f", { { 0, 1 }, { 8, 2 }, { 13, 3 } } },
+        },
+        ""
+    },
+};
+
+static const AsmLineScanType lineScanTypesTbl[] =
+{ AsmLineScanType::AUTO, AsmLineScanType::SCALAR, AsmLineScanType::SSE2,
+  AsmLineScanType::AVX2 };
+
+static const char* lineScanTypeNamesTbl[] = { "auto", "scalar", "sse2", "avx2" };
+
+static const char* mappedInputName = "AsmInputFilterTest.s";
+
+/* filter input. if mapped is true, input is written to file which is read through
+ * memory mapping, otherwise input is read from stream named as filename */
+static std::vector<FilteredLine> filterInput(const std::string& input,
+            AsmLineScanType scanType, std::string& messages, bool mapped = false,
+            const char* filename = "")
+{
+    std::istringstream emptyIs("");
+    std::ostringstream msgOs;
+    Assembler assembler("", emptyIs, ASM_WARNINGS, BinaryFormat::RAWCODE,
+            GPUDeviceType::CAPE_VERDE, msgOs);
+    std::istringstream is(input);
+    std::unique_ptr<AsmStreamInputFilter> filter;
+    if (mapped)
+    {
+        {
+            std::ofstream ofs(mappedInputName, std::ios::binary);
+            ofs.write(input.data(), input.size());
+        }
+        filter.reset(new AsmStreamInputFilter(mappedInputName));
+        if (!filter->isMappedFile())
+        {
+            std::remove(mappedInputName);
+            throw Exception("Input file is not mapped");
+        }
+    }
+    else
+        filter.reset(new AsmStreamInputFilter(is, filename));
+    filter->setLineScanType(scanType);
+    std::vector<FilteredLine> lines;
+    size_t lineSize;
+    const char* line;
+    while ((line = filter->readLine(assembler, lineSize)) != nullptr)
+        lines.push_back({ std::string(line, lineSize), filter->getColTranslations() });
+    filter.reset();
+    if (mapped)
+        std::remove(mappedInputName);
+    messages = msgOs.str();
+    return lines;
+}
+
+static void checkFilteredLines(const std::string& testName,
+            const Array<FilteredLine>& expected, const std::vector<FilteredLine>& result)
+{
+    assertValue(testName, "linesNum", expected.size(), result.size());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        std::ostringstream lOss;
+        lOss << "line#" << i;
+        lOss.flush();
+        const std::string lName = lOss.str();
+        assertString(testName, lName, expected[i].line.c_str(), result[i].line);
+        assertValue(testName, lName+".colTransSize", expected[i].colTrans.size(),
+                    result[i].colTrans.size());
+        for (size_t j = 0; j < expected[i].colTrans.size(); j++)
+        {
+            std::ostringstream tOss;
+            tOss << lName << ".colTrans#" << j;
+            tOss.flush();
+            const std::string tName = tOss.str();
+            assertValue(testName, tName+".position", expected[i].colTrans[j].position,
+                        result[i].colTrans[j].position);
+            assertValue(testName, tName+".lineNo", expected[i].colTrans[j].lineNo,
+                        result[i].colTrans[j].lineNo);
+        }
+    }
+}
+
+static void testAsmInputFilter(cxuint testId, const AsmInputFilterTestCase& testCase)
+{
+    for (AsmLineScanType scanType: lineScanTypesTbl)
+    {
+        if (!AsmStreamInputFilter::isLineScanTypeSupported(scanType))
+            continue;
+        std::ostringstream oss;
+        oss << "AsmInputFilter#" << testId << "." << lineScanTypeNamesTbl[cxuint(scanType)];
+        oss.flush();
+        const std::string testName = oss.str();
+        std::string messages;
+        std::vector<FilteredLine> result = filterInput(testCase.input, scanType, messages);
+        checkFilteredLines(testName, testCase.lines, result);
+        assertString(testName, "messages", testCase.messages, messages);
+        // same input read from memory mapped file
+        std::string expMessages;
+        filterInput(testCase.input, scanType, expMessages, false, mappedInputName);
+        result = filterInput(testCase.input, scanType, messages, true);
+        checkFilteredLines(testName+".mapped", testCase.lines, result);
+        assertString(testName+".mapped", "messages", expMessages.c_str(), messages);
+    }
+}
+
+/* inputs read through memory mapping: result must be same as read from stream */
+static const char* asmMappedInputsTbl[] =
+{
+    "",
+    "\n",
+    "single line without newline",
+    "line1\nline2\n\nline4\n",
+    "x=1\r\ny=2\r\n\r\nz=3\r\n",
+    "a=1\r\n  b = 2  # comment\r\nc=3",
+    "  .byte 1, 2 /* comm\nent */ , 3\n.int 4\\\n5\n"
+};
+
+/* generate big source (greater than single read from stream) with lines
+ * returned directly from mapping and lines that requires filtering */
+static std::string generateBigInput(size_t size)
+{
+    std::string out;
+    for (cxuint i = 0; out.size() < size; i++)
+    {
+        out += "        v_add_f32 v1, v2, v3\n";
+        out += ".int 1, 2, 3   # comment\r\n";
+        if ((i % 7) == 0)
+            out += "s_mov_b32 s1, \\\n  s2 /* long\n comment */ ; x = 1\n";
+        if ((i % 11) == 0)
+            out += std::string(300, 'a') + "\n"; // very long line
+    }
+    out += "last = 1"; // no newline at end
+    return out;
+}
+
+static void testAsmInputFilterMapped(cxuint testId, const std::string& input)
+{
+    for (AsmLineScanType scanType: lineScanTypesTbl)
+    {
+        if (!AsmStreamInputFilter::isLineScanTypeSupported(scanType))
+            continue;
+        std::ostringstream oss;
+        oss << "AsmInputFilterMapped#" << testId << "." <<
+                lineScanTypeNamesTbl[cxuint(scanType)];
+        oss.flush();
+        const std::string testName = oss.str();
+        std::string expMessages, messages;
+        std::vector<FilteredLine> expLines = filterInput(input, scanType, expMessages,
+                    false, mappedInputName);
+        std::vector<FilteredLine> result = filterInput(input, scanType, messages, true);
+        checkFilteredLines(testName, Array<FilteredLine>(expLines.begin(),
+                    expLines.end()), result);
+        assertString(testName, "messages", expMessages.c_str(), messages);
+        if (input.empty())
+            assertValue(testName, "emptyLinesNum", size_t(0), result.size());
+    }
+}
+
+/* generate random source with many special characters and long runs of
+ * regular characters (to cross vector boundaries) */
+static std::string generateRandomInput(uint32_t seed, size_t size)
+{
+    static const char* pieces[] =
+    {
+        " ", "  ", "\t", "\n", "\r\n", ";", "#", "/*", "*/", "*", "/", "\"", "'",
+        "\\", "\\\n", "v_add_f32", "s_mov_b32", "v0", ",", "0x1234",
+        "very_long_symbol_name_that_is_longer_than_thirty_two_bytes",
+        "abcdefghijklmno", "abcdefghijklmnop", "abcdefghijklmnopq"
+    };
+    const size_t piecesNum = sizeof(pieces)/sizeof(const char*);
+    std::string out;
+    uint32_t x = seed;
+    while (out.size() < size)
+    {
+        x = x*1103515245U + 12345U;
+        out += pieces[(x>>16) % piecesNum];
+    }
+    return out;
+}
+
+/* FNV-1a digest of filtered lines, column translations and messages */
+static uint64_t getFilteredDigest(const std::vector<FilteredLine>& lines,
+            const std::string& messages)
+{
+    std::ostringstream oss;
+    for (const FilteredLine& line: lines)
+    {
+        oss << line.line << '\0';
+        for (const LineTrans& trans: line.colTrans)
+            oss << trans.position << ',' << trans.lineNo << ';';
+        oss << '\n';
+    }
+    oss << messages;
+    uint64_t digest = 14695981039346656037ULL;
+    for (const char c: oss.str())
+        digest = (digest ^ cxbyte(c)) * 1099511628211ULL;
+    return digest;
+}
+
+/* digests of random inputs filtered by AsmStreamInputFilter before SIMD scanning
+ * (input from stream named as mappedInputName) */
+static const uint64_t asmInputFilterRandomDigestsTbl[50] =
+{
+    0x34c01ad367672f24ULL, 0x9a8909f44e5d7666ULL, 0xc10375fc0dfc0427ULL,
+    0x25508541c811238eULL, 0xd9ef45115eb2661cULL, 0x3c1318f129713f1cULL,
+    0xc8fe7396f2eb78d3ULL, 0xa8924e399236eb75ULL, 0xe4f841258decf167ULL,
+    0xe7e0e18851ca0057ULL, 0x61a137f270575544ULL, 0x5c9a9f5dcf2984b9ULL,
+    0x53a88ac476ec8f3bULL, 0xe45e61f9d1afd053ULL, 0x1aa33be045b5378eULL,
+    0x14d0d3d0a7a54526ULL, 0xfe710c96514c1bf8ULL, 0xcea1e3dae5bb67b4ULL,
+    0x54ea90b82ad55161ULL, 0xa9c1835104b6e594ULL, 0x7618cf94201600b1ULL,
+    0x521583cfd0e68a78ULL, 0x703e37e0cbce06beULL, 0xfbe3b3044677300fULL,
+    0x90978f3358a02746ULL, 0x853f3872ed5b7a64ULL, 0xd720b8edfc746b01ULL,
+    0xbc4feeee4fee6d3fULL, 0x2f9d5fe9bec0842eULL, 0xb79f91ea60f5f83cULL,
+    0x8f904b7837dd525fULL, 0xdf6ecacff6d5be8bULL, 0x3d3f99874f10e354ULL,
+    0x56d8be20842d62c7ULL, 0x454e1f6afdaea140ULL, 0xfee0eb4e15532132ULL,
+    0x2cca63103ea559d7ULL, 0xbb8e253f3980c106ULL, 0x37dcaaa1738027c8ULL,
+    0xc458b5cd0d726086ULL, 0x80631ab8618c5b2aULL, 0x4ec6696ad51d28e5ULL,
+    0xee4df0fc8eb9d7d8ULL, 0xfe5fb337ab0fb4c4ULL, 0x6b4f6ad1d4502d3cULL,
+    0x4209969929883afbULL, 0x3e97c278b773956cULL, 0xa7c11cfdc82ec772ULL,
+    0xc1460937bf65b2e5ULL, 0x634b5eebf0b8f019ULL
+};
+
+static void testAsmInputFilterRandom(cxuint testId)
+{
+    const std::string input = generateRandomInput(testId*7919U+1, 4000);
+    for (AsmLineScanType scanType: lineScanTypesTbl)
+    {
+        if (!AsmStreamInputFilter::isLineScanTypeSupported(scanType))
+            continue;
+        for (bool mapped: { false, true })
+        {
+            std::ostringstream oss;
+            oss << "AsmInputFilterRandom#" << testId << "." <<
+                    lineScanTypeNamesTbl[cxuint(scanType)] << (mapped ? ".mapped" : "");
+            oss.flush();
+            const std::string testName = oss.str();
+            std::string messages;
+            std::vector<FilteredLine> result = filterInput(input, scanType, messages,
+                        mapped, mappedInputName);
+            assertValue(testName, "digest", asmInputFilterRandomDigestsTbl[testId],
+                        getFilteredDigest(result, messages));
+        }
+    }
+}
+
+struct AsmMacroFilterTestCase
+{
+    const char* body;
+    Array<FilteredLine> lines;
+};
+
+static const AsmMacroFilterTestCase asmMacroFilterTestCasesTbl[] =
+{
+    {   /* 0 */
+        "  v_add_f32 v\\a, v\\b, v\\a   # comment\n"
+        "  .int \\@, \\a\\()1, \\c \\x, \\\\b\n"
+        "  s_mov_b32 s\\a, \\\n  s\\b ; .byte \\a ; .byte \\b\n"
+        "  .byte \\a+\\b,\\b\n"
+        "\n",
+        {
+            { "  v_add_f32 v12, vxyz, v12            ", { { 0, 1 } } },
+            { "  .int 7, 121, \\c \\x, \\xyz", { { 0, 2 } } },
+            { "  s_mov_b32 s12,   sxyz ", { { 0, 3 }, { 17, 4 } } },
+            { " .byte 12 ", { { -8, 4 } } },
+            { " .byte xyz", { { -19, 4 } } },
+            { "  .byte 12+xyz,xyz", { { 0, 5 } } },
+            { "", { { 0, 6 } } }
+        }
+    }
+};
+
+/* macro body is filtered by stream filter, and it is substituted
+ * with arguments a=12, b=xyz and macro count 7 */
+static void testAsmMacroFilter(cxuint testId, const AsmMacroFilterTestCase& testCase)
+{
+    std::ostringstream oss;
+    oss << "AsmMacroFilter#" << testId;
+    oss.flush();
+    const std::string testName = oss.str();
+    std::istringstream emptyIs("");
+    std::ostringstream msgOs;
+    Assembler assembler("", emptyIs, ASM_WARNINGS, BinaryFormat::RAWCODE,
+            GPUDeviceType::CAPE_VERDE, msgOs);
+    std::istringstream is(testCase.body);
+    AsmStreamInputFilter bodyFilter(is, "");
+    AsmMacro* macro = new AsmMacro(AsmSourcePos(), Array<AsmMacroArg>({
+            { "a", "", false, false }, { "b", "", false, false } }));
+    RefPtr<const AsmMacro> macroRef(macro);
+    size_t lineSize;
+    const char* line;
+    while ((line = bodyFilter.readLine(assembler, lineSize)) != nullptr)
+        macro->addLine(RefPtr<const AsmMacroSubst>(), bodyFilter.getSource(),
+                bodyFilter.getColTranslations(), lineSize, line);
+    
+    AsmMacroInputFilter filter(macroRef, AsmSourcePos(), AsmMacroInputFilter::MacroArgMap({
+            { "a", "12" }, { "b", "xyz" } }), 7, false);
+    std::vector<FilteredLine> result;
+    while ((line = filter.readLine(assembler, lineSize)) != nullptr)
+        result.push_back({ std::string(line, lineSize), filter.getColTranslations() });
+    checkFilteredLines(testName, testCase.lines, result);
+}
+
+int main(int argc, const char** argv)
+{
+    int retVal = 0;
+    for (cxuint i = 0; i < sizeof(asmInputFilterTestCasesTbl)/
+                    sizeof(AsmInputFilterTestCase); i++)
+        try
+        { testAsmInputFilter(i, asmInputFilterTestCasesTbl[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    for (cxuint i = 0; i < sizeof(asmMacroFilterTestCasesTbl)/
+                    sizeof(AsmMacroFilterTestCase); i++)
+        try
+        { testAsmMacroFilter(i, asmMacroFilterTestCasesTbl[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    const size_t mappedInputsNum = sizeof(asmMappedInputsTbl)/sizeof(const char*);
+    for (cxuint i = 0; i <= mappedInputsNum; i++)
+        try
+        {
+            testAsmInputFilterMapped(i, (i < mappedInputsNum) ? 
+                    std::string(asmMappedInputsTbl[i]) : generateBigInput(1U<<20));
+        }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    for (cxuint i = 0; i < 50; i++)
+        try
+        { testAsmInputFilterRandom(i); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    return retVal;
+}
@@ -0,0 +1,159 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2016 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <CLRX/utils/Containers.h>
+#include <CLRX/amdasm/Assembler.h>
+#include "../TestUtils.h"
+
+using namespace CLRX;
+
+static const char* macroLibSource = R"ffDXD(.macro outer x, y=3, z:vararg
+    .byte \x, \y
+    .byte \z
+    inner \x
+.endm
+.macro inner a:req
+    .byte \a, \
+        zzz+
+.endm
+.irp n, a, b
+.macro mk\n v
+    .byte \v+\n
+.endm
+.endr
+)ffDXD";
+
+static const char* macroLibName = "AsmMacroLibraryTest.macl";
+
+static const char* macroLibUseSource = R"ffDXD(a = 5
+b = 7
+.usemacrolib "AsmMacroLibraryTest.macl"
+    outer 1,2,5,6
+    mkb 4
+    mka 3
+)ffDXD";
+
+static const char* macroLibUseMessages =
+    "In macro substituted from lib.s:4:5;\n"
+    "                     from test.s:4:5:\n"
+    "lib.s:8:13: Error: Unterminated expression\n";
+
+static std::string generateMacroLib()
+{
+    std::istringstream input(macroLibSource);
+    std::ostringstream errorStream;
+    std::ostringstream printStream;
+    Assembler assembler("lib.s", input, (ASM_ALL|ASM_TESTRUN)&~ASM_ALTMACRO,
+            BinaryFormat::RAWCODE, GPUDeviceType::CAPE_VERDE, errorStream, printStream);
+    assertTrue("MacroLib", "good", assembler.assemble());
+    std::ostringstream libStream;
+    assembler.writeMacroLibrary(libStream);
+    return libStream.str();
+}
+
+static void testMacroLibRoundTrip(const std::string& lib)
+{
+    const AsmMacroList macros = readAsmMacroLibrary(lib.size(),
+                (const cxbyte*)lib.data());
+    assertValue("MacroLib", "macros.length", size_t(4), macros.size());
+    const char* names[4] = { "inner", "mka", "mkb", "outer" };
+    for (size_t i = 0; i < 4; i++)
+        assertString("MacroLib", "name", names[i], macros[i].first.c_str());
+
+    const AsmMacro& outer = *macros[3].second.operator->();
+    assertValue("MacroLib", "outer.args", size_t(3), outer.getArgsNum());
+    assertString("MacroLib", "outer.arg1.default", "3",
+                 outer.getArg(1).defaultValue.c_str());
+    assertTrue("MacroLib", "outer.arg2.vararg", outer.getArg(2).vararg);
+    assertTrue("MacroLib", "inner.arg0.required",
+               macros[0].second->getArg(0).required);
+    assertValue("MacroLib", "outer.lineNo", LineNo(1), outer.getSourcePos().lineNo);
+    assertString("MacroLib", "outer.file", "lib.s", outer.getSourcePos().source.
+                staticCast<const AsmFile>()->file.c_str());
+
+    // writing loaded macros must give same library
+    std::ostringstream libStream;
+    writeAsmMacroLibrary(libStream, macros);
+    assertTrue("MacroLib", "roundTrip", lib == libStream.str());
+
+    // truncated library must be rejected
+    bool failed = false;
+    try
+    { readAsmMacroLibrary(lib.size()-1, (const cxbyte*)lib.data()); }
+    catch(const Exception& ex)
+    { failed = true; }
+    assertTrue("MacroLib", "truncated", failed);
+    
+    // too many macro arguments for library size must be rejected before allocation
+    std::string badLib = lib.substr(0, 12);
+    badLib.append("\0\0\0\0" "\1\0\0\0" "\0\0\0\0" "\0\0\0\0\0\0\0\0"
+            "\0\0\0\0\0\0\0\0" "\0\0\0\0\0\0\0\0" "\xff\xff\xff\xff", 40);
+    failed = false;
+    try
+    { readAsmMacroLibrary(badLib.size(), (const cxbyte*)badLib.data()); }
+    catch(const Exception& ex)
+    { failed = true; }
+    assertTrue("MacroLib", "tooManyArgs", failed);
+}
+
+static void testMacroLibUse(const std::string& lib)
+{
+    {
+        std::ofstream ofs(macroLibName, std::ios::binary);
+        ofs.write(lib.data(), lib.size());
+    }
+    std::istringstream input(macroLibUseSource);
+    std::ostringstream errorStream;
+    std::ostringstream printStream;
+    Assembler assembler("test.s", input, (ASM_ALL|ASM_TESTRUN)&~ASM_ALTMACRO,
+            BinaryFormat::RAWCODE, GPUDeviceType::CAPE_VERDE, errorStream, printStream);
+    const bool good = assembler.assemble();
+    std::remove(macroLibName);
+    assertTrue("MacroLibUse", "failed", !good);
+    assertString("MacroLibUse", "errorMessages", macroLibUseMessages,
+                 errorStream.str().c_str());
+    const std::vector<AsmSection>& sections = assembler.getSections();
+    assertValue("MacroLibUse", "sections.length", size_t(1), sections.size());
+    assertArray<cxbyte>("MacroLibUse", "content", Array<cxbyte>(
+            { 1, 2, 5, 6, 1, 11, 8 }), sections[0].content);
+}
+
+int main(int argc, const char** argv)
+{
+    int retVal = 0;
+    try
+    {
+        const std::string lib = generateMacroLib();
+        testMacroLibRoundTrip(lib);
+        testMacroLibUse(lib);
+    }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    return retVal;
+}
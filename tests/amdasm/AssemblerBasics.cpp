@@ -19,11 +19,17 @@
 
 #include <CLRX/Config.h>
 #include <iostream>
+#include <fstream>
 #include <cstdio>
+#include <cstring>
+#include <vector>
 #include <sstream>
 #include <memory>
+#include <stdexcept>
 #include <CLRX/utils/Containers.h>
 #include <CLRX/amdasm/Assembler.h>
+#include <CLRX/amdbin/AmdBinaries.h>
+#include <CLRX/amdbin/AmdCL2Binaries.h>
 #include "../TestUtils.h"
 
 using namespace CLRX;
@@ -3617,6 +3623,39 @@ loop:   .rept 10
             { "cloopc", 44U, 0, 0U, true, true, false, 0, 0 }
         },
         true, "", ""
+    },
+    /* repeated include (cached content) */
+    {   R"ffDXD(            .rept 3
+            .include "inc1.s"
+            .endr
+            .include "inc3.s"
+            .include "inc1.s")ffDXD",
+        BinaryFormat::AMD, GPUDeviceType::CAPE_VERDE, false, { },
+        { { nullptr, ASMKERN_GLOBAL, AsmSectionType::DATA,
+            { 11,22,44,55, 11,22,44,55, 11,22,44,55, 31,23,44,55, 11,22,44,55 } } },
+        { { ".", 20U, 0, 0U, true, false, false, 0, 0 } },
+        true, "", "",
+        { CLRX_SOURCE_DIR "/tests/amdasm/incdir0", CLRX_SOURCE_DIR "/tests/amdasm/incdir1" }
+    },
+    /* local labels with leading zeroes and big numbers */
+    {   R"ffDXD(        .byte 1f, 01f, 123456f
+1:      .byte 1b, 1f
+01:     .byte 01b, 1b
+123456: .byte 123456b
+1:      .byte 1b)ffDXD",
+        BinaryFormat::AMD, GPUDeviceType::CAPE_VERDE, false, { },
+        { { nullptr, ASMKERN_GLOBAL, AsmSectionType::DATA,
+            { 3, 5, 7, 3, 8, 5, 3, 7, 8 } } },
+        {
+            { ".", 9U, 0, 0U, true, false, false, 0, 0 },
+            { "01b", 5U, 0, 0U, true, false, false, 0, 0 },
+            { "01f", 5U, 0, 0U, false, false, false, 0, 0 },
+            { "123456b", 7U, 0, 0U, true, false, false, 0, 0 },
+            { "123456f", 7U, 0, 0U, false, false, false, 0, 0 },
+            { "1b", 8U, 0, 0U, true, false, false, 0, 0 },
+            { "1f", 8U, 0, 0U, false, false, false, 0, 0 }
+        },
+        true, "", ""
     }
 };
 
@@ -3720,9 +3759,433 @@ static void testAssembler(cxuint testId, const AsmTestCase& testCase)
     assertString(testName, "printMessages", testCase.printMessages, printMsgs);
 }
 
+static void testAssemblerStats()
+{
+    std::istringstream input(R"ffDXD(
+        .rawcode
+        .macro putx a
+        .int \a, \a+1
+        .endm
+        .rept 3
+        putx 5
+        .endr
+        s_mov_b32 s1, s2
+        sym = 7
+        .byte sym
+)ffDXD");
+    std::ostringstream errorStream;
+    std::ostringstream printStream;
+    Assembler assembler("test.s", input, ASM_WARNINGS|ASM_STATS, BinaryFormat::AMD,
+            GPUDeviceType::CAPE_VERDE, errorStream, printStream);
+    assertTrue("AsmStats", "good", assembler.assemble());
+    Array<cxbyte> output;
+    assembler.writeBinary(output);
+    const AsmStats& stats = assembler.getStats();
+    assertValue("AsmStats", "linesNum", uint64_t(17), stats.linesNum);
+    assertValue("AsmStats", "macroSubstsNum", uint64_t(3), stats.macroSubstsNum);
+    assertValue("AsmStats", "repetitionsNum", uint64_t(1), stats.repetitionsNum);
+    assertValue("AsmStats", "expressionsNum", uint64_t(9), stats.expressionsNum);
+    assertValue("AsmStats", "symbolsNum", size_t(2), stats.symbolsNum);
+    assertValue("AsmStats", "sectionsSize", uint64_t(29), stats.sectionsSize);
+    assertTrue("AsmStats", "encodingTime", stats.encodingTime > 0.0);
+    assertTrue("AsmStats", "macroTime", stats.macroTime > 0.0);
+    assertValue("AsmStats", "fixupsNum", uint64_t(0), stats.fixupsNum);
+    
+    // jumps to forward labels are fixups, not expressions
+    std::istringstream input2(R"ffDXD(
+        .rawcode
+        s_branch lab1
+        s_cbranch_scc0 lab2+4
+        s_branch lab1+x
+        s_branch lab1
+lab1:   s_endpgm
+lab2:   s_nop 1
+        x = 4
+)ffDXD");
+    Assembler assembler2("test.s", input2, ASM_WARNINGS|ASM_STATS, BinaryFormat::RAWCODE,
+            GPUDeviceType::CAPE_VERDE, errorStream, printStream);
+    assertTrue("AsmStats", "good2", assembler2.assemble());
+    const AsmStats& stats2 = assembler2.getStats();
+    assertValue("AsmStats", "fixupsNum2", uint64_t(2), stats2.fixupsNum);
+    // 'lab1+x', 'lab1' (already used in expression), s_nop operand and '4'
+    assertValue("AsmStats", "expressionsNum2", uint64_t(4), stats2.expressionsNum);
+}
+
+static void testSymbolMapHash()
+{
+    // names with common suffix or prefix must be spread over slots
+    const char* formats[2] = { "sym%u_shared_suffix_name", "shared_prefix_name_sym%u" };
+    for (cxuint f = 0; f < 2; f++)
+    {
+        std::vector<bool> used(4096);
+        size_t usedNum = 0;
+        for (cxuint i = 0; i < 4096; i++)
+        {
+            char name[64];
+            snprintf(name, sizeof name, formats[f], i);
+            const size_t slot = AsmSymbolMap::hashName(name, ::strlen(name)) & 4095;
+            if (!used[slot])
+                usedNum++;
+            used[slot] = true;
+        }
+        // random hash fills about 63% of slots
+        assertTrue("AsmSymbolMap", std::string("slotsUsed.")+formats[f], usedNum > 2400);
+    }
+    
+    AsmSymbolMap symbolMap;
+    for (cxuint i = 0; i < 40000; i++)
+    {
+        char name[64];
+        snprintf(name, sizeof name, formats[0], i);
+        symbolMap.insert(std::make_pair(CString(name), AsmSymbol(0, uint64_t(i))));
+    }
+    assertValue("AsmSymbolMap", "size", size_t(40000), symbolMap.size());
+    for (cxuint i = 0; i < 40000; i += 997)
+    {
+        char name[64];
+        snprintf(name, sizeof name, formats[0], i);
+        AsmSymbolMap::const_iterator it = symbolMap.find(CString(name));
+        assertTrue("AsmSymbolMap", std::string("found.")+name, it != symbolMap.end());
+        assertValue("AsmSymbolMap", std::string("value.")+name, uint64_t(i),
+                    it->second.value);
+    }
+    // lookup interface of std::unordered_map
+    const AsmSymbolMap& constMap = symbolMap;
+    assertValue("AsmSymbolMap", "count", size_t(1),
+                constMap.count("sym7_shared_suffix_name"));
+    assertValue("AsmSymbolMap", "countMissing", size_t(0), constMap.count("nosym"));
+    assertValue("AsmSymbolMap", "at", uint64_t(7),
+                constMap.at("sym7_shared_suffix_name").value);
+    bool notFound = false;
+    try
+    { constMap.at("nosym"); }
+    catch(const std::out_of_range&)
+    { notFound = true; }
+    assertTrue("AsmSymbolMap", "atMissing", notFound);
+}
+
+/* write binary to file (raw code is written by gathered writes) and compare */
+static void checkFileOutput(const char* testName, const Assembler& assembler,
+            const std::vector<cxbyte>& expected)
+{
+    const char* filename = "AsmSectionOutputTest.bin";
+    assembler.writeBinary(filename);
+    const Array<cxbyte> output = loadDataFromFile(filename);
+    std::remove(filename);
+    assertArray<cxbyte>(testName, "fileOutput", Array<cxbyte>(
+            expected.begin(), expected.end()), output);
+}
+
+static void testSectionFills()
+{
+    std::istringstream input(R"ffDXD(
+        .rawcode
+        .byte 1,2
+        .skip 1000, 0x5a
+        .int x
+        .fill 300, 4, 0x11223344
+        .int y
+        s_endpgm
+        .org .+600
+        .fill 400, 2, 0x7788
+        .int x+1
+        x = 0x33
+        y = 0x44
+)ffDXD");
+    std::ostringstream errorStream;
+    std::ostringstream printStream;
+    Assembler assembler("test.s", input, ASM_WARNINGS, BinaryFormat::AMD,
+            GPUDeviceType::CAPE_VERDE, errorStream, printStream);
+    assertTrue("SectionFills", "good", assembler.assemble());
+    // build expected content
+    std::vector<cxbyte> expected = { 1, 2 };
+    expected.insert(expected.end(), 1000, 0x5a);
+    expected.insert(expected.end(), { 0x33, 0, 0, 0 });
+    for (cxuint i = 0; i < 300; i++)
+        expected.insert(expected.end(), { 0x44, 0x33, 0x22, 0x11 });
+    expected.insert(expected.end(), { 0x44, 0, 0, 0 });
+    expected.insert(expected.end(), { 0x00, 0x00, 0x81, 0xbf }); // s_endpgm
+    expected.insert(expected.end(), 600, 0);
+    for (cxuint i = 0; i < 400; i++)
+        expected.insert(expected.end(), { 0x88, 0x77 });
+    expected.insert(expected.end(), { 0x34, 0, 0, 0 });
+    // write through stream (fill runs are written directly)
+    std::ostringstream outStream;
+    assembler.writeBinary(outStream);
+    const std::string outStr = outStream.str();
+    assertArray<cxbyte>("SectionFills", "streamOutput", Array<cxbyte>(
+            expected.begin(), expected.end()), outStr.size(),
+            (const cxbyte*)outStr.data());
+    Array<cxbyte> output;
+    assembler.writeBinary(output);
+    assertArray<cxbyte>("SectionFills", "output", Array<cxbyte>(
+            expected.begin(), expected.end()), output);
+    checkFileOutput("SectionFills", assembler, expected);
+    const AsmSection& section = assembler.getSections()[0];
+    assertTrue("SectionFills", "noFills", section.fills.empty());
+    // assembler sections are not changed by getSections
+    const AsmSection& rawSection = assembler.getRawSections()[0];
+    assertTrue("SectionFills", "fillsKept", !rawSection.fills.empty());
+    assertValue("SectionFills", "rawSectionSize", uint64_t(expected.size()),
+            rawSection.getSize());
+    assertValue("SectionFills", "sectionSize", uint64_t(expected.size()),
+            section.getSize());
+    assertArray<cxbyte>("SectionFills", "content", Array<cxbyte>(
+            expected.begin(), expected.end()), section.content);
+}
+
+static void testIncBinMapped()
+{
+    // big regions of file are held as references to mapped file
+    std::istringstream input(R"ffDXD(
+        .rawcode
+        .byte 1
+        .incbin "samplekernels.clo", 100, 5000
+        .int x
+        .incbin "samplekernels.clo"
+        .incbin "samplekernels.clo", 16000
+        x = 0x55
+)ffDXD");
+    std::ostringstream errorStream;
+    std::ostringstream printStream;
+    Assembler assembler("test.s", input, ASM_WARNINGS, BinaryFormat::AMD,
+            GPUDeviceType::CAPE_VERDE, errorStream, printStream);
+    assembler.addIncludeDir(CLRX_SOURCE_DIR "/tests/amdasm/amdbins");
+    assertTrue("IncBinMapped", "good", assembler.assemble());
+    const Array<cxbyte> file = loadDataFromFile(
+                CLRX_SOURCE_DIR "/tests/amdasm/amdbins/samplekernels.clo");
+    std::vector<cxbyte> expected = { 1 };
+    expected.insert(expected.end(), file.begin()+100, file.begin()+5100);
+    expected.insert(expected.end(), { 0x55, 0, 0, 0 });
+    expected.insert(expected.end(), file.begin(), file.end());
+    expected.insert(expected.end(), file.begin()+16000, file.end());
+    std::ostringstream outStream;
+    assembler.writeBinary(outStream);
+    const std::string outStr = outStream.str();
+    assertArray<cxbyte>("IncBinMapped", "streamOutput", Array<cxbyte>(
+            expected.begin(), expected.end()), outStr.size(),
+            (const cxbyte*)outStr.data());
+    checkFileOutput("IncBinMapped", assembler, expected);
+    const AsmSection& section = assembler.getSections()[0];
+    assertArray<cxbyte>("IncBinMapped", "content", Array<cxbyte>(
+            expected.begin(), expected.end()), section.content);
+}
+
+static void writeIncBinFile(const char* filename, const std::vector<cxbyte>& data)
+{
+    std::ofstream ofs(filename, std::ios::binary);
+    ofs.write((const char*)data.data(), data.size());
+    if (!ofs)
+        throw Exception("Can't write test file");
+}
+
+static void testIncBinSameOutput()
+{
+    const char* filename = "AsmIncBinTest.bin";
+    std::vector<cxbyte> fileData(10000);
+    for (size_t i = 0; i < fileData.size(); i++)
+        fileData[i] = cxbyte(i*7+(i>>8));
+    writeIncBinFile(filename, fileData);
+    std::vector<cxbyte> expected = { 1 };
+    expected.insert(expected.end(), fileData.begin(), fileData.end());
+    expected.insert(expected.end(), fileData.begin()+5000, fileData.end());
+    expected.push_back(2);
+    
+    const char* source = R"ffDXD(
+        .rawcode
+        .byte 1
+        .incbin "AsmIncBinTest.bin"
+        .incbin "AsmIncBinTest.bin", 5000
+        .byte 2
+)ffDXD";
+    {   // output is file included by .incbin
+        std::istringstream input(source);
+        std::ostringstream errorStream;
+        Assembler assembler("test.s", input, ASM_WARNINGS, BinaryFormat::RAWCODE,
+                GPUDeviceType::CAPE_VERDE, errorStream, errorStream);
+        assertTrue("IncBinSameOutput", "good", assembler.assemble());
+        assembler.writeBinary(filename);
+        const Array<cxbyte> output = loadDataFromFile(filename);
+        assertArray<cxbyte>("IncBinSameOutput", "output", Array<cxbyte>(
+                expected.begin(), expected.end()), output);
+    }
+    
+    writeIncBinFile(filename, fileData);
+    {   // file included by .incbin has been changed while assembling
+        std::istringstream input(source);
+        std::ostringstream errorStream;
+        Assembler assembler("test.s", input, ASM_WARNINGS, BinaryFormat::RAWCODE,
+                GPUDeviceType::CAPE_VERDE, errorStream, errorStream);
+        assertTrue("IncBinSameOutput", "good2", assembler.assemble());
+        writeIncBinFile(filename, std::vector<cxbyte>(100, 0x11));
+        bool changedError = false;
+        try
+        {
+            Array<cxbyte> output;
+            assembler.writeBinary(output);
+        }
+        catch(const Exception& ex)
+        { changedError = true; }
+        assertTrue("IncBinSameOutput", "changedError", changedError);
+    }
+    std::remove(filename);
+}
+
+static const char* dedupAmdSource = R"ffDXD(
+        .amd
+        .gpu Pitcairn
+        .driver_version 140000
+        .kernel a
+            .config
+                .dims x
+            .text
+                s_mov_b32 s1, s2
+                s_endpgm
+        .kernel b
+            .config
+                .dims x
+            .text
+                s_mov_b32 s1, s3
+                s_endpgm
+        .kernel c
+            .config
+                .dims x
+            .text
+                s_mov_b32 s1, s2
+                s_endpgm
+)ffDXD";
+
+static const char* dedupAmdCL2Source = R"ffDXD(
+        .amdcl2
+        .gpu Bonaire
+        .driver_version 200406
+        .kernel a
+            .config
+                .dims x
+            .text
+                s_mov_b32 s1, s2
+                s_endpgm
+        .kernel b
+            .config
+                .dims x
+            .text
+                s_mov_b32 s1, s3
+                s_endpgm
+        .kernel c
+            .config
+                .dims x
+            .text
+                s_mov_b32 s1, s2
+                s_endpgm
+)ffDXD";
+
+static Array<cxbyte> assembleForDedup(const char* source, BinaryFormat binFormat,
+            Flags flags, uint64_t& dedupSavedSize)
+{
+    std::istringstream input(source);
+    std::ostringstream errorStream;
+    std::ostringstream printStream;
+    Assembler assembler("test.s", input, ASM_WARNINGS|ASM_TESTRUN|flags, binFormat,
+            GPUDeviceType::CAPE_VERDE, errorStream, printStream);
+    assertTrue("Dedup", "good", assembler.assemble());
+    Array<cxbyte> binary;
+    assembler.writeBinary(binary);
+    dedupSavedSize = assembler.getStats().dedupSavedSize;
+    return binary;
+}
+
+static void testDeduplication()
+{
+    // AMD binaries: identical inner binaries are stored once
+    uint64_t savedSize = 0;
+    Array<cxbyte> plainBin = assembleForDedup(dedupAmdSource, BinaryFormat::AMD,
+                0, savedSize);
+    assertValue("DedupAmd", "savedSizeNoDedup", uint64_t(0), savedSize);
+    Array<cxbyte> dedupBin = assembleForDedup(dedupAmdSource, BinaryFormat::AMD,
+                ASM_DEDUP, savedSize);
+    assertTrue("DedupAmd", "savedSize", savedSize != 0);
+    assertTrue("DedupAmd", "size", dedupBin.size() < plainBin.size());
+    {
+        AmdMainGPUBinary32 binary(dedupBin.size(), dedupBin.data());
+        assertValue("DedupAmd", "innerBinsNum", size_t(3), binary.getInnerBinariesNum());
+        const AmdInnerGPUBinary32& innerA = binary.getInnerBinary(size_t(0));
+        const AmdInnerGPUBinary32& innerB = binary.getInnerBinary(size_t(1));
+        const AmdInnerGPUBinary32& innerC = binary.getInnerBinary(size_t(2));
+        assertString("DedupAmd", "innerName0", "a", innerA.getKernelName());
+        assertString("DedupAmd", "innerName2", "c", innerC.getKernelName());
+        assertTrue("DedupAmd", "sharedAC",
+                   innerA.getBinaryCode() == innerC.getBinaryCode());
+        assertTrue("DedupAmd", "notSharedAB",
+                   innerA.getBinaryCode() != innerB.getBinaryCode());
+        assertValue("DedupAmd", "sizeAC", innerA.getSize(), innerC.getSize());
+    }
+    
+    // AMD OpenCL 2.0 binaries: identical setups and codes are stored once
+    plainBin = assembleForDedup(dedupAmdCL2Source, BinaryFormat::AMDCL2, 0, savedSize);
+    assertValue("DedupAmdCL2", "savedSizeNoDedup", uint64_t(0), savedSize);
+    dedupBin = assembleForDedup(dedupAmdCL2Source, BinaryFormat::AMDCL2, ASM_DEDUP,
+                savedSize);
+    assertTrue("DedupAmdCL2", "savedSize", savedSize != 0);
+    assertTrue("DedupAmdCL2", "size", dedupBin.size() < plainBin.size());
+    {
+        AmdCL2MainGPUBinary binary(dedupBin.size(), dedupBin.data());
+        const AmdCL2InnerGPUBinary& innerBin = binary.getInnerBinary();
+        assertValue("DedupAmdCL2", "kernelsNum", size_t(3),
+                    innerBin.getKernelsNum());
+        const AmdCL2GPUKernel& kernelA = innerBin.getKernelData("a");
+        const AmdCL2GPUKernel& kernelB = innerBin.getKernelData("b");
+        const AmdCL2GPUKernel& kernelC = innerBin.getKernelData("c");
+        assertTrue("DedupAmdCL2", "sharedAC", kernelA.setup == kernelC.setup);
+        assertTrue("DedupAmdCL2", "notSharedAB", kernelA.setup != kernelB.setup);
+        assertValue("DedupAmdCL2", "codeSizeC", size_t(8), kernelC.codeSize);
+    }
+}
+
 int main(int argc, const char** argv)
 {
     int retVal = 0;
+    try
+    { testAssemblerStats(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testSymbolMapHash(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testSectionFills(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testIncBinMapped(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testIncBinSameOutput(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testDeduplication(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
     for (size_t i = 0; i < sizeof(asmTestCases1Tbl)/sizeof(AsmTestCase); i++)
         try
         { testAssembler(i, asmTestCases1Tbl[i]); }
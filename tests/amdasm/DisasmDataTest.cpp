@@ -1387,7 +1387,8 @@ data2:
     }
 };
 
-static void testDisasmData(cxuint testId, const DisasmAmdTestCase& testCase)
+static void testDisasmData(cxuint testId, const DisasmAmdTestCase& testCase,
+            cxuint threadsNum)
 {
     std::ostringstream disasmOss;
     std::string resultStr;
@@ -1399,12 +1400,14 @@ static void testDisasmData(cxuint testId, const DisasmAmdTestCase& testCase)
         if (testCase.amdInput != nullptr)
         {
             Disassembler disasm(testCase.amdInput, disasmOss, disasmFlags);
+            disasm.setThreadsNum(threadsNum);
             disasm.disassemble();
             resultStr = disasmOss.str();
         }
         else if (testCase.galliumInput != nullptr)
         {
             Disassembler disasm(testCase.galliumInput, disasmOss, disasmFlags);
+            disasm.setThreadsNum(threadsNum);
             disasm.disassemble();
             resultStr = disasmOss.str();
         }
@@ -1422,6 +1425,7 @@ static void testDisasmData(cxuint testId, const DisasmAmdTestCase& testCase)
                     AMDBIN_CREATE_INFOSTRINGS));
             AmdMainGPUBinary32* amdGpuBin = static_cast<AmdMainGPUBinary32*>(base.get());
             Disassembler disasm(*amdGpuBin, disasmOss, disasmFlags);
+            disasm.setThreadsNum(threadsNum);
             disasm.disassemble();
             resultStr = disasmOss.str();
         }
@@ -1434,6 +1438,7 @@ static void testDisasmData(cxuint testId, const DisasmAmdTestCase& testCase)
                 AMDBIN_CREATE_INFOSTRINGS | AMDCL2BIN_INNER_CREATE_KERNELDATA |
                 AMDCL2BIN_INNER_CREATE_KERNELDATAMAP | AMDCL2BIN_INNER_CREATE_KERNELSTUBS);
             Disassembler disasm(amdBin, disasmOss, disasmFlags);
+            disasm.setThreadsNum(threadsNum);
             disasm.disassemble();
             resultStr = disasmOss.str();
         }
@@ -1441,6 +1446,7 @@ static void testDisasmData(cxuint testId, const DisasmAmdTestCase& testCase)
         {
             ROCmBinary rocmBin(binaryData.size(), binaryData.data(), 0);
             Disassembler disasm(rocmBin, disasmOss, disasmFlags);
+            disasm.setThreadsNum(threadsNum);
             disasm.disassemble();
             resultStr = disasmOss.str();
         }
@@ -1449,6 +1455,7 @@ static void testDisasmData(cxuint testId, const DisasmAmdTestCase& testCase)
             GalliumBinary galliumBin(binaryData.size(),binaryData.data(), 0);
             Disassembler disasm(GPUDeviceType::CAPE_VERDE, galliumBin,
                             disasmOss, disasmFlags);
+            disasm.setThreadsNum(threadsNum);
             disasm.disassemble();
             resultStr = disasmOss.str();
         }
@@ -1457,7 +1464,7 @@ static void testDisasmData(cxuint testId, const DisasmAmdTestCase& testCase)
     if (::strcmp(testCase.expectedString, resultStr.c_str()) != 0)
     {   // print error
         std::ostringstream oss;
-        oss << "Failed for #" << testId << std::endl;
+        oss << "Failed for #" << testId << " threads=" << threadsNum << std::endl;
         oss << resultStr << std::endl;
         oss.flush();
         throw Exception(oss.str());
@@ -1468,12 +1475,13 @@ int main(int argc, const char** argv)
 {
     int retVal = 0;
     for (cxuint i = 0; i < sizeof(disasmDataTestCases)/sizeof(DisasmAmdTestCase); i++)
-        try
-        { testDisasmData(i, disasmDataTestCases[i]); }
-        catch(const std::exception& ex)
-        {
-            std::cerr << ex.what() << std::endl;
-            retVal = 1;
-        }
+        for (cxuint threadsNum: { 1U, 3U })
+            try
+            { testDisasmData(i, disasmDataTestCases[i], threadsNum); }
+            catch(const std::exception& ex)
+            {
+                std::cerr << ex.what() << std::endl;
+                retVal = 1;
+            }
     return retVal;
 }
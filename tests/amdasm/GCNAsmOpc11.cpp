@@ -418,6 +418,17 @@ const GCNAsmOpcodeCase encGCNOpcodeCases[] =
         "test.s:1:14: Error: Jump over current section!\n" },
     { ".rodata\nxxxx:.text\n    s_branch xxxx+8", 0, 0, false, false,
         "test.s:3:14: Error: Jump over current section!\n" },
+    { "    s_branch 1f\n1:\n", 0xbf820000U, 0, false, true, "" },
+    { "    s_branch xxxx - 0x8\nxxxx:\n", 0xbf82fffeU, 0, false, true, "" },
+    { "    s_branch xxxx\nxxxx=.+12\n", 0xbf820003U, 0, false, true, "" },
+    { "    s_branch xxxx\n.skip 0x40000\nxxxx:\n", 0, 0, false, false,
+        "test.s:1:14: Error: Jump out of range!\n" },
+    { "    s_branch xxxx+8\n", 0, 0, false, false,
+        "test.s:1:14: Error: Unresolved symbol 'xxxx'\n" },
+    { "    s_branch xxxx+8\nxxxx=%s[2:3]\n", 0, 0, false, false,
+        "test.s:1:14: Error: Expression have register symbol\n"
+        "test.s:2:1: Error: Register range symbol 'xxxx' was used in some expressions\n"
+        "test.s:1:14: Error: Unresolved symbol 'xxxx'\n" },
     { "    s_cbranch_scc0  xxxx-8\nxxxx:\n", 0xbf84fffeU, 0, false, true, "" },
     { "    s_cbranch_scc1  xxxx-8\nxxxx:\n", 0xbf85fffeU, 0, false, true, "" },
     { "    s_cbranch_vccz  xxxx-8\nxxxx:\n", 0xbf86fffeU, 0, false, true, "" },
@@ -19,6 +19,7 @@
 
 #include <CLRX/Config.h>
 #include <iostream>
+#include <cstring>
 #include <sstream>
 #include <algorithm>
 #include <CLRX/utils/Utilities.h>
@@ -268,7 +269,7 @@ static const GCNDisasmLabelCase decGCN12LabelCases[] =
 };
 
 static void testDecGCNLabels(cxuint i, const GCNDisasmLabelCase& testCase,
-                      GPUDeviceType deviceType)
+                      GPUDeviceType deviceType, cxuint threadsNum)
 {
     std::ostringstream disOss;
     AmdDisasmInput input;
@@ -276,6 +277,9 @@ static void testDecGCNLabels(cxuint i, const GCNDisasmLabelCase& testCase,
     input.is64BitMode = false;
     Disassembler disasm(&input, disOss, DISASM_FLOATLITS);
     GCNDisassembler gcnDisasm(disasm);
+    // decode every instruction in separate chunk
+    disasm.setThreadsNum(threadsNum);
+    gcnDisasm.setDecodeChunkSize(4);
     Array<uint32_t> code(testCase.words.size());
     for (size_t i = 0; i < testCase.words.size(); i++)
         code[i] = LEV(testCase.words[i]);
@@ -289,7 +293,8 @@ static void testDecGCNLabels(cxuint i, const GCNDisasmLabelCase& testCase,
     {
         std::ostringstream oss;
         oss << "FAILED for " << getGPUDeviceTypeName(deviceType) <<
-            " decGCNCase#" << i << ": size=" << (testCase.words.size()) << std::endl;
+            " decGCNCase#" << i << ": size=" << (testCase.words.size()) <<
+            ", threads=" << threadsNum << std::endl;
         oss << "\nExpected: " << testCase.expected << ", Result: " << outStr;
         throw Exception(oss.str());
     }
@@ -303,7 +308,7 @@ static const uint32_t unalignedNamedLabelCode[] =
     LEV(0xbf82fffcU)
 };
 
-static void testDecGCNNamedLabels()
+static void testDecGCNNamedLabels(cxuint threadsNum)
 {
     std::ostringstream disOss;
     AmdDisasmInput input;
@@ -311,6 +316,8 @@ static void testDecGCNNamedLabels()
     input.is64BitMode = false;
     Disassembler disasm(&input, disOss, DISASM_FLOATLITS);
     GCNDisassembler gcnDisasm(disasm);
+    disasm.setThreadsNum(threadsNum);
+    gcnDisasm.setDecodeChunkSize(4);
     gcnDisasm.setInput(sizeof(unalignedNamedLabelCode),
                    reinterpret_cast<const cxbyte*>(unalignedNamedLabelCode));
     gcnDisasm.addNamedLabel(1, "buru");
@@ -331,7 +338,8 @@ static void testDecGCNNamedLabels()
         "        v_sub_f32       v154, 0x11110000 /* 1.14384831e-28f */, v107\n"
         "        s_lshr_b32      s21, s2, s61\n"
         "        s_branch        nextInstr\n")
-        throw Exception("FAILED namedLabelsTest: result: "+disOss.str());
+        throw Exception("FAILED namedLabelsTest: threads="+std::to_string(threadsNum)+
+                ", result: "+disOss.str());
 }
 
 static const uint32_t relocationCode[] =
@@ -411,7 +419,7 @@ static const Relocation relocationData[] =
     { 144+44, 17, RELTYPE_VALUE, 122 }
 };
 
-static void testDecGCNRelocations()
+static void testDecGCNRelocations(cxuint threadsNum)
 {
     std::ostringstream disOss;
     AmdDisasmInput input;
@@ -420,6 +428,8 @@ static void testDecGCNRelocations()
     Disassembler disasm(&input, disOss, DISASM_FLOATLITS);
     
     GCNDisassembler gcnDisasm(disasm);
+    disasm.setThreadsNum(threadsNum);
+    gcnDisasm.setDecodeChunkSize(4);
     gcnDisasm.setInput(sizeof(relocationCode),
                    reinterpret_cast<const cxbyte*>(relocationCode));
     
@@ -455,42 +465,238 @@ static void testDecGCNRelocations()
         "        v_madmk_f32     v154, v21, (bcaa3+122)>>32, v107\n"
         "        v_madmk_f32     v154, v21, bcaa4, v107\n"
         "        v_madmk_f32     v154, v21, bcaa5+122, v107\n")
-        throw Exception("FAILED relocationTest: result: "+disOss.str());
+        throw Exception("FAILED relocationTest: threads="+std::to_string(threadsNum)+
+                ", result: "+disOss.str());
+}
+
+static const uint32_t instrIndexCode[] =
+{
+    LEV(0xd8dc2625U), LEV(0x37000006U), // ds_read2_b32
+    LEV(0xbf82fffcU), // s_branch (before code start)
+    LEV(0xbf820002U), // s_branch
+    LEV(0xea88f7d4U), LEV(0x23f43d12U), // tbuffer_load_format_x
+    LEV(0xd25a0037U), LEV(0x4002b41bU), // v_cvt_pknorm_i16_f32 (VOP3)
+    LEV(0x0934d6ffU), LEV(0x11110000U), // v_sub_f32 with literal
+    LEV(0U)
+};
+
+struct InstrIndexEntry
+{
+    uint32_t offset;
+    cxbyte encoding;
+    uint16_t opcode;
+    cxbyte size;
+    cxbyte flags;
+    uint32_t branchTarget;
+    size_t absBranchTarget;
+};
+
+static const InstrIndexEntry instrIndexEntries[] =
+{
+    { 0, GCNENC_DS, 55, 8, 0, UINT32_MAX, SIZE_MAX },
+    { 8, GCNENC_SOPP, 2, 4, GCNINSTR_BRANCH, uint32_t(-4), 12 },
+    { 12, GCNENC_SOPP, 2, 4, GCNINSTR_BRANCH, 24, 40 },
+    { 16, GCNENC_MTBUF, 0, 8, 0, UINT32_MAX, SIZE_MAX },
+    { 24, GCNENC_VOP3A, 301, 8, 0, UINT32_MAX, SIZE_MAX },
+    { 32, GCNENC_VOP2, 4, 8, GCNINSTR_LITERAL, UINT32_MAX, SIZE_MAX },
+    { 40, GCNENC_VOP2, 0, 4, 0, UINT32_MAX, SIZE_MAX }
+};
+
+static void testDecGCNInstrIndex()
+{
+    std::ostringstream disOss;
+    AmdDisasmInput input;
+    input.deviceType = GPUDeviceType::PITCAIRN;
+    input.is64BitMode = false;
+    Disassembler disasm(&input, disOss, DISASM_FLOATLITS);
+    GCNDisassembler gcnDisasm(disasm);
+    gcnDisasm.setInput(sizeof(instrIndexCode),
+                   reinterpret_cast<const cxbyte*>(instrIndexCode), 16);
+    gcnDisasm.beforeDisassemble();
+    const GCNInstrIndex& index = gcnDisasm.getInstrIndex();
+    const size_t entriesNum = sizeof(instrIndexEntries)/sizeof(InstrIndexEntry);
+    if (index.startOffset != 16 || index.size() != entriesNum ||
+        index.encodings.size() != entriesNum || index.opcodes.size() != entriesNum || index.sizes.size() != entriesNum ||
+        index.flags.size() != entriesNum || index.branchTargets.size() != entriesNum)
+        throw Exception("FAILED instrIndexTest: wrong index size");
+    for (size_t i = 0; i < entriesNum; i++)
+    {
+        const InstrIndexEntry& entry = instrIndexEntries[i];
+        if (index.offsets[i] != entry.offset || index.encodings[i] != entry.encoding ||
+            index.opcodes[i] != entry.opcode || index.sizes[i] != entry.size ||
+            index.flags[i] != entry.flags || index.branchTargets[i] != entry.branchTarget ||
+            index.getOffset(i) != 16+entry.offset ||
+            index.getBranchTarget(i) != entry.absBranchTarget)
+            throw Exception("FAILED instrIndexTest: entry#"+std::to_string(i));
+    }
+    // labels from index
+    if (gcnDisasm.getLabels() != std::vector<size_t>{ 12, 40 })
+        throw Exception("FAILED instrIndexTest: labels");
+    gcnDisasm.disassemble();
+    
+    // decoding in chunks (code with start offset) must give same output
+    std::ostringstream chunkDisOss;
+    Disassembler chunkDisasm(&input, chunkDisOss, DISASM_FLOATLITS);
+    GCNDisassembler chunkGCNDisasm(chunkDisasm);
+    chunkDisasm.setThreadsNum(3);
+    chunkGCNDisasm.setDecodeChunkSize(4);
+    chunkGCNDisasm.setInput(sizeof(instrIndexCode),
+                   reinterpret_cast<const cxbyte*>(instrIndexCode), 16);
+    chunkGCNDisasm.beforeDisassemble();
+    chunkGCNDisasm.disassemble();
+    if (chunkDisOss.str() != disOss.str())
+        throw Exception("FAILED instrIndexTest: chunks, result: "+chunkDisOss.str());
+}
+
+static const uint32_t instrRecordCode[] =
+{
+    0x8005ff02U, 0x00004567U, // s_add_u32 s5, s2, 0x4567
+    0xbf840000U,    // s_cbranch_scc0 .L1
+    0xd2060903U, 0x28000b01U,   // v_add_f32 v3, -abs(v1), s5 mul:2 clamp
+    0xc0820308U,    // s_load_dwordx4 s[4:7], s[2:3], 0x8
+    // buffer_load_dword v2, v[4:5], s[8:11], s3 offset:12 glc slc addr64
+    0xe030c00cU, 0x03420204U,
+    0xd8380804U, 0x00030201U,   // ds_write2_b32 v1, v2, v3 offset0:4 offset1:8
+    0x7e0202f2U,    // v_mov_b32 v1, 1.0
+    0x50020702U     // v_addc_u32 v1, vcc, v2, v3, vcc
+};
+
+struct InstrRecordEntry
+{
+    size_t offset;
+    const char* mnemonic;
+    cxbyte encoding;
+    cxbyte operandsNum;
+    GCNOperand operands[5];
+    uint32_t flags;
+    uint32_t memOffset;
+    cxbyte omod;
+    size_t branchTarget;
+};
+
+static const InstrRecordEntry instrRecordEntries[] =
+{
+    { 0, "s_add_u32", GCNENC_SOP2, 3,
+        { { GCNOP_REG, 1, 0, 5, 0 }, { GCNOP_REG, 1, 0, 2, 0 },
+          { GCNOP_LITERAL, 1, 0, 255, 0x4567 } }, 0, 0, 0, SIZE_MAX },
+    { 8, "s_cbranch_scc0", GCNENC_SOPP, 1, { { GCNOP_IMM, 0, 0, 0, 0 } },
+        0, 0, 0, 12 },
+    { 12, "v_add_f32", GCNENC_VOP3A, 3,
+        { { GCNOP_REG, 1, 0, 259, 0 }, { GCNOP_REG, 1, GCNOPMOD_ABS|GCNOPMOD_NEG, 257, 0 },
+          { GCNOP_REG, 1, 0, 5, 0 } }, GCNREC_CLAMP, 0, 1, SIZE_MAX },
+    { 20, "s_load_dwordx4", GCNENC_SMRD, 3,
+        { { GCNOP_REG, 4, 0, 4, 0 }, { GCNOP_REG, 2, 0, 2, 0 },
+          { GCNOP_IMM, 0, 0, 0, 8 } }, 0, 0, 0, SIZE_MAX },
+    { 24, "buffer_load_dword", GCNENC_MUBUF, 4,
+        { { GCNOP_REG, 1, 0, 258, 0 }, { GCNOP_REG, 2, 0, 260, 0 },
+          { GCNOP_REG, 4, 0, 8, 0 }, { GCNOP_REG, 1, 0, 3, 0 } },
+        GCNREC_GLC|GCNREC_SLC|GCNREC_ADDR64, 12, 0, SIZE_MAX },
+    { 32, "ds_write2_b32", GCNENC_DS, 3,
+        { { GCNOP_REG, 1, 0, 257, 0 }, { GCNOP_REG, 1, 0, 258, 0 },
+          { GCNOP_REG, 1, 0, 259, 0 } }, 0, 0x804, 0, SIZE_MAX },
+    { 40, "v_mov_b32", GCNENC_VOP1, 2,
+        { { GCNOP_REG, 1, 0, 257, 0 }, { GCNOP_INLINE, 1, 0, 242, 0 } },
+        0, 0, 0, SIZE_MAX },
+    { 44, "v_addc_u32", GCNENC_VOP2, 5,
+        { { GCNOP_REG, 1, 0, 257, 0 }, { GCNOP_REG, 2, 0, 106, 0 },
+          { GCNOP_REG, 1, 0, 258, 0 }, { GCNOP_REG, 1, 0, 259, 0 },
+          { GCNOP_REG, 2, 0, 106, 0 } }, 0, 0, 0, SIZE_MAX }
+};
+
+static void testDecGCNInstrRecords()
+{
+    std::ostringstream disOss;
+    AmdDisasmInput input;
+    input.deviceType = GPUDeviceType::PITCAIRN;
+    input.is64BitMode = false;
+    Disassembler disasm(&input, disOss, 0);
+    GCNDisassembler gcnDisasm(disasm);
+    gcnDisasm.setInput(sizeof(instrRecordCode),
+                   reinterpret_cast<const cxbyte*>(instrRecordCode));
+    std::vector<GCNInstrRecord> records;
+    gcnDisasm.decodeInstrs([&records](const GCNInstrRecord& record)
+            { records.push_back(record); });
+    const size_t entriesNum = sizeof(instrRecordEntries)/sizeof(InstrRecordEntry);
+    if (records.size() != entriesNum)
+        throw Exception("FAILED instrRecordTest: wrong records number");
+    for (size_t i = 0; i < entriesNum; i++)
+    {
+        const InstrRecordEntry& entry = instrRecordEntries[i];
+        const GCNInstrRecord& record = records[i];
+        const std::string caseName = "FAILED instrRecordTest: record#"+std::to_string(i);
+        if (record.offset != entry.offset || record.mnemonic == nullptr ||
+            ::strcmp(record.mnemonic, entry.mnemonic) != 0 ||
+            record.encoding != entry.encoding ||
+            record.operandsNum != entry.operandsNum || record.flags != entry.flags ||
+            record.memOffset != entry.memOffset || record.omod != entry.omod ||
+            record.branchTarget != entry.branchTarget)
+            throw Exception(caseName);
+        for (cxuint k = 0; k < entry.operandsNum; k++)
+        {
+            const GCNOperand& op = record.operands[k];
+            const GCNOperand& expOp = entry.operands[k];
+            if (op.kind != expOp.kind || op.regsNum != expOp.regsNum ||
+                op.modifiers != expOp.modifiers || op.code != expOp.code ||
+                op.value != expOp.value)
+                throw Exception(caseName+", operand#"+std::to_string(k));
+        }
+    }
 }
 
 int main(int argc, const char** argv)
 {
     int retVal = 0;
     for (cxuint i = 0; i < sizeof(decGCNLabelCases)/sizeof(GCNDisasmLabelCase); i++)
-        try
-        { testDecGCNLabels(i, decGCNLabelCases[i], GPUDeviceType::PITCAIRN); }
-        catch(const std::exception& ex)
-        {
-            std::cerr << ex.what() << std::endl;
-            retVal = 1;
-        }
+        for (cxuint threadsNum: { 1U, 3U })
+            try
+            { testDecGCNLabels(i, decGCNLabelCases[i], GPUDeviceType::PITCAIRN,
+                        threadsNum); }
+            catch(const std::exception& ex)
+            {
+                std::cerr << ex.what() << std::endl;
+                retVal = 1;
+            }
     for (cxuint i = 0; i < sizeof(decGCN11LabelCases)/sizeof(GCNDisasmLabelCase); i++)
+        for (cxuint threadsNum: { 1U, 3U })
+            try
+            { testDecGCNLabels(i, decGCN11LabelCases[i], GPUDeviceType::HAWAII,
+                        threadsNum); }
+            catch(const std::exception& ex)
+            {
+                std::cerr << ex.what() << std::endl;
+                retVal = 1;
+            }
+    for (cxuint i = 0; i < sizeof(decGCN12LabelCases)/sizeof(GCNDisasmLabelCase); i++)
+        for (cxuint threadsNum: { 1U, 3U })
+            try
+            { testDecGCNLabels(i, decGCN12LabelCases[i], GPUDeviceType::TONGA,
+                        threadsNum); }
+            catch(const std::exception& ex)
+            {
+                std::cerr << ex.what() << std::endl;
+                retVal = 1;
+            }
+    
+    for (cxuint threadsNum: { 1U, 3U })
         try
-        { testDecGCNLabels(i, decGCN11LabelCases[i], GPUDeviceType::HAWAII); }
-        catch(const std::exception& ex)
         {
-            std::cerr << ex.what() << std::endl;
-            retVal = 1;
+            testDecGCNNamedLabels(threadsNum);
+            testDecGCNRelocations(threadsNum);
         }
-    for (cxuint i = 0; i < sizeof(decGCN12LabelCases)/sizeof(GCNDisasmLabelCase); i++)
-        try
-        { testDecGCNLabels(i, decGCN12LabelCases[i], GPUDeviceType::TONGA); }
         catch(const std::exception& ex)
         {
             std::cerr << ex.what() << std::endl;
             retVal = 1;
         }
-    
     try
+    { testDecGCNInstrIndex(); }
+    catch(const std::exception& ex)
     {
-        testDecGCNNamedLabels();
-        testDecGCNRelocations();
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
     }
+    try
+    { testDecGCNInstrRecords(); }
     catch(const std::exception& ex)
     {
         std::cerr << ex.what() << std::endl;
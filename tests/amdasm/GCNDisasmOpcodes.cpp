@@ -20,9 +20,13 @@
 #include <CLRX/Config.h>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/amdasm/Disassembler.h>
 #include <CLRX/utils/MemAccess.h>
+#include "../TestUtils.h"
 #include "GCNDisasmOpc.h"
 
 using namespace CLRX;
@@ -53,32 +57,330 @@ static void testDecGCNOpcodes(cxuint i, const GCNDisasmOpcodeCase& testCase,
     }
 }
 
-int main(int argc, const char** argv)
+/*
+ * cross-checking instruction records (GCNDisassembler::decodeInstr) with text
+ * from disassembler. every operand, flag and modifier from record must be
+ * in expected text and vice versa
+ */
+
+static const char* gcnFloatOperandsTbl[] =
+{ "0.5", "-0.5", "1.0", "-1.0", "2.0", "-2.0", "4.0", "-4.0" };
+
+static const char* mtbufDFMTNamesTbl[] =
 {
-    int retVal = 0;
-    for (cxuint i = 0; decGCNOpcodeCases[i].expected!=nullptr; i++)
-        try
-        { testDecGCNOpcodes(i, decGCNOpcodeCases[i], GPUDeviceType::PITCAIRN); }
-        catch(const std::exception& ex)
+    "invalid", "8", "16", "8_8", "32", "16_16", "10_11_11", "11_11_10",
+    "10_10_10_2", "2_10_10_10", "8_8_8_8", "32_32", "16_16_16_16", "32_32_32",
+    "32_32_32_32", "reserved"
+};
+
+static const char* mtbufNFMTNamesTbl[] =
+{ "unorm", "snorm", "uscaled", "sscaled", "uint", "sint", "snorm_ogl", "float" };
+
+static std::string regRangeName(const char* prefix, cxuint first, cxuint regsNum,
+            cxuint regsMask = 0xffff)
+{
+    std::ostringstream oss;
+    oss << prefix;
+    if (regsNum == 1)
+        oss << first;
+    else
+        oss << '[' << first << ':' << ((first+regsNum-1)&regsMask) << ']';
+    return oss.str();
+}
+
+/* format operand as disassembler prints it. returns empty string if operand
+ * has not fixed textual form (immediates except SMRD/SMEM) or is illegal */
+static std::string formatGCNRecOperand(const GCNOperand& operand, cxbyte encoding,
+            GPUArchitecture arch)
+{
+    const bool isGCN11 = (arch == GPUArchitecture::GCN1_1);
+    const bool isGCN12 = (arch == GPUArchitecture::GCN1_2);
+    std::string out;
+    const cxuint code = operand.code;
+    switch(operand.kind)
+    {
+        case GCNOP_NONE:
+            return "off";
+        case GCNOP_IMM:
+            if (encoding != GCNENC_SMRD)
+                return "";
+            // SMRD/SMEM offset and immediate data are printed in hexadecimal
+        case GCNOP_LITERAL:
         {
-            std::cerr << ex.what() << std::endl;
-            retVal = 1;
+            std::ostringstream oss;
+            oss << "0x" << std::hex << operand.value;
+            out = oss.str();
+            break;
+        }
+        case GCNOP_INLINE:
+            if (code >= 128 && code <= 192)
+                out = std::to_string(code-128);
+            else if (code > 192 && code <= 208)
+                out = std::to_string(192-int(code));
+            else if (code >= 240 && code < 248)
+                out = gcnFloatOperandsTbl[code-240];
+            else if (code == 248 && isGCN12)
+                out = "0.15915494";
+            else
+                return ""; // illegal
+            break;
+        case GCNOP_REG:
+        {
+            const cxuint code2 = code&~1U;
+            if (code >= 256)
+                out = regRangeName("v", code-256, operand.regsNum, 0xff);
+            else if ((!isGCN12 && code < 104) || (isGCN12 && code < 102))
+                out = regRangeName("s", code, operand.regsNum);
+            else if (code2 == 106 || code2 == 108 || code2 == 110 || code2 == 126 ||
+                (code2 == 104 && isGCN11) || ((code2 == 102 || code2 == 104) && isGCN12))
+            {
+                out = (code2 == 102 || (code2 == 104 && isGCN11)) ? "flat_scratch" :
+                    (code2 == 104) ? "xnack_mask" : (code2 == 106) ? "vcc" :
+                    (code2 == 108) ? "tba" : (code2 == 110) ? "tma" : "exec";
+                if (operand.regsNum == 1)
+                    out += (code&1) ? "_hi" : "_lo";
+                else if (operand.regsNum != 2 || (code&1) != 0)
+                    return ""; // illegal
+            }
+            else if (code >= 112 && code < 124)
+                out = regRangeName("ttmp", code-112, operand.regsNum);
+            else if (code == 124 && operand.regsNum == 1)
+                out = "m0";
+            else if (code == 251)
+                out = "vccz";
+            else if (code == 252)
+                out = "execz";
+            else if (code == 253)
+                out = "scc";
+            else if (code == 254)
+                out = "lds";
+            else
+                return ""; // illegal
+            break;
+        }
+        default:
+            return "";
+    }
+    if (operand.modifiers & GCNOPMOD_ABS)
+        out = "abs(" + out + ")";
+    if (operand.modifiers & GCNOPMOD_NEG)
+        out = "-" + out;
+    if (operand.modifiers & GCNOPMOD_SEXT)
+        out = "sext(" + out + ")";
+    return out;
+}
+
+static bool hasToken(const std::vector<std::string>& tokens, const char* token)
+{
+    for (const std::string& t: tokens)
+        if (t == token)
+            return true;
+    return false;
+}
+
+// get value of token 'name:value' (returns false if not found)
+static bool getTokenValue(const std::vector<std::string>& tokens, const char* name,
+            std::string& value)
+{
+    const size_t nameLen = ::strlen(name);
+    for (const std::string& t: tokens)
+        if (t.compare(0, nameLen, name) == 0)
+        {
+            value = t.substr(nameLen);
+            return true;
+        }
+    return false;
+}
+
+static void testDecGCNRecords(cxuint i, const GCNDisasmOpcodeCase& testCase,
+                      GPUDeviceType deviceType)
+{
+    std::ostringstream disOss;
+    AmdDisasmInput input;
+    input.deviceType = deviceType;
+    input.is64BitMode = false;
+    Disassembler disasm(&input, disOss, DISASM_FLOATLITS);
+    GCNDisassembler gcnDisasm(disasm);
+    uint32_t inputCode[2] = { LEV(testCase.word0), LEV(testCase.word1) };
+    gcnDisasm.setInput(testCase.twoWords?8:4, reinterpret_cast<cxbyte*>(inputCode));
+    std::vector<GCNInstrRecord> records;
+    gcnDisasm.decodeInstrs([&records](const GCNInstrRecord& record)
+            { records.push_back(record); });
+    
+    const GPUArchitecture arch = getGPUArchitectureFromDeviceType(deviceType);
+    std::ostringstream caseOss;
+    caseOss << "decGCNRecord " << getGPUDeviceTypeName(deviceType) << " #" << i <<
+            ": word0=0x" << std::hex << testCase.word0 << std::dec;
+    if (testCase.twoWords)
+        caseOss << ", word1=0x" << std::hex << testCase.word1 << std::dec;
+    const std::string testName = caseOss.str();
+    assertTrue(testName, "recordsNum", !records.empty());
+    const GCNInstrRecord& record = records[0];
+    
+    // tokens of first line of expected text (commas are separators)
+    const char* lineEnd = ::strchr(testCase.expected, '\n');
+    std::string line(testCase.expected, lineEnd != nullptr ? lineEnd :
+                testCase.expected + ::strlen(testCase.expected));
+    const bool singleLine = (lineEnd == nullptr || lineEnd[1] == 0);
+    for (char& c: line)
+        if (c == ',')
+            c = ' ';
+    std::vector<std::string> tokens;
+    {
+        std::istringstream lineIss(line);
+        std::string token;
+        while (lineIss >> token)
+            tokens.push_back(token);
+    }
+    assertTrue(testName, "tokens", !tokens.empty());
+    
+    if (tokens[0] == ".int" || tokens[0].find("_ill_") != std::string::npos)
+    {   // illegal instruction
+        assertTrue(testName, "illegal", record.mnemonic == nullptr);
+        return;
+    }
+    assertTrue(testName, "legal", record.mnemonic != nullptr);
+    assertString(testName, "mnemonic", tokens[0].c_str(), record.mnemonic);
+    if (singleLine)
+        assertValue(testName, "size", cxuint(testCase.twoWords ? 8 : 4),
+                    cxuint(record.size));
+    
+    // operands must be in order of text
+    size_t tokenPos = 1;
+    for (cxuint k = 0; k < record.operandsNum; k++)
+    {
+        const GCNOperand& operand = record.operands[k];
+        const std::string opStr = formatGCNRecOperand(operand, record.encoding, arch);
+        if (opStr.empty())
+            continue;
+        std::string litStr;
+        if (operand.kind == GCNOP_LITERAL && int32_t(operand.value) <= 64 &&
+            int32_t(operand.value) >= -16)
+            litStr = "lit(" + std::to_string(int32_t(operand.value)) + ")";
+        for (; tokenPos < tokens.size(); tokenPos++)
+            if (tokens[tokenPos] == opStr || (!litStr.empty() && tokens[tokenPos] == litStr))
+                break;
+        assertTrue(testName, ("operand#" + std::to_string(k) + " '" + opStr + "'").c_str(),
+                   tokenPos < tokens.size());
+        tokenPos++;
+    }
+    
+    // flags
+    static const std::pair<uint32_t, const char*> flagNamesTbl[] =
+    {
+        { GCNREC_GLC, "glc" }, { GCNREC_SLC, "slc" }, { GCNREC_TFE, "tfe" },
+        { GCNREC_GDS, "gds" }, { GCNREC_OFFEN, "offen" }, { GCNREC_IDXEN, "idxen" },
+        { GCNREC_ADDR64, "addr64" }, { GCNREC_CLAMP, "clamp" }, { GCNREC_UNORM, "unorm" },
+        { GCNREC_R128, "r128" }, { GCNREC_LWE, "lwe" }, { GCNREC_DA, "da" },
+        { GCNREC_D16, "d16" }, { GCNREC_DONE, "done" }, { GCNREC_COMPR, "compr" },
+        { GCNREC_VM, "vm" }, { GCNREC_HIGH, "high" }
+    };
+    for (const auto& entry: flagNamesTbl)
+        assertTrue(testName, (std::string("flag ")+entry.second).c_str(),
+                   ((record.flags & entry.first) != 0) == hasToken(tokens, entry.second));
+    if (record.encoding == GCNENC_MUBUF)
+        assertTrue(testName, "flag lds",
+                   ((record.flags & GCNREC_LDS) != 0) == hasToken(tokens, "lds"));
+    else
+        assertTrue(testName, "flag lds", (record.flags & GCNREC_LDS) == 0);
+    
+    // SDWA and DPP word
+    if ((record.flags & (GCNREC_SDWA|GCNREC_DPP)) != 0)
+        assertValue(testName, "extra", testCase.word1, record.extra);
+    std::string value;
+    assertTrue(testName, "dpp", ((record.flags & GCNREC_DPP) != 0) ==
+                getTokenValue(tokens, "bank_mask:", value));
+    
+    // memory offset
+    if (record.encoding == GCNENC_DS || record.encoding == GCNENC_MUBUF ||
+        record.encoding == GCNENC_MTBUF)
+    {
+        uint32_t textOffset = 0;
+        if (getTokenValue(tokens, "offset:", value))
+            textOffset = std::stoul(value);
+        if (getTokenValue(tokens, "offset0:", value))
+            textOffset |= std::stoul(value);
+        if (getTokenValue(tokens, "offset1:", value))
+            textOffset |= std::stoul(value)<<8;
+        assertValue(testName, "memOffset", textOffset, record.memOffset);
+    }
+    // output modifier
+    cxuint textOmod = 0;
+    if (hasToken(tokens, "mul:2"))
+        textOmod = 1;
+    else if (hasToken(tokens, "mul:4"))
+        textOmod = 2;
+    else if (hasToken(tokens, "div:2"))
+        textOmod = 3;
+    assertValue(testName, "omod", textOmod, cxuint(record.omod));
+    // MIMG dmask
+    if (record.encoding == GCNENC_MIMG)
+    {
+        cxuint textDmask = 1;
+        if (getTokenValue(tokens, "dmask:", value))
+            textDmask = std::stoul(value, nullptr, 0);
+        assertValue(testName, "dmask", textDmask, cxuint(record.dmask));
+    }
+    // MTBUF format
+    if (record.encoding == GCNENC_MTBUF)
+    {
+        std::string format;
+        if (record.dfmt != 1 || record.nfmt != 0)
+        {
+            format = "[";
+            if (record.dfmt != 1)
+                format += mtbufDFMTNamesTbl[record.dfmt];
+            if (record.dfmt != 1 && record.nfmt != 0)
+                format += ' '; // commas are replaced by spaces
+            if (record.nfmt != 0)
+                format += mtbufNFMTNamesTbl[record.nfmt];
+            format += "]";
         }
-    for (cxuint i = 0; decGCNOpcodeGCN11Cases[i].expected!=nullptr; i++)
+        // format is split into two tokens if it has two fields
+        std::string textFormat;
+        for (size_t t = 0; t < tokens.size(); t++)
+            if (tokens[t].compare(0, 7, "format:") == 0)
+            {
+                textFormat = tokens[t].substr(7);
+                if (textFormat.back() != ']' && t+1 < tokens.size())
+                    textFormat += " " + tokens[t+1];
+                break;
+            }
+        assertString(testName, "format", format.c_str(), textFormat);
+    }
+    // branch target
+    if (record.branchTarget != SIZE_MAX)
+        assertTrue(testName, "branchTarget", hasToken(tokens,
+                (".L" + std::to_string(record.branchTarget) + "_0").c_str()));
+}
+
+static void testDecGCNOpcodeCases(const GCNDisasmOpcodeCase* testCases,
+            GPUDeviceType deviceType, int& retVal)
+{
+    for (cxuint i = 0; testCases[i].expected!=nullptr; i++)
+    {
         try
-        { testDecGCNOpcodes(i, decGCNOpcodeGCN11Cases[i], GPUDeviceType::HAWAII); }
+        { testDecGCNOpcodes(i, testCases[i], deviceType); }
         catch(const std::exception& ex)
         {
             std::cerr << ex.what() << std::endl;
             retVal = 1;
         }
-    for (cxuint i = 0; decGCNOpcodeGCN12Cases[i].expected!=nullptr; i++)
         try
-        { testDecGCNOpcodes(i, decGCNOpcodeGCN12Cases[i], GPUDeviceType::TONGA); }
+        { testDecGCNRecords(i, testCases[i], deviceType); }
         catch(const std::exception& ex)
         {
             std::cerr << ex.what() << std::endl;
             retVal = 1;
         }
+    }
+}
+
+int main(int argc, const char** argv)
+{
+    int retVal = 0;
+    testDecGCNOpcodeCases(decGCNOpcodeCases, GPUDeviceType::PITCAIRN, retVal);
+    testDecGCNOpcodeCases(decGCNOpcodeGCN11Cases, GPUDeviceType::HAWAII, retVal);
+    testDecGCNOpcodeCases(decGCNOpcodeGCN12Cases, GPUDeviceType::TONGA, retVal);
     return retVal;
 }
@@ -687,25 +687,30 @@ static void testOrigBinary(cxuint testCase, const char* origBinaryFilename, bool
     
     amdCL2Input = genAmdCL2Input(reconf, amdCL2GpuBin, false, false);
     
-    AmdCL2GPUBinGenerator binGen(&amdCL2Input);
-    binGen.generate(output);
-    
-    if (output.size() != inputData.size())
+    // output must be same if kernel's binaries are generated by threads
+    for (cxuint threadsNum: { 1U, 3U })
     {
-        std::ostringstream oss;
-        oss << "Failed for #" << testCase << " file=" << origBinaryFilename <<
-                ": expectedSize=" << inputData.size() <<
-                ", resultSize=" << output.size();
-        throw Exception(oss.str());
-    }
-    for (size_t i = 0; i < inputData.size(); i++)
-        if (output[i] != inputData[i])
+        AmdCL2GPUBinGenerator binGen(&amdCL2Input);
+        binGen.setThreadsNum(threadsNum);
+        binGen.generate(output);
+        
+        if (output.size() != inputData.size())
         {
             std::ostringstream oss;
             oss << "Failed for #" << testCase << " file=" << origBinaryFilename <<
-                    ": byte=" << i;
+                    " threads=" << threadsNum << ": expectedSize=" <<
+                    inputData.size() << ", resultSize=" << output.size();
             throw Exception(oss.str());
         }
+        for (size_t i = 0; i < inputData.size(); i++)
+            if (output[i] != inputData[i])
+            {
+                std::ostringstream oss;
+                oss << "Failed for #" << testCase << " file=" << origBinaryFilename <<
+                        " threads=" << threadsNum << ": byte=" << i;
+                throw Exception(oss.str());
+            }
+    }
 }
 
 int main(int argc, const char** argv)
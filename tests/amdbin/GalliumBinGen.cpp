@@ -20,6 +20,7 @@
 #include <CLRX/Config.h>
 #include <iostream>
 #include <sstream>
+#include <cstring>
 #include <memory>
 #include <CLRX/utils/Containers.h>
 #include <CLRX/amdbin/GalliumBinaries.h>
@@ -128,6 +129,18 @@ static void testOrigBinary(cxuint testCase, const char* origBinaryFilename)
                     ": byte=" << i;
             throw Exception(oss.str());
         }
+    // generate to output stream
+    std::ostringstream outStream;
+    binGen.generate(outStream);
+    const std::string outStr = outStream.str();
+    if (outStr.size() != inputData.size() ||
+        ::memcmp(outStr.data(), inputData.data(), inputData.size()) != 0)
+    {
+        std::ostringstream oss;
+        oss << "Failed for #" << testCase << " file=" << origBinaryFilename <<
+                ": stream output differs";
+        throw Exception(oss.str());
+    }
 }
 
 int main(int argc, const char** argv)
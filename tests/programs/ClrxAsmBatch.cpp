@@ -0,0 +1,204 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2016 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include "../TestUtils.h"
+
+using namespace CLRX;
+
+struct BatchFile
+{
+    const char* name;
+    std::string content;
+};
+
+struct BatchTestCase
+{
+    std::vector<BatchFile> inputs;  // sources and files existing before run
+    const char* manifest;
+    cxuint jobsNum;
+    bool good;
+    std::vector<BatchFile> outputs; // expected files after run
+    const char* messages;   // expected standard error output
+};
+
+static const BatchTestCase batchTestCases[] =
+{
+    {   /* 0 - all jobs succeeded */
+        { { "bt0a.s", ".byte 1,2,3\n" }, { "bt0b.s", ".byte 4,5\n" } },
+        "bt0a.s -b rawcode -o bt0a.bin\n"
+        "# comment line\n"
+        "\n"
+        "-b rawcode -o 'bt0b.bin' bt0b.s  # comment\n",
+        2, true,
+        { { "bt0a.bin", "\1\2\3" }, { "bt0b.bin", "\4\5" } },
+        ""
+    },
+    {   /* 1 - second job failed, previous output of failed job is kept */
+        { { "bt1a.s", ".byte 1,2,3\n" },
+          { "bt1b.s", ".byte 4,5\n.error \"bad\"\n" },
+          { "bt1c.s", ".warning \"www\"\n.byte 6\n" },
+          { "bt1b.bin", "old" } },
+        "bt1a.s -b rawcode -o bt1a.bin\n"
+        "-b rawcode -o bt1b.bin bt1b.s\n"
+        "-b rawcode -o bt1c.bin bt1c.s\n",
+        3, false,
+        { { "bt1a.bin", "\1\2\3" }, { "bt1b.bin", "old" }, { "bt1c.bin", "\6" } },
+        "bt1b.s:2:1: Error: bad\n"
+        "bt1.txt:2: Batch job failed\n"
+        "bt1c.s:1:1: Warning: www\n"
+    },
+    {   /* 2 - errors of jobs are printed in manifest order */
+        { { "bt2a.s", ".error \"first\"\n" },
+          { "bt2b.s", ".byte 7\n" },
+          { "bt2c.s", ".error \"third\"\n" } },
+        "-b rawcode -o bt2a.bin bt2a.s\n"
+        "-b rawcode -o bt2b.bin bt2b.s\n"
+        "-b rawcode -o bt2c.bin bt2c.s\n",
+        1, false,
+        { { "bt2b.bin", "\7" } },
+        "bt2a.s:1:1: Error: first\n"
+        "bt2.txt:1: Batch job failed\n"
+        "bt2c.s:1:1: Error: third\n"
+        "bt2.txt:3: Batch job failed\n"
+    },
+    {   /* 3 - missing input and bad option */
+        { { "bt3b.s", ".byte 8,9\n" } },
+        "-b rawcode -o bt3a.bin bt3nofile.s\n"
+        "-b rawcode -o bt3b.bin bt3b.s\n"
+        "-b rawcode -j 2 -o bt3c.bin bt3b.s\n",
+        0, false,
+        { { "bt3b.bin", "\10\11" } },
+        "Can't open source file 'bt3nofile.s'\n"
+        "bt3.txt:1: Batch job failed\n"
+        "Batch options are not allowed in batch job\n"
+        "bt3.txt:3: Batch job failed\n"
+    }
+};
+
+static void writeFile(const char* filename, const std::string& content)
+{
+    std::ofstream ofs(filename, std::ios::binary);
+    ofs.write(content.c_str(), content.size());
+    if (!ofs)
+        throw Exception(std::string("Can't write file '")+filename+"'");
+}
+
+static bool readFile(const char* filename, std::string& content)
+{
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs)
+        return false;
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    content = oss.str();
+    return true;
+}
+
+static void testClrxAsmBatch(cxuint i, const char* clrxasmPath,
+                const BatchTestCase& testCase)
+{
+    std::ostringstream oss;
+    oss << "bt" << i;
+    const std::string prefix = oss.str();
+    const std::string testName = "clrxasmBatch#" + prefix;
+    const std::string manifestName = prefix + ".txt";
+    const std::string messagesName = prefix + ".err";
+
+    for (const BatchFile& output: testCase.outputs)
+        std::remove(output.name);
+    for (const BatchFile& input: testCase.inputs)
+        writeFile(input.name, input.content);
+    writeFile(manifestName.c_str(), testCase.manifest);
+
+    std::ostringstream cmdOss;
+    cmdOss << "\"" << clrxasmPath << "\" --batch=" << manifestName;
+    if (testCase.jobsNum != 0)
+        cmdOss << " -j " << testCase.jobsNum;
+    cmdOss << " 2>" << messagesName;
+    const int status = std::system(cmdOss.str().c_str());
+    assertTrue(testName, "exitStatus", testCase.good == (status == 0));
+
+    std::string messages;
+    assertTrue(testName, "messagesRead", readFile(messagesName.c_str(), messages));
+    assertString(testName, "messages", testCase.messages, messages);
+    for (const BatchFile& output: testCase.outputs)
+    {
+        std::string content;
+        assertTrue(testName, std::string("exists.")+output.name,
+                   readFile(output.name, content));
+        assertString(testName, std::string("content.")+output.name,
+                   output.content.c_str(), content);
+    }
+}
+
+/* statistics of batch job must not have memory peak of whole process,
+ * jobs number must not be given without batch manifest */
+static void testClrxAsmBatchOptions(const char* clrxasmPath)
+{
+    writeFile("bts.s", ".byte 1\n");
+    writeFile("bts.txt", "-b rawcode --stats=json -o bts.bin bts.s\n");
+    std::string cmd = std::string("\"") + clrxasmPath + "\" --batch=bts.txt 2>bts.err";
+    assertTrue("clrxasmBatchStats", "exitStatus", std::system(cmd.c_str()) == 0);
+    std::string messages;
+    assertTrue("clrxasmBatchStats", "messagesRead", readFile("bts.err", messages));
+    assertTrue("clrxasmBatchStats", "stats",
+            messages.find("\"exprMemoryPeak\"") != std::string::npos);
+    assertTrue("clrxasmBatchStats", "noMemoryPeak",
+            messages.find("\"memoryPeak\"") == std::string::npos);
+    
+    cmd = std::string("\"") + clrxasmPath + "\" -b rawcode -j 2 -o bts.bin bts.s 2>bts.err";
+    assertTrue("clrxasmJobsNoBatch", "exitStatus", std::system(cmd.c_str()) != 0);
+    assertTrue("clrxasmJobsNoBatch", "messagesRead", readFile("bts.err", messages));
+    assertString("clrxasmJobsNoBatch", "messages",
+            "Number of jobs can be given only with batch manifest\n", messages);
+}
+
+int main(int argc, const char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: ClrxAsmBatch CLRXASMPATH" << std::endl;
+        return 1;
+    }
+    int retVal = 0;
+    for (cxuint i = 0; i < sizeof(batchTestCases)/sizeof(BatchTestCase); i++)
+        try
+        { testClrxAsmBatch(i, argv[1], batchTestCases[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    try
+    { testClrxAsmBatchOptions(argv[1]); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    return retVal;
+}
@@ -0,0 +1,94 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2016 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <CLRX/utils/Utilities.h>
+#include "../TestUtils.h"
+
+using namespace CLRX;
+
+// strings shorter, equal and longer than inline storage
+static const char* testStrings[] =
+{
+    "", "a", "v_add_f32", "abcdefghijklmno", "abcdefghijklmnop",
+    "some_very_long_label_name_that_needs_heap"
+};
+
+static void testCStringBasic(const char* str)
+{
+    const std::string expected(str);
+    CString s1(str);
+    assertString("CString", "construct", str, s1.c_str());
+    assertValue("CString", "size", expected.size(), s1.size());
+    assertTrue("CString", "empty", s1.empty() == expected.empty());
+    
+    CString s2(s1);
+    assertString("CString", "copy", str, s2.c_str());
+    CString s3(std::move(s2));
+    assertString("CString", "move", str, s3.c_str());
+    assertTrue("CString", "movedEmpty", s2.empty());
+    
+    CString s4("xyz");
+    s4 = s3;
+    assertString("CString", "copyAssign", str, s4.c_str());
+    s4 = std::move(s3);
+    assertString("CString", "moveAssign", str, s4.c_str());
+    s4 = s4;
+    assertString("CString", "selfAssign", str, s4.c_str());
+    
+    CString s5("some_other_long_string_in_heap");
+    s5.swap(s4);
+    assertString("CString", "swap1", str, s5.c_str());
+    assertString("CString", "swap2", "some_other_long_string_in_heap", s4.c_str());
+    
+    // assign part of itself
+    if (!expected.empty())
+    {
+        s5.assign(s5.c_str()+1, expected.size()-1);
+        assertString("CString", "assignPart", expected.substr(1).c_str(), s5.c_str());
+    }
+    
+    // writeable buffer
+    CString s6(expected.size());
+    if (!expected.empty())
+    {
+        std::copy(expected.begin(), expected.end(), s6.begin());
+        assertString("CString", "buffer", str, s6.c_str());
+    }
+    assertTrue("CString", "compare", s6 == s1);
+    assertValue("CString", "hash", std::hash<CString>()(CString(str)),
+                std::hash<CString>()(s1));
+}
+
+int main(int argc, const char** argv)
+{
+    int retVal = 0;
+    for (const char* str: testStrings)
+        try
+        { testCStringBasic(str); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << "For '" << str << "': " << ex.what() << std::endl;
+            retVal = 1;
+        }
+    return retVal;
+}
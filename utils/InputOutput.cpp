@@ -18,9 +18,19 @@
  */
 
 #include <CLRX/Config.h>
+#ifdef HAVE_WINDOWS
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cerrno>
 #include <algorithm>
 #include <cstring>
 #include <climits>
+#include <cstdint>
 #include <string>
 #include <istream>
 #include <ostream>
@@ -290,3 +300,145 @@ VectorIOStream::VectorIOStream(std::vector<char>& vector)
 {
     rdbuf(&buffer);
 }
+
+/*
+ * MappedFile
+ */
+
+bool MappedFile::isMappable(const char* filename)
+{
+    struct stat stBuf;
+    if (::stat(filename, &stBuf) != 0)
+        return false;
+#ifdef HAVE_WINDOWS
+    return (_S_IFREG&stBuf.st_mode)!=0;
+#else
+    return S_ISREG(stBuf.st_mode);
+#endif
+}
+
+#ifndef HAVE_WINDOWS
+static uint64_t getFileModTime(const struct stat& stBuf)
+{
+#ifdef HAVE_LINUX
+    return uint64_t(stBuf.st_mtim.tv_sec)*1000000000ULL + stBuf.st_mtim.tv_nsec;
+#else
+    return uint64_t(stBuf.st_mtime)*1000000000ULL;
+#endif
+}
+
+MappedFile::MappedFile(const char* _filename) : content(nullptr), contentSize(0),
+            filename(_filename)
+{
+    errno = 0;
+    int fd = ::open(_filename, O_RDONLY);
+    if (fd < 0)
+        throw Exception(std::string("Can't open file '")+_filename+"'");
+    struct stat stBuf;
+    if (::fstat(fd, &stBuf) != 0)
+    {
+        ::close(fd);
+        throw Exception(std::string("Can't get size of file '")+_filename+"'");
+    }
+    if (uint64_t(stBuf.st_size) > SIZE_MAX)
+    {
+        ::close(fd);
+        throw Exception("File is too big to map");
+    }
+    contentSize = stBuf.st_size;
+    fileDevice = stBuf.st_dev;
+    fileInode = stBuf.st_ino;
+    fileModTime = getFileModTime(stBuf);
+    if (contentSize != 0)
+    {
+        void* mapped = ::mmap(nullptr, contentSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            ::close(fd);
+            throw Exception(std::string("Can't map file '")+_filename+"'");
+        }
+#ifdef MADV_SEQUENTIAL
+        // mapped files are mostly read sequentially
+        ::madvise(mapped, contentSize, MADV_SEQUENTIAL);
+#endif
+        content = (const cxbyte*)mapped;
+    }
+    // mapping holds reference to file
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (content != nullptr)
+        ::munmap((void*)content, contentSize);
+}
+
+bool MappedFile::isSameFile(const char* otherName) const
+{
+    struct stat stBuf;
+    if (::stat(otherName, &stBuf) != 0)
+        return false;
+    return uint64_t(stBuf.st_dev) == fileDevice && uint64_t(stBuf.st_ino) == fileInode;
+}
+
+bool MappedFile::isChanged() const
+{
+    struct stat stBuf;
+    if (::stat(filename.c_str(), &stBuf) != 0 || uint64_t(stBuf.st_dev) != fileDevice ||
+        uint64_t(stBuf.st_ino) != fileInode)
+        return false; // removed or replaced, mapping holds old file
+    return uint64_t(stBuf.st_size) != contentSize || getFileModTime(stBuf) != fileModTime;
+}
+#else
+MappedFile::MappedFile(const char* _filename) : content(nullptr), contentSize(0),
+            filename(_filename), fileHandle(INVALID_HANDLE_VALUE), mapHandle(nullptr)
+{
+    fileHandle = CreateFileA(_filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        throw Exception(std::string("Can't open file '")+_filename+"'");
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize))
+    {
+        CloseHandle(fileHandle);
+        throw Exception(std::string("Can't get size of file '")+_filename+"'");
+    }
+    if (uint64_t(fileSize.QuadPart) > SIZE_MAX)
+    {
+        CloseHandle(fileHandle);
+        throw Exception("File is too big to map");
+    }
+    contentSize = fileSize.QuadPart;
+    if (contentSize != 0)
+    {
+        mapHandle = CreateFileMapping(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapHandle == nullptr)
+        {
+            CloseHandle(fileHandle);
+            throw Exception(std::string("Can't map file '")+_filename+"'");
+        }
+        content = (const cxbyte*)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+        if (content == nullptr)
+        {
+            CloseHandle(mapHandle);
+            CloseHandle(fileHandle);
+            throw Exception(std::string("Can't map file '")+_filename+"'");
+        }
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (content != nullptr)
+        UnmapViewOfFile(content);
+    if (mapHandle != nullptr)
+        CloseHandle(mapHandle);
+    CloseHandle(fileHandle);
+}
+
+bool MappedFile::isSameFile(const char* otherName) const
+{ return false; }
+
+bool MappedFile::isChanged() const
+{ return false; }
+#endif
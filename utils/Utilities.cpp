@@ -34,6 +34,10 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <mutex>
+#include <thread>
+#include <system_error>
+#include <algorithm>
+#include <exception>
 #include <cerrno>
 #include <cstring>
 #include <string>
@@ -541,3 +545,49 @@ void CLRX::makeDir(const char* dirname)
             throw Exception("Can't create directory");
     }
 }
+
+void CLRX::runInParallel(cxuint threadsNum, size_t itemsNum,
+            const std::function<void(size_t)>& func)
+{
+    threadsNum = std::max(1U, std::min(threadsNum, cxuint(std::min(itemsNum,
+                    size_t(UINT_MAX)))));
+    if (threadsNum <= 1)
+    {
+        for (size_t i = 0; i < itemsNum; i++)
+            func(i);
+        return;
+    }
+    // every range stops at first failed item
+    std::vector<std::exception_ptr> exceptions(threadsNum);
+    auto runRange = [&func, &exceptions](cxuint t, size_t start, size_t end)
+    {
+        try
+        {
+            for (size_t i = start; i < end; i++)
+                func(i);
+        }
+        catch(...)
+        { exceptions[t] = std::current_exception(); }
+    };
+    std::vector<std::thread> threads;
+    for (cxuint t = 0; t < threadsNum; t++)
+    {
+        const size_t start = itemsNum*t / threadsNum;
+        const size_t end = itemsNum*(t+1) / threadsNum;
+        if (t+1 < threadsNum)
+            try
+            {
+                threads.push_back(std::thread(runRange, t, start, end));
+                continue;
+            }
+            catch(const std::system_error&)
+            { }  // if thread can not be created
+        runRange(t, start, end);
+    }
+    for (std::thread& thread: threads)
+        thread.join();
+    // ranges are ordered, hence first exception is from first failed item
+    for (const std::exception_ptr& ex: exceptions)
+        if (ex)
+            std::rethrow_exception(ex);
+}